@@ -0,0 +1,199 @@
+/**
+ * Chunking and compression
+ * ========================
+ *
+ * This example shows how to set the chunk dimensions and the lossless HDF5 filters of the
+ * task datasets. The creation properties of each dataset are checked in the
+ * DatasetPrepare() hook with the HDF5 API
+ *
+ * Compilation
+ * -----------
+ *
+ *    mpicc -std=c99 -fPIC -Dpic -shared -lmechanic -lhdf5 -lhdf5_hl \
+ *        mechanic_module_ex_filters.c -o libmechanic_module_ex_filters.so
+ *
+ * Using the module
+ * ----------------
+ *
+ *    mpirun -np 4 mechanic -p ex_filters -x 10 -y 20
+ *
+ * Getting the data
+ * ----------------
+ *
+ * The creation properties (the chunk dimensions, the filters and the allocation time) are
+ * printed with:
+ *
+ *    h5dump -p -H -d/Pools/pool-0000/Tasks/result mechanic-master-00.h5
+ */
+#include "mechanic.h"
+
+#define CHUNK 16 /**< The chunk rows of the result dataset */
+#define LEVEL 4 /**< The deflate level of the result dataset */
+
+/**
+ * Implements Init()
+ */
+int Init(init *i) {
+  i->banks_per_task = 3;
+  return SUCCESS;
+}
+
+/**
+ * Implements Storage()
+ *
+ * The result dataset is shuffled and deflated, with the chunk of CHUNK rows. The plain
+ * dataset has the default chunk (the task results grouped up to CHUNK_SIZE bytes), and no
+ * filters. The shuffle of the count dataset is ignored, since the N-bit filter packs the
+ * bits of the elements first.
+ */
+int Storage(pool *p) {
+  p->task->storage[0].layout = (schema) {
+    .name = "result",
+    .rank = 2,
+    .dims[0] = 1,
+    .dims[1] = 3,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = STORAGE_PM3D,
+    .datatype = H5T_NATIVE_DOUBLE,
+    .chunk[0] = CHUNK,
+    .filters = FILTER_SHUFFLE | FILTER_DEFLATE,
+    .deflate = LEVEL
+  };
+
+  p->task->storage[1].layout = (schema) {
+    .name = "plain",
+    .rank = 2,
+    .dims[0] = 1,
+    .dims[1] = 3,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = STORAGE_PM3D,
+    .datatype = H5T_NATIVE_DOUBLE
+  };
+
+  p->task->storage[2].layout = (schema) {
+    .name = "count",
+    .rank = 2,
+    .dims[0] = 1,
+    .dims[1] = 3,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = STORAGE_PM3D,
+    .datatype = H5T_NATIVE_INT,
+    .filters = FILTER_NBIT | FILTER_SHUFFLE | FILTER_DEFLATE
+  };
+
+  return SUCCESS;
+}
+
+/**
+ * Implements TaskProcess()
+ */
+int TaskProcess(pool *p, task *t) {
+  double result[1][3];
+  int count[1][3];
+
+  result[0][0] = t->location[0];
+  result[0][1] = t->location[1];
+  result[0][2] = 0.5 * t->location[0] + 0.25 * t->location[1];
+
+  count[0][0] = t->location[0];
+  count[0][1] = t->location[1];
+  count[0][2] = t->tid;
+
+  MWriteData(t, "result", &result[0][0]);
+  MWriteData(t, "plain", &result[0][0]);
+  MWriteData(t, "count", &count[0][0]);
+
+  return TASK_FINALIZE;
+}
+
+/**
+ * Implements DatasetPrepare()
+ *
+ * The task datasets are chunked and allocated incrementally. The filters are listed in
+ * the order of the HDF5 pipeline.
+ */
+int DatasetPrepare(hid_t h5location, hid_t h5dataset, pool *p, storage *d) {
+  hid_t dcpl, dataspace;
+  hsize_t chunk[MAX_RANK], dims[MAX_RANK];
+  H5D_alloc_time_t alloc_time;
+  H5Z_filter_t filters[3], filter;
+  unsigned int flags, values[1], level = 0;
+  size_t elements;
+  int i, expected = 0, deflate;
+
+  if (strcmp(d->layout.name, "result") != 0 && strcmp(d->layout.name, "plain") != 0 &&
+      strcmp(d->layout.name, "count") != 0) return SUCCESS;
+
+  deflate = H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0;
+
+  if (strcmp(d->layout.name, "result") == 0) {
+    filters[expected++] = H5Z_FILTER_SHUFFLE;
+    if (deflate) filters[expected++] = H5Z_FILTER_DEFLATE;
+    level = LEVEL;
+  }
+
+  if (strcmp(d->layout.name, "count") == 0) {
+    filters[expected++] = H5Z_FILTER_NBIT;
+    if (deflate) filters[expected++] = H5Z_FILTER_DEFLATE;
+    level = FILTER_DEFLATE_LEVEL;
+  }
+
+  dcpl = H5Dget_create_plist(h5dataset);
+  H5CheckStatus(dcpl);
+
+  if (H5Pget_layout(dcpl) != H5D_CHUNKED) {
+    Message(MESSAGE_ERR, "The dataset '%s' is not chunked\n", d->layout.name);
+    return MODULE_ERR_HDF;
+  }
+
+  H5Pget_alloc_time(dcpl, &alloc_time);
+  if (alloc_time != H5D_ALLOC_TIME_INCR) {
+    Message(MESSAGE_ERR, "The dataset '%s' is not allocated incrementally\n", d->layout.name);
+    return MODULE_ERR_HDF;
+  }
+
+  /* The user defined chunk is limited by the dataset dimensions */
+  if (strcmp(d->layout.name, "result") == 0) {
+    dataspace = H5Dget_space(h5dataset);
+    H5Sget_simple_extent_dims(dataspace, dims, NULL);
+    H5Sclose(dataspace);
+
+    H5Pget_chunk(dcpl, MAX_RANK, chunk);
+    if (chunk[0] != (dims[0] < CHUNK ? dims[0] : CHUNK) || chunk[1] != dims[1]) {
+      Message(MESSAGE_ERR, "The chunk of the dataset '%s' is %llu x %llu\n", d->layout.name,
+          (unsigned long long) chunk[0], (unsigned long long) chunk[1]);
+      return MODULE_ERR_HDF;
+    }
+  }
+
+  if (H5Pget_nfilters(dcpl) != expected) {
+    Message(MESSAGE_ERR, "The dataset '%s' has %d filters, %d expected\n", d->layout.name,
+        H5Pget_nfilters(dcpl), expected);
+    return MODULE_ERR_HDF;
+  }
+
+  for (i = 0; i < expected; i++) {
+    elements = 1;
+    values[0] = 0;
+    filter = H5Pget_filter2(dcpl, i, &flags, &elements, values, 0, NULL, NULL);
+
+    if (filter != filters[i]) {
+      Message(MESSAGE_ERR, "The filter %d of the dataset '%s' is %d, %d expected\n",
+          i, d->layout.name, filter, filters[i]);
+      return MODULE_ERR_HDF;
+    }
+
+    if (filter == H5Z_FILTER_DEFLATE && values[0] != level) {
+      Message(MESSAGE_ERR, "The deflate level of the dataset '%s' is %u, %u expected\n",
+          d->layout.name, values[0], level);
+      return MODULE_ERR_HDF;
+    }
+  }
+
+  H5Pclose(dcpl);
+
+  return SUCCESS;
+}
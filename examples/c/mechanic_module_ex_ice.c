@@ -0,0 +1,108 @@
+/**
+ * Stopping the run (the ICE file)
+ * ===============================
+ *
+ * This example shows how to stop the run from the module. When the master node finds the
+ * `mechanic.ice` file, the current checkpoint is flushed and the run is aborted. The run
+ * may be then continued in the restart mode.
+ *
+ * Here, the ICE file is created by the master node in the CheckpointPrepare() hook, after
+ * the number of checkpoints given by the `ice-checkpoint` option (0 disables).
+ *
+ * Compilation
+ * -----------
+ *
+ *    mpicc -std=c99 -fPIC -Dpic -shared -lmechanic -lhdf5 -lhdf5_hl \
+ *        mechanic_module_ex_ice.c -o libmechanic_module_ex_ice.so
+ *
+ * Using the module
+ * ----------------
+ *
+ *    mpirun -np 4 mechanic -p ex_ice -x 10 -y 20 -d 10 --ice-checkpoint=5
+ *
+ * Remove the ICE file and restart the run:
+ *
+ *    rm mechanic.ice
+ *    cp mechanic-master-00.h5 mechanic-stopped.h5
+ *    mpirun -np 4 mechanic -p ex_ice -x 10 -y 20 -d 10 --restart-mode \
+ *        --restart-file=mechanic-stopped.h5
+ *
+ * Getting the data
+ * ----------------
+ *
+ *    h5dump -d/Pools/pool-0000/Tasks/result mechanic-master-00.h5
+ */
+#include "mechanic.h"
+
+/**
+ * Implements Setup()
+ */
+int Setup(setup *s) {
+  s->options[0] = (options) {
+    .space="ex_ice",
+    .name="ice-checkpoint",
+    .shortName='\0',
+    .value="0",
+    .type=C_INT,
+    .description="Create the ICE file after this number of checkpoints (0 disables)"
+  };
+  s->options[1] = (options) OPTIONS_END;
+
+  return SUCCESS;
+}
+
+/**
+ * Implements Storage()
+ */
+int Storage(pool *p) {
+  p->task->storage[0].layout = (schema) {
+    .name = "result",
+    .rank = 2,
+    .dims[0] = 1,
+    .dims[1] = 3,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = STORAGE_PM3D,
+    .datatype = H5T_NATIVE_DOUBLE
+  };
+
+  return SUCCESS;
+}
+
+/**
+ * Implements TaskProcess()
+ *
+ * The task result depends on the task location only, so that the restarted run gives the
+ * same result as the uninterrupted one.
+ */
+int TaskProcess(pool *p, task *t) {
+  double buffer[1][3];
+
+  buffer[0][0] = t->location[0];
+  buffer[0][1] = t->location[1];
+  buffer[0][2] = t->location[0] * t->location[1];
+
+  MWriteData(t, "result", &buffer[0][0]);
+
+  return TASK_FINALIZE;
+}
+
+/**
+ * Implements CheckpointPrepare()
+ *
+ * The ICE file is checked by the master node before the next task is received, so that
+ * the next checkpoint is the last one.
+ */
+int CheckpointPrepare(pool *p, checkpoint *c) {
+  int ice = 0;
+  FILE *file;
+
+  MReadOption(p, "ice-checkpoint", &ice);
+
+  if (ice > 0 && c->cid + 1 == ice) {
+    file = fopen(ICE_FILENAME, "w");
+    if (file) fclose(file);
+  }
+
+  return SUCCESS;
+}
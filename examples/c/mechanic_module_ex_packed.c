@@ -0,0 +1,78 @@
+/**
+ * Packed task storage
+ * ===================
+ *
+ * This example shows how to use the STORAGE_PACKED task banks. The task blocks are stored
+ * in a single dataset with the task ID as the leading axis, instead of the task groups of
+ * STORAGE_GROUP
+ *
+ * Compilation
+ * -----------
+ *
+ *    mpicc -std=c99 -fPIC -Dpic -shared -lmechanic -lhdf5 -lhdf5_hl \
+ *        mechanic_module_ex_packed.c -o libmechanic_module_ex_packed.so
+ *
+ * Using the module
+ * ----------------
+ *
+ *    mpirun -np 4 mechanic -p ex_packed -x 10 -y 20
+ *
+ * Getting the data
+ * ----------------
+ *
+ * The block of the task ID is result[ID]:
+ *
+ *    h5dump -d/Pools/pool-0000/Tasks/result mechanic-master-00.h5
+ */
+#include "mechanic.h"
+
+/**
+ * Implements Storage()
+ *
+ * Each task stores a 2x3 block, the final dataset is pool_size x 2 x 3.
+ */
+int Storage(pool *p) {
+  p->task->storage[0].layout = (schema) {
+    .name = "result",
+    .rank = 2,
+    .dims[0] = 2,
+    .dims[1] = 3,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = STORAGE_PACKED,
+    .datatype = H5T_NATIVE_INT
+  };
+
+  return SUCCESS;
+}
+
+/**
+ * Implements TaskProcess()
+ *
+ * The first row is written before the task snapshot (TASK_CHECKPOINT), and read back when
+ * the task continues, so that the packed block goes through the checkpoint buffer.
+ */
+int TaskProcess(pool *p, task *t) {
+  int buffer[2][3];
+
+  if (t->cid == 0) {
+    buffer[0][0] = t->location[0];
+    buffer[0][1] = t->location[1];
+    buffer[0][2] = t->tid;
+    buffer[1][0] = buffer[1][1] = buffer[1][2] = 0;
+
+    MWriteData(t, "result", &buffer[0][0]);
+
+    return TASK_CHECKPOINT;
+  }
+
+  MReadData(t, "result", &buffer[0][0]);
+
+  buffer[1][0] = buffer[0][0] + buffer[0][1];
+  buffer[1][1] = buffer[0][0] * buffer[0][1];
+  buffer[1][2] = t->cid;
+
+  MWriteData(t, "result", &buffer[0][0]);
+
+  return TASK_FINALIZE;
+}
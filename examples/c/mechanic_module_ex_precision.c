@@ -0,0 +1,292 @@
+/**
+ * Storage precision
+ * =================
+ *
+ * This example shows how to store the floating point task datasets with the reduced
+ * precision. The stored datatype and the precision attributes are checked in the
+ * DatasetPrepare() hook, the stored values and the memory banks in the DatasetProcess() hook
+ *
+ * Compilation
+ * -----------
+ *
+ *    mpicc -std=c99 -fPIC -Dpic -shared -lmechanic -lhdf5 -lhdf5_hl \
+ *        mechanic_module_ex_precision.c -o libmechanic_module_ex_precision.so
+ *
+ * Using the module
+ * ----------------
+ *
+ *    mpirun -np 4 mechanic -p ex_precision -x 10 -y 20
+ *
+ * Getting the data
+ * ----------------
+ *
+ * The stored datatype and the precision attributes are printed with:
+ *
+ *    h5dump -H -d/Pools/pool-0000/Tasks/round mechanic-master-00.h5
+ */
+#include <math.h>
+#include "mechanic.h"
+
+#define DIGITS 3 /**< The digits kept by the round and scale-offset datasets */
+#define BANKS 4 /**< The number of the task datasets */
+
+/**
+ * The precision of the task datasets
+ */
+static const struct {
+  char *name;
+  unsigned short precision;
+  char *attribute;
+} datasets[BANKS] = {
+  {"full", PRECISION_FULL, NULL},
+  {"float", PRECISION_FLOAT, "float32"},
+  {"round", PRECISION_ROUND, "round"},
+  {"scaleoffset", PRECISION_SCALEOFFSET, "scale-offset"}
+};
+
+/**
+ * The full precision value of the task
+ */
+static double Value(double x, double y) {
+  return 1.0 / (y + 3.0) + 0.1234567 * x;
+}
+
+/**
+ * The precision of the dataset (the index of datasets[]), -1 for other datasets
+ */
+static int Dataset(storage *d) {
+  int i;
+
+  for (i = 0; i < BANKS; i++) {
+    if (strcmp(d->layout.name, datasets[i].name) == 0) return i;
+  }
+
+  return -1;
+}
+
+/**
+ * Implements Init()
+ */
+int Init(init *i) {
+  i->banks_per_task = BANKS;
+  return SUCCESS;
+}
+
+/**
+ * Implements Storage()
+ *
+ * All datasets hold the same double values. The float dataset is stored as float32, the
+ * mantissa of the round dataset is rounded to DIGITS significant digits, and the
+ * scale-offset dataset keeps DIGITS decimal digits after the point.
+ */
+int Storage(pool *p) {
+  int i;
+
+  for (i = 0; i < BANKS; i++) {
+    p->task->storage[i].layout = (schema) {
+      .name = datasets[i].name,
+      .rank = 2,
+      .dims[0] = 1,
+      .dims[1] = 3,
+      .sync = 1,
+      .use_hdf = 1,
+      .storage_type = STORAGE_PM3D,
+      .datatype = H5T_NATIVE_DOUBLE,
+      .precision = datasets[i].precision,
+      .digits = DIGITS
+    };
+  }
+
+  return SUCCESS;
+}
+
+/**
+ * Implements TaskProcess()
+ */
+int TaskProcess(pool *p, task *t) {
+  double result[1][3];
+  int i;
+
+  result[0][0] = t->location[0];
+  result[0][1] = t->location[1];
+  result[0][2] = Value(t->location[0], t->location[1]);
+
+  for (i = 0; i < BANKS; i++) {
+    MWriteData(t, datasets[i].name, &result[0][0]);
+  }
+
+  return TASK_FINALIZE;
+}
+
+/**
+ * Implements DatasetPrepare()
+ *
+ * The float dataset is stored as float32, the others keep the double datatype. The lossy
+ * datasets have the "Precision" attribute, and the round and scale-offset datasets the
+ * "Precision digits" attribute too. The scale-offset dataset has the scale-offset filter.
+ */
+int DatasetPrepare(hid_t h5location, hid_t h5dataset, pool *p, storage *d) {
+  hid_t datatype, attr_d, attr_t, dcpl;
+  H5Z_filter_t filter = H5Z_FILTER_NONE;
+  unsigned int flags, values[2] = {0, 0};
+  char precision[CONFIG_LEN];
+  int n, digits = 0;
+  size_t size, elements = 2;
+
+  n = Dataset(d);
+  if (n < 0) return SUCCESS;
+
+  datatype = H5Dget_type(h5dataset);
+  H5CheckStatus(datatype);
+
+  size = (datasets[n].precision == PRECISION_FLOAT) ? sizeof(float) : sizeof(double);
+  if (H5Tget_class(datatype) != H5T_FLOAT || H5Tget_size(datatype) != size) {
+    Message(MESSAGE_ERR, "The dataset '%s' is stored with %zu bytes, %zu expected\n",
+        d->layout.name, H5Tget_size(datatype), size);
+    return MODULE_ERR_HDF;
+  }
+
+  H5Tclose(datatype);
+
+  if (!datasets[n].attribute) {
+    if (H5Aexists(h5dataset, "Precision") > 0) {
+      Message(MESSAGE_ERR, "The dataset '%s' has the precision attribute\n", d->layout.name);
+      return MODULE_ERR_HDF;
+    }
+    return SUCCESS;
+  }
+
+  if (H5Aexists(h5dataset, "Precision") <= 0) {
+    Message(MESSAGE_ERR, "The dataset '%s' has no precision attribute\n", d->layout.name);
+    return MODULE_ERR_HDF;
+  }
+
+  attr_d = H5Aopen(h5dataset, "Precision", H5P_DEFAULT);
+  H5CheckStatus(attr_d);
+
+  attr_t = H5Aget_type(attr_d);
+  memset(precision, 0, CONFIG_LEN);
+  if (H5Tget_size(attr_t) < CONFIG_LEN) H5Aread(attr_d, attr_t, precision);
+
+  H5Tclose(attr_t);
+  H5Aclose(attr_d);
+
+  if (strcmp(precision, datasets[n].attribute) != 0) {
+    Message(MESSAGE_ERR, "The precision of the dataset '%s' is '%s', '%s' expected\n",
+        d->layout.name, precision, datasets[n].attribute);
+    return MODULE_ERR_HDF;
+  }
+
+  if (datasets[n].precision == PRECISION_FLOAT) return SUCCESS;
+
+  if (H5Aexists(h5dataset, "Precision digits") > 0) {
+    attr_d = H5Aopen(h5dataset, "Precision digits", H5P_DEFAULT);
+    H5CheckStatus(attr_d);
+    H5Aread(attr_d, H5T_NATIVE_INT, &digits);
+    H5Aclose(attr_d);
+  }
+
+  if (digits != DIGITS) {
+    Message(MESSAGE_ERR, "The dataset '%s' keeps %d digits, %d expected\n",
+        d->layout.name, digits, DIGITS);
+    return MODULE_ERR_HDF;
+  }
+
+  if (datasets[n].precision != PRECISION_SCALEOFFSET) return SUCCESS;
+
+  /* The scale-offset filter quantizes the data with the decimal scale */
+  dcpl = H5Dget_create_plist(h5dataset);
+  H5CheckStatus(dcpl);
+
+  if (H5Pget_nfilters(dcpl) > 0) {
+    filter = H5Pget_filter2(dcpl, 0, &flags, &elements, values, 0, NULL, NULL);
+  }
+
+  H5Pclose(dcpl);
+
+  if (filter != H5Z_FILTER_SCALEOFFSET || values[0] != H5Z_SO_FLOAT_DSCALE || values[1] != DIGITS) {
+    Message(MESSAGE_ERR, "The dataset '%s' has no decimal scale-offset filter\n", d->layout.name);
+    return MODULE_ERR_HDF;
+  }
+
+  return SUCCESS;
+}
+
+/**
+ * Implements DatasetProcess()
+ *
+ * The stored values are within the precision of the dataset, and the float and round
+ * datasets have at least one reduced value. The memory banks of the pool (the data seen by the PoolProcess() hook) keep the
+ * full precision. The tasks restored from the stored file in the restart mode hold the
+ * stored values, the tasks computed in the current run the full precision values.
+ */
+int DatasetProcess(hid_t h5location, hid_t h5dataset, pool *p, storage *d) {
+  double **memory = NULL, **stored = NULL;
+  double value, error, tolerance;
+  unsigned int i, reduced = 0, exact = 0;
+  int n, mstat = SUCCESS;
+  herr_t hstat;
+
+  n = Dataset(d);
+  if (n < 0 || p->state != POOL_PROCESSED) return SUCCESS;
+
+  MAllocate2(p->task, d->layout.name, memory, double);
+  MAllocate2(p->task, d->layout.name, stored, double);
+
+  MReadData(p->task, d->layout.name, &memory[0][0]);
+
+  hstat = H5Dread(h5dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &stored[0][0]);
+  H5CheckStatus(hstat);
+
+  tolerance = 1.0;
+  for (i = 0; i < DIGITS; i++) tolerance /= 10.0;
+  if (datasets[n].precision == PRECISION_FLOAT) tolerance = 1e-7;
+  if (datasets[n].precision == PRECISION_FULL) tolerance = 0.0;
+
+  for (i = 0; i < d->layout.storage_dim[0]; i++) {
+    value = Value(round(stored[i][0]), round(stored[i][1]));
+    error = fabs(stored[i][2] - value);
+
+    /* The round and float datasets keep the significant digits */
+    if (datasets[n].precision != PRECISION_SCALEOFFSET) error /= fabs(value);
+
+    if (error > tolerance) {
+      Message(MESSAGE_ERR, "The stored value %f of the dataset '%s' differs from %f\n",
+          stored[i][2], d->layout.name, value);
+      mstat = MODULE_ERR_HDF;
+      break;
+    }
+
+    if (stored[i][2] != value) reduced++;
+
+    value = Value(memory[i][0], memory[i][1]);
+    if (memory[i][2] == value && stored[i][2] != value) exact++;
+
+    if (memory[i][2] != value && memory[i][2] != stored[i][2]) {
+      Message(MESSAGE_ERR, "The memory value %.15f of the dataset '%s' differs from %.15f\n",
+          memory[i][2], d->layout.name, value);
+      mstat = MODULE_ERR_HDF;
+      break;
+    }
+  }
+
+  /* The chunk cache holds the unfiltered chunks until they are flushed, so that the
+   * quantized scale-offset values are compared with the reference files only */
+  if (mstat == SUCCESS && (datasets[n].precision == PRECISION_FLOAT ||
+        datasets[n].precision == PRECISION_ROUND) && reduced == 0) {
+    Message(MESSAGE_ERR, "The dataset '%s' is stored with the full precision\n", d->layout.name);
+    mstat = MODULE_ERR_HDF;
+  }
+
+  /* The tasks computed in this run keep the digits lost in the stored file */
+  if (mstat == SUCCESS && (datasets[n].precision == PRECISION_FLOAT ||
+        datasets[n].precision == PRECISION_ROUND) && exact == 0) {
+    Message(MESSAGE_ERR, "The memory of the dataset '%s' has the reduced precision\n", d->layout.name);
+    mstat = MODULE_ERR_HDF;
+  }
+
+  free(memory);
+  free(stored);
+
+  return mstat;
+}
@@ -0,0 +1,107 @@
+/**
+ * Streaming task output
+ * =====================
+ *
+ * This example shows how to use the STORAGE_STREAM task banks. Each task appends a
+ * variable number of records, and only the appended records are sent to the master node
+ *
+ * Compilation
+ * -----------
+ *
+ *    mpicc -std=c99 -fPIC -Dpic -shared -lmechanic -lhdf5 -lhdf5_hl \
+ *        mechanic_module_ex_stream.c -o libmechanic_module_ex_stream.so
+ *
+ * Using the module
+ * ----------------
+ *
+ *    mpirun -np 4 mechanic -p ex_stream -x 10 -y 20
+ *
+ * Getting the data
+ * ----------------
+ *
+ * The records are appended in the order of the task messages, the task ID, the checkpoint
+ * ID, the offset and the number of records of each message are stored in the index:
+ *
+ *    h5dump -d/Pools/pool-0000/Tasks/events mechanic-master-00.h5
+ *    h5dump -d/Pools/pool-0000/Tasks/events-index mechanic-master-00.h5
+ *
+ * The records of the task are extracted with:
+ *
+ *    mechanic-extract -d events -t 10 mechanic-master-00.h5
+ */
+#include "mechanic.h"
+
+#define CAPACITY 4
+#define MAX_EVENTS 7
+
+/**
+ * Implements Init()
+ */
+int Init(init *i) {
+  i->banks_per_task = 2;
+  return SUCCESS;
+}
+
+/**
+ * Implements Storage()
+ *
+ * The task message holds up to CAPACITY records of the stream. The number of records of
+ * each task is stored in the PM3D dataset as well.
+ */
+int Storage(pool *p) {
+  p->task->storage[0].layout = (schema) {
+    .name = "events",
+    .rank = 2,
+    .dims[0] = CAPACITY,
+    .dims[1] = 3,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = STORAGE_STREAM,
+    .datatype = H5T_NATIVE_DOUBLE
+  };
+
+  p->task->storage[1].layout = (schema) {
+    .name = "count",
+    .rank = 2,
+    .dims[0] = 1,
+    .dims[1] = 3,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = STORAGE_PM3D,
+    .datatype = H5T_NATIVE_INT
+  };
+
+  return SUCCESS;
+}
+
+/**
+ * Implements TaskProcess()
+ *
+ * The task produces up to MAX_EVENTS records. When the records do not fit the task
+ * message, the task returns TASK_CHECKPOINT to send the records appended so far, and
+ * continues with the next checkpoint ID.
+ */
+int TaskProcess(pool *p, task *t) {
+  double event[1][3];
+  int count[1][3], events, first, last, i;
+
+  events = (t->location[0] + t->location[1]) % (MAX_EVENTS + 1);
+  first = t->cid * CAPACITY;
+  last = first + CAPACITY < events ? first + CAPACITY : events;
+
+  for (i = first; i < last; i++) {
+    event[0][0] = t->location[0];
+    event[0][1] = t->location[1];
+    event[0][2] = i;
+    MAppendData(t, "events", &event[0][0], 1);
+  }
+
+  if (last < events) return TASK_CHECKPOINT;
+
+  count[0][0] = t->location[0];
+  count[0][1] = t->location[1];
+  count[0][2] = events;
+  MWriteData(t, "count", &count[0][0]);
+
+  return TASK_FINALIZE;
+}
@@ -106,6 +106,13 @@
 #include "mechanic.h"
 #include "mechanic_module_arnoldweb.h"
 
+/* The options and the task banks of TaskProcess(), resolved in LoopPrepare() */
+static struct {
+  optionHandle step, tend, epsilon_min, driver, snapshots, power_intervals, force_step;
+  storageHandle result, state;
+  attrHandle intervals, interval_step, loop_step;
+} handles;
+
 /* Implements Init() */
 int Init(init *i) {
   i->banks_per_pool = 1;
@@ -356,6 +363,31 @@ int PoolProcess(pool **all, pool *p) {
   return POOL_CREATE_NEW;
 }
 
+/**
+ * Implements LoopPrepare()
+ *
+ * All nodes resolve the names used by TaskProcess() once per pool, so that the task
+ * reads the options and the task banks without the name lookups.
+ */
+int LoopPrepare(int mpi_size, int node, pool **all, pool *p) {
+  MOptionHandle(p, "step", &handles.step);
+  MOptionHandle(p, "tend", &handles.tend);
+  MOptionHandle(p, "epsilon_min", &handles.epsilon_min);
+  MOptionHandle(p, "driver", &handles.driver);
+  MOptionHandle(p, "task-checkpoints", &handles.snapshots);
+  MOptionHandle(p, "power-intervals", &handles.power_intervals);
+  MOptionHandle(p, "force-step", &handles.force_step);
+
+  MStorageHandle(p->task, "result", &handles.result);
+  MStorageHandle(p->task, "state", &handles.state);
+
+  MAttrHandle(p->task, "result", "intervals", &handles.intervals);
+  MAttrHandle(p->task, "result", "interval_step", &handles.interval_step);
+  MAttrHandle(p->task, "result", "loop_step", &handles.loop_step);
+
+  return SUCCESS;
+}
+
 /* Implements TaskPrepare() */
 int TaskPrepare(pool *p, task *t) {
   double state[24];
@@ -416,20 +448,17 @@ int TaskProcess(pool *p, task *t) {
   int power_intervals, force_step;
   unsigned long int loop_step;
 
-  MReadOption(p, "step", &step);
-  MReadOption(p, "tend", &tend);
-  MReadOption(p, "epsilon_min", &eps);
-  MReadOption(p, "driver", &driver);
-  MReadOption(p, "task-checkpoints", &snapshots);
-  MReadOption(p, "power-intervals", &power_intervals);
-  MReadOption(p, "force-step", &force_step);
+  MReadOptionH(p, handles.step, &step);
+  MReadOptionH(p, handles.tend, &tend);
+  MReadOptionH(p, handles.epsilon_min, &eps);
+  MReadOptionH(p, handles.driver, &driver);
+  MReadOptionH(p, handles.snapshots, &snapshots);
+  MReadOptionH(p, handles.power_intervals, &power_intervals);
+  MReadOptionH(p, handles.force_step, &force_step);
 
-  MReadAttr(t, "result", 
-      "intervals", &intervals[0]);
-  MReadAttr(t, "result", 
-      "interval_step", &interval_step);
-  MReadAttr(t, "result",
-      "loop_step", &loop_step);
+  MReadAttrH(t, handles.intervals, &intervals[0]);
+  MReadAttrH(t, handles.interval_step, &interval_step);
+  MReadAttrH(t, handles.loop_step, &loop_step);
 
   if (power_intervals == 1) {
     if (t->cid == 0) {
@@ -447,10 +476,10 @@ int TaskProcess(pool *p, task *t) {
     step = step*(pow(5,0.5) - 1.0)/2.0;
   }
 
-  MReadData(t, "state", &state[0]);
+  MReadDataH(t, handles.state, &state[0]);
 
   if (t->cid > 0) {
-    MReadData(t, "result", &r[0][0][0][0]);
+    MReadDataH(t, handles.result, &r[0][0][0][0]);
   }
  
   // Numerical integration goes here
@@ -479,10 +508,10 @@ int TaskProcess(pool *p, task *t) {
     task_finalize = 0;
   }
 
-  MWriteData(t, "result", &r[0][0][0][0]);
-  MWriteAttr(t, "result", "loop_step", &loop_step);
+  MWriteDataH(t, handles.result, &r[0][0][0][0]);
+  MWriteAttrH(t, handles.loop_step, &loop_step);
 
-  MWriteData(t, "state", &state[0]);
+  MWriteDataH(t, handles.state, &state[0]);
 
   if (t->cid + 1 == (unsigned int) snapshots) return TASK_FINALIZE;
   if (task_finalize == 1) return TASK_FINALIZE;
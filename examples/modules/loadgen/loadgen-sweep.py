@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+#
+# The end-to-end taskfarm benchmark: runs the loadgen module for a sweep of the number
+# of nodes and reports the task rate, the master node utilization, the dispatch latency
+# and the I/O throughput, from the timeline trace and the metrics file of each run.
+#
+# Usage:
+#
+#   loadgen-sweep.py --np 2,4,8,16 -- -x 100 -y 100 --duration=0.01 --output=1024
+#
+# The arguments after `--` are passed to mechanic (the loadgen and the core options).
+#
+import argparse
+import json
+import os
+import shlex
+import subprocess
+import sys
+
+COLUMNS = [
+    ('np', '%4d'),
+    ('tasks', '%7d'),
+    ('elapsed', '%9.3f'),
+    ('tasks/s', '%10.1f'),
+    ('master', '%7.1f%%'),
+    ('workers', '%7.1f%%'),
+    ('p50 ms', '%8.3f'),
+    ('p90 ms', '%8.3f'),
+    ('p99 ms', '%8.3f'),
+    ('recv MB/s', '%10.2f'),
+    ('flushes', '%8d'),
+    ('flush MB/s', '%11.2f'),
+]
+
+
+def percentile(values, p):
+  """The p-th percentile (nearest rank) of the values"""
+  if not values:
+    return float('nan')
+  values = sorted(values)
+  k = max(0, min(len(values) - 1, int(round(p / 100.0 * len(values) + 0.5)) - 1))
+  return values[k]
+
+
+def read_metrics(path):
+  """Read the Prometheus text file as {name[:node or state]: value}"""
+  metrics = {}
+  with open(path) as f:
+    for line in f:
+      if not line.strip() or line.startswith('#'):
+        continue
+      key, value = line.rsplit(' ', 1)
+      name = key.split('{', 1)[0]
+      if 'node="' in key:
+        name += ':' + key.split('node="', 1)[1].split('"', 1)[0]
+      elif 'state="' in key:
+        name += ':' + key.split('state="', 1)[1].split('"', 1)[0]
+      metrics[name] = float(value)
+  return metrics
+
+
+def read_trace(path, nodes):
+  """Compute the master utilization, the worker busy time and the dispatch latency"""
+  with open(path) as f:
+    events = json.load(f)['traceEvents']
+
+  loop = {}
+  wait = [0.0] * nodes
+  receive = {}
+  latency = []
+  dropped = 0
+
+  for e in sorted((e for e in events if e['ph'] != 'M'), key=lambda e: e['ts']):
+    pid = e['pid']
+    if e['name'] == 'dropped':
+      dropped += e['args']['events']
+    elif e['name'] == 'task loop':
+      loop[pid] = e['dur']
+    elif e['name'] == 'wait':
+      wait[pid] += e['dur']
+    elif pid == 0 and e['name'] == 'receive':
+      receive[e['args']['node']] = e['ts']
+    elif pid == 0 and e['name'] == 'dispatch':
+      node = e['args']['node']
+      if node in receive:
+        latency.append((e['ts'] - receive.pop(node)) / 1000.0)
+
+  if dropped:
+    sys.stderr.write('%s: %d events dropped, increase --trace-buffer\n' % (path, dropped))
+
+  master = 100.0 * (1.0 - wait[0] / loop[0]) if loop.get(0) else float('nan')
+  busy = [1.0 - wait[n] / loop[n] for n in range(1, nodes) if loop.get(n)]
+  workers = 100.0 * sum(busy) / len(busy) if busy else float('nan')
+
+  return master, workers, latency
+
+
+def run(args, nodes):
+  """Run the loadgen module on the given number of nodes"""
+  name = '%s-%d' % (args.name, nodes)
+  metrics = name + '.prom'
+  command = shlex.split(args.mpirun) + ['-np', str(nodes), args.mechanic,
+      '-p', 'loadgen', '-n', name, '--trace', '--trace-buffer=%d' % args.trace_buffer,
+      '--metrics=%s' % metrics, '--metrics-interval=%d' % 86400] + args.extra
+
+  sys.stderr.write(' '.join(command) + '\n')
+  with open(os.path.join(args.workdir, name + '.log'), 'w') as log:
+    status = subprocess.call(command, cwd=args.workdir, stdout=log, stderr=subprocess.STDOUT)
+  if status != 0:
+    sys.exit('%s failed (%d), see %s.log' % (' '.join(command), status, name))
+
+  m = read_metrics(os.path.join(args.workdir, metrics))
+  master, workers, latency = read_trace(os.path.join(args.workdir, name + '-trace-0000.json'), nodes)
+
+  elapsed = m['mechanic_elapsed_seconds']
+  received = m.get('mechanic_received_bytes_total', 0.0) / 1e6
+  flush = m.get('mechanic_checkpoint_flush_seconds_sum', 0.0)
+
+  return (nodes, int(m['mechanic_tasks:completed']), elapsed,
+      m['mechanic_tasks_per_second_average'], master, workers,
+      percentile(latency, 50), percentile(latency, 90), percentile(latency, 99),
+      received / elapsed if elapsed > 0 else 0.0,
+      int(m.get('mechanic_checkpoint_flush_seconds_count', 0)),
+      received / flush if flush > 0 else 0.0)
+
+
+def main():
+  parser = argparse.ArgumentParser(description='Run the loadgen module for a sweep of the number of nodes')
+  parser.add_argument('--np', default='2,4,8', help='The comma-separated list of the number of nodes')
+  parser.add_argument('--mpirun', default='mpirun', help='The MPI launcher (with its options)')
+  parser.add_argument('--mechanic', default='mechanic', help='The mechanic binary')
+  parser.add_argument('--name', default='loadgen', help='The run name prefix')
+  parser.add_argument('--workdir', default='.', help='The directory of the output files')
+  parser.add_argument('--trace-buffer', type=int, default=1 << 20, help='The trace buffer (events per node)')
+  parser.add_argument('--csv', action='store_true', help='Print the CSV instead of the table')
+  parser.add_argument('extra', nargs=argparse.REMAINDER, help='The mechanic options (after --)')
+  args = parser.parse_args()
+
+  if args.extra and args.extra[0] == '--':
+    args.extra = args.extra[1:]
+
+  rows = [run(args, int(n)) for n in args.np.split(',')]
+
+  if args.csv:
+    print(','.join(c[0] for c in COLUMNS))
+    for row in rows:
+      print(','.join(str(v) for v in row))
+    return
+
+  widths = [len(f % 0) for _, f in COLUMNS]
+  print(' '.join(c.rjust(w) for (c, _), w in zip(COLUMNS, widths)))
+  for row in rows:
+    print(' '.join(f % v for (_, f), v in zip(COLUMNS, row)))
+
+
+if __name__ == '__main__':
+  main()
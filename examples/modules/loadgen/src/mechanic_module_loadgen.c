@@ -0,0 +1,311 @@
+/**
+ * Mechanic synthetic load generator
+ * ---------------------------------
+ *
+ * Note: This is a part of the Mechanic package
+ *
+ * The module does no real computation. Each task waits for the time drawn from the given
+ * distribution and writes the task banks of the given size and storage type, so that the
+ * runtime modes, the storage types and the checkpoint options may be compared on the
+ * same, reproducible load. The task durations and snapshots depend only on the seed and
+ * the task ID, so that the load does not depend on the number of nodes.
+ *
+ * Module compilation
+ * ------------------
+ *
+ *    mpicc -fPIC -Dpic -shared mechanic_module_loadgen.c \
+ *      -o libmechanic_module_loadgen.so -lmechanic -lhdf5 -lm
+ *
+ * Module options
+ * --------------
+ *
+ *    mpirun -np 4 mechanic -p loadgen --help
+ *
+ * Options:
+ * - duration - the mean task duration in seconds
+ * - distribution - the task duration distribution (constant, exponential, pareto)
+ * - alpha - the shape of the pareto distribution (heavy-tailed, alpha > 1)
+ * - spin - busy-wait instead of sleeping
+ * - banks - the number of task banks (max LOADGEN_MAX_BANKS)
+ * - output - the number of elements (double) of each task bank per task
+ * - input - the number of elements (double) of the pool bank sent to the workers
+ * - storage - the storage type of the task banks (pm3d, list, texture, packed, group, stream)
+ * - snapshot-rate - the probability of the `TASK_CHECKPOINT` after each task step
+ * - seed - the random seed
+ *
+ * The checkpoint frequency is set with the core `--checkpoint`, `--checkpoint-interval`
+ * and `--checkpoint-memory` options.
+ *
+ * Using the module
+ * ----------------
+ *
+ *    mpirun -np 8 mechanic -p loadgen -x 100 -y 100 --duration=0.01 \
+ *      --distribution=pareto --output=1024 --storage=list -d 500
+ *
+ * The `loadgen-sweep.py` driver runs the module for a sweep of the number of nodes and
+ * reports the task rate, the master node utilization, the dispatch latency and the I/O
+ * throughput.
+ */
+#define _XOPEN_SOURCE 600
+
+#include "mechanic.h"
+#include "mechanic_module_loadgen.h"
+
+/* The task bank names */
+static char bank_names[LOADGEN_MAX_BANKS][CONFIG_LEN];
+
+/* The task bank buffer (largest bank so far) */
+static double *buffer = NULL;
+static unsigned int buffer_size = 0;
+
+/* Implements Init() */
+int Init(init *i) {
+  i->banks_per_pool = 1;
+  i->banks_per_task = LOADGEN_MAX_BANKS;
+  i->min_cpu_required = 1;
+  return SUCCESS;
+}
+
+/* Implements Setup() */
+int Setup(setup *s) {
+  s->options[0] = (options) {
+    .space="loadgen", .name="duration", .shortName='\0', .value="0.001", .type=C_DOUBLE,
+    .description="The mean task duration in seconds"
+  };
+  s->options[1] = (options) {
+    .space="loadgen", .name="distribution", .shortName='\0', .value="constant", .type=C_STRING,
+    .description="The task duration distribution (constant, exponential, pareto)"
+  };
+  s->options[2] = (options) {
+    .space="loadgen", .name="alpha", .shortName='\0', .value="1.5", .type=C_DOUBLE,
+    .description="The shape of the pareto distribution (alpha > 1)"
+  };
+  s->options[3] = (options) {
+    .space="loadgen", .name="spin", .shortName='\0', .value="0", .type=C_VAL,
+    .description="Busy-wait instead of sleeping"
+  };
+  s->options[4] = (options) {
+    .space="loadgen", .name="banks", .shortName='\0', .value="1", .type=C_INT,
+    .description="The number of task banks"
+  };
+  s->options[5] = (options) {
+    .space="loadgen", .name="output", .shortName='\0', .value="1", .type=C_INT,
+    .description="The number of elements of each task bank per task"
+  };
+  s->options[6] = (options) {
+    .space="loadgen", .name="input", .shortName='\0', .value="0", .type=C_INT,
+    .description="The number of elements of the pool bank sent to the workers"
+  };
+  s->options[7] = (options) {
+    .space="loadgen", .name="storage", .shortName='\0', .value="pm3d", .type=C_STRING,
+    .description="The storage type of the task banks (pm3d, list, texture, packed, group, stream)"
+  };
+  s->options[8] = (options) {
+    .space="loadgen", .name="snapshot-rate", .shortName='\0', .value="0.0", .type=C_DOUBLE,
+    .description="The probability of the task checkpoint after each task step"
+  };
+  s->options[9] = (options) {
+    .space="loadgen", .name="seed", .shortName='\0', .value="1", .type=C_INT,
+    .description="The random seed"
+  };
+  s->options[10] = (options) OPTIONS_END;
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Get the storage type by its name
+ *
+ * @param name The storage type name
+ *
+ * @return The storage type, STORAGE_NULL if unknown
+ */
+static int StorageType(char *name) {
+  if (strcmp(name, "pm3d") == 0) return STORAGE_PM3D;
+  if (strcmp(name, "list") == 0) return STORAGE_LIST;
+  if (strcmp(name, "texture") == 0) return STORAGE_TEXTURE;
+  if (strcmp(name, "packed") == 0) return STORAGE_PACKED;
+  if (strcmp(name, "group") == 0) return STORAGE_GROUP;
+  if (strcmp(name, "stream") == 0) return STORAGE_STREAM;
+  return STORAGE_NULL;
+}
+
+/* Implements Storage() */
+int Storage(pool *p) {
+  int i = 0, banks, output, input, type;
+  char storage_type[CONFIG_LEN];
+
+  MReadOption(p, "banks", &banks);
+  MReadOption(p, "output", &output);
+  MReadOption(p, "input", &input);
+  MReadOption(p, "storage", &storage_type);
+
+  if (banks < 1) banks = 1;
+  if (banks > LOADGEN_MAX_BANKS) banks = LOADGEN_MAX_BANKS;
+  if (output < 1) output = 1;
+
+  type = StorageType(storage_type);
+  if (type == STORAGE_NULL) {
+    Message(MESSAGE_ERR, "Unknown storage type '%s'\n", storage_type);
+    return CORE_ERR_SETUP;
+  }
+
+  // Path: /Pools/pool-ID/input
+  if (input > 0) {
+    p->storage[0].layout = (schema) {
+      .name = "input",
+      .rank = 2,
+      .dims[0] = 1,
+      .dims[1] = input,
+      .sync = 1,
+      .use_hdf = HDF_NORMAL_STORAGE,
+      .storage_type = STORAGE_GROUP,
+      .datatype = H5T_NATIVE_DOUBLE
+    };
+  }
+
+  // Path: /Pools/pool-ID/Tasks/bank-N
+  for (i = 0; i < banks; i++) {
+    snprintf(bank_names[i], CONFIG_LEN, LOADGEN_BANK, i);
+    p->task->storage[i].layout = (schema) {
+      .rank = type == STORAGE_TEXTURE ? TASK_BOARD_RANK : 2,
+      .dims[0] = type == STORAGE_STREAM ? output : 1,
+      .dims[1] = type == STORAGE_STREAM ? 1 : output,
+      .dims[2] = 1,
+      .sync = 1,
+      .use_hdf = HDF_NORMAL_STORAGE,
+      .storage_type = type,
+      .datatype = H5T_NATIVE_DOUBLE
+    };
+    p->task->storage[i].layout.name = bank_names[i];
+  }
+
+  if (buffer_size < (unsigned int) output) {
+    free(buffer);
+    buffer = calloc(output, sizeof(double));
+    if (!buffer) return CORE_ERR_MEM;
+    buffer_size = output;
+  }
+
+  return SUCCESS;
+}
+
+/* Implements PoolPrepare() */
+int PoolPrepare(pool **all, pool *p) {
+  int i = 0, input;
+  double *data;
+
+  MReadOption(p, "input", &input);
+  if (input < 1) return SUCCESS;
+
+  data = calloc(input, sizeof(double));
+  if (!data) return CORE_ERR_MEM;
+
+  for (i = 0; i < input; i++) data[i] = i;
+  MWriteData(p, "input", data);
+
+  free(data);
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Draw the task duration and the number of task snapshots
+ *
+ * The random state depends only on the seed and the task ID.
+ *
+ * @param p The current pool pointer
+ * @param t The current task pointer
+ * @param snapshots The number of task snapshots
+ *
+ * @return The task duration in seconds
+ */
+static double Draw(pool *p, task *t, int *snapshots) {
+  double duration, alpha, rate, u;
+  char distribution[CONFIG_LEN];
+  unsigned short state[3];
+  int seed;
+
+  MReadOption(p, "duration", &duration);
+  MReadOption(p, "distribution", &distribution);
+  MReadOption(p, "alpha", &alpha);
+  MReadOption(p, "snapshot-rate", &rate);
+  MReadOption(p, "seed", &seed);
+
+  state[0] = (unsigned short) seed;
+  state[1] = (unsigned short) (t->tid & 0xffff);
+  state[2] = (unsigned short) ((t->tid >> 16) ^ p->pid);
+  erand48(state);
+
+  u = erand48(state);
+  if (strcmp(distribution, "exponential") == 0) {
+    duration = -duration * log(1.0 - u);
+  } else if (strcmp(distribution, "pareto") == 0) {
+    if (alpha <= 1.0) alpha = LOADGEN_ALPHA_MIN;
+    duration = duration * (alpha - 1.0) / alpha / pow(1.0 - u, 1.0 / alpha);
+  }
+
+  *snapshots = 0;
+  while (*snapshots < LOADGEN_MAX_SNAPSHOTS && erand48(state) < rate) (*snapshots)++;
+
+  return duration;
+}
+
+/**
+ * @brief Wait for the given time
+ *
+ * @param seconds The time to wait
+ * @param spin Busy-wait instead of sleeping
+ */
+static void Wait(double seconds, int spin) {
+  struct timespec ts;
+  double end;
+
+  if (seconds <= 0) return;
+
+  if (spin) {
+    end = MPI_Wtime() + seconds;
+    while (MPI_Wtime() < end);
+    return;
+  }
+
+  ts.tv_sec = (time_t) seconds;
+  ts.tv_nsec = (long) ((seconds - ts.tv_sec) * 1e9);
+  while (nanosleep(&ts, &ts) != 0);
+}
+
+/**
+ * Implements TaskProcess()
+ *
+ * The task duration is split into the task steps, and the task returns the
+ * `TASK_CHECKPOINT` after each step but the last one.
+ */
+int TaskProcess(pool *p, task *t) {
+  int i = 0, snapshots, spin, output;
+  unsigned int j = 0;
+  double duration;
+  char storage_type[CONFIG_LEN];
+
+  MReadOption(p, "spin", &spin);
+  MReadOption(p, "output", &output);
+  MReadOption(p, "storage", &storage_type);
+  if (output < 1) output = 1;
+
+  duration = Draw(p, t, &snapshots);
+  Wait(duration / (snapshots + 1), spin);
+
+  for (j = 0; j < (unsigned int) output; j++) buffer[j] = t->tid + t->cid;
+
+  for (i = 0; i < p->task_banks; i++) {
+    if (StorageType(storage_type) == STORAGE_STREAM) {
+      MAppendData(t, bank_names[i], buffer, output);
+    } else {
+      MWriteData(t, bank_names[i], buffer);
+    }
+  }
+
+  if (t->cid < (unsigned int) snapshots) return TASK_CHECKPOINT;
+
+  return TASK_FINALIZE;
+}
+
@@ -0,0 +1,11 @@
+#ifndef MECHANIC_MODULE_LOADGEN_H
+#define MECHANIC_MODULE_LOADGEN_H
+
+#include <math.h>
+
+#define LOADGEN_MAX_BANKS 8
+#define LOADGEN_MAX_SNAPSHOTS 64
+#define LOADGEN_ALPHA_MIN 1.01
+#define LOADGEN_BANK "bank-%d"
+
+#endif
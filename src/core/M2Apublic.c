@@ -2,6 +2,25 @@
  * @file
  * Common functions (public API)
  */
+#if HAVE_CONFIG_H
+  #include "mechanic_config.h"
+#endif
+
+#if HAVE_COPY_FILE_RANGE && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+
+#if HAVE_FICLONE
+  #include <sys/ioctl.h>
+  #include <linux/fs.h>
+#endif
+
+#if HAVE_SENDFILE
+  #include <sys/sendfile.h>
+#endif
+
 #include "M2Apublic.h"
 
 /**
@@ -44,9 +63,82 @@ char* Name(char *prefix, char *name, char *suffix, char *extension) {
   return fname;
 }
 
+/**
+ * @brief Copy the file contents between the file descriptors
+ *
+ * The fastest available method is used: the reflink clone (copy-on-write filesystems),
+ * the in-kernel copy (copy_file_range(), sendfile()) and finally the read/write loop with
+ * a bounded buffer. The in-kernel methods advance the file offsets, so that the next
+ * method continues where the previous one stopped.
+ *
+ * @param input The input file descriptor
+ * @param output The output file descriptor
+ * @param size The input file size
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int CopyStream(int input, int output, off_t size) {
+  off_t done = 0;
+  ssize_t n = 0, w = 0, written = 0;
+  char *buffer;
+
+#if HAVE_FICLONE
+  if (ioctl(output, FICLONE, input) == 0) return SUCCESS;
+#endif
+
+#if HAVE_COPY_FILE_RANGE
+  while (done < size) {
+    n = copy_file_range(input, NULL, output, NULL, (size_t) (size - done), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += n;
+  }
+  if (done >= size) return SUCCESS;
+#endif
+
+#if HAVE_SENDFILE
+  while (done < size) {
+    n = sendfile(output, input, NULL, (size_t) (size - done));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += n;
+  }
+  if (done >= size) return SUCCESS;
+#endif
+
+  buffer = malloc(COPY_BUFFER_SIZE);
+  if (!buffer) return CORE_ERR_MEM;
+
+  while ((n = read(input, buffer, COPY_BUFFER_SIZE)) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      free(buffer);
+      return CORE_ERR_HDF;
+    }
+
+    /* Writes may be partial */
+    for (written = 0; written < n; written += w) {
+      w = write(output, buffer + written, (size_t) (n - written));
+      if (w < 0 && errno == EINTR) {
+        w = 0;
+        continue;
+      }
+      if (w <= 0) {
+        free(buffer);
+        return CORE_ERR_HDF;
+      }
+    }
+  }
+
+  free(buffer);
+  return SUCCESS;
+}
+
 /**
  * @brief Copy files
  *
+ * The file is streamed, so that the memory usage does not depend on the file size.
+ *
  * @param in The input filename
  * @param out The output filename
  *
@@ -55,8 +147,7 @@ char* Name(char *prefix, char *name, char *suffix, char *extension) {
 int Copy(char *in, char *out) {
   int input;
   int output;
-  int mstat = 0;
-  char *c;
+  int mstat = SUCCESS;
   struct stat st;
 
   /* Read and write files in binary mode */
@@ -66,43 +157,34 @@ int Copy(char *in, char *out) {
     return CORE_ERR_HDF;
   }
 
-  stat(in, &st);
-
-  output = open(out, O_RDWR | O_CREAT | O_TRUNC, 0644);
-  if (output < 0) {
-    Message(MESSAGE_ERR, "Could not open output file %s\n", out);
+  if (fstat(input, &st) < 0) {
+    Message(MESSAGE_ERR, "Could not stat input file %s\n", in);
+    close(input);
     return CORE_ERR_HDF;
   }
 
-  /* CHAR_BIT in limits.h */
-  c = malloc(st.st_size * CHAR_BIT + 1);
-  if (!c) return CORE_ERR_MEM;
-
-  /* Read and write the whole file, without loops */
-  mstat = read(input, c, st.st_size);
-  if (mstat < 0) {
-    Message(MESSAGE_ERR, "Could not read input file %s\n", in);
+  output = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (output < 0) {
+    Message(MESSAGE_ERR, "Could not open output file %s\n", out);
+    close(input);
     return CORE_ERR_HDF;
   }
 
-  mstat = write(output, c, st.st_size);
-  if (mstat < 0) {
-    Message(MESSAGE_ERR, "Could not write output file %s\n", out);
-    return CORE_ERR_HDF;
+  mstat = CopyStream(input, output, st.st_size);
+  if (mstat != SUCCESS) {
+    Message(MESSAGE_ERR, "Could not copy file %s to %s\n", in, out);
   }
 
-  free(c);
-
   if (close(input) < 0) {
     Message(MESSAGE_ERR, "Error closing input file\n");
-    return CORE_ERR_HDF;
+    mstat = CORE_ERR_HDF;
   }
 
   if (close(output) < 0) {
     Message(MESSAGE_ERR, "Error closing output file\n");
-    return CORE_ERR_HDF;
+    mstat = CORE_ERR_HDF;
   }
 
-  return SUCCESS;
+  return mstat;
 }
 
@@ -36,6 +36,8 @@
 
 #define TAG_TERMINATE 12763 /** The node terminate tag */
 
+#define COPY_BUFFER_SIZE 1048576 /**< The buffer size of the fallback file copy */
+
 /* Data */
 #define HEADER_SIZE 4+TASK_BOARD_RANK /**< The data header size */
 #define HEADER_INIT {TAG_TERMINATE,0,TASK_EMPTY,TASK_NO_LOCATION,TASK_NO_LOCATION,TASK_NO_LOCATION,0}
@@ -19,10 +19,9 @@
  * @return 0 on success, error code otherwise
  */
 int Setup(module *m, char *filename, int argc, char **argv, int setup_mode) {
-  int mstat = SUCCESS, n = 0;
+  int mstat = SUCCESS;
   unsigned int i = 0, opts = 0;
   MPI_Datatype mpi_t;
-  MPI_Status mpi_status;
   hid_t h5location, h5board, h5attr, h5atype;
   char string_attr[CONFIG_LEN];
   int int_attr;
@@ -102,18 +101,13 @@ int Setup(module *m, char *filename, int argc, char **argv, int setup_mode) {
     ConfigHead2StructNoalloc(m->layer->setup->head, m->layer->setup->options);
   }
 
-  /* Broadcast new configuration */
+  /* Broadcast new configuration (the whole options table at once) */
   mstat = ConfigDatatype(m->layer->setup->options[0], &mpi_t);
   CheckStatus(mstat);
 
-  for (i = 0; i < opts; i++) {
-    if (m->node == MASTER) {
-      for (n = 1; n < m->mpi_size; n++) {
-        MPI_Send(&m->layer->setup->options[i], 1, mpi_t, n, TAG_STANDBY, MPI_COMM_WORLD);
-      }
-    } else {
-      MPI_Recv(&m->layer->setup->options[i], 1, mpi_t, MASTER, TAG_STANDBY, MPI_COMM_WORLD, &mpi_status);
-    }
+  if (opts > 0) {
+    mstat = MPI_Bcast(m->layer->setup->options, opts, mpi_t, MASTER, MPI_COMM_WORLD);
+    if (mstat != MPI_SUCCESS) Error(CORE_ERR_MPI);
   }
   MPI_Type_free(&mpi_t);
 
@@ -350,6 +344,7 @@ int ConfigDatatype(options c, MPI_Datatype *mpi_t) {
   MPI_Aint displacements[6];
   MPI_Datatype types[6];
   MPI_Aint addresses[7];
+  MPI_Datatype struct_t;
 
   block_lengths[0] = CONFIG_LEN;
   block_lengths[1] = CONFIG_LEN;
@@ -376,12 +371,18 @@ int ConfigDatatype(options c, MPI_Datatype *mpi_t) {
     displacements[i] = addresses[i+1] - addresses[0];
   }
 
-  mstat = MPI_Type_create_struct(6, block_lengths, displacements, types, mpi_t);
+  mstat = MPI_Type_create_struct(6, block_lengths, displacements, types, &struct_t);
+  if (mstat != MPI_SUCCESS) Error(CORE_ERR_MPI);
+
+  /* The extent of the options struct, so that the options table is sent at once */
+  mstat = MPI_Type_create_resized(struct_t, 0, sizeof(options), mpi_t);
   if (mstat != MPI_SUCCESS) Error(CORE_ERR_MPI);
 
   mstat = MPI_Type_commit(mpi_t);
   if (mstat != MPI_SUCCESS) Error(CORE_ERR_MPI);
 
+  MPI_Type_free(&struct_t);
+
   return mstat;
 }
 
@@ -82,21 +82,66 @@ typedef struct {
   popt *popt; /**< The popt options, @see popt */
 } setup;
 
+/**
+ * @macro
+ * Resolve the pool option (runtime configuration) into the handle
+ */
+#define MOptionHandle(_mobject, _mattr_name, _mhandle)\
+  if (_mobject) {\
+    *(_mhandle) = GetOptionHandle(_mobject->board, _mattr_name);\
+    if (!(_mhandle)->name) {\
+      Message(MESSAGE_ERR, "MOptionHandle: Option '%s' could not be found\n",\
+        _mattr_name);\
+      Error(CORE_ERR_MEM);\
+    }\
+  } else {\
+    Message(MESSAGE_ERR, "MOptionHandle: Invalid object\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
+/**
+ * @macro
+ * Read the attribute for the pool task board (runtime configuration) by the option handle
+ */
+#define MReadOptionH(_mobject, _mhandle, _mdata)\
+  if (_mobject && (_mhandle).name) {\
+    int _mmstat;\
+    _mmstat = ReadAttr(&_mobject->board->attr[(_mhandle).index], _mdata);\
+    CheckStatus(_mmstat);\
+  } else {\
+    Message(MESSAGE_ERR, "MReadOptionH: Invalid object or option handle\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
+/**
+ * @macro
+ * Write the attribute for the pool task board (runtime configuration) by the option handle
+ */
+#define MWriteOptionH(_mobject, _mhandle, _mdata)\
+  if (_mobject && (_mhandle).name) {\
+    int _mmstat;\
+    _mmstat = WriteAttr(&_mobject->board->attr[(_mhandle).index], _mdata);\
+    CheckStatus(_mmstat);\
+  } else {\
+    Message(MESSAGE_ERR, "MWriteOptionH: Invalid object or option handle\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
 /**
  * @macro
  * Read the attribute for the pool task board (runtime configuration)
  */
 #define MReadOption(_mobject, _mattr_name, _mdata)\
   if (_mobject) {\
-    int _maindex, _mmstat;\
-    _maindex = GetAttributeIndex(_mobject->board->attr, _mattr_name);\
-    if (_maindex < 0) {\
+    optionHandle _mohandle;\
+    _mohandle = GetOptionHandle(_mobject->board, _mattr_name);\
+    if (!_mohandle.name) {\
       Message(MESSAGE_ERR, "MReadOption: Option '%s' could not be found\n",\
         _mattr_name);\
       Error(CORE_ERR_MEM);\
+    } else {\
+      MReadOptionH(_mobject, _mohandle, _mdata);\
     }\
-    _mmstat = ReadAttr(&_mobject->board->attr[_maindex], _mdata);\
-    CheckStatus(_mmstat);\
   } else {\
     Message(MESSAGE_ERR, "MReadOption: Invalid object\n");\
     Error(CORE_ERR_MEM);\
@@ -108,15 +153,15 @@ typedef struct {
  */
 #define MWriteOption(_mobject, _mattr_name, _mdata)\
   if (_mobject) {\
-    int _maindex, _mmstat;\
-    _maindex = GetAttributeIndex(_mobject->board->attr, _mattr_name);\
-    if (_maindex < 0) {\
+    optionHandle _mohandle;\
+    _mohandle = GetOptionHandle(_mobject->board, _mattr_name);\
+    if (!_mohandle.name) {\
       Message(MESSAGE_ERR, "MWriteOption: Option '%s' could not be found\n",\
         _mattr_name);\
       Error(CORE_ERR_MEM);\
+    } else {\
+      MWriteOptionH(_mobject, _mohandle, _mdata);\
     }\
-    _mmstat = WriteAttr(&_mobject->board->attr[_maindex], _mdata);\
-    CheckStatus(_mmstat);\
   } else {\
     Message(MESSAGE_ERR, "MWriteOption: Invalid object\n");\
     Error(CORE_ERR_MEM);\
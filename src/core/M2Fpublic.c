@@ -0,0 +1,1453 @@
+/**
+ * @file
+ * The master datafile session (public API)
+ *
+ * The master node keeps the master datafile open during the pool life, together with
+ * the pool and task groups, the pool datasets and the compound file datatypes. The data
+ * is pushed to the disk at explicit flush points (i.e. after each checkpoint), instead of
+ * reopening the file every time.
+ */
+#if HAVE_CONFIG_H
+  #include "mechanic_config.h"
+#endif
+
+#include "M2Fpublic.h"
+
+/* The parallel output is experimental, it is built on demand (-DENABLE_PARALLEL_HDF5=ON) */
+#if defined(H5_HAVE_PARALLEL) && ENABLE_PARALLEL_HDF5
+  #define SESSION_PARALLEL 1
+#endif
+
+/**
+ * @struct session
+ * The master datafile session
+ */
+static struct {
+  hid_t file; /**< The master datafile */
+  char filename[CONFIG_LEN]; /**< The master datafile name */
+  int pid; /**< The pool id of the cached groups */
+  hid_t pool; /**< The pool group */
+  hid_t tasks; /**< The tasks group */
+  unsigned int datasets; /**< The number of cached datasets */
+  hid_t dataset_location[SESSION_DATASETS]; /**< The cached datasets locations */
+  char dataset_name[SESSION_DATASETS][CONFIG_LEN]; /**< The cached datasets names */
+  hid_t dataset[SESSION_DATASETS]; /**< The cached datasets */
+  unsigned int datatypes; /**< The number of cached datatypes */
+  unsigned long long datatype_key[SESSION_DATATYPES]; /**< The cached datatypes keys */
+  hid_t datatype[SESSION_DATATYPES]; /**< The cached compound file datatypes */
+  int parallel; /**< Whether the datafile is opened collectively (MPI-IO) */
+  int shards; /**< Whether the workers write the task banks to the shard files */
+  int shard_fresh; /**< Whether the shard file has to be truncated on the next open */
+  hid_t shard; /**< The shard file of the node */
+  hid_t shard_tasks; /**< The tasks group of the shard file */
+} session = {.file = -1, .pid = -1, .pool = -1, .tasks = -1, .datasets = 0, .datatypes = 0,
+  .parallel = 0, .shards = 0, .shard_fresh = 1, .shard = -1, .shard_tasks = -1};
+
+/**
+ * @brief Create the file access property list for the master datafile
+ *
+ * @param latest Use the latest file format (libver bounds)
+ * @param cache The initial metadata cache size in kB (0 for the library default)
+ * @param alignment The alignment of the file objects in bytes, i.e. the filesystem stripe
+ * size (0 disables)
+ *
+ * @return The file access property list, negative value otherwise
+ */
+hid_t SessionAccessList(int latest, int cache, int alignment) {
+  hid_t fapl;
+  herr_t h5status;
+  H5AC_cache_config_t config;
+
+  fapl = H5Pcreate(H5P_FILE_ACCESS);
+  H5CheckStatus(fapl);
+
+  if (latest) {
+    h5status = H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+    H5CheckStatus(h5status);
+  }
+
+  if (cache > 0) {
+    config.version = H5AC__CURR_CACHE_CONFIG_VERSION;
+    h5status = H5Pget_mdc_config(fapl, &config);
+    H5CheckStatus(h5status);
+
+    config.set_initial_size = 1;
+    config.initial_size = (size_t) cache * 1024;
+    if (config.max_size < config.initial_size) config.max_size = config.initial_size;
+    if (config.min_size > config.initial_size) config.min_size = config.initial_size;
+
+    h5status = H5Pset_mdc_config(fapl, &config);
+    H5CheckStatus(h5status);
+  }
+
+  if (alignment > 0) {
+    h5status = H5Pset_alignment(fapl, SESSION_ALIGNMENT_THRESHOLD, alignment);
+    H5CheckStatus(h5status);
+  }
+
+  return fapl;
+}
+
+/**
+ * @brief Create the file creation property list for the master datafile
+ *
+ * @param page_size The page size of the paged aggregation in bytes (0 disables)
+ *
+ * @return The file creation property list, negative value otherwise
+ */
+hid_t SessionCreateList(int page_size) {
+  hid_t fcpl;
+  herr_t h5status;
+
+  fcpl = H5Pcreate(H5P_FILE_CREATE);
+  H5CheckStatus(fcpl);
+
+  if (page_size > 0) {
+#if H5_VERSION_GE(1,10,1)
+    h5status = H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_PAGE, 0, 1);
+    H5CheckStatus(h5status);
+
+    h5status = H5Pset_file_space_page_size(fcpl, page_size);
+    H5CheckStatus(h5status);
+#else
+    Message(MESSAGE_WARN, "The paged aggregation requires HDF5 1.10.1 or later, ignoring\n");
+    h5status = 0;
+#endif
+  }
+
+  return fcpl;
+}
+
+/**
+ * @brief Open the master datafile, or return the one already opened
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return The master datafile HDF5 pointer
+ */
+hid_t SessionOpen(module *m, pool *p) {
+  int latest = 0, cache = 0, alignment = 0;
+  hid_t fapl;
+
+  if (session.file >= 0 && (session.parallel || strcmp(session.filename, m->filename) == 0)) {
+    return session.file;
+  }
+  if (session.file >= 0) SessionClose(m);
+
+  MReadOption(p, "hdf5-latest-format", &latest);
+  MReadOption(p, "hdf5-metadata-cache", &cache);
+  MReadOption(p, "hdf5-alignment", &alignment);
+
+  fapl = SessionAccessList(latest, cache, alignment);
+
+  session.file = H5Fopen(m->filename, H5F_ACC_RDWR, fapl);
+  H5CheckStatus(session.file);
+
+  H5Pclose(fapl);
+
+  strncpy(session.filename, m->filename, CONFIG_LEN - 1);
+  m->datafile = session.file;
+
+  return session.file;
+}
+
+/**
+ * @brief Drop the cached groups and datasets
+ */
+static void SessionDrop(void) {
+  unsigned int i = 0;
+
+  for (i = 0; i < session.datasets; i++) {
+    H5Dclose(session.dataset[i]);
+  }
+  session.datasets = 0;
+
+  if (session.tasks >= 0) H5Gclose(session.tasks);
+  if (session.pool >= 0) H5Gclose(session.pool);
+
+  session.tasks = -1;
+  session.pool = -1;
+  session.pid = -1;
+}
+
+/**
+ * @brief Get the group of the current pool
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return The pool group HDF5 pointer
+ */
+hid_t SessionPool(module *m, pool *p) {
+  char path[CONFIG_LEN];
+  hid_t h5location;
+
+  h5location = SessionOpen(m, p);
+
+  if (session.pool >= 0 && session.pid == (int) p->pid) return session.pool;
+  SessionDrop();
+
+  sprintf(path, POOL_PATH, p->pid);
+
+  session.pool = H5Gopen2(h5location, path, H5P_DEFAULT);
+  H5CheckStatus(session.pool);
+
+  session.pid = p->pid;
+
+  return session.pool;
+}
+
+/**
+ * @brief Get the tasks group of the current pool
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return The tasks group HDF5 pointer
+ */
+hid_t SessionTasks(module *m, pool *p) {
+  hid_t group;
+
+  group = SessionPool(m, p);
+
+  if (session.tasks >= 0) return session.tasks;
+
+  session.tasks = H5Gopen2(group, TASKS_GROUP, H5P_DEFAULT);
+  H5CheckStatus(session.tasks);
+
+  return session.tasks;
+}
+
+/**
+ * @brief Open the dataset
+ *
+ * The datasets of the session pool and tasks groups (and of the shard tasks group) are kept
+ * open until the end of the session. Use SessionDatasetClose() to release the dataset.
+ *
+ * @param h5location The HDF5 location of the dataset
+ * @param name The dataset name
+ *
+ * @return The dataset HDF5 pointer
+ */
+hid_t SessionDataset(hid_t h5location, char *name) {
+  unsigned int i = 0;
+  hid_t dataset;
+
+  if (h5location >= 0 && (h5location == session.pool || h5location == session.tasks
+        || h5location == session.shard_tasks)) {
+    for (i = 0; i < session.datasets; i++) {
+      if (session.dataset_location[i] == h5location && strcmp(session.dataset_name[i], name) == 0) {
+        return session.dataset[i];
+      }
+    }
+  }
+
+  dataset = H5Dopen2(h5location, name, H5P_DEFAULT);
+  H5CheckStatus(dataset);
+
+  if (h5location >= 0 && (h5location == session.pool || h5location == session.tasks
+        || h5location == session.shard_tasks)
+      && session.datasets < SESSION_DATASETS && strlen(name) < CONFIG_LEN) {
+    session.dataset_location[session.datasets] = h5location;
+    strcpy(session.dataset_name[session.datasets], name);
+    session.dataset[session.datasets] = dataset;
+    session.datasets++;
+  }
+
+  return dataset;
+}
+
+/**
+ * @brief Release the dataset opened with SessionDataset()
+ *
+ * @param dataset The dataset HDF5 pointer
+ */
+void SessionDatasetClose(hid_t dataset) {
+  unsigned int i = 0;
+
+  for (i = 0; i < session.datasets; i++) {
+    if (session.dataset[i] == dataset) return;
+  }
+
+  H5Dclose(dataset);
+}
+
+/**
+ * @brief Forget the cached dataset (i.e. before it is removed from the file)
+ *
+ * @param h5location The HDF5 location of the dataset
+ * @param name The dataset name
+ */
+void SessionForget(hid_t h5location, char *name) {
+  unsigned int i = 0;
+
+  for (i = 0; i < session.datasets; i++) {
+    if (session.dataset_location[i] == h5location && strcmp(session.dataset_name[i], name) == 0) {
+      H5Dclose(session.dataset[i]);
+
+      session.datasets--;
+      session.dataset_location[i] = session.dataset_location[session.datasets];
+      strcpy(session.dataset_name[i], session.dataset_name[session.datasets]);
+      session.dataset[i] = session.dataset[session.datasets];
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Get the HDF5 file datatype of the storage bank
+ *
+ * The compound file datatypes are built once and cached (the key is computed from the
+ * bank name and the fields layout). Native datatypes are returned as is. The returned
+ * datatype must not be closed.
+ *
+ * @param s The storage bank
+ *
+ * @return The HDF5 file datatype
+ */
+hid_t SessionDatatype(storage *s) {
+  unsigned long long key = 14695981039346656037ULL;
+  unsigned int i = 0, j = 0;
+  size_t values[4];
+  unsigned char *c;
+  hid_t h5datatype;
+
+  if (s->layout.datatype != H5T_COMPOUND) return s->layout.datatype;
+
+  for (c = (unsigned char*) s->layout.name; c && *c; c++) {
+    key = (key ^ *c) * 1099511628211ULL;
+  }
+
+  for (i = 0; i <= s->compound_fields; i++) {
+    if (i < s->compound_fields) {
+      for (c = (unsigned char*) s->field[i].layout.name; c && *c; c++) {
+        key = (key ^ *c) * 1099511628211ULL;
+      }
+      values[0] = s->field[i].layout.datatype;
+      values[1] = s->field[i].layout.field_offset;
+      values[2] = s->field[i].layout.elements;
+      values[3] = s->field[i].layout.rank;
+    } else {
+      values[0] = s->layout.compound_size;
+      values[1] = s->compound_fields;
+      values[2] = 0;
+      values[3] = 0;
+    }
+    for (j = 0; j < 4; j++) {
+      key = (key ^ values[j]) * 1099511628211ULL;
+    }
+  }
+
+  for (i = 0; i < session.datatypes; i++) {
+    if (session.datatype_key[i] == key) return session.datatype[i];
+  }
+
+  h5datatype = CommitFileDatatype(s);
+  H5CheckStatus(h5datatype);
+
+  if (session.datatypes == SESSION_DATATYPES) {
+    H5Tclose(session.datatype[0]);
+    session.datatypes--;
+    session.datatype_key[0] = session.datatype_key[session.datatypes];
+    session.datatype[0] = session.datatype[session.datatypes];
+  }
+
+  session.datatype_key[session.datatypes] = key;
+  session.datatype[session.datatypes] = h5datatype;
+  session.datatypes++;
+
+  return h5datatype;
+}
+
+/**
+ * @brief Flush the master datafile to the disk
+ *
+ * The flush is collective for the datafile opened with the MPI-IO driver, so that it is
+ * deferred to SessionParallelClose().
+ *
+ * @param m The module pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionFlush(module *m) {
+  int mstat = SUCCESS;
+  herr_t h5status;
+
+  if (session.file >= 0 && !session.parallel) {
+    h5status = H5Fflush(session.file, H5F_SCOPE_GLOBAL);
+    H5CheckStatus(h5status);
+  }
+
+  return mstat;
+}
+
+/**
+ * @brief Close the master datafile session
+ *
+ * @param m The module pointer
+ */
+void SessionClose(module *m) {
+  unsigned int i = 0;
+
+  SessionDrop();
+
+  for (i = 0; i < session.datatypes; i++) {
+    H5Tclose(session.datatype[i]);
+  }
+  session.datatypes = 0;
+
+  if (session.file >= 0) H5Fclose(session.file);
+
+  session.file = -1;
+  session.filename[0] = '\0';
+  session.parallel = 0;
+  if (m) m->datafile = -1;
+}
+
+/**
+ * @brief Check whether the task banks are written by the workers (parallel HDF5)
+ *
+ * The parallel output is experimental. It requires the parallel HDF5 build, the core
+ * built with ENABLE_PARALLEL_HDF5 and the taskfarm mode, and it is not used with the
+ * STORAGE_STREAM banks.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 1 if the parallel output is used, 0 otherwise
+ */
+int SessionParallelMode(module *m, pool *p) {
+  int parallel = 0;
+#ifdef SESSION_PARALLEL
+  char mode[CONFIG_LEN];
+#endif
+
+  MReadOption(p, "hdf5-parallel", &parallel);
+  if (!parallel) return 0;
+
+  /* The stream datasets are extended by the master node only */
+  if (StreamBanks(p) > 0) return 0;
+
+#ifdef SESSION_PARALLEL
+  MReadOption(p, "mode", &mode);
+  if (strcmp(mode, "taskfarm") == 0 && m->mpi_size > 1) return 1;
+#endif
+
+  return 0;
+}
+
+/**
+ * @brief Check whether the datafile is opened collectively
+ *
+ * @return 1 if the datafile is opened with the MPI-IO driver, 0 otherwise
+ */
+int SessionParallel(void) {
+  return session.parallel;
+}
+
+/**
+ * @brief Open the master datafile collectively on all nodes (parallel HDF5)
+ *
+ * The master node closes its session, and all nodes open the datafile with the MPI-IO
+ * driver. The workers write the task banks (STORAGE_PM3D, STORAGE_LIST, STORAGE_PACKED,
+ * STORAGE_TEXTURE) directly with the independent I/O, and the master node updates the task
+ * board, the pool banks and the task groups. This function must be called on all nodes.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionParallelOpen(module *m, pool *p) {
+  int mstat = SUCCESS, parallel = 0;
+#ifdef SESSION_PARALLEL
+  int latest = 0, cache = 0, alignment = 0;
+  char name[CONFIG_LEN], *filename;
+  hid_t fapl;
+  herr_t h5status;
+#endif
+
+  MReadOption(p, "hdf5-parallel", &parallel);
+  if (!parallel) return mstat;
+
+  if (!SessionParallelMode(m, p)) {
+    if (m->node == MASTER) {
+      Message(MESSAGE_WARN, "The experimental parallel output requires the parallel HDF5 build, "
+          "-DENABLE_PARALLEL_HDF5=ON and the taskfarm mode, ignoring\n");
+    }
+    return mstat;
+  }
+
+#ifdef SESSION_PARALLEL
+  if (m->node == MASTER) SessionClose(m);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  MReadOption(p, "name", &name);
+  MReadOption(p, "hdf5-latest-format", &latest);
+  MReadOption(p, "hdf5-metadata-cache", &cache);
+  MReadOption(p, "hdf5-alignment", &alignment);
+
+  filename = Name(name, "-master-", "00", ".h5");
+
+  fapl = SessionAccessList(latest, cache, alignment);
+
+  h5status = H5Pset_fapl_mpio(fapl, MPI_COMM_WORLD, MPI_INFO_NULL);
+  H5CheckStatus(h5status);
+
+  session.file = H5Fopen(filename, H5F_ACC_RDWR, fapl);
+  H5CheckStatus(session.file);
+
+  H5Pclose(fapl);
+
+  strncpy(session.filename, filename, CONFIG_LEN - 1);
+  session.parallel = 1;
+  m->datafile = session.file;
+
+  free(filename);
+#endif
+
+  return mstat;
+}
+
+/**
+ * @brief Close the collectively opened master datafile (parallel HDF5)
+ *
+ * This function must be called on all nodes. The master node reopens the datafile
+ * serially on the next session access.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionParallelClose(module *m, pool *p) {
+  int mstat = SUCCESS;
+
+  if (!session.parallel) return mstat;
+
+  SessionClose(m);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  return mstat;
+}
+
+/**
+ * @brief Compute the extent of the task bank in the shard file
+ *
+ * The extent is the same as of the task bank in the master datafile, so that the task
+ * regions in both files match.
+ *
+ * @param p The current pool pointer
+ * @param s The task bank
+ * @param extent The extent of the task bank
+ *
+ * @return The rank of the task bank dataset
+ */
+static unsigned int ShardExtent(pool *p, storage *s, hsize_t *extent) {
+  unsigned int i = 0;
+
+  for (i = 0; i < MAX_RANK; i++) {
+    extent[i] = s->layout.dims[i];
+  }
+
+  if (s->layout.storage_type == STORAGE_PM3D || s->layout.storage_type == STORAGE_LIST ||
+      s->layout.storage_type == STORAGE_PACKED) {
+    extent[0] = (hsize_t) s->layout.dims[0] * p->pool_size;
+  }
+
+  if (s->layout.storage_type == STORAGE_TEXTURE) {
+    for (i = 0; i < TASK_BOARD_RANK; i++) {
+      extent[i] = (hsize_t) s->layout.dims[i] * p->board->layout.dims[i];
+    }
+  }
+
+  return StorageFileRegion(s, NULL, extent);
+}
+
+/**
+ * @brief Open the shard file of the node
+ *
+ * The shard file is truncated on the first open in the normal mode, and it is reused in
+ * the restart mode (the restarted task board points to it). The sieve buffer is disabled,
+ * so that the task regions are written through to the file (see SessionWriteTask()).
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param node The node
+ *
+ * @return The shard file HDF5 pointer
+ */
+static hid_t ShardFile(module *m, pool *p, int node) {
+  int latest = 0;
+  char *filename;
+  hid_t fapl, file;
+  herr_t h5status;
+  struct stat st;
+
+  MReadOption(p, "hdf5-latest-format", &latest);
+
+  fapl = SessionAccessList(latest, 0, 0);
+
+  h5status = H5Pset_sieve_buf_size(fapl, 0);
+  H5CheckStatus(h5status);
+
+  filename = SessionShardName(p, node);
+
+  if ((session.shard_fresh && m->mode != RESTART_MODE) || stat(filename, &st) != 0) {
+    file = H5Fcreate(filename, H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+  } else {
+    file = H5Fopen(filename, H5F_ACC_RDWR, fapl);
+  }
+  H5CheckStatus(file);
+
+  session.shard_fresh = 0;
+
+  H5Pclose(fapl);
+  free(filename);
+
+  return file;
+}
+
+/**
+ * @brief Open the tasks group of the pool in the shard file, create it if necessary
+ *
+ * @param file The shard file
+ * @param p The current pool pointer
+ *
+ * @return The tasks group HDF5 pointer
+ */
+static hid_t ShardTasks(hid_t file, pool *p) {
+  char pool_path[CONFIG_LEN], path[CONFIG_LEN];
+  hid_t group, lcpl;
+  herr_t h5status;
+
+  sprintf(pool_path, POOL_PATH, p->pid);
+  sprintf(path, POOL_PATH "/" TASKS_GROUP, p->pid);
+
+  if (H5Lexists(file, POOLS_GROUP, H5P_DEFAULT) > 0 && H5Lexists(file, pool_path, H5P_DEFAULT) > 0
+      && H5Lexists(file, path, H5P_DEFAULT) > 0) {
+    group = H5Gopen2(file, path, H5P_DEFAULT);
+    H5CheckStatus(group);
+    return group;
+  }
+
+  lcpl = H5Pcreate(H5P_LINK_CREATE);
+  H5CheckStatus(lcpl);
+
+  h5status = H5Pset_create_intermediate_group(lcpl, 1);
+  H5CheckStatus(h5status);
+
+  group = H5Gcreate2(file, path, lcpl, H5P_DEFAULT, H5P_DEFAULT);
+  H5CheckStatus(group);
+
+  H5Pclose(lcpl);
+
+  return group;
+}
+
+/**
+ * @brief Create the task bank in the shard file, if it does not exist
+ *
+ * The dataset has the full extent of the task bank. It is contiguous and never filled, so
+ * that the task region is written with a single write, and the regions not written by the
+ * node remain holes in the (sparse) shard file. The dataset is allocated early and the
+ * shard file is flushed once here, so that the task writes do not change the metadata.
+ *
+ * @param tasks The tasks group of the shard file
+ * @param p The current pool pointer
+ * @param s The task bank
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int ShardCreate(hid_t tasks, pool *p, storage *s) {
+  int mstat = SUCCESS;
+  unsigned int rank = 0;
+  hsize_t extent[MAX_RANK];
+  hid_t dataspace, dataset, dcpl;
+  herr_t h5status;
+
+  if (H5Lexists(tasks, s->layout.name, H5P_DEFAULT) > 0) return mstat;
+
+  rank = ShardExtent(p, s, extent);
+
+  dataspace = H5Screate_simple(rank, extent, NULL);
+  H5CheckStatus(dataspace);
+
+  dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  H5CheckStatus(dcpl);
+
+  h5status = H5Pset_fill_time(dcpl, H5D_FILL_TIME_NEVER);
+  H5CheckStatus(h5status);
+
+  h5status = H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_EARLY);
+  H5CheckStatus(h5status);
+
+  dataset = H5Dcreate2(tasks, s->layout.name, SessionDatatype(s), dataspace,
+      H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  H5CheckStatus(dataset);
+
+  H5Dclose(dataset);
+  H5Pclose(dcpl);
+  H5Sclose(dataspace);
+
+  h5status = H5Fflush(tasks, H5F_SCOPE_LOCAL);
+  H5CheckStatus(h5status);
+
+  return mstat;
+}
+
+/**
+ * @brief Select the task regions of the task bank owned by each node
+ *
+ * The owner is the node recorded on the task board for the computed tasks. The master node
+ * owns all other tasks (not computed, disabled, or restored from a datafile without shards).
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param bank The task bank index
+ * @param nodes The number of nodes
+ * @param spaces The dataspaces (one for each node) with the selected task regions
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int ShardMap(module *m, pool *p, unsigned int bank, int nodes, hid_t *spaces) {
+  int mstat = SUCCESS, node = 0;
+  unsigned int i = 0, tid = 0, rank = 0;
+  short ****board = NULL, *cell;
+  hsize_t extent[MAX_RANK], offsets[MAX_RANK], dims[MAX_RANK];
+  herr_t h5status;
+  task *t = NULL;
+  query *q;
+
+  rank = ShardExtent(p, &p->task->storage[bank], extent);
+
+  for (i = 0; i < (unsigned int) nodes; i++) {
+    spaces[i] = H5Screate_simple(rank, extent, NULL);
+    H5CheckStatus(spaces[i]);
+    H5Sselect_none(spaces[i]);
+  }
+
+  board = AllocateShort4(p->board);
+  ReadData(p->board, &board[0][0][0][0]);
+
+  t = M2TaskLoad(m, p, 0);
+  q = LoadSym(m, "TaskBoardMap", LOAD_DEFAULT);
+
+  for (tid = 0; tid < p->pool_size; tid++) {
+    t->tid = tid;
+
+    if (q) mstat = q(p, t);
+    CheckStatus(mstat);
+
+    cell = board[t->location[0]][t->location[1]][t->location[2]];
+    node = 0;
+    if (cell[0] != TASK_AVAILABLE && cell[1] > 0 && cell[1] < nodes) node = cell[1];
+
+    TaskStorageOffsets(p, t, bank, offsets);
+    for (i = 0; i < MAX_RANK; i++) {
+      dims[i] = p->task->storage[bank].layout.dims[i];
+    }
+    StorageFileRegion(&p->task->storage[bank], offsets, dims);
+
+    h5status = H5Sselect_hyperslab(spaces[node], H5S_SELECT_OR, offsets, NULL, dims, NULL);
+    H5CheckStatus(h5status);
+  }
+
+  TaskFinalize(m, p, t);
+  free(board);
+
+  return mstat;
+}
+
+/**
+ * @brief Get the number of nodes referenced on the task board
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return The number of nodes (at least the MPI size)
+ */
+static int ShardNodes(module *m, pool *p) {
+  int nodes = m->mpi_size;
+  unsigned int i = 0;
+  short *board;
+
+  board = (short*) p->board->memory;
+  for (i = 1; i < p->board->layout.storage_elements; i += p->board->layout.dims[TASK_BOARD_RANK]) {
+    if (board[i] >= nodes) nodes = board[i] + 1;
+  }
+
+  return nodes;
+}
+
+/**
+ * @brief Write the task banks directly to the master datafile (parallel HDF5) or to the
+ * shard file of the node
+ *
+ * The task region is written with the independent I/O. Only the STORAGE_PM3D,
+ * STORAGE_LIST and STORAGE_TEXTURE banks are written, the task groups are written
+ * by the master node. The shard datasets are contiguous and allocated on creation, and the
+ * sieve buffer is disabled, so that the task region is handed to the filesystem by the
+ * write itself, before the master node marks the task finished. The shard file is not
+ * flushed per task, the metadata is flushed when the dataset is created and on close.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param t The task pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionWriteTask(module *m, pool *p, task *t) {
+  int mstat = SUCCESS;
+  unsigned int i = 0, j = 0;
+  hid_t tasks, dataset, dataspace, memspace, h5datatype;
+  hsize_t dims[MAX_RANK], offsets[MAX_RANK];
+  herr_t h5status;
+  void *buffer = NULL;
+
+  if (!session.parallel && session.shard < 0) return mstat;
+
+  tasks = session.parallel ? SessionTasks(m, p) : session.shard_tasks;
+
+  for (j = 0; j < p->task_banks; j++) {
+    if (!t->storage[j].layout.use_hdf || t->storage[j].layout.size == 0) continue;
+    if (t->storage[j].layout.storage_type != STORAGE_PM3D &&
+        t->storage[j].layout.storage_type != STORAGE_LIST &&
+        t->storage[j].layout.storage_type != STORAGE_PACKED &&
+        t->storage[j].layout.storage_type != STORAGE_TEXTURE) continue;
+
+    TaskStorageOffsets(p, t, j, offsets);
+
+    for (i = 0; i < MAX_RANK; i++) {
+      dims[i] = t->storage[j].layout.dims[i];
+    }
+
+    if (!session.parallel) {
+      mstat = ShardCreate(tasks, p, &p->task->storage[j]);
+      CheckStatus(mstat);
+    }
+
+    dataset = SessionDataset(tasks, t->storage[j].layout.name);
+    dataspace = H5Dget_space(dataset);
+    H5CheckStatus(dataspace);
+
+    memspace = H5Screate_simple(t->storage[j].layout.rank, dims, NULL);
+    H5CheckStatus(memspace);
+
+    StorageFileRegion(&t->storage[j], offsets, dims);
+
+    h5status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offsets, NULL, dims, NULL);
+    H5CheckStatus(h5status);
+
+    /* The lossy precision is applied to the copy only */
+    buffer = t->storage[j].memory;
+    if (t->storage[j].layout.precision == PRECISION_ROUND) {
+      buffer = malloc(t->storage[j].layout.size);
+      if (!buffer) Error(CORE_ERR_MEM);
+
+      memcpy(buffer, t->storage[j].memory, t->storage[j].layout.size);
+      mstat = ReducePrecision(&t->storage[j], buffer, t->storage[j].layout.elements);
+      CheckStatus(mstat);
+    }
+
+    h5datatype = SessionDatatype(&t->storage[j]);
+
+    h5status = H5Dwrite(dataset, h5datatype, memspace, dataspace, H5P_DEFAULT, buffer);
+    H5CheckStatus(h5status);
+
+    if (buffer != t->storage[j].memory) free(buffer);
+
+    H5Sclose(memspace);
+    H5Sclose(dataspace);
+    SessionDatasetClose(dataset);
+  }
+
+  return mstat;
+}
+
+/**
+ * @brief Get the shard file name of the node
+ *
+ * @param p The current pool pointer
+ * @param node The node
+ *
+ * @return The shard file name (must be freed)
+ */
+char* SessionShardName(pool *p, int node) {
+  char name[CONFIG_LEN], suffix[CONFIG_LEN];
+
+  MReadOption(p, "name", &name);
+  sprintf(suffix, "%04d", node);
+
+  return Name(name, "-shard-", suffix, ".h5");
+}
+
+/**
+ * @brief Check whether the task banks are written to the shard files
+ *
+ * The shard files require the taskfarm mode. The parallel output takes precedence.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 1 if the shard files are used, 0 otherwise
+ */
+int SessionShardMode(module *m, pool *p) {
+  int shards = 0;
+  char mode[CONFIG_LEN];
+
+  MReadOption(p, "hdf5-shards", &shards);
+  if (!shards) return 0;
+
+  MReadOption(p, "mode", &mode);
+  if (strcmp(mode, "taskfarm") != 0 || m->mpi_size < 2) return 0;
+
+  return !SessionParallelMode(m, p);
+}
+
+/**
+ * @brief Check whether the task banks are written to the shard files during the task loop
+ *
+ * @return 1 if the shard files are used, 0 otherwise
+ */
+int SessionShards(void) {
+  return session.shards;
+}
+
+/**
+ * @brief Open the shard files for the task loop
+ *
+ * Each worker writes the task banks (STORAGE_PM3D, STORAGE_LIST, STORAGE_PACKED,
+ * STORAGE_TEXTURE) to its own shard file, with the same Pools/pool-XXXX/Tasks layout as the
+ * master datafile. The master node records the computing node on the task board, and marks
+ * the tasks group of the master datafile. This function must be called on all nodes.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionShardOpen(module *m, pool *p) {
+  int mstat = SUCCESS, shards = 0, mark = 1;
+  unsigned int i = 0;
+  short *board;
+  hid_t tasks, attr_s, attr_d;
+
+  MReadOption(p, "hdf5-shards", &shards);
+  if (!shards) return mstat;
+
+  if (!SessionShardMode(m, p)) {
+    if (m->node == MASTER && !SessionParallelMode(m, p)) {
+      Message(MESSAGE_WARN, "The shard files require the taskfarm mode, ignoring\n");
+    }
+    return mstat;
+  }
+
+  /* The master node has released the shard files of the previous pool */
+  MPI_Barrier(MPI_COMM_WORLD);
+  session.shards = 1;
+
+  if (m->node == MASTER) {
+    tasks = SessionTasks(m, p);
+
+    /* The nodes recorded on the task board of a datafile without shards are stale */
+    if (H5Aexists(tasks, SHARD_ATTRIBUTE) <= 0) {
+      board = (short*) p->board->memory;
+      for (i = 1; i < p->board->layout.storage_elements; i += p->board->layout.dims[TASK_BOARD_RANK]) {
+        board[i] = 0;
+      }
+
+      attr_s = H5Screate(H5S_SCALAR);
+      H5CheckStatus(attr_s);
+
+      attr_d = H5Acreate2(tasks, SHARD_ATTRIBUTE, H5T_NATIVE_INT, attr_s, H5P_DEFAULT, H5P_DEFAULT);
+      H5CheckStatus(attr_d);
+
+      H5Awrite(attr_d, H5T_NATIVE_INT, &mark);
+
+      H5Aclose(attr_d);
+      H5Sclose(attr_s);
+    }
+
+    return mstat;
+  }
+
+  session.shard = ShardFile(m, p, m->node);
+  session.shard_tasks = ShardTasks(session.shard, p);
+
+  return mstat;
+}
+
+/**
+ * @brief Assemble the task banks of the master datafile from the shard files
+ *
+ * The task bank is replaced with the virtual dataset, which maps the task regions of each
+ * node to its shard file. The task regions owned by the master node are written to the
+ * master shard file.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int ShardAssemble(module *m, pool *p) {
+  int mstat = SUCCESS, nodes = 0, i = 0;
+  unsigned int j = 0, rank = 0;
+  char path[CONFIG_LEN], *filename, *source;
+  hsize_t extent[MAX_RANK];
+  hid_t tasks, file, group, dataset, dataspace, dcpl, *spaces;
+  herr_t h5status;
+  storage *s;
+  void *buffer = NULL;
+
+  /* The master node writes the restored tasks from its memory banks */
+  mstat = SessionFetchPool(m, p);
+  CheckStatus(mstat);
+
+  nodes = ShardNodes(m, p);
+
+  spaces = calloc(nodes, sizeof(hid_t));
+  if (!spaces) Error(CORE_ERR_MEM);
+
+  sprintf(path, POOL_PATH "/" TASKS_GROUP, p->pid);
+  tasks = SessionTasks(m, p);
+
+  for (j = 0; j < p->task_banks; j++) {
+    s = &p->task->storage[j];
+    if (!s->layout.use_hdf || s->layout.size == 0) continue;
+    if (s->layout.storage_type != STORAGE_PM3D &&
+        s->layout.storage_type != STORAGE_LIST &&
+        s->layout.storage_type != STORAGE_PACKED &&
+        s->layout.storage_type != STORAGE_TEXTURE) continue;
+
+    mstat = ShardMap(m, p, j, nodes, spaces);
+    CheckStatus(mstat);
+
+    /* The task regions owned by the master node */
+    if (H5Sget_select_npoints(spaces[0]) > 0) {
+      file = ShardFile(m, p, MASTER);
+      group = ShardTasks(file, p);
+
+      mstat = ShardCreate(group, p, s);
+      CheckStatus(mstat);
+
+      dataset = H5Dopen2(group, s->layout.name, H5P_DEFAULT);
+      H5CheckStatus(dataset);
+
+      /* The lossy precision is applied to the copy only */
+      buffer = s->memory;
+      if (s->layout.precision == PRECISION_ROUND) {
+        buffer = malloc(s->layout.storage_size);
+        if (!buffer) Error(CORE_ERR_MEM);
+
+        memcpy(buffer, s->memory, s->layout.storage_size);
+        mstat = ReducePrecision(s, buffer, s->layout.storage_elements);
+        CheckStatus(mstat);
+      }
+
+      h5status = H5Dwrite(dataset, SessionDatatype(s), spaces[0], spaces[0], H5P_DEFAULT, buffer);
+      H5CheckStatus(h5status);
+
+      if (buffer != s->memory) free(buffer);
+
+      H5Dclose(dataset);
+      H5Gclose(group);
+      H5Fclose(file);
+    }
+
+    /* The virtual dataset */
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5CheckStatus(dcpl);
+
+    for (i = 0; i < nodes; i++) {
+      if (H5Sget_select_npoints(spaces[i]) > 0) {
+        filename = SessionShardName(p, i);
+        source = strrchr(filename, '/');
+        source = source ? source + 1 : filename;
+
+        sprintf(path, POOL_PATH "/" TASKS_GROUP "/%s", p->pid, s->layout.name);
+
+        h5status = H5Pset_virtual(dcpl, spaces[i], source, path, spaces[i]);
+        H5CheckStatus(h5status);
+
+        free(filename);
+      }
+      H5Sclose(spaces[i]);
+    }
+
+    SessionForget(tasks, s->layout.name);
+    h5status = H5Ldelete(tasks, s->layout.name, H5P_DEFAULT);
+    H5CheckStatus(h5status);
+
+    rank = ShardExtent(p, s, extent);
+
+    dataspace = H5Screate_simple(rank, extent, NULL);
+    H5CheckStatus(dataspace);
+
+    dataset = H5Dcreate2(tasks, s->layout.name, SessionDatatype(s), dataspace,
+        H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5CheckStatus(dataset);
+
+    H5Dclose(dataset);
+    H5Sclose(dataspace);
+    H5Pclose(dcpl);
+  }
+
+  free(spaces);
+
+  mstat = SessionFlush(m);
+  CheckStatus(mstat);
+
+  return mstat;
+}
+
+/**
+ * @brief Close the shard files after the task loop
+ *
+ * The workers close their shard files, and the master node assembles the task banks of
+ * the master datafile. This function must be called on all nodes.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionShardClose(module *m, pool *p) {
+  int mstat = SUCCESS;
+  unsigned int i = 0;
+
+  if (!session.shards) return mstat;
+
+  if (session.shard >= 0) {
+    for (i = 0; i < session.datasets; ) {
+      if (session.dataset_location[i] == session.shard_tasks) {
+        SessionForget(session.shard_tasks, session.dataset_name[i]);
+      } else {
+        i++;
+      }
+    }
+
+    H5Gclose(session.shard_tasks);
+    H5Fclose(session.shard);
+
+    session.shard_tasks = -1;
+    session.shard = -1;
+  }
+
+  /* The shard files are closed before they are mapped */
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (m->node == MASTER) {
+    mstat = ShardAssemble(m, p);
+    CheckStatus(mstat);
+  }
+
+  session.shards = 0;
+
+  return mstat;
+}
+
+/**
+ * @brief Read the task regions computed after the last assembly from the shard files
+ *
+ * The task banks of the master datafile are assembled at the end of the task loop. When
+ * the run is restarted from a checkpoint taken during the task loop, the task regions of
+ * the computed tasks are read from the shard files of the nodes recorded on the task board.
+ * This function is called on the master node only.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param tasks The tasks group of the restart file
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionShardRestore(module *m, pool *p, hid_t tasks) {
+  int mstat = SUCCESS, nodes = 0, i = 0;
+  unsigned int j = 0;
+  char path[CONFIG_LEN], *filename;
+  hid_t file, dataset, *spaces;
+  herr_t h5status;
+  storage *s;
+  struct stat st;
+
+  if (H5Aexists(tasks, SHARD_ATTRIBUTE) <= 0) return mstat;
+
+  nodes = ShardNodes(m, p);
+
+  spaces = calloc(nodes, sizeof(hid_t));
+  if (!spaces) Error(CORE_ERR_MEM);
+
+  for (j = 0; j < p->task_banks; j++) {
+    s = &p->task->storage[j];
+    if (!s->layout.use_hdf || s->layout.size == 0) continue;
+    if (s->layout.storage_type != STORAGE_PM3D &&
+        s->layout.storage_type != STORAGE_LIST &&
+        s->layout.storage_type != STORAGE_PACKED &&
+        s->layout.storage_type != STORAGE_TEXTURE) continue;
+
+    mstat = ShardMap(m, p, j, nodes, spaces);
+    CheckStatus(mstat);
+
+    sprintf(path, POOL_PATH "/" TASKS_GROUP "/%s", p->pid, s->layout.name);
+
+    /* The task regions owned by the master node are read from the restart file */
+    for (i = 1; i < nodes; i++) {
+      filename = SessionShardName(p, i);
+
+      if (H5Sget_select_npoints(spaces[i]) > 0) {
+        if (stat(filename, &st) != 0) {
+          Message(MESSAGE_WARN, "The shard file '%s' is missing\n", filename);
+        } else {
+          file = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+          H5CheckStatus(file);
+
+          dataset = H5Dopen2(file, path, H5P_DEFAULT);
+          H5CheckStatus(dataset);
+
+          h5status = H5Dread(dataset, SessionDatatype(s), spaces[i], spaces[i], H5P_DEFAULT, s->memory);
+          H5CheckStatus(h5status);
+
+          H5Dclose(dataset);
+          H5Fclose(file);
+        }
+      }
+
+      free(filename);
+    }
+
+    for (i = 0; i < nodes; i++) {
+      H5Sclose(spaces[i]);
+    }
+  }
+
+  free(spaces);
+
+  return mstat;
+}
+
+/**
+ * @brief Get the board cell index of the task location
+ *
+ * @param p The current pool pointer
+ * @param location The task location
+ *
+ * @return The board cell index
+ */
+static unsigned int FetchCell(pool *p, unsigned int *location) {
+  return (location[0] * p->board->layout.dims[1] + location[1]) * p->board->layout.dims[2]
+    + location[2];
+}
+
+/**
+ * @brief Read the task regions of the lazily restarted task into the master memory banks
+ *
+ * The STORAGE_PM3D, STORAGE_LIST and STORAGE_TEXTURE regions and the task group datasets
+ * are read from the master datafile only once, when the task is restored. This function
+ * is called on the master node only.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param t The task pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionFetchTask(module *m, pool *p, task *t) {
+  int mstat = SUCCESS;
+  unsigned int i = 0, j = 0, cell = 0, rank = 0;
+  char path[CONFIG_LEN];
+  hsize_t dims[MAX_RANK], extent[MAX_RANK], offsets[MAX_RANK];
+  hid_t tasks, group, dataset, dataspace, memspace;
+  herr_t h5status;
+  storage *s;
+
+  if (!p->restored) return mstat;
+
+  cell = FetchCell(p, t->location);
+  if (!p->restored[cell]) return mstat;
+
+  tasks = SessionTasks(m, p);
+
+  for (j = 0; j < p->task_banks; j++) {
+    s = &p->task->storage[j];
+    if (!s->layout.use_hdf || s->layout.size == 0) continue;
+    if (s->layout.storage_type == STORAGE_STREAM) continue;
+
+    if (s->layout.storage_type == STORAGE_GROUP) {
+      sprintf(path, TASK_PATH, t->tid);
+      group = H5Gopen2(tasks, path, H5P_DEFAULT);
+      H5CheckStatus(group);
+
+      ReadDataset(group, 1, &p->tasks[t->tid]->storage[j], 1);
+      H5Gclose(group);
+      continue;
+    }
+
+    TaskStorageOffsets(p, t, j, offsets);
+    for (i = 0; i < MAX_RANK; i++) {
+      dims[i] = t->storage[j].layout.dims[i];
+      extent[i] = s->layout.storage_dim[i];
+    }
+
+    /* The memory bank has the same element order as the dataset */
+    rank = StorageFileRegion(s, offsets, dims);
+    StorageFileRegion(s, NULL, extent);
+
+    dataset = SessionDataset(tasks, s->layout.name);
+    dataspace = H5Dget_space(dataset);
+    H5CheckStatus(dataspace);
+
+    h5status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offsets, NULL, dims, NULL);
+    H5CheckStatus(h5status);
+
+    memspace = H5Screate_simple(rank, extent, NULL);
+    H5CheckStatus(memspace);
+
+    h5status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, offsets, NULL, dims, NULL);
+    H5CheckStatus(h5status);
+
+    h5status = H5Dread(dataset, SessionDatatype(s), memspace, dataspace, H5P_DEFAULT, s->memory);
+    H5CheckStatus(h5status);
+
+    H5Sclose(memspace);
+    H5Sclose(dataspace);
+    SessionDatasetClose(dataset);
+  }
+
+  p->restored[cell] = 0;
+
+  return mstat;
+}
+
+/**
+ * @brief Read all remaining task regions of the lazily restarted pool
+ *
+ * Each task bank is read with a single read of the restored task regions. The regions of
+ * the tasks computed after the restart are kept (they may not be in the master datafile
+ * yet). This function is called on the master node only.
+ *
+ * @param m The module pointer
+ * @param p The pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionFetchPool(module *m, pool *p) {
+  int mstat = SUCCESS;
+  unsigned int i = 0, j = 0, tid = 0, cell = 0, fetched = 0, rank = 0;
+  char path[CONFIG_LEN];
+  hsize_t dims[MAX_RANK], extent[MAX_RANK], offsets[MAX_RANK];
+  hid_t tasks, group, dataset, memspace;
+  herr_t h5status;
+  storage *s;
+  task *t = NULL;
+  query *q;
+
+  if (m->node != MASTER || !p->restored) return mstat;
+
+  tasks = SessionTasks(m, p);
+  t = M2TaskLoad(m, p, 0);
+  q = LoadSym(m, "TaskBoardMap", LOAD_DEFAULT);
+
+  for (j = 0; j < p->task_banks; j++) {
+    s = &p->task->storage[j];
+    if (!s->layout.use_hdf || s->layout.size == 0) continue;
+    if (s->layout.storage_type == STORAGE_STREAM) continue;
+
+    for (i = 0; i < MAX_RANK; i++) {
+      extent[i] = s->layout.storage_dim[i];
+    }
+
+    /* The memory bank has the same element order as the dataset */
+    rank = StorageFileRegion(s, NULL, extent);
+
+    memspace = H5Screate_simple(rank, extent, NULL);
+    H5CheckStatus(memspace);
+    H5Sselect_none(memspace);
+
+    fetched = 0;
+    for (tid = 0; tid < p->pool_size; tid++) {
+      t->tid = tid;
+
+      if (q) mstat = q(p, t);
+      CheckStatus(mstat);
+
+      cell = FetchCell(p, t->location);
+      if (!p->restored[cell]) continue;
+
+      if (s->layout.storage_type == STORAGE_GROUP) {
+        sprintf(path, TASK_PATH, tid);
+        group = H5Gopen2(tasks, path, H5P_DEFAULT);
+        H5CheckStatus(group);
+
+        ReadDataset(group, 1, &p->tasks[tid]->storage[j], 1);
+        H5Gclose(group);
+        continue;
+      }
+
+      TaskStorageOffsets(p, t, j, offsets);
+      for (i = 0; i < MAX_RANK; i++) {
+        dims[i] = s->layout.dims[i];
+      }
+      StorageFileRegion(s, offsets, dims);
+
+      h5status = H5Sselect_hyperslab(memspace, H5S_SELECT_OR, offsets, NULL, dims, NULL);
+      H5CheckStatus(h5status);
+      fetched++;
+    }
+
+    /* The memory bank has the extent of the dataset */
+    if (fetched > 0) {
+      dataset = SessionDataset(tasks, s->layout.name);
+
+      h5status = H5Dread(dataset, SessionDatatype(s), memspace, memspace, H5P_DEFAULT, s->memory);
+      H5CheckStatus(h5status);
+
+      SessionDatasetClose(dataset);
+    }
+
+    H5Sclose(memspace);
+  }
+
+  TaskFinalize(m, p, t);
+
+  Message(MESSAGE_DEBUG, "[%s:%d] Pool %04d task data fetched\n", __FILE__, __LINE__, p->pid);
+
+  free(p->restored);
+  p->restored = NULL;
+
+  return mstat;
+}
+
+/**
+ * @brief Read the lazily restarted pools before the module hook accesses them
+ *
+ * The pools are read only when the module implements the hook (the core hooks do not
+ * access the task data). This function is called on the master node only.
+ *
+ * @param m The module pointer
+ * @param all The pointer to the all pools (NULL for the current pool only)
+ * @param p The current pool pointer
+ * @param hook The hook name
+ *
+ * @return 0 on success, error code otherwise
+ */
+int SessionFetchHook(module *m, pool **all, pool *p, char *hook) {
+  int mstat = SUCCESS;
+  unsigned int i = 0;
+
+  if (m->node != MASTER) return mstat;
+
+  dlerror();
+  if (!dlsym(m->layer->handler, hook)) return mstat;
+
+  if (!all) return SessionFetchPool(m, p);
+
+  for (i = 0; i <= p->pid; i++) {
+    if (all[i] && all[i]->restored) {
+      mstat = SessionFetchPool(m, all[i]);
+      CheckStatus(mstat);
+    }
+  }
+
+  return mstat;
+}
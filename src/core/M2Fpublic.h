@@ -0,0 +1,45 @@
+/**
+ * @file
+ * The master datafile session (public API)
+ */
+#ifndef MECHANIC_M2F_PUBLIC_H
+#define MECHANIC_M2F_PUBLIC_H
+
+#include "M2Apublic.h"
+#include "M2Epublic.h"
+#include "M2Spublic.h"
+#include "M2Tpublic.h"
+
+#define SESSION_DATASETS 64 /**< The maximum number of cached datasets */
+#define SESSION_DATATYPES 64 /**< The maximum number of cached compound datatypes */
+#define SESSION_ALIGNMENT_THRESHOLD 65536 /**< Only objects larger than this are aligned */
+#define SHARD_ATTRIBUTE "Shards" /**< Marks the tasks group written to the shard files */
+
+hid_t SessionAccessList(int latest, int cache, int alignment);
+hid_t SessionCreateList(int page_size);
+hid_t SessionOpen(module *m, pool *p);
+hid_t SessionPool(module *m, pool *p);
+hid_t SessionTasks(module *m, pool *p);
+hid_t SessionDataset(hid_t h5location, char *name);
+void SessionDatasetClose(hid_t dataset);
+void SessionForget(hid_t h5location, char *name);
+hid_t SessionDatatype(storage *s);
+int SessionFlush(module *m);
+void SessionClose(module *m);
+int SessionParallelMode(module *m, pool *p);
+int SessionParallel(void);
+int SessionParallelOpen(module *m, pool *p);
+int SessionParallelClose(module *m, pool *p);
+int SessionWriteTask(module *m, pool *p, task *t);
+char* SessionShardName(pool *p, int node);
+int SessionShardMode(module *m, pool *p);
+int SessionShards(void);
+int SessionShardOpen(module *m, pool *p);
+int SessionShardClose(module *m, pool *p);
+int SessionShardRestore(module *m, pool *p, hid_t tasks);
+int SessionFetchTask(module *m, pool *p, task *t);
+int SessionFetchPool(module *m, pool *p);
+int SessionFetchHook(module *m, pool **all, pool *p, char *hook);
+
+#endif
+
@@ -0,0 +1,648 @@
+/**
+ * @file
+ * The live metrics and the timeline trace of the task loop (public API)
+ *
+ * With the `metrics` option, the master node keeps the counters of the task loop (the
+ * task states, the received data, the checkpoint flush latency and the idle time of each
+ * worker) and rewrites the metrics file in the Prometheus text exposition format every
+ * `metrics-interval` seconds. The counters are updated in constant time, and the file is
+ * replaced atomically (written aside and renamed), so that it may be read at any time,
+ * i.e. by the node_exporter textfile collector.
+ *
+ * With the `trace` option, each node records the timestamped events of the pool into its
+ * in-memory ring buffer (the oldest events are overwritten). At the end of the pool, the
+ * buffers are sent to the master node, which writes the Chrome trace file
+ * (`name-trace-XXXX.json`, where `XXXX` is the pool id), to be opened with Perfetto or
+ * chrome://tracing.
+ */
+#include <limits.h>
+
+#include "M2Ipublic.h"
+
+/**
+ * @struct metrics
+ * The metrics of the current pool
+ */
+static struct {
+  int enabled; /**< Whether the metrics are collected */
+  char filename[CONFIG_LEN]; /**< The metrics file */
+  char temporary[CONFIG_LEN + sizeof(METRICS_SUFFIX)]; /**< The metrics file being written */
+  int interval; /**< The metrics file update interval in seconds */
+  int pid; /**< The pool id */
+  unsigned int pool_size; /**< The number of tasks in the pool */
+  unsigned int started; /**< The number of completed tasks when the task loop started */
+  unsigned int completed; /**< The number of completed tasks at the last update */
+  unsigned int in_flight; /**< The number of tasks sent to the workers */
+  double start; /**< The wall time of the task loop start */
+  double written; /**< The wall time of the last update */
+  double rate; /**< The task rate between the last two updates */
+  unsigned long long messages; /**< The number of received messages */
+  unsigned long long bytes; /**< The number of received bytes */
+  unsigned long long checkpoints; /**< The number of checkpoint flushes */
+  double flush_sum; /**< The total checkpoint flush time */
+  double flush_last; /**< The last checkpoint flush time */
+  double flush_max; /**< The longest checkpoint flush time */
+  int nodes; /**< The number of nodes */
+  double *idle; /**< The idle time of each node */
+  double *idle_since; /**< The wall time the node became idle, 0 if busy */
+  unsigned long long *tasks; /**< The number of tasks completed by each node */
+  unsigned char *busy; /**< Whether the node computes the task */
+  int failed; /**< Whether the metrics file could not be written */
+} metrics = {.enabled = 0, .nodes = 0, .idle = NULL, .idle_since = NULL, .tasks = NULL,
+  .busy = NULL, .failed = 0};
+
+/**
+ * @brief Write the metrics file
+ *
+ * @param now The current wall time
+ * @param completed The number of completed tasks
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int MetricsWrite(double now, unsigned int completed) {
+  double elapsed, average, eta, idle;
+  unsigned int available, done;
+  int i = 0;
+  FILE *f;
+
+  elapsed = now - metrics.start;
+  done = completed - metrics.started;
+  average = elapsed > 0 ? done / elapsed : 0.0;
+
+  available = metrics.pool_size - completed;
+  if (available > metrics.in_flight) {
+    available -= metrics.in_flight;
+  } else {
+    available = 0;
+  }
+
+  f = fopen(metrics.temporary, "w");
+  if (!f) {
+    if (!metrics.failed) Message(MESSAGE_WARN, "Could not write the metrics file %s\n", metrics.temporary);
+    metrics.failed = 1;
+    return CORE_ERR_CORE;
+  }
+
+  fprintf(f, "# HELP mechanic_pool_id The current pool ID\n");
+  fprintf(f, "# TYPE mechanic_pool_id gauge\n");
+  fprintf(f, "mechanic_pool_id %d\n", metrics.pid);
+
+  fprintf(f, "# HELP mechanic_tasks The number of tasks of the pool by the task state\n");
+  fprintf(f, "# TYPE mechanic_tasks gauge\n");
+  fprintf(f, "mechanic_tasks{pool=\"%d\",state=\"completed\"} %u\n", metrics.pid, completed);
+  fprintf(f, "mechanic_tasks{pool=\"%d\",state=\"in_flight\"} %u\n", metrics.pid, metrics.in_flight);
+  fprintf(f, "mechanic_tasks{pool=\"%d\",state=\"available\"} %u\n", metrics.pid, available);
+
+  fprintf(f, "# HELP mechanic_pool_size The number of tasks in the pool\n");
+  fprintf(f, "# TYPE mechanic_pool_size gauge\n");
+  fprintf(f, "mechanic_pool_size{pool=\"%d\"} %u\n", metrics.pid, metrics.pool_size);
+
+  fprintf(f, "# HELP mechanic_tasks_per_second The task rate since the previous update\n");
+  fprintf(f, "# TYPE mechanic_tasks_per_second gauge\n");
+  fprintf(f, "mechanic_tasks_per_second{pool=\"%d\"} %g\n", metrics.pid, metrics.rate);
+
+  fprintf(f, "# HELP mechanic_tasks_per_second_average The task rate since the task loop start\n");
+  fprintf(f, "# TYPE mechanic_tasks_per_second_average gauge\n");
+  fprintf(f, "mechanic_tasks_per_second_average{pool=\"%d\"} %g\n", metrics.pid, average);
+
+  fprintf(f, "# HELP mechanic_eta_seconds The estimated time to complete the pool\n");
+  fprintf(f, "# TYPE mechanic_eta_seconds gauge\n");
+  if (completed >= metrics.pool_size) {
+    fprintf(f, "mechanic_eta_seconds{pool=\"%d\"} 0\n", metrics.pid);
+  } else if (average > 0) {
+    eta = (metrics.pool_size - completed) / average;
+    fprintf(f, "mechanic_eta_seconds{pool=\"%d\"} %g\n", metrics.pid, eta);
+  } else {
+    fprintf(f, "mechanic_eta_seconds{pool=\"%d\"} NaN\n", metrics.pid);
+  }
+
+  fprintf(f, "# HELP mechanic_elapsed_seconds The wall time since the task loop start\n");
+  fprintf(f, "# TYPE mechanic_elapsed_seconds gauge\n");
+  fprintf(f, "mechanic_elapsed_seconds{pool=\"%d\"} %g\n", metrics.pid, elapsed);
+
+  fprintf(f, "# HELP mechanic_checkpoint_flush_seconds The checkpoint flush latency\n");
+  fprintf(f, "# TYPE mechanic_checkpoint_flush_seconds summary\n");
+  fprintf(f, "mechanic_checkpoint_flush_seconds_sum{pool=\"%d\"} %g\n", metrics.pid, metrics.flush_sum);
+  fprintf(f, "mechanic_checkpoint_flush_seconds_count{pool=\"%d\"} %llu\n", metrics.pid, metrics.checkpoints);
+
+  fprintf(f, "# HELP mechanic_checkpoint_flush_last_seconds The last checkpoint flush latency\n");
+  fprintf(f, "# TYPE mechanic_checkpoint_flush_last_seconds gauge\n");
+  fprintf(f, "mechanic_checkpoint_flush_last_seconds{pool=\"%d\"} %g\n", metrics.pid, metrics.flush_last);
+
+  fprintf(f, "# HELP mechanic_checkpoint_flush_max_seconds The longest checkpoint flush latency\n");
+  fprintf(f, "# TYPE mechanic_checkpoint_flush_max_seconds gauge\n");
+  fprintf(f, "mechanic_checkpoint_flush_max_seconds{pool=\"%d\"} %g\n", metrics.pid, metrics.flush_max);
+
+  fprintf(f, "# HELP mechanic_received_bytes_total The data received by the master node\n");
+  fprintf(f, "# TYPE mechanic_received_bytes_total counter\n");
+  fprintf(f, "mechanic_received_bytes_total{pool=\"%d\"} %llu\n", metrics.pid, metrics.bytes);
+
+  fprintf(f, "# HELP mechanic_received_messages_total The messages received by the master node\n");
+  fprintf(f, "# TYPE mechanic_received_messages_total counter\n");
+  fprintf(f, "mechanic_received_messages_total{pool=\"%d\"} %llu\n", metrics.pid, metrics.messages);
+
+  fprintf(f, "# HELP mechanic_worker_tasks_total The tasks completed by the node\n");
+  fprintf(f, "# TYPE mechanic_worker_tasks_total counter\n");
+  for (i = 0; i < metrics.nodes; i++) {
+    if (metrics.tasks[i] == 0 && !metrics.busy[i] && metrics.idle[i] == 0) continue;
+    fprintf(f, "mechanic_worker_tasks_total{pool=\"%d\",node=\"%d\"} %llu\n", metrics.pid, i, metrics.tasks[i]);
+  }
+
+  fprintf(f, "# HELP mechanic_worker_idle_seconds_total The time the node waited for the master node\n");
+  fprintf(f, "# TYPE mechanic_worker_idle_seconds_total counter\n");
+  for (i = 0; i < metrics.nodes; i++) {
+    if (metrics.tasks[i] == 0 && !metrics.busy[i] && metrics.idle[i] == 0) continue;
+    idle = metrics.idle[i];
+    if (metrics.idle_since[i] > 0) idle += now - metrics.idle_since[i];
+    fprintf(f, "mechanic_worker_idle_seconds_total{pool=\"%d\",node=\"%d\"} %g\n", metrics.pid, i, idle);
+  }
+
+  fprintf(f, "# HELP mechanic_metrics_timestamp_seconds The time of this update (Unix epoch)\n");
+  fprintf(f, "# TYPE mechanic_metrics_timestamp_seconds gauge\n");
+  fprintf(f, "mechanic_metrics_timestamp_seconds %lld\n", (long long) time(NULL));
+
+  if (fclose(f) != 0 || rename(metrics.temporary, metrics.filename) != 0) {
+    if (!metrics.failed) Message(MESSAGE_WARN, "Could not write the metrics file %s\n", metrics.filename);
+    metrics.failed = 1;
+    return CORE_ERR_CORE;
+  }
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Start collecting the metrics of the pool (master node)
+ *
+ * The metrics are collected only with the `metrics` option.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int MetricsOpen(module *m, pool *p) {
+  int i = 0;
+
+  MetricsClose(m, NULL);
+
+  MReadOption(p, "metrics", &metrics.filename);
+  MReadOption(p, "metrics-interval", &metrics.interval);
+  if (metrics.filename[0] == '\0') return SUCCESS;
+
+  sprintf(metrics.temporary, "%s%s", metrics.filename, METRICS_SUFFIX);
+
+  metrics.nodes = m->mpi_size > 0 ? m->mpi_size : 1;
+  metrics.idle = calloc(metrics.nodes, sizeof(double));
+  metrics.idle_since = calloc(metrics.nodes, sizeof(double));
+  metrics.tasks = calloc(metrics.nodes, sizeof(unsigned long long));
+  metrics.busy = calloc(metrics.nodes, sizeof(unsigned char));
+  if (!metrics.idle || !metrics.idle_since || !metrics.tasks || !metrics.busy) Error(CORE_ERR_MEM);
+
+  metrics.enabled = 1;
+  metrics.failed = 0;
+  metrics.pid = p->pid;
+  metrics.pool_size = p->pool_size;
+  metrics.started = p->completed;
+  metrics.completed = p->completed;
+  metrics.in_flight = 0;
+  metrics.rate = 0.0;
+  metrics.messages = 0;
+  metrics.bytes = 0;
+  metrics.checkpoints = 0;
+  metrics.flush_sum = 0.0;
+  metrics.flush_last = 0.0;
+  metrics.flush_max = 0.0;
+
+  metrics.start = MPI_Wtime();
+  metrics.written = metrics.start;
+
+  /* The workers wait for their first task */
+  for (i = 1; i < metrics.nodes; i++) metrics.idle_since[i] = metrics.start;
+
+  MetricsWrite(metrics.start, p->completed);
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Check whether the metrics are collected
+ *
+ * @return 1 if the metrics are collected, 0 otherwise
+ */
+int MetricsEnabled(void) {
+  return metrics.enabled;
+}
+
+/**
+ * @brief Record the message sent to the node
+ *
+ * @param node The node
+ * @param task 1 if the new task is sent, 0 otherwise (i.e. the task checkpoint reply)
+ */
+void MetricsSend(int node, int task) {
+  if (!metrics.enabled || node < 0 || node >= metrics.nodes) return;
+
+  if (metrics.idle_since[node] > 0) {
+    metrics.idle[node] += MPI_Wtime() - metrics.idle_since[node];
+    metrics.idle_since[node] = 0;
+  }
+
+  if (task && !metrics.busy[node]) {
+    metrics.busy[node] = 1;
+    metrics.in_flight++;
+  }
+}
+
+/**
+ * @brief Record the message received from the node
+ *
+ * The worker is idle until the master node replies.
+ *
+ * @param node The node
+ * @param tag The message tag
+ * @param bytes The message size
+ */
+void MetricsReceive(int node, int tag, size_t bytes) {
+  if (!metrics.enabled || node < 0 || node >= metrics.nodes) return;
+
+  metrics.messages++;
+  metrics.bytes += bytes;
+
+  if (node != MASTER) metrics.idle_since[node] = MPI_Wtime();
+
+  if (tag == TAG_RESULT) {
+    metrics.tasks[node]++;
+    if (metrics.busy[node]) {
+      metrics.busy[node] = 0;
+      metrics.in_flight--;
+    }
+  }
+}
+
+/**
+ * @brief Record the checkpoint flush
+ *
+ * @param seconds The checkpoint flush time
+ */
+void MetricsCheckpoint(double seconds) {
+  if (!metrics.enabled) return;
+
+  metrics.checkpoints++;
+  metrics.flush_sum += seconds;
+  metrics.flush_last = seconds;
+  if (seconds > metrics.flush_max) metrics.flush_max = seconds;
+}
+
+/**
+ * @brief Update the metrics file, if the update interval has passed
+ *
+ * This function is called in each iteration of the task loop.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int MetricsUpdate(module *m, pool *p) {
+  double now;
+
+  if (!metrics.enabled) return SUCCESS;
+
+  now = MPI_Wtime();
+  if (now - metrics.written < metrics.interval) return SUCCESS;
+
+  metrics.rate = (p->completed - metrics.completed) / (now - metrics.written);
+  metrics.completed = p->completed;
+  metrics.written = now;
+
+  MetricsWrite(now, p->completed);
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Write the final metrics of the pool and stop collecting the metrics
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer (NULL to discard the metrics)
+ *
+ * @return 0 on success, error code otherwise
+ */
+int MetricsClose(module *m, pool *p) {
+  double now;
+
+  if (metrics.enabled && p) {
+    now = MPI_Wtime();
+    if (now > metrics.written) {
+      metrics.rate = (p->completed - metrics.completed) / (now - metrics.written);
+    }
+    metrics.completed = p->completed;
+    metrics.written = now;
+    metrics.in_flight = 0;
+
+    MetricsWrite(now, p->completed);
+  }
+
+  metrics.enabled = 0;
+  metrics.nodes = 0;
+
+  free(metrics.idle);
+  free(metrics.idle_since);
+  free(metrics.tasks);
+  free(metrics.busy);
+
+  metrics.idle = NULL;
+  metrics.idle_since = NULL;
+  metrics.tasks = NULL;
+  metrics.busy = NULL;
+
+  return SUCCESS;
+}
+
+/**
+ * @struct trace
+ * The timeline trace of the current pool
+ */
+static struct {
+  int enabled; /**< Whether the events are recorded */
+  double origin; /**< The wall time of the pool start */
+  unsigned int size; /**< The size of the ring buffer (number of events) */
+  unsigned long long count; /**< The number of events recorded */
+  trace_event *events; /**< The ring buffer */
+} trace = {.enabled = 0, .origin = 0.0, .size = 0, .count = 0, .events = NULL};
+
+/**
+ * @struct trace_type
+ * The trace event type
+ */
+static const struct {
+  char *name; /**< The event name */
+  char *category; /**< The event category */
+  char *arg; /**< The name of the event argument */
+} trace_types[TRACE_EVENTS] = {
+  [TRACE_POOL] = {"pool", "pool", "reset"},
+  [TRACE_RESET] = {"reset", "pool", "reset"},
+  [TRACE_STAGE] = {"stage", "pool", "stage"},
+  [TRACE_TASK_LOOP] = {"task loop", "pool", "node"},
+  [TRACE_DISPATCH] = {"dispatch", "mpi", "node"},
+  [TRACE_RECEIVE] = {"receive", "mpi", "node"},
+  [TRACE_WAIT] = {"wait", "mpi", "node"},
+  [TRACE_TASK_PREPARE] = {"TaskPrepare", "task", "checkpoint"},
+  [TRACE_TASK_PROCESS] = {"TaskProcess", "task", "checkpoint"},
+  [TRACE_CHECKPOINT] = {"checkpoint", "io", "checkpoint"},
+  [TRACE_BACKUP] = {"Backup", "io", "checkpoint"},
+  [TRACE_JOURNAL] = {"journal", "io", "checkpoint"},
+  [TRACE_COMMIT_BOARD] = {"commit board", "hdf5", "checkpoint"},
+  [TRACE_COMMIT_POOL] = {"commit pool", "hdf5", "checkpoint"},
+  [TRACE_COMMIT_TASKS] = {"commit tasks", "hdf5", "checkpoint"},
+  [TRACE_FLUSH] = {"flush", "hdf5", "checkpoint"},
+};
+
+/**
+ * @brief Start recording the timeline trace of the pool
+ *
+ * The trace is recorded only with the `trace` option. The nodes are synchronized, so
+ * that the event times of all nodes start at the same moment. This function must be
+ * called on all nodes.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int TraceOpen(module *m, pool *p) {
+  int enabled = 0, size = 0;
+
+  MReadOption(p, "trace", &enabled);
+  MReadOption(p, "trace-buffer", &size);
+
+  trace.enabled = 0;
+  trace.count = 0;
+  if (!enabled || size < 1) return SUCCESS;
+
+  if (trace.size != (unsigned int) size) {
+    free(trace.events);
+    trace.events = calloc(size, sizeof(trace_event));
+    if (!trace.events) Error(CORE_ERR_MEM);
+    trace.size = size;
+  }
+
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  trace.origin = MPI_Wtime();
+  trace.enabled = 1;
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Get the start time of the trace span
+ *
+ * @return The current wall time (0 if the trace is not recorded)
+ */
+double TraceTime(void) {
+  if (!trace.enabled) return 0.0;
+  return MPI_Wtime();
+}
+
+/**
+ * @brief Record the event
+ *
+ * @param event The event type
+ * @param start The event wall time
+ * @param duration The event duration (TRACE_INSTANT for instant events)
+ * @param tid The task id (-1 if none)
+ * @param pid The pool id
+ * @param arg The event argument
+ */
+static void TraceRecord(int event, double start, double duration, int tid, int pid, int arg) {
+  trace_event *e;
+
+  e = &trace.events[trace.count % trace.size];
+  e->start = start - trace.origin;
+  e->duration = duration;
+  e->event = event;
+  e->tid = tid;
+  e->pid = pid;
+  e->arg = arg;
+
+  trace.count++;
+}
+
+/**
+ * @brief Record the span event, from the start time to now
+ *
+ * @param event The event type
+ * @param start The span start time (as returned by TraceTime())
+ * @param tid The task id (-1 if none)
+ * @param pid The pool id
+ * @param arg The event argument
+ */
+void TraceSpan(int event, double start, int tid, int pid, int arg) {
+  if (!trace.enabled) return;
+  TraceRecord(event, start, MPI_Wtime() - start, tid, pid, arg);
+}
+
+/**
+ * @brief Record the instant event
+ *
+ * @param event The event type
+ * @param tid The task id (-1 if none)
+ * @param pid The pool id
+ * @param arg The event argument
+ */
+void TraceInstant(int event, int tid, int pid, int arg) {
+  if (!trace.enabled) return;
+  TraceRecord(event, MPI_Wtime(), TRACE_INSTANT, tid, pid, arg);
+}
+
+/**
+ * @brief Write the trace events of the node
+ *
+ * The events are written in the Chrome trace event format (microseconds, one process
+ * per node).
+ *
+ * @param f The trace file
+ * @param node The node
+ * @param events The ring buffer of the node
+ * @param count The number of events recorded by the node
+ * @param first Whether the first event of the file is written
+ */
+static void TraceWrite(FILE *f, int node, trace_event *events, unsigned long long count, int *first) {
+  unsigned long long i = 0, n = 0;
+  trace_event *e;
+
+  fprintf(f, "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+      "\"args\":{\"name\":\"%s %d\"}}", *first ? "" : ",", node, node == MASTER ? "master" : "worker", node);
+  fprintf(f, ",\n{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+      "\"args\":{\"sort_index\":%d}}", node, node);
+  *first = 0;
+
+  /* The oldest events have been overwritten */
+  n = count < trace.size ? count : trace.size;
+  if (count > trace.size) {
+    fprintf(f, ",\n{\"name\":\"dropped\",\"cat\":\"trace\",\"ph\":\"i\",\"s\":\"p\",\"ts\":0,"
+        "\"pid\":%d,\"tid\":0,\"args\":{\"events\":%llu}}", node, count - trace.size);
+  }
+
+  for (i = count - n; i < count; i++) {
+    e = &events[i % trace.size];
+    if (e->event < 0 || e->event >= TRACE_EVENTS) continue;
+
+    fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",", trace_types[e->event].name, trace_types[e->event].category);
+    if (e->duration == TRACE_INSTANT) {
+      fprintf(f, "\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,", e->start * 1e6);
+    } else {
+      fprintf(f, "\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,", e->start * 1e6, e->duration * 1e6);
+    }
+    fprintf(f, "\"pid\":%d,\"tid\":0,\"args\":{\"pool\":%d", node, e->pid);
+    if (e->tid >= 0) fprintf(f, ",\"task\":%d", e->tid);
+    fprintf(f, ",\"%s\":%d}}", trace_types[e->event].arg, e->arg);
+  }
+}
+
+/**
+ * @brief Send or receive the trace events in messages of at most INT_MAX bytes
+ *
+ * The size of the ring buffer (`trace-buffer`) is not bounded by the MPI count, so that the
+ * events are transferred in chunks, as the setup is broadcast.
+ *
+ * @param events The events buffer
+ * @param count The number of events
+ * @param node The destination (the worker) or the source node (the master node)
+ * @param send Whether to send or receive the events
+ */
+static void TraceTransfer(trace_event *events, size_t count, int node, int send) {
+  size_t size = count * sizeof(trace_event), offset = 0;
+  char *buffer = (char*) events;
+  int chunk = 0, mstat = MPI_SUCCESS;
+  MPI_Status mpi_status;
+
+  while (offset < size) {
+    chunk = (size - offset > INT_MAX) ? INT_MAX : (int) (size - offset);
+
+    if (send) {
+      mstat = MPI_Send(buffer + offset, chunk, MPI_CHAR, node, TAG_TRACE, MPI_COMM_WORLD);
+    } else {
+      mstat = MPI_Recv(buffer + offset, chunk, MPI_CHAR, node, TAG_TRACE, MPI_COMM_WORLD, &mpi_status);
+    }
+    if (mstat != MPI_SUCCESS) Error(CORE_ERR_MPI);
+
+    offset += chunk;
+  }
+}
+
+/**
+ * @brief The number of events kept in the ring buffer
+ *
+ * @param count The number of events recorded
+ *
+ * @return The number of events to transfer
+ */
+static size_t TraceKept(unsigned long long count) {
+  return count < trace.size ? (size_t) count : (size_t) trace.size;
+}
+
+/**
+ * @brief Merge the timeline trace of the pool into the trace file
+ *
+ * The workers send their ring buffers to the master node one by one, so that the master
+ * node holds a single buffer at a time. Only the recorded events of the buffer are sent.
+ * This function must be called on all nodes.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int TraceClose(module *m, pool *p) {
+  int mstat = SUCCESS, node = 0, first = 1;
+  char name[CONFIG_LEN], suffix[CONFIG_LEN], *filename;
+  unsigned long long count = 0;
+  trace_event *events = NULL;
+  MPI_Status mpi_status;
+  FILE *f = NULL;
+
+  if (!trace.enabled) return mstat;
+
+  TraceRecord(TRACE_POOL, trace.origin, MPI_Wtime() - trace.origin, -1, p->pid, p->rid);
+  trace.enabled = 0;
+
+  if (m->node != MASTER) {
+    MPI_Send(&trace.count, 1, MPI_UNSIGNED_LONG_LONG, MASTER, TAG_TRACE, MPI_COMM_WORLD);
+    TraceTransfer(trace.events, TraceKept(trace.count), MASTER, 1);
+    return mstat;
+  }
+
+  MReadOption(p, "name", &name);
+  sprintf(suffix, "%04d", p->pid);
+  filename = Name(name, "-trace-", suffix, ".json");
+
+  f = fopen(filename, "w");
+  if (!f) Message(MESSAGE_WARN, "Could not write the trace file %s\n", filename);
+
+  if (f) {
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    TraceWrite(f, MASTER, trace.events, trace.count, &first);
+  }
+
+  events = calloc(trace.size, sizeof(trace_event));
+  if (!events) Error(CORE_ERR_MEM);
+
+  for (node = 1; node < m->mpi_size; node++) {
+    MPI_Recv(&count, 1, MPI_UNSIGNED_LONG_LONG, node, TAG_TRACE, MPI_COMM_WORLD, &mpi_status);
+    TraceTransfer(events, TraceKept(count), node, 0);
+    if (f) TraceWrite(f, node, events, count, &first);
+  }
+
+  if (f) {
+    fprintf(f, "\n]}\n");
+    if (fclose(f) != 0) Message(MESSAGE_WARN, "Could not write the trace file %s\n", filename);
+  }
+
+  free(events);
+  free(filename);
+
+  return mstat;
+}
+
@@ -0,0 +1,64 @@
+/**
+ * @file
+ * The live metrics and the timeline trace of the task loop (public API)
+ */
+#ifndef MECHANIC_M2I_PUBLIC_H
+#define MECHANIC_M2I_PUBLIC_H
+
+#include "M2Apublic.h"
+#include "M2Epublic.h"
+#include "M2Mpublic.h"
+#include "M2Spublic.h"
+
+#define METRICS_SUFFIX ".tmp" /**< The suffix of the metrics file being written */
+
+/* Trace events */
+#define TRACE_POOL 0 /**< The pool (span) */
+#define TRACE_RESET 1 /**< The pool reset (span) */
+#define TRACE_STAGE 2 /**< The pool stage (span) */
+#define TRACE_TASK_LOOP 3 /**< The task loop (span) */
+#define TRACE_DISPATCH 4 /**< The task sent to the worker (instant) */
+#define TRACE_RECEIVE 5 /**< The task result received by the master node (instant) */
+#define TRACE_WAIT 6 /**< Waiting for the message (span) */
+#define TRACE_TASK_PREPARE 7 /**< The TaskPrepare() hook (span) */
+#define TRACE_TASK_PROCESS 8 /**< The TaskProcess() hook (span) */
+#define TRACE_CHECKPOINT 9 /**< The checkpoint flush (span) */
+#define TRACE_BACKUP 10 /**< The master datafile backup (span) */
+#define TRACE_JOURNAL 11 /**< The checkpoint journal append (span) */
+#define TRACE_COMMIT_BOARD 12 /**< The task board commit (span) */
+#define TRACE_COMMIT_POOL 13 /**< The pool banks commit (span) */
+#define TRACE_COMMIT_TASKS 14 /**< The task banks commit (span) */
+#define TRACE_FLUSH 15 /**< The master datafile flush (span) */
+#define TRACE_EVENTS 16 /**< The number of trace events */
+
+#define TRACE_INSTANT -1.0 /**< The duration of the instant event */
+
+/**
+ * @struct trace_event
+ * The timeline trace event
+ */
+typedef struct {
+  double start; /**< The event time, since the pool start (in seconds) */
+  double duration; /**< The event duration, TRACE_INSTANT for instant events */
+  int event; /**< The event type */
+  int tid; /**< The task id (-1 if none) */
+  int pid; /**< The pool id */
+  int arg; /**< The event argument (i.e. the node or the checkpoint id) */
+} trace_event;
+
+int MetricsOpen(module *m, pool *p);
+int MetricsEnabled(void);
+void MetricsSend(int node, int task);
+void MetricsReceive(int node, int tag, size_t bytes);
+void MetricsCheckpoint(double seconds);
+int MetricsUpdate(module *m, pool *p);
+int MetricsClose(module *m, pool *p);
+
+int TraceOpen(module *m, pool *p);
+double TraceTime(void);
+void TraceSpan(int event, double start, int tid, int pid, int arg);
+void TraceInstant(int event, int tid, int pid, int arg);
+int TraceClose(module *m, pool *p);
+
+#endif
+
@@ -24,11 +24,12 @@ int main(int argc, char **argv) {
 
   char *filename = NULL, *module_name = NULL;
   char *masterfile = NULL, *masterfile_backup = NULL;
+  char *journal = NULL, *masterjournal = NULL;
   char cwd[MAXPATHLEN+1], hostname[MPI_MAX_PROCESSOR_NAME];
   int hostname_len = MPI_MAX_PROCESSOR_NAME;
 
   struct stat file;
-  hid_t h5location;
+  hid_t h5location, fapl, fcpl;
 
   int mstat = SUCCESS;
   hid_t hstat;
@@ -192,6 +193,19 @@ int main(int argc, char **argv) {
         "-master-", "00", ".h5");
       if (node == MASTER) Message(MESSAGE_DEBUG, "(Restart) Restart file: %s\n", masterfile);
       Copy(module->filename, masterfile);
+
+      // The checkpoint journal follows the restart file
+      journal = JournalName(module->filename);
+      masterjournal = JournalName(masterfile);
+      if (strcmp(journal, masterjournal) != 0) {
+        if (stat(journal, &file) == 0) {
+          Copy(journal, masterjournal);
+        } else {
+          unlink(masterjournal);
+        }
+      }
+      free(journal);
+      free(masterjournal);
       free(masterfile);
 
       // Our restart file now becomes the master file
@@ -213,12 +227,25 @@ int main(int argc, char **argv) {
     module->filename = Name(Option2String("core", "name", module->layer->setup->head),
       "-master", "-00", ".h5");
 
-    h5location = H5Fcreate(module->filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    fcpl = SessionCreateList(Option2Int("core", "hdf5-page-size", module->layer->setup->head));
+    fapl = SessionAccessList(Option2Int("core", "hdf5-latest-format", module->layer->setup->head),
+      Option2Int("core", "hdf5-metadata-cache", module->layer->setup->head),
+      Option2Int("core", "hdf5-alignment", module->layer->setup->head));
+
+    h5location = H5Fcreate(module->filename, H5F_ACC_TRUNC, fcpl, fapl);
     H5CheckStatus(h5location);
 
+    H5Pclose(fapl);
+    H5Pclose(fcpl);
+
     MechanicHeader(module, h5location);
 
     H5Fclose(h5location);
+
+    // Remove the checkpoint journal of the previous run
+    journal = JournalName(module->filename);
+    unlink(journal);
+    free(journal);
   }
 
   /**
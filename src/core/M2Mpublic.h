@@ -15,6 +15,7 @@
 #define TAG_STANDBY 49 /**< The node standby tag */
 #define TAG_RESULT 59 /**< The data result tag */
 #define TAG_CHECKPOINT 69 /**< The data checkpoint tag */
+#define TAG_TRACE 79 /**< The timeline trace tag */
 
 #define MASTER 0 /**< The master node */
 #define DEST 0
@@ -128,6 +128,30 @@ pool* PoolLoad(module *m, unsigned int pid) {
   return p;
 }
 
+/**
+ * @brief Warn when the task order is ignored by the module TaskBoardMap() hook
+ *
+ * The task order is implemented by the core TaskBoardMap() only. The warning is printed
+ * once per run.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ */
+static void TaskOrderCheck(module *m, pool *p) {
+  static int warned = 0;
+  char order[CONFIG_LEN];
+
+  if (warned) return;
+
+  MReadOption(p, "task-order", &order);
+  if (strcmp(order, "row") == 0) return;
+
+  if (LoadSym(m, "TaskBoardMap", LOAD_DEFAULT) != LoadSym(m, "TaskBoardMap", FALLBACK_ONLY)) {
+    Message(MESSAGE_WARN, "The module TaskBoardMap() overrides the task order '%s'\n", order);
+    warned = 1;
+  }
+}
+
 /**
  * @brief Prepare the pool
  *
@@ -143,6 +167,7 @@ int PoolPrepare(module *m, pool **all, pool *p) {
   setup *s = m->layer->setup;
 
   task *t;
+  refinement r;
   short ****board_buffer = NULL;
   clock_t time_in, time_out;
   double cpu_time;
@@ -150,22 +175,37 @@ int PoolPrepare(module *m, pool **all, pool *p) {
   int reset_checkpoints = 0;
   unsigned int i = 0, j = 0;
   unsigned int x = 0, y = 0, z = 0, k = 0;
+  unsigned int buffers = 0;
+  void **data = NULL;
+  size_t *sizes = NULL;
 
   if (m->node == MASTER) {
 
     p->mask_size = p->pool_size;
     p->completed = 0;
 
+    mstat = SessionFetchHook(m, all, p, "PoolPrepare");
+    CheckStatus(mstat);
+
     q = LoadSym(m, "PoolPrepare", LOAD_DEFAULT);
     if (q) mstat = q(all, p);
     CheckStatus(mstat);
 
+    mstat = SessionFetchHook(m, all, p, "BoardPrepare");
+    CheckStatus(mstat);
+
     p->state = POOL_PREPARED;
     if (p->mask_size > p->pool_size) p->mask_size = p->pool_size;
 
     mstat = PoolProcessData(m, p, s);
     CheckStatus(mstat);
 
+    TaskOrderCheck(m, p);
+
+    // Prepare the adaptive refinement
+    mstat = RefineLoad(m, p, &r);
+    CheckStatus(mstat);
+
     // Prepare the task board
     t = M2TaskLoad(m, p, 0);
     board_buffer = AllocateShort4(p->board);
@@ -194,7 +234,7 @@ int PoolPrepare(module *m, pool **all, pool *p) {
       for (y = 0; y < p->board->layout.dims[1]; y++) {
         for (z = 0; z < p->board->layout.dims[2]; z++) {
 
-          // restart mode
+          // restart mode (the tasks outside the mask are finished below)
           if (m->mode == RESTART_MODE) {
             if (board_buffer[x][y][z][0] == TASK_IN_USE) {
               board_buffer[x][y][z][0] = TASK_TO_BE_RESTARTED;
@@ -202,11 +242,6 @@ int PoolPrepare(module *m, pool **all, pool *p) {
                 board_buffer[x][y][z][2] = 0;
               }
             }
-            if (reversed) {
-              if (board_buffer[x][y][z][0] == TASK_AVAILABLE) {
-                board_buffer[x][y][z][0] = TASK_FINISHED;
-              }
-            }
           } else {
             if (reversed) {
               board_buffer[x][y][z][0] = TASK_FINISHED;
@@ -246,6 +281,8 @@ int PoolPrepare(module *m, pool **all, pool *p) {
       q = LoadSym(m, "BoardPrepare", LOAD_DEFAULT);
       if (q) t->state = q(all, p, t);
 
+      t->state = RefineState(&r, p, t);
+
       if (m->mode != RESTART_MODE) {
         if (t->state == TASK_ENABLED) {
           board_buffer[t->location[0]][t->location[1]][t->location[2]][0] = TASK_AVAILABLE;
@@ -260,12 +297,12 @@ int PoolPrepare(module *m, pool **all, pool *p) {
 
       // the logic below somehow works...
       if (m->mode == RESTART_MODE) {
-        // skip already finished tasks
+        // skip already finished tasks, and the tasks restored from their checkpoint
         if (board_buffer[t->location[0]][t->location[1]][t->location[2]][0] == TASK_FINISHED) continue;
+        if (board_buffer[t->location[0]][t->location[1]][t->location[2]][0] == TASK_TO_BE_RESTARTED) continue;
 
         if (t->state == TASK_ENABLED) {
           board_buffer[t->location[0]][t->location[1]][t->location[2]][0] = TASK_AVAILABLE;
-          if (reversed) p->completed--;
         }
 
         if (board_buffer[t->location[0]][t->location[1]][t->location[2]][0] == TASK_AVAILABLE) {
@@ -277,6 +314,23 @@ int PoolPrepare(module *m, pool **all, pool *p) {
       }
     }
 
+    // The restart mode: the tasks outside the mask are not computed. The tasks of the mask
+    // keep their state, so that the tasks not computed before the restart are available
+    if (m->mode == RESTART_MODE && reversed) {
+      for (i = p->mask_size; i < p->pool_size; i++) {
+        t->tid = i;
+
+        q = LoadSym(m, "TaskBoardMap", LOAD_DEFAULT);
+        if (q) mstat = q(p, t);
+        CheckStatus(mstat);
+
+        if (board_buffer[t->location[0]][t->location[1]][t->location[2]][0] == TASK_AVAILABLE) {
+          board_buffer[t->location[0]][t->location[1]][t->location[2]][0] = TASK_FINISHED;
+          p->completed++;
+        }
+      }
+    }
+
     time_out = clock();
     cpu_time = (double)(time_out - time_in)/CLOCKS_PER_SEC;
     if (m->showtime) Message(MESSAGE_INFO, "BoardPrepare completed. CPU time: %f\n", cpu_time);
@@ -284,47 +338,77 @@ int PoolPrepare(module *m, pool **all, pool *p) {
     WriteData(p->board, &board_buffer[0][0][0][0]);
 
     TaskFinalize(m, p, t);
+    RefineFinalize(&r);
     free(board_buffer);
 
   }
 
-  /* Broadcast pool data */
+  /**
+   * Broadcast the pool data, the pool setup and the attributes (in a single message)
+   */
+  buffers = p->board->attr_banks;
+  for (i = 0; i < p->pool_banks; i++) {
+    buffers += 1 + p->storage[i].attr_banks;
+  }
+  for (i = 0; i < p->task_banks; i++) {
+    buffers += p->task->storage[i].attr_banks;
+  }
+
+  data = calloc(buffers > 0 ? buffers : 1, sizeof(void*));
+  if (!data) Error(CORE_ERR_MEM);
+
+  sizes = calloc(buffers > 0 ? buffers : 1, sizeof(size_t));
+  if (!sizes) Error(CORE_ERR_MEM);
+
+  buffers = 0;
+
+  /* Pool data */
   for (i = 0; i < p->pool_banks; i++) {
     if (p->storage[i].layout.sync) {
       if (p->storage[i].layout.elements > 0) {
-        MPI_Bcast(&(p->storage[i].memory[0]), p->storage[i].layout.storage_size,
-            MPI_CHAR, MASTER, MPI_COMM_WORLD);
-        // Broadcast pool attributes
+        data[buffers] = p->storage[i].memory;
+        sizes[buffers++] = p->storage[i].layout.storage_size;
+        // Pool attributes
         for (j = 0; j < p->storage[i].attr_banks; j++) {
-          MPI_Bcast(&(p->storage[i].attr[j].memory[0]), p->storage[i].attr[j].layout.storage_size,
-              MPI_CHAR, MASTER, MPI_COMM_WORLD);
+          data[buffers] = p->storage[i].attr[j].memory;
+          sizes[buffers++] = p->storage[i].attr[j].layout.storage_size;
         }
       }
     }
   }
 
-  /* Broadcast pool setup */
+  /* Pool setup */
   for (i = 0; i < p->board->attr_banks; i++) {
-    MPI_Bcast(&(p->board->attr[i].memory[0]), p->board->attr[i].layout.storage_size,
-        MPI_CHAR, MASTER, MPI_COMM_WORLD);
+    data[buffers] = p->board->attr[i].memory;
+    sizes[buffers++] = p->board->attr[i].layout.storage_size;
   }
 
-  /* Broadcast task banks attributes */
+  /* Task banks attributes */
   for (i = 0; i < p->task_banks; i++) {
     if (p->task->storage[i].layout.storage_type != STORAGE_GROUP) {
       for (j = 0; j < p->task->storage[i].attr_banks; j++) {
-        MPI_Bcast(&(p->task->storage[i].attr[j].memory[0]), p->task->storage[i].attr[j].layout.storage_size,
-            MPI_CHAR, MASTER, MPI_COMM_WORLD);
+        data[buffers] = p->task->storage[i].attr[j].memory;
+        sizes[buffers++] = p->task->storage[i].attr[j].layout.storage_size;
       }
     }
   }
 
+  mstat = BroadcastData(m->node, buffers, data, sizes);
+  CheckStatus(mstat);
+
+  free(data);
+  free(sizes);
+
   return mstat;
 }
 
 /**
  * @brief Process the pool
  *
+ * With the adaptive refinement, the coarse and the refined passes are the reset loops 0 and
+ * 1 of the pool (p->rid). The module PoolProcess() hook is called after both passes, and
+ * the pool is always reset after the coarse pass (the hook return value is ignored).
+ *
  * @param m The module pointer
  * @param all The pointer to pool array (all pools)
  * @param p The current pool pointer
@@ -335,12 +419,33 @@ int PoolProcess(module *m, pool **all, pool *p) {
   int mstat = SUCCESS;
   int pool_create = 0;
   setup *s = m->layer->setup;
+  refinement r;
   query *q;
 
   if (m->node == MASTER) {
+    mstat = RefineLoad(m, p, &r);
+    CheckStatus(mstat);
+
+    // The refinement interpolates the computed tasks (after the refined pass)
+    if (r.stride > 1) {
+      mstat = SessionFetchPool(m, p);
+      CheckStatus(mstat);
+    }
+
+    mstat = RefineProcess(m, p, &r);
+    CheckStatus(mstat);
+
+    mstat = SessionFetchHook(m, all, p, "PoolProcess");
+    CheckStatus(mstat);
+
     q = LoadSym(m, "PoolProcess", LOAD_DEFAULT);
     if (q) pool_create = q(all, p);
 
+    // The coarse pass (the first reset loop) is always followed by the refined pass
+    if (r.stride > 1 && p->rid == 0) pool_create = POOL_RESET;
+
+    RefineFinalize(&r);
+
     p->state = POOL_PROCESSED;
 
     mstat = PoolProcessData(m, p, s);
@@ -373,12 +478,8 @@ int PoolProcessData(module *m, pool *p, setup *s) {
   hid_t hstat;
 
   /* Do some data processing */
-  h5location = H5Fopen(m->filename, H5F_ACC_RDWR, H5P_DEFAULT);
-  H5CheckStatus(h5location);
-
-  sprintf(path, POOL_PATH, p->pid);
-  h5pool = H5Gopen2(h5location, path, H5P_DEFAULT);
-  H5CheckStatus(h5pool);
+  h5location = SessionOpen(m, p);
+  h5pool = SessionPool(m, p);
 
   /* Process task board attributes */
   h5dataset = H5Dopen2(h5pool, p->board->layout.name, H5P_DEFAULT);
@@ -458,12 +559,12 @@ int PoolProcessData(module *m, pool *p, setup *s) {
 
   /* The last pool link */
   if (p->state == POOL_PREPARED) {
-    Message(MESSAGE_DEBUG, "Last group: %s\n", path);
+    Message(MESSAGE_DEBUG, "Last group: " POOL_PATH "\n", p->pid);
     if (H5Lexists(h5location, LAST_GROUP, H5P_DEFAULT)) {
       H5Ldelete(h5location, LAST_GROUP, H5P_DEFAULT);
     }
 
-    hstat = H5Lcreate_hard(h5pool, path, h5location, LAST_GROUP, H5P_DEFAULT, H5P_DEFAULT);
+    hstat = H5Lcreate_hard(h5pool, ".", h5location, LAST_GROUP, H5P_DEFAULT, H5P_DEFAULT);
     H5CheckStatus(hstat);
   }
 
@@ -489,13 +590,14 @@ int PoolProcessData(module *m, pool *p, setup *s) {
       // Remove the temporary dataset
       if (p->storage[i].layout.use_hdf == HDF_TEMP_STORAGE) {
         if (p->state == POOL_PROCESSED) {
+          SessionForget(h5pool, p->storage[i].layout.name);
           H5Ldelete(h5pool, p->storage[i].layout.name, H5P_DEFAULT);
         }
       }
     }
   }
 
-  h5tasks = H5Gopen2(h5pool, TASKS_GROUP, H5P_DEFAULT);
+  h5tasks = SessionTasks(m, p);
 
   /* Process all task datasets in the current pool */
   for (i = 0; i < p->task_banks; i++) {
@@ -520,6 +622,7 @@ int PoolProcessData(module *m, pool *p, setup *s) {
         // Remove the temporary dataset
         if (p->task->storage[i].layout.use_hdf == HDF_TEMP_STORAGE) {
           if (p->state == POOL_PROCESSED) {
+            SessionForget(h5tasks, p->task->storage[i].layout.name);
             H5Ldelete(h5tasks, p->task->storage[i].layout.name, H5P_DEFAULT);
           }
         }
@@ -568,9 +671,8 @@ int PoolProcessData(module *m, pool *p, setup *s) {
     }
   }
 
-  H5Gclose(h5tasks);
-  H5Gclose(h5pool);
-  H5Fclose(h5location);
+  mstat = SessionFlush(m);
+  CheckStatus(mstat);
 
   return mstat;
 }
@@ -586,8 +688,7 @@ int PoolProcessData(module *m, pool *p, setup *s) {
 int PoolReset(module *m, pool *p) {
   int mstat = SUCCESS;
   unsigned int i, j, k, l;
-  hid_t h5location, group;
-  char path[CONFIG_LEN];
+  hid_t group;
   short ****board;
 
   /* Reset the board memory banks */
@@ -609,18 +710,13 @@ int PoolReset(module *m, pool *p) {
     WriteData(p->board, &board[0][0][0][0]);
 
     /* Reset the board storage banks */
-    h5location = H5Fopen(m->filename, H5F_ACC_RDWR, H5P_DEFAULT);
-    H5CheckStatus(h5location);
-
-    sprintf(path, POOL_PATH, p->pid);
-    group = H5Gopen2(h5location, path, H5P_DEFAULT);
-    H5CheckStatus(group);
+    group = SessionPool(m, p);
 
     mstat = CommitData(group, 1, p->board);
     CheckStatus(mstat);
 
-    H5Gclose(group);
-    H5Fclose(h5location);
+    mstat = SessionFlush(m);
+    CheckStatus(mstat);
 
     free(board);
   }
@@ -640,8 +736,13 @@ int PoolReset(module *m, pool *p) {
  */
 void PoolFinalize(module *m, pool *p) {
   unsigned int i = 0;
+  query *q;
 
   if (p) {
+    // The task order of the core TaskBoardMap() (the core module only, not a module hook)
+    q = LoadSym(m, "TaskBoardOrderFinalize", FALLBACK_ONLY);
+    if (q) q(p);
+
     if (p->storage) {
       FreeMemoryLayout(m->layer->init->banks_per_pool, m->layer->init->attr_per_dataset, p->storage);
     }
@@ -666,6 +767,8 @@ void PoolFinalize(module *m, pool *p) {
       free(p->tasks);
     }
 
+    if (p->restored) free(p->restored);
+
     if (p->board) {
       for (i = 0; i < p->board->attr_banks; i++) {
         free(p->board->attr[i].layout.name);
@@ -677,3 +780,487 @@ void PoolFinalize(module *m, pool *p) {
   }
 }
 
+
+/**
+ * @brief Get the board cell index of the given location
+ *
+ * @param r The refinement pointer
+ * @param location The task board location
+ *
+ * @return The board cell index
+ */
+static unsigned int RefineCell(refinement *r, unsigned int *location) {
+  return (location[0] * r->dims[1] + location[1]) * r->dims[2] + location[2];
+}
+
+/**
+ * @brief Check whether the board location is a node of the coarse grid
+ *
+ * The last row/column/layer of the board is always a coarse node, so that the whole
+ * board is covered by the coarse cells.
+ *
+ * @param r The refinement pointer
+ * @param location The task board location
+ *
+ * @return 1 if the location is a coarse node, 0 otherwise
+ */
+static int RefineNode(refinement *r, unsigned int *location) {
+  unsigned int a;
+
+  for (a = 0; a < TASK_BOARD_RANK; a++) {
+    if (location[a] % r->stride != 0 && location[a] != r->dims[a] - 1) return 0;
+  }
+
+  return 1;
+}
+
+/**
+ * @brief Convert the memory block to doubles
+ *
+ * @param s The storage pointer (task bank)
+ * @param in The input buffer
+ * @param out The output buffer (at least `s->layout.elements` doubles)
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int RefineToDouble(storage *s, void *in, double *out) {
+  herr_t hstat;
+
+  CopyData(in, out, s->layout.elements * s->layout.datatype_size);
+  hstat = H5Tconvert(s->layout.datatype, H5T_NATIVE_DOUBLE, s->layout.elements, out, NULL, H5P_DEFAULT);
+  H5CheckStatus(hstat);
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Convert doubles to the memory block
+ *
+ * @param s The storage pointer (task bank)
+ * @param in The input buffer (modified in place)
+ * @param out The output buffer
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int RefineFromDouble(storage *s, double *in, void *out) {
+  herr_t hstat;
+  unsigned int i;
+
+  if (H5Tget_class(s->layout.datatype) == H5T_INTEGER) {
+    for (i = 0; i < s->layout.elements; i++) in[i] = floor(in[i] + 0.5);
+  }
+
+  hstat = H5Tconvert(H5T_NATIVE_DOUBLE, s->layout.datatype, s->layout.elements, in, NULL, H5P_DEFAULT);
+  H5CheckStatus(hstat);
+  CopyData(in, out, s->layout.elements * s->layout.datatype_size);
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Check whether the task bank may be interpolated
+ *
+ * @param s The storage pointer (task bank)
+ *
+ * @return 1 for the numeric, non-compound banks, 0 otherwise
+ */
+static int RefineNumeric(storage *s) {
+  H5T_class_t c;
+
+  if (s->layout.datatype == H5T_COMPOUND) return 0;
+  if (s->layout.datatype_size > sizeof(double)) return 0;
+  if (s->layout.storage_type == STORAGE_STREAM) return 0;
+
+  c = H5Tget_class(s->layout.datatype);
+  return (c == H5T_INTEGER || c == H5T_FLOAT);
+}
+
+/**
+ * @brief Walk the coarse cells of the task board
+ *
+ * For each coarse cell, the task data of its corners (coarse nodes) is restored from the
+ * pool task banks. Then, the cell is either flagged for refinement (according to the
+ * criterion), or the fine tasks inside the cell, that have not been flagged, are
+ * multilinearly interpolated from the corners and stored in the pool task banks.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param r The refinement pointer
+ * @param interpolate 0 to flag the cells, 1 to interpolate the cells
+ * @param count The number of interpolated tasks (output)
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int RefineWalk(module *m, pool *p, refinement *r, int interpolate, unsigned int *count) {
+  int mstat = SUCCESS, valid[8], flag;
+  unsigned int a, j, k, e, kmax, cell, todo;
+  unsigned int lo[TASK_BOARD_RANK], hi[TASK_BOARD_RANK], x[TASK_BOARD_RANK];
+  double v[8], w[8], f, vmin, vmax, *buffer = NULL, *acc = NULL;
+  size_t elements = 1;
+  storage *s;
+  task *c[8], *t;
+
+  for (k = 0; k < 8; k++) c[k] = M2TaskLoad(m, p, 0);
+  t = M2TaskLoad(m, p, 0);
+
+  for (j = 0; j < p->task_banks; j++) {
+    if (p->task->storage[j].layout.elements > elements) elements = p->task->storage[j].layout.elements;
+  }
+
+  buffer = calloc(elements, sizeof(double));
+  if (!buffer) Error(CORE_ERR_MEM);
+
+  acc = calloc(elements, sizeof(double));
+  if (!acc) Error(CORE_ERR_MEM);
+
+  for (lo[0] = 0; lo[0] == 0 || lo[0] < r->dims[0] - 1; lo[0] += r->stride) {
+    for (lo[1] = 0; lo[1] == 0 || lo[1] < r->dims[1] - 1; lo[1] += r->stride) {
+      for (lo[2] = 0; lo[2] == 0 || lo[2] < r->dims[2] - 1; lo[2] += r->stride) {
+
+        for (a = 0; a < TASK_BOARD_RANK; a++) {
+          hi[a] = lo[a] + r->stride;
+          if (hi[a] > r->dims[a] - 1) hi[a] = r->dims[a] - 1;
+        }
+
+        // Skip the cells with nothing to interpolate
+        if (interpolate) {
+          todo = 0;
+          for (x[0] = lo[0]; x[0] <= hi[0]; x[0]++) {
+            for (x[1] = lo[1]; x[1] <= hi[1]; x[1]++) {
+              for (x[2] = lo[2]; x[2] <= hi[2]; x[2]++) {
+                if (!RefineNode(r, x) && r->flags[RefineCell(r, x)] == 0) todo = 1;
+              }
+            }
+          }
+          if (!todo) continue;
+        }
+
+        // Restore the corners
+        for (k = 0; k < 8; k++) {
+          valid[k] = 1;
+          for (a = 0; a < TASK_BOARD_RANK; a++) {
+            if (((k >> a) & 1) && hi[a] == lo[a]) valid[k] = 0;
+            c[k]->location[a] = ((k >> a) & 1) ? hi[a] : lo[a];
+          }
+          if (!valid[k]) continue;
+
+          c[k]->tid = r->tids[RefineCell(r, c[k]->location)];
+          mstat = TaskRestore(m, p, c[k]);
+          CheckStatus(mstat);
+
+          s = &c[k]->storage[r->bank];
+          mstat = RefineToDouble(s, s->memory, buffer);
+          CheckStatus(mstat);
+          v[k] = buffer[r->field];
+        }
+
+        // Flag the cell
+        if (!interpolate) {
+          vmin = vmax = v[0];
+          for (k = 1; k < 8; k++) {
+            if (!valid[k]) continue;
+            if (v[k] < vmin) vmin = v[k];
+            if (v[k] > vmax) vmax = v[k];
+          }
+
+          flag = 0;
+          if (r->criterion == REFINE_GRADIENT && vmax - vmin > r->threshold) flag = 1;
+          if (r->criterion == REFINE_THRESHOLD && vmin < r->threshold && vmax >= r->threshold) flag = 1;
+
+          if (flag) {
+            for (x[0] = lo[0]; x[0] <= hi[0]; x[0]++) {
+              for (x[1] = lo[1]; x[1] <= hi[1]; x[1]++) {
+                for (x[2] = lo[2]; x[2] <= hi[2]; x[2]++) {
+                  r->flags[RefineCell(r, x)] = REFINE_FLAGGED;
+                }
+              }
+            }
+          }
+          continue;
+        }
+
+        // Interpolate the cell
+        for (x[0] = lo[0]; x[0] <= hi[0]; x[0]++) {
+          for (x[1] = lo[1]; x[1] <= hi[1]; x[1]++) {
+            for (x[2] = lo[2]; x[2] <= hi[2]; x[2]++) {
+              cell = RefineCell(r, x);
+              if (RefineNode(r, x) || r->flags[cell] != 0) continue;
+
+              kmax = 0;
+              for (k = 0; k < 8; k++) {
+                w[k] = 0.0;
+                if (!valid[k]) continue;
+                w[k] = 1.0;
+                for (a = 0; a < TASK_BOARD_RANK; a++) {
+                  f = (hi[a] > lo[a]) ? (double)(x[a] - lo[a]) / (double)(hi[a] - lo[a]) : 0.0;
+                  w[k] *= ((k >> a) & 1) ? f : 1.0 - f;
+                }
+                if (w[k] > w[kmax]) kmax = k;
+              }
+
+              t->tid = r->tids[cell];
+              for (a = 0; a < TASK_BOARD_RANK; a++) t->location[a] = x[a];
+
+              for (j = 0; j < p->task_banks; j++) {
+                s = &t->storage[j];
+
+                // Nearest corner for non-numeric banks
+                if (!RefineNumeric(s)) {
+                  mstat = CopyData(c[kmax]->storage[j].memory, s->memory, s->layout.size);
+                  CheckStatus(mstat);
+                  continue;
+                }
+
+                for (e = 0; e < s->layout.elements; e++) acc[e] = 0.0;
+
+                for (k = 0; k < 8; k++) {
+                  if (w[k] <= 0.0) continue;
+                  mstat = RefineToDouble(s, c[k]->storage[j].memory, buffer);
+                  CheckStatus(mstat);
+                  for (e = 0; e < s->layout.elements; e++) acc[e] += w[k] * buffer[e];
+                }
+
+                mstat = RefineFromDouble(s, acc, s->memory);
+                CheckStatus(mstat);
+              }
+
+              mstat = TaskStore(m, p, t);
+              CheckStatus(mstat);
+
+              r->flags[cell] = REFINE_INTERPOLATED;
+              (*count)++;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  free(buffer);
+  free(acc);
+
+  for (k = 0; k < 8; k++) TaskFinalize(m, p, c[k]);
+  TaskFinalize(m, p, t);
+
+  return mstat;
+}
+
+/**
+ * @brief Load the adaptive refinement setup for the current pool
+ *
+ * The refinement is enabled with the `refine` option (the coarse grid stride). The first
+ * reset loop computes the coarse grid only. Before the second reset loop, the coarse cells
+ * are flagged according to the `refine-criterion`, evaluated on the `refine-field` element
+ * of the `refine-dataset` task bank:
+ *
+ * - `gradient` - the field varies more than `refine-threshold` over the coarse cell
+ * - `threshold` - the field crosses `refine-threshold` in the coarse cell
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param r The refinement pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int RefineLoad(module *m, pool *p, refinement *r) {
+  int mstat = SUCCESS, stride = 0, field = 0, index = 0;
+  char name[CONFIG_LEN], criterion[CONFIG_LEN];
+  unsigned int i = 0, size = 0, count = 0;
+  query *q;
+  task *t;
+
+  r->stride = 0;
+  r->tids = NULL;
+  r->flags = NULL;
+
+  MReadOption(p, "refine", &stride);
+  if (stride < 2) return mstat;
+
+  MReadOption(p, "refine-dataset", &name);
+  MReadOption(p, "refine-field", &field);
+  MReadOption(p, "refine-criterion", &criterion);
+  MReadOption(p, "refine-threshold", &r->threshold);
+
+  r->bank = 0;
+  if (name[0] != CONFIG_NULL) {
+    index = GetStorageIndex(p->task->storage, name);
+    if (index < 0) {
+      Message(MESSAGE_ERR, "Refinement: the task dataset '%s' could not be found\n", name);
+      return CORE_ERR_SETUP;
+    }
+    r->bank = index;
+  }
+
+  if (r->bank >= p->task_banks || !RefineNumeric(&p->task->storage[r->bank])) {
+    Message(MESSAGE_ERR, "Refinement: the task dataset must be a numeric dataset\n");
+    return CORE_ERR_SETUP;
+  }
+
+  if (field < 0 || (unsigned int) field >= p->task->storage[r->bank].layout.elements) {
+    Message(MESSAGE_ERR, "Refinement: the field %d is out of the task dataset\n", field);
+    return CORE_ERR_SETUP;
+  }
+  r->field = field;
+
+  r->criterion = 0;
+  if (strcmp(criterion, "gradient") == 0) r->criterion = REFINE_GRADIENT;
+  if (strcmp(criterion, "threshold") == 0) r->criterion = REFINE_THRESHOLD;
+  if (r->criterion == 0) {
+    Message(MESSAGE_ERR, "Refinement: unknown criterion '%s'\n", criterion);
+    return CORE_ERR_SETUP;
+  }
+
+  r->stride = stride;
+  for (i = 0; i < TASK_BOARD_RANK; i++) {
+    r->dims[i] = p->board->layout.dims[i];
+  }
+  size = r->dims[0] * r->dims[1] * r->dims[2];
+
+  r->tids = calloc(size, sizeof(unsigned int));
+  if (!r->tids) Error(CORE_ERR_MEM);
+
+  r->flags = calloc(size, sizeof(unsigned char));
+  if (!r->flags) Error(CORE_ERR_MEM);
+
+  // The board cell to task id map
+  t = M2TaskLoad(m, p, 0);
+  q = LoadSym(m, "TaskBoardMap", LOAD_DEFAULT);
+  for (i = 0; i < p->pool_size; i++) {
+    t->tid = i;
+    if (q) mstat = q(p, t);
+    CheckStatus(mstat);
+    r->tids[RefineCell(r, t->location)] = i;
+  }
+  TaskFinalize(m, p, t);
+
+  // Flag the coarse cells
+  if (p->rid > 0) {
+    mstat = RefineWalk(m, p, r, 0, &count);
+    CheckStatus(mstat);
+  }
+
+  return mstat;
+}
+
+/**
+ * @brief Get the refinement state of the task
+ *
+ * @param r The refinement pointer
+ * @param p The current pool pointer
+ * @param t The current task pointer (after TaskBoardMap() and BoardPrepare())
+ *
+ * @return `TASK_ENABLED` if the task has to be computed, `TASK_DISABLED` otherwise
+ */
+int RefineState(refinement *r, pool *p, task *t) {
+  int node;
+
+  if (r->stride < 2 || t->state != TASK_ENABLED) return t->state;
+
+  node = RefineNode(r, t->location);
+
+  // The coarse pass
+  if (p->rid == 0) return node ? TASK_ENABLED : TASK_DISABLED;
+
+  // The refined pass
+  if (p->rid == 1) {
+    if (!node && r->flags[RefineCell(r, t->location)] == REFINE_FLAGGED) return TASK_ENABLED;
+    return TASK_DISABLED;
+  }
+
+  return t->state;
+}
+
+/**
+ * @brief Interpolate the tasks that have not been refined
+ *
+ * This function is called after the refined pass. The interpolated task data is stored in
+ * the pool task banks and the master datafile.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param r The refinement pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int RefineProcess(module *m, pool *p, refinement *r) {
+  int mstat = SUCCESS;
+  unsigned int i = 0, j = 0, size = 0, count = 0, flagged = 0;
+  char path[CONFIG_LEN];
+  hid_t h5tasks, h5task, h5dataset, h5datatype;
+  herr_t hstat;
+  void *buffer = NULL;
+
+  if (r->stride < 2 || p->rid != 1) return mstat;
+
+  size = r->dims[0] * r->dims[1] * r->dims[2];
+  for (i = 0; i < size; i++) {
+    if (r->flags[i] == REFINE_FLAGGED) flagged++;
+  }
+
+  mstat = RefineWalk(m, p, r, 1, &count);
+  CheckStatus(mstat);
+
+  Message(MESSAGE_INFO, "Refinement: %d tasks flagged, %d tasks interpolated\n", flagged, count);
+
+  /* Write the interpolated data */
+  h5tasks = SessionTasks(m, p);
+
+  for (j = 0; j < p->task_banks; j++) {
+    if (!p->task->storage[j].layout.use_hdf) continue;
+    if (p->task->storage[j].layout.storage_type == STORAGE_STREAM) continue;
+
+    if (p->task->storage[j].layout.storage_type == STORAGE_GROUP) {
+      for (i = 0; i < size; i++) {
+        if (r->flags[i] != REFINE_INTERPOLATED) continue;
+
+        sprintf(path, TASK_PATH, r->tids[i]);
+        h5task = H5Gopen2(h5tasks, path, H5P_DEFAULT);
+        H5CheckStatus(h5task);
+
+        mstat = CommitData(h5task, 1, &p->tasks[r->tids[i]]->storage[j]);
+        CheckStatus(mstat);
+
+        H5Gclose(h5task);
+      }
+    } else {
+      h5dataset = SessionDataset(h5tasks, p->task->storage[j].layout.name);
+      h5datatype = SessionDatatype(&p->task->storage[j]);
+
+      buffer = p->task->storage[j].memory;
+
+      /* The lossy precision is applied to the copy only */
+      if (p->task->storage[j].layout.precision == PRECISION_ROUND) {
+        buffer = calloc(p->task->storage[j].layout.storage_elements, p->task->storage[j].layout.datatype_size);
+        if (!buffer) Error(CORE_ERR_MEM);
+
+        memcpy(buffer, p->task->storage[j].memory, p->task->storage[j].layout.storage_size);
+        mstat = ReducePrecision(&p->task->storage[j], buffer, p->task->storage[j].layout.storage_elements);
+        CheckStatus(mstat);
+      }
+
+      hstat = H5Dwrite(h5dataset, h5datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer);
+      H5CheckStatus(hstat);
+
+      if (buffer != p->task->storage[j].memory) free(buffer);
+
+      SessionDatasetClose(h5dataset);
+    }
+  }
+
+  mstat = SessionFlush(m);
+  CheckStatus(mstat);
+
+  return mstat;
+}
+
+/**
+ * @brief Finalize the refinement
+ *
+ * @param r The refinement pointer
+ */
+void RefineFinalize(refinement *r) {
+  if (r->tids) free(r->tids);
+  if (r->flags) free(r->flags);
+  r->tids = NULL;
+  r->flags = NULL;
+}
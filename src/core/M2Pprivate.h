@@ -5,7 +5,29 @@
 #ifndef MECHANIC_M2P_PRIVATE_H
 #define MECHANIC_M2P_PRIVATE_H
 
+#include <math.h>
 #include "M2Ppublic.h"
+#include "M2Fpublic.h"
+
+#define REFINE_GRADIENT 1 /**< Refine where the field varies more than the threshold */
+#define REFINE_THRESHOLD 2 /**< Refine where the field crosses the threshold */
+#define REFINE_FLAGGED 1 /**< The board cell is flagged for refinement */
+#define REFINE_INTERPOLATED 2 /**< The board cell has been interpolated */
+
+/**
+ * @struct refinement
+ * The adaptive refinement of the task board
+ */
+typedef struct {
+  unsigned int stride; /**< The coarse grid stride */
+  unsigned int bank; /**< The task bank used by the criterion */
+  unsigned int field; /**< The element of the task bank used by the criterion */
+  int criterion; /**< The refinement criterion */
+  double threshold; /**< The criterion threshold */
+  unsigned int dims[TASK_BOARD_RANK]; /**< The task board dimensions */
+  unsigned int *tids; /**< The board cell to task id map */
+  unsigned char *flags; /**< The board cell flags */
+} refinement;
 
 pool* PoolLoad(module *m, unsigned int pid);
 int PoolPrepare(module *m, pool **all, pool *p);
@@ -15,4 +37,9 @@ void PoolFinalize(module *m, pool *p);
 
 int PoolProcessData(module *m, pool *p, setup *s);
 
+int RefineLoad(module *m, pool *p, refinement *r);
+int RefineState(refinement *r, pool *p, task *t);
+int RefineProcess(module *m, pool *p, refinement *r);
+void RefineFinalize(refinement *r);
+
 #endif
@@ -4,6 +4,41 @@
  */
 #include "M2Rprivate.h"
 
+/**
+ * @brief Mark the restored tasks of the pool for the lazy restart
+ *
+ * Only the task board and the pool banks are read at the restart. The task data of the
+ * computed and checkpointed tasks is read when the task is restored, or when a module hook
+ * accesses the pool (see SessionFetchTask() and SessionFetchPool()).
+ *
+ * @param m The module pointer
+ * @param p The pool pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int RestartLazy(module *m, pool *p) {
+  int mstat = SUCCESS;
+  unsigned int i = 0, cells = 0, restored = 0;
+  short *board;
+
+  cells = p->board->layout.dims[0] * p->board->layout.dims[1] * p->board->layout.dims[2];
+
+  p->restored = calloc(cells > 0 ? cells : 1, sizeof(unsigned char));
+  if (!p->restored) Error(CORE_ERR_MEM);
+
+  board = (short*) p->board->memory;
+  for (i = 0; i < cells; i++) {
+    if (board[i * p->board->layout.dims[TASK_BOARD_RANK]] != TASK_AVAILABLE) {
+      p->restored[i] = 1;
+      restored++;
+    }
+  }
+
+  Message(MESSAGE_INFO, "Pool %04d: %d tasks to read on demand\n", p->pid, restored);
+
+  return mstat;
+}
+
 /**
  * @brief Performs restart-related tasks
  *
@@ -14,12 +49,27 @@
  * @return 0 on success, error code otherwise
  */
 int Restart(module *m, pool **pools, unsigned int *pool_counter) {
-  int mstat = SUCCESS;
-  unsigned int i, j, k, size;
-  char path[CONFIG_LEN], task_path[CONFIG_LEN];
+  int mstat = SUCCESS, lazy = 0;
+  unsigned int i, j, k, size, buffers = 0;
+  void **data = NULL;
+  size_t *sizes = NULL;
+  char path[CONFIG_LEN], task_path[CONFIG_LEN], *journal;
   hid_t h5location, group, tasks, task_id, attr_id, hstat;
+  struct stat st;
 
   if (m->node == MASTER) {
+    /* The journal folds write the whole task banks, so they need the task data in memory */
+    lazy = Option2Int("core", "restart-lazy", m->layer->setup->head);
+    if (lazy) {
+      journal = JournalName(m->filename);
+      if (Option2Int("core", "checkpoint-journal", m->layer->setup->head) > 0 ||
+          (stat(journal, &st) == 0 && st.st_size > 0)) {
+        Message(MESSAGE_WARN, "The lazy restart is not available with the checkpoint journal\n");
+        lazy = 0;
+      }
+      free(journal);
+    }
+
     Message(MESSAGE_INFO, "Restart filename: %s\n", m->filename);
     h5location = H5Fopen(m->filename, H5F_ACC_RDONLY, H5P_DEFAULT);
     H5CheckStatus(h5location);
@@ -96,18 +146,38 @@ int Restart(module *m, pool **pools, unsigned int *pool_counter) {
       tasks = H5Gopen2(group, "Tasks", H5P_DEFAULT);
       H5CheckStatus(tasks);
 
+      /* The lazy restart reads the task data on demand (except the shard files) */
+      if (lazy && H5Aexists(tasks, SHARD_ATTRIBUTE) <= 0) {
+        mstat = RestartLazy(m, pools[i]);
+        CheckStatus(mstat);
+
+        H5Gclose(tasks);
+        H5Gclose(group);
+        continue;
+      }
+
       /* Read simple datasets */
       for (j = 0; j < pools[i]->task_banks; j++) {
         size = GetSize(pools[i]->task->storage[j].layout.rank, pools[i]->task->storage[j].layout.dims);
         if (size > 0 && pools[i]->task->storage[j].layout.use_hdf) {
           if (pools[i]->task->storage[j].layout.storage_type == STORAGE_PM3D
             || pools[i]->task->storage[j].layout.storage_type == STORAGE_LIST
+            || pools[i]->task->storage[j].layout.storage_type == STORAGE_PACKED
             || pools[i]->task->storage[j].layout.storage_type == STORAGE_TEXTURE) {
             ReadDataset(tasks, 1, &(pools[i]->task->storage[j]), pools[i]->pool_size);
           }
         }
       }
 
+      /* Read the task regions computed after the last assembly of the shard files */
+      mstat = SessionShardRestore(m, pools[i], tasks);
+      CheckStatus(mstat);
+
+      /* The restored task data is kept in the scratch file only (out-of-core) */
+      for (j = 0; j < pools[i]->task_banks; j++) {
+        StorageEvict(&(pools[i]->task->storage[j]));
+      }
+
       /* Read datasets inside TaskID groups */
       for (j = 0; j < pools[i]->pool_size; j++) {
         for (k = 0; k < pools[i]->task_banks; k++) {
@@ -115,7 +185,7 @@ int Restart(module *m, pool **pools, unsigned int *pool_counter) {
               && pools[i]->task->storage[k].layout.storage_type == STORAGE_GROUP) {
             size = GetSize(pools[i]->task->storage[k].layout.rank, pools[i]->task->storage[k].layout.dims);
             if (size > 0) {
-              sprintf(task_path, TASK_PATH, k);
+              sprintf(task_path, TASK_PATH, j);
               task_id = H5Gopen2(tasks, task_path, H5P_DEFAULT);
               H5CheckStatus(task_id);
 
@@ -131,25 +201,50 @@ int Restart(module *m, pool **pools, unsigned int *pool_counter) {
     }
 
     H5Fclose(h5location);
+
+    /* (D) Replay the checkpoints journaled after the last fold */
+    mstat = JournalReplay(m, pools, *pool_counter);
+    CheckStatus(mstat);
   }
 
-  /* Broadcast pool data */
+  /* Broadcast the pool data and the counters of all pools (in a single message) */
+  for (i = 0; i <= *pool_counter; i++) {
+    buffers += pools[i]->pool_banks + 4;
+  }
+
+  data = calloc(buffers, sizeof(void*));
+  if (!data) Error(CORE_ERR_MEM);
+
+  sizes = calloc(buffers, sizeof(size_t));
+  if (!sizes) Error(CORE_ERR_MEM);
+
+  buffers = 0;
   for (i = 0; i <= *pool_counter; i++) {
     for (j = 0; j < pools[i]->pool_banks; j++) {
       if (pools[i]->storage[j].layout.sync) {
         if (pools[i]->storage[j].layout.elements > 0) {
-          MPI_Bcast(&(pools[i]->storage[j].memory[0]), pools[i]->storage[j].layout.storage_size,
-              MPI_CHAR, MASTER, MPI_COMM_WORLD);
+          data[buffers] = pools[i]->storage[j].memory;
+          sizes[buffers++] = pools[i]->storage[j].layout.storage_size;
         }
       }
     }
     // Counters
-    MPI_Bcast(&(pools[i]->pid), 1, MPI_UNSIGNED, MASTER, MPI_COMM_WORLD);
-    MPI_Bcast(&(pools[i]->rid), 1, MPI_UNSIGNED, MASTER, MPI_COMM_WORLD);
-    MPI_Bcast(&(pools[i]->sid), 1, MPI_UNSIGNED, MASTER, MPI_COMM_WORLD);
-    MPI_Bcast(&(pools[i]->srid), 1, MPI_UNSIGNED, MASTER, MPI_COMM_WORLD);
+    data[buffers] = &(pools[i]->pid);
+    sizes[buffers++] = sizeof(pools[i]->pid);
+    data[buffers] = &(pools[i]->rid);
+    sizes[buffers++] = sizeof(pools[i]->rid);
+    data[buffers] = &(pools[i]->sid);
+    sizes[buffers++] = sizeof(pools[i]->sid);
+    data[buffers] = &(pools[i]->srid);
+    sizes[buffers++] = sizeof(pools[i]->srid);
   }
 
+  mstat = BroadcastData(m->node, buffers, data, sizes);
+  CheckStatus(mstat);
+
+  free(data);
+  free(sizes);
+
   return mstat;
 }
 
@@ -2,8 +2,19 @@
  * @file
  * The restart mode (public API)
  */
+#include <errno.h>
+
 #include "M2Rpublic.h"
 
+/**
+ * @struct region
+ * The region of the task bank dataset updated by a single checkpoint record
+ */
+typedef struct {
+  hsize_t offsets[MAX_RANK]; /**< The offsets of the region */
+  hsize_t count[MAX_RANK]; /**< The dimensions of the region */
+} region;
+
 /**
  * @brief Load the checkpoint
  *
@@ -15,6 +26,9 @@
  */
 checkpoint* CheckpointLoad(module *m, pool *p, int cid) {
   int i = 0;
+  long memory = 0, records = 0;
+  char *name = NULL;
+  struct stat st;
   checkpoint *c = NULL;
 
   /* Allocate checkpoint pointer */
@@ -29,11 +43,9 @@ checkpoint* CheckpointLoad(module *m, pool *p, int cid) {
 
   c->cid = cid;
   c->counter = 0;
-  c->size = p->checkpoint_size;
 
   /* The storage buffer */
   c->storage->layout.rank = 2;
-  c->storage->layout.dims[0] = c->size;
   c->storage->layout.dims[1] = HEADER_SIZE; // offset: tag, tid, status, location
 
   c->storage->layout.size = sizeof(int) * (HEADER_SIZE);
@@ -42,18 +54,72 @@ checkpoint* CheckpointLoad(module *m, pool *p, int cid) {
   for (i = 0; i < p->task_banks; i++) {
     c->storage->layout.dims[1] +=
       GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.dims);
-    c->storage->layout.size +=
-      GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.dims) * p->task->storage[i].layout.datatype_size;
     c->storage->layout.elements +=
       GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.dims);
   }
 
-  Message(MESSAGE_DEBUG, "[%s:%d] Checkpoint size %d %d\n", __FILE__, __LINE__,
-      c->size, c->size * c->storage->layout.size);
+  /* The task record, as packed by the workers */
+  c->storage->layout.size = PackSize(p);
+
+  /**
+   * The checkpoint is flushed when the task count, the memory budget or the wall time
+   * interval is hit first. The buffer starts small and grows up to the limit on demand
+   */
+  MReadOption(p, "checkpoint-interval", &c->interval);
+  MReadOption(p, "checkpoint-memory", &memory);
+
+  c->limit = p->checkpoint_size;
+  if (memory > 0) {
+    records = memory / c->storage->layout.size;
+    if (records < 1) records = 1;
+    if ((unsigned long) records < c->limit) c->limit = records;
+  }
+
+  c->size = c->limit;
+  if (c->size > CHECKPOINT_INITIAL_SIZE) c->size = CHECKPOINT_INITIAL_SIZE;
+  c->initial = c->size;
+
+  c->storage->layout.dims[0] = c->size;
+
+  Message(MESSAGE_DEBUG, "[%s:%d] Checkpoint size %d %d (limit %d)\n", __FILE__, __LINE__,
+      c->size, c->size * c->storage->layout.size, c->limit);
 
   c->storage->memory = calloc(c->size * c->storage->layout.size, sizeof(unsigned char));
   if (!c->storage->memory) Error(CORE_ERR_MEM);
 
+  /* The state of the master datafile, used for incremental commits */
+  c->committed = 0;
+
+  c->board = calloc(p->board->layout.size, sizeof(unsigned char));
+  if (!c->board) Error(CORE_ERR_MEM);
+
+  if (p->pool_banks > 0) {
+    c->checksums = calloc(p->pool_banks, sizeof(unsigned long long));
+    if (!c->checksums) Error(CORE_ERR_MEM);
+  }
+
+  /* The journal state */
+  c->journal = -1;
+  c->journaled = 0;
+
+  c->dirty = calloc(p->task_banks > 0 ? p->task_banks : 1, sizeof(unsigned char));
+  if (!c->dirty) Error(CORE_ERR_MEM);
+
+  c->pending = calloc(p->pool_size > 0 ? p->pool_size : 1, sizeof(unsigned char));
+  if (!c->pending) Error(CORE_ERR_MEM);
+
+  /* The journal left by the previous run has been replayed (restart mode), and has to be
+   * folded into the master datafile */
+  if (m->filename) {
+    name = JournalName(m->filename);
+    if (stat(name, &st) == 0 && st.st_size > 0) {
+      c->journaled = 1;
+      memset(c->dirty, 1, p->task_banks > 0 ? p->task_banks : 1);
+      memset(c->pending, 1, p->pool_size);
+    }
+    free(name);
+  }
+
   CheckpointReset(m, p, c, 0);
 
   return c;
@@ -73,6 +139,9 @@ int M2CheckpointPrepare(module *m, pool *p, checkpoint *c) {
   query *q = NULL;
 
   if (p->node == MASTER) {
+    mstat = SessionFetchHook(m, NULL, p, "CheckpointPrepare");
+    CheckStatus(mstat);
+
     q = LoadSym(m, "CheckpointPrepare", LOAD_DEFAULT);
     if (q) mstat = q(p, c);
     CheckStatus(mstat);
@@ -82,61 +151,466 @@ int M2CheckpointPrepare(module *m, pool *p, checkpoint *c) {
 }
 
 /**
- * @brief Process the checkpoint
+ * @brief Compute the checksum of the memory block (FNV-1a)
  *
- * @param m The module pointer
+ * @param data The memory block
+ * @param size The size of the memory block
+ *
+ * @return The checksum
+ */
+static unsigned long long CheckpointChecksum(unsigned char *data, size_t size) {
+  unsigned long long hash = 14695981039346656037ULL;
+  size_t i = 0;
+
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/**
+ * @brief Commit the task board rows changed since the last checkpoint
+ *
+ * The task board is compared row by row with the copy committed during the previous
+ * checkpoint. Consecutive changed rows are merged into a single hyperslab and the
+ * whole selection is written at once. The first checkpoint commits the full board.
+ *
+ * @param h5location The HDF5 location of the task board
  * @param p The current pool pointer
  * @param c The current checkpoint pointer
  *
  * @return 0 on success, error code otherwise
  */
-int CheckpointProcess(module *m, pool *p, checkpoint *c) {
+static int CheckpointCommitBoard(hid_t h5location, pool *p, checkpoint *c) {
+  int mstat = SUCCESS;
+  unsigned int x = 0, first = 0, rows = 0, selected = 0;
+  size_t row_size = 0;
+  hid_t dataset, dataspace, memspace;
+  hsize_t dims[MAX_RANK], offsets[MAX_RANK], count[MAX_RANK];
+  herr_t hdf_status = 0;
+
+  if (!c->committed) {
+    mstat = CommitData(h5location, 1, p->board);
+    CheckStatus(mstat);
+
+    memcpy(c->board, p->board->memory, p->board->layout.size);
+    return mstat;
+  }
+
+  rows = p->board->layout.dims[0];
+  row_size = p->board->layout.size / rows;
+
+  for (x = 0; x < MAX_RANK; x++) {
+    dims[x] = p->board->layout.dims[x];
+    offsets[x] = 0;
+    count[x] = dims[x];
+  }
+
+  dataset = SessionDataset(h5location, p->board->layout.name);
+  dataspace = H5Dget_space(dataset);
+  H5CheckStatus(dataspace);
+
+  H5Sselect_none(dataspace);
+
+  /* Merge consecutive changed rows into hyperslabs */
+  x = 0;
+  while (x < rows) {
+    if (memcmp(c->board + x * row_size, p->board->memory + x * row_size, row_size) == 0) {
+      x++;
+      continue;
+    }
+
+    first = x;
+    while (x < rows && memcmp(c->board + x * row_size, p->board->memory + x * row_size, row_size) != 0) {
+      x++;
+    }
+
+    offsets[0] = first;
+    count[0] = x - first;
+
+    hdf_status = H5Sselect_hyperslab(dataspace, H5S_SELECT_OR, offsets, NULL, count, NULL);
+    H5CheckStatus(hdf_status);
+
+    memcpy(c->board + first * row_size, p->board->memory + first * row_size, (x - first) * row_size);
+    selected += x - first;
+  }
+
+  Message(MESSAGE_DEBUG, "[%s:%d] Board rows committed: %d of %d\n", __FILE__, __LINE__, selected, rows);
+
+  if (selected > 0) {
+    memspace = H5Screate_simple(p->board->layout.rank, dims, NULL);
+    H5CheckStatus(memspace);
+
+    hdf_status = H5Sselect_copy(memspace, dataspace);
+    H5CheckStatus(hdf_status);
+
+    hdf_status = H5Dwrite(dataset, p->board->layout.datatype,
+        memspace, dataspace, H5P_DEFAULT, p->board->memory);
+    H5CheckStatus(hdf_status);
+
+    H5Sclose(memspace);
+  }
+
+  H5Sclose(dataspace);
+  SessionDatasetClose(dataset);
+
+  return mstat;
+}
+
+/**
+ * @brief Commit the pool banks modified since the last checkpoint
+ *
+ * The pool banks are usually modified only in the pool hooks, so they are written
+ * during the checkpoint only if their checksum differs from the committed one
+ * (i.e. the CheckpointPrepare() or any other hook has changed them).
+ *
+ * @param h5location The HDF5 location of the pool banks
+ * @param p The current pool pointer
+ * @param c The current checkpoint pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int CheckpointCommitPool(hid_t h5location, pool *p, checkpoint *c) {
+  int mstat = SUCCESS;
+  unsigned int i = 0;
+  unsigned long long checksum = 0;
+
+  for (i = 0; i < p->pool_banks; i++) {
+    if (!p->storage[i].layout.use_hdf || p->storage[i].layout.size == 0) continue;
+
+    checksum = CheckpointChecksum(p->storage[i].memory, p->storage[i].layout.size);
+    if (c->committed && checksum == c->checksums[i]) continue;
+
+    mstat = CommitData(h5location, 1, &p->storage[i]);
+    CheckStatus(mstat);
+
+    c->checksums[i] = checksum;
+  }
+
+  return mstat;
+}
+
+/**
+ * @brief Compare two regions by their offsets (qsort helper)
+ *
+ * @param a The first region
+ * @param b The second region
+ *
+ * @return -1, 0 or 1, as for qsort()
+ */
+static int RegionCompare(const void *a, const void *b) {
+  const region *ra = (const region*) a;
+  const region *rb = (const region*) b;
+  unsigned int i = 0;
+
+  for (i = 0; i < MAX_RANK; i++) {
+    if (ra->offsets[i] < rb->offsets[i]) return -1;
+    if (ra->offsets[i] > rb->offsets[i]) return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Commit the checkpointed regions of the task bank with a single write
+ *
+ * The regions are sorted by their file offsets, and the regions adjacent along the first
+ * dimension are merged. The resulting union of hyperslabs is written at once from the
+ * master task bank, which holds the whole dataset in the file order.
+ *
+ * @param h5location The HDF5 location of the task bank dataset
+ * @param s The master task bank
+ * @param r The regions to commit
+ * @param n The number of regions
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int CheckpointCommitBank(hid_t h5location, storage *s, region *r, unsigned int n) {
+  int mstat = SUCCESS;
+  unsigned int i = 0, j = 0, k = 0, merge = 0, rank = 0;
+  hid_t dataset, dataspace, memspace, h5datatype;
+  hsize_t dims[MAX_RANK];
+  hssize_t elements = 0;
+  herr_t hdf_status = 0;
+  void *buffer = NULL;
+
+  qsort(r, n, sizeof(region), RegionCompare);
+
+  /* Merge the adjacent regions */
+  for (i = 1; i < n; i++) {
+    merge = (r[k].offsets[0] + r[k].count[0] == r[i].offsets[0]);
+    for (j = 1; j < s->layout.rank && merge; j++) {
+      merge = (r[k].offsets[j] == r[i].offsets[j] && r[k].count[j] == r[i].count[j]);
+    }
+
+    if (merge) {
+      r[k].count[0] += r[i].count[0];
+    } else if (RegionCompare(&r[k], &r[i]) != 0) {
+      r[++k] = r[i];
+    }
+  }
+  n = k + 1;
+
+  Message(MESSAGE_DEBUG, "[%s:%d] Commit '%s' in %d regions\n", __FILE__, __LINE__, s->layout.name, n);
+
+  for (i = 0; i < MAX_RANK; i++) {
+    dims[i] = s->layout.storage_dim[i];
+  }
+
+  /* The master bank has the same element order as the dataset */
+  rank = StorageFileRegion(s, NULL, dims);
+
+  dataset = SessionDataset(h5location, s->layout.name);
+  dataspace = H5Dget_space(dataset);
+  H5CheckStatus(dataspace);
+
+  for (i = 0; i < n; i++) {
+    StorageFileRegion(s, r[i].offsets, r[i].count);
+    hdf_status = H5Sselect_hyperslab(dataspace, i == 0 ? H5S_SELECT_SET : H5S_SELECT_OR,
+        r[i].offsets, NULL, r[i].count, NULL);
+    H5CheckStatus(hdf_status);
+  }
+
+  memspace = H5Screate_simple(rank, dims, NULL);
+  H5CheckStatus(memspace);
+
+  hdf_status = H5Sselect_copy(memspace, dataspace);
+  H5CheckStatus(hdf_status);
+
+  h5datatype = SessionDatatype(s);
+
+  if (s->layout.precision == PRECISION_ROUND) {
+
+    /* Gather the selected elements, so that the master bank keeps the full precision */
+    elements = H5Sget_select_npoints(dataspace);
+    buffer = calloc(elements, s->layout.datatype_size);
+    if (!buffer) Error(CORE_ERR_MEM);
+
+    hdf_status = H5Dgather(memspace, s->memory, h5datatype, elements * s->layout.datatype_size,
+        buffer, NULL, NULL);
+    H5CheckStatus(hdf_status);
+
+    mstat = ReducePrecision(s, buffer, elements);
+    CheckStatus(mstat);
+
+    H5Sclose(memspace);
+    dims[0] = elements;
+    memspace = H5Screate_simple(1, dims, NULL);
+    H5CheckStatus(memspace);
+
+    hdf_status = H5Dwrite(dataset, h5datatype, memspace, dataspace, H5P_DEFAULT, buffer);
+    H5CheckStatus(hdf_status);
+
+    free(buffer);
+  } else {
+    hdf_status = H5Dwrite(dataset, h5datatype, memspace, dataspace, H5P_DEFAULT, s->memory);
+    H5CheckStatus(hdf_status);
+  }
+
+  H5Sclose(memspace);
+  H5Sclose(dataspace);
+  SessionDatasetClose(dataset);
+
+  return mstat;
+}
+
+/**
+ * @brief Append the stream records of the checkpoint buffer to the stream dataset
+ *
+ * The records sent with the task messages are gathered, the dataset is extended and
+ * written at once. The index dataset receives one row per task message.
+ *
+ * @param p The current pool pointer
+ * @param c The current checkpoint pointer
+ * @param h5location The HDF5 location of the stream dataset
+ * @param bank The stream task bank
+ * @param stream The number of the stream among the stream banks
+ * @param d_offset The offset of the bank in the task record
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int CheckpointStream(pool *p, checkpoint *c, hid_t h5location, unsigned int bank,
+    unsigned int stream, size_t d_offset) {
   int mstat = SUCCESS;
-  char path[CONFIG_LEN];
   int header[HEADER_SIZE] = HEADER_INIT;
-  unsigned int i = 0, j = 0, k = 0, l = 0, r = 0;
-  unsigned int c_offset = 0, d_offset = 0, e_offset = 0, l_offset = 0, k_offset = 0, z_offset = 0;
-  unsigned int s_offset = 0, r_offset = 0, dim_offset = 0;
-  size_t elements, header_size;
-  task *t = NULL;
-  hid_t h5location, group, tasks, datapath;
-  hsize_t dims[MAX_RANK], offsets[MAX_RANK];
+  char name[CONFIG_LEN];
+  unsigned int i = 0, l = 0, records = 0, rows = 0, rank = 0;
+  size_t record_size, trailer, c_offset, total = 0;
+  unsigned long long *index = NULL;
+  unsigned char *buffer = NULL;
+  storage *s;
+  hid_t dataset, dataspace, memspace, h5datatype;
+  hsize_t dims[MAX_RANK], offsets[MAX_RANK], count[MAX_RANK];
+  herr_t hdf_status = 0;
+
+  s = &p->task->storage[bank];
+  record_size = s->layout.size / s->layout.dims[0];
+  trailer = c->storage->layout.size - (StreamBanks(p) - stream) * sizeof(unsigned int);
+
+  buffer = calloc(c->size, s->layout.size);
+  if (!buffer) Error(CORE_ERR_MEM);
+
+  index = calloc(c->size * STREAM_INDEX_FIELDS, sizeof(unsigned long long));
+  if (!index) Error(CORE_ERR_MEM);
+
+  /* The current length of the stream */
+  dataset = SessionDataset(h5location, s->layout.name);
+  dataspace = H5Dget_space(dataset);
+  H5CheckStatus(dataspace);
+
+  rank = H5Sget_simple_extent_dims(dataspace, dims, NULL);
+  H5Sclose(dataspace);
 
-  header_size = sizeof(int) * (HEADER_SIZE);
+  for (i = 0; i < c->size; i++) {
+    c_offset = i * c->storage->layout.size;
 
-  Backup(m, p);
+    mstat = CopyData(c->storage->memory + c_offset, header, sizeof(int) * (HEADER_SIZE));
+    CheckStatus(mstat);
 
-  /* Commit data for the task board */
-  h5location = H5Fopen(m->filename, H5F_ACC_RDWR, H5P_DEFAULT);
-  H5CheckStatus(h5location);
+    if (header[2] == TASK_EMPTY || (header[0] != TAG_CHECKPOINT && header[0] != TAG_RESULT)) continue;
 
-  sprintf(path, POOL_PATH, p->pid);
+    mstat = CopyData(c->storage->memory + c_offset + trailer, &records, sizeof(unsigned int));
+    CheckStatus(mstat);
 
-  group = H5Gopen2(h5location, path, H5P_DEFAULT);
-  H5CheckStatus(group);
+    if (records == 0) continue;
 
-  mstat = CommitData(group, 1, p->board);
-  CheckStatus(mstat);
+    mstat = CopyData(c->storage->memory + c_offset + sizeof(int) * (HEADER_SIZE) + d_offset,
+        buffer + total * record_size, records * record_size);
+    CheckStatus(mstat);
 
-  /* Update pool data */
-  mstat = CommitData(group, p->pool_banks, p->storage);
-  CheckStatus(mstat);
+    index[rows * STREAM_INDEX_FIELDS + 0] = header[1];
+    index[rows * STREAM_INDEX_FIELDS + 1] = header[6];
+    index[rows * STREAM_INDEX_FIELDS + 2] = dims[0] + total;
+    index[rows * STREAM_INDEX_FIELDS + 3] = records;
 
-  tasks = H5Gopen2(group, TASKS_GROUP, H5P_DEFAULT);
-  H5CheckStatus(tasks);
+    total += records;
+    rows++;
+  }
 
-  t = M2TaskLoad(m, p, 0);
+  Message(MESSAGE_DEBUG, "[%s:%d] Append %zu records to '%s'\n", __FILE__, __LINE__, total, s->layout.name);
 
-  for (l = 0; l < MAX_RANK; l++) {
-    dims[l] = p->board->layout.dims[l];
+  if (total > 0) {
+    h5datatype = SessionDatatype(s);
+
+    if (s->layout.precision == PRECISION_ROUND) {
+      mstat = ReducePrecision(s, buffer, total * (record_size / s->layout.datatype_size));
+      CheckStatus(mstat);
+    }
+
+    for (l = 0; l < rank; l++) {
+      offsets[l] = 0;
+      count[l] = dims[l];
+    }
+    offsets[0] = dims[0];
+    count[0] = total;
+    dims[0] += total;
+
+    hdf_status = H5Dset_extent(dataset, dims);
+    H5CheckStatus(hdf_status);
+
+    dataspace = H5Dget_space(dataset);
+    H5CheckStatus(dataspace);
+
+    hdf_status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offsets, NULL, count, NULL);
+    H5CheckStatus(hdf_status);
+
+    memspace = H5Screate_simple(rank, count, NULL);
+    H5CheckStatus(memspace);
+
+    hdf_status = H5Dwrite(dataset, h5datatype, memspace, dataspace, H5P_DEFAULT, buffer);
+    H5CheckStatus(hdf_status);
+
+    H5Sclose(memspace);
+    H5Sclose(dataspace);
   }
+  SessionDatasetClose(dataset);
+
+  /* The index rows */
+  if (rows > 0) {
+    snprintf(name, CONFIG_LEN, STREAM_INDEX, s->layout.name);
+    dataset = SessionDataset(h5location, name);
+
+    dataspace = H5Dget_space(dataset);
+    H5CheckStatus(dataspace);
+    H5Sget_simple_extent_dims(dataspace, dims, NULL);
+    H5Sclose(dataspace);
+
+    offsets[0] = dims[0];
+    offsets[1] = 0;
+    count[0] = rows;
+    count[1] = STREAM_INDEX_FIELDS;
+    dims[0] += rows;
+
+    hdf_status = H5Dset_extent(dataset, dims);
+    H5CheckStatus(hdf_status);
+
+    dataspace = H5Dget_space(dataset);
+    H5CheckStatus(dataspace);
+
+    hdf_status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offsets, NULL, count, NULL);
+    H5CheckStatus(hdf_status);
+
+    memspace = H5Screate_simple(2, count, NULL);
+    H5CheckStatus(memspace);
+
+    hdf_status = H5Dwrite(dataset, H5T_NATIVE_ULLONG, memspace, dataspace, H5P_DEFAULT, index);
+    H5CheckStatus(hdf_status);
+
+    H5Sclose(memspace);
+    H5Sclose(dataspace);
+    SessionDatasetClose(dataset);
+  }
+
+  free(buffer);
+  free(index);
+
+  return mstat;
+}
+
+/**
+ * @brief Merge the checkpoint buffer into the master banks
+ *
+ * The task results are copied to the master task banks (and the task groups), and
+ * committed to the master datafile. When the HDF5 location is negative (the journal
+ * mode), the modified banks and tasks are only marked for the next fold.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param c The current checkpoint pointer
+ * @param tasks The HDF5 location of the tasks group, negative value to skip the commit
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int CheckpointMerge(module *m, pool *p, checkpoint *c, hid_t tasks) {
+  int mstat = SUCCESS;
+  char path[CONFIG_LEN];
+  int header[HEADER_SIZE] = HEADER_INIT;
+  unsigned int i = 0, j = 0, l = 0;
+  unsigned int c_offset = 0, d_offset = 0, regions = 0, streams = 0;
+  size_t header_size;
+  task *t = NULL;
+  region *r_buffer = NULL;
+  hid_t datapath;
+  hsize_t offsets[MAX_RANK];
+
+  header_size = sizeof(int) * (HEADER_SIZE);
+
+  t = M2TaskLoad(m, p, 0);
+
+  r_buffer = calloc(c->size, sizeof(region));
+  if (!r_buffer) Error(CORE_ERR_MEM);
 
   for (j = 0; j < p->task_banks; j++) {
 
     if (p->task->storage[j].layout.storage_type == STORAGE_PM3D ||
         p->task->storage[j].layout.storage_type == STORAGE_LIST ||
+        p->task->storage[j].layout.storage_type == STORAGE_PACKED ||
         p->task->storage[j].layout.storage_type == STORAGE_TEXTURE) {
 
+      regions = 0;
+
       for (i = 0; i < c->size; i++) {
 
         // Get the data header
@@ -158,118 +632,49 @@ int CheckpointProcess(module *m, pool *p, checkpoint *c) {
 
         if (t->status != TASK_EMPTY && (header[0] == TAG_CHECKPOINT || header[0] == TAG_RESULT)) {
 
-          for (l = 0; l < MAX_RANK; l++) {
-            offsets[l] = 0;
-          }
-
-          elements = 1;
-          for (k = 1; k < t->storage[j].layout.rank; k++) {
-            elements *= t->storage[j].layout.dims[k];
-          }
-          elements *= t->storage[j].layout.datatype_size;
-
-          dim_offset = 1;
-          for (k = 2; k < t->storage[j].layout.rank; k++) {
-            dim_offset *= t->storage[j].layout.dims[k];
-          }
-
-          // Prepare STORAGE_PM3D
-          if (t->storage[j].layout.storage_type == STORAGE_PM3D) {
-            offsets[0] = (t->location[0] + dims[0]*t->location[1]) * t->storage[j].layout.dims[0]
-              + t->location[2]*dims[0]*dims[1]*t->storage[j].layout.dims[0];
-            offsets[1] = 0;
-            Message(MESSAGE_DEBUG, "[%s:%d] PM3D[%d] task %d %d %d with offsets %d %d %d\n", __FILE__, __LINE__,
-                j, t->tid, t->location[0], t->location[1], (int)offsets[0], (int)offsets[1], (int)offsets[2]);
-
-            l_offset = elements;
-            z_offset = 0;
-          }
-
-          // Prepare STORAGE_LIST
-          if (t->storage[j].layout.storage_type == STORAGE_LIST) {
-            offsets[0] = t->tid * t->storage[j].layout.dims[0];
-            offsets[1] = 0;
-            Message(MESSAGE_DEBUG, "[%s:%d] LIST[%d] task %d %d %d with offsets %d %d %d\n", __FILE__, __LINE__,
-                j, t->tid, t->location[0], t->location[1], (int)offsets[0], (int)offsets[1], (int)offsets[2]);
-
-            l_offset = elements;
-            z_offset = 0;
-          }
-
-          // Prepare STORAGE_TEXTURE
-          if (t->storage[j].layout.storage_type == STORAGE_TEXTURE) {
-            offsets[0] = t->location[0] * t->storage[j].layout.dims[0];
-            offsets[1] = t->location[1] * t->storage[j].layout.dims[1];
-            offsets[2] = t->location[2] * t->storage[j].layout.dims[2];
-
-            Message(MESSAGE_DEBUG, "[%s:%d] BOARD[%d] task %d %d %d with offsets %d %d %d\n", __FILE__, __LINE__,
-                j, t->tid, t->location[0], t->location[1], (int)offsets[0], (int)offsets[1], (int)offsets[2]);
-
-          }
+          // The task region in the dataset
+          TaskStorageOffsets(p, t, j, offsets);
+          Message(MESSAGE_DEBUG, "[%s:%d] BANK[%d] task %d %d %d with offsets %d %d %d\n", __FILE__, __LINE__,
+              j, t->tid, t->location[0], t->location[1], (int)offsets[0], (int)offsets[1], (int)offsets[2]);
 
           for (l = 0; l < MAX_RANK; l++) {
             t->storage[j].layout.offsets[l] = offsets[l];
           }
 
+          // Commit data to the pool, directly from the checkpoint buffer
           c_offset = c->storage->layout.size * i + header_size;
+          ScatterData(&p->task->storage[j], offsets, c->storage->memory + c_offset + d_offset);
 
-          mstat = CopyData(c->storage->memory + c_offset + d_offset, t->storage[j].memory, t->storage[j].layout.size);
-          CheckStatus(mstat);
-
-          // Commit data to the pool
-          if (t->storage[j].layout.storage_type == STORAGE_TEXTURE) {
-
-            elements = 1;
-            for (k = 2; k < t->storage[j].layout.rank; k++) {
-              elements *= t->storage[j].layout.dims[k];
-            }
-
-            elements *= t->storage[j].layout.datatype_size;
-            s_offset = dims[1] * dims[2] * elements * t->storage[j].layout.dims[1];
-
-            for (k = 0; k < t->storage[j].layout.dims[0]; k++) {
-
-              k_offset = k * s_offset;
-              k_offset += t->location[0] * t->storage[j].layout.dims[0] * s_offset;
-              k_offset += t->location[1] * t->storage[j].layout.dims[1] * dims[2] * elements;
-              k_offset += t->location[2] * elements;
-
-              for (r = 0; r < t->storage[j].layout.dims[1]; r++) {
-
-                e_offset = r * elements + k * t->storage[j].layout.dims[1] * elements;
-                r_offset = r * elements * dims[2] + k_offset;
-
-                mstat = CopyData(t->storage[j].memory + e_offset, p->task->storage[j].memory + r_offset, elements);
-                CheckStatus(mstat);
-              }
-            }
-
-          // For STORAGE_LIST and STORAGE_PM3D it is simpler
-          } else {
-            for (k = 0; k < t->storage[j].layout.dims[0]; k++) {
-              k_offset = k * l_offset;
-              k_offset += t->storage[j].layout.offsets[1] * dim_offset * t->storage[j].layout.datatype_size;
-              k_offset += t->storage[j].layout.offsets[0] * l_offset;
-              k_offset += z_offset;
-
-              e_offset = k * elements;
-
-              mstat = CopyData(t->storage[j].memory + e_offset, p->task->storage[j].memory + k_offset, elements);
-              CheckStatus(mstat);
-            }
+          // Mark the region to commit to master datafile
+          for (l = 0; l < MAX_RANK; l++) {
+            r_buffer[regions].offsets[l] = t->storage[j].layout.offsets[l];
+            r_buffer[regions].count[l] = t->storage[j].layout.storage_dim[l];
           }
+          regions++;
+        }
+      }
 
-          // Commit data to master datafile
-          if (p->task->storage[j].layout.use_hdf) {
-            Message(MESSAGE_DEBUG, "CommitData for '%s' with use_hdf = %d\n",
-                p->task->storage[j].layout.name, p->task->storage[j].layout.use_hdf);
-            mstat = CommitData(tasks, 1, &t->storage[j]);
-            CheckStatus(mstat);
-          }
+      // Commit data to master datafile (the workers write it themselves in the parallel mode
+      // and to the shard files)
+      if (p->task->storage[j].layout.use_hdf && regions > 0 && !SessionParallel() && !SessionShards()) {
+        if (tasks >= 0) {
+          mstat = CheckpointCommitBank(tasks, &p->task->storage[j], r_buffer, regions);
+          CheckStatus(mstat);
+        } else {
+          c->dirty[j] = 1;
         }
       }
     }
 
+    // The stream records are appended to the master datafile only (the workers never write them)
+    if (p->task->storage[j].layout.storage_type == STORAGE_STREAM) {
+      if (p->task->storage[j].layout.use_hdf && tasks >= 0) {
+        mstat = CheckpointStream(p, c, tasks, j, streams, d_offset);
+        CheckStatus(mstat);
+      }
+      streams++;
+    }
+
     if (p->task->storage[j].layout.storage_type == STORAGE_GROUP) {
       for (i = 0; i < c->size; i++) {
 
@@ -311,7 +716,10 @@ int CheckpointProcess(module *m, pool *p, checkpoint *c) {
           CheckStatus(mstat);
 
           // Commit data to master datafile
-          if (p->task->storage[j].layout.use_hdf) {
+          if (p->task->storage[j].layout.use_hdf && tasks < 0) {
+            c->dirty[j] = 1;
+            c->pending[t->tid] = 1;
+          } else if (p->task->storage[j].layout.use_hdf) {
             sprintf(path, TASK_PATH, t->tid);
             datapath = H5Gopen2(tasks, path, H5P_DEFAULT);
             H5CheckStatus(datapath);
@@ -324,17 +732,346 @@ int CheckpointProcess(module *m, pool *p, checkpoint *c) {
     }
 
     d_offset += p->task->storage[j].layout.size;
+
+    // The merged regions are kept in the scratch file only (out-of-core)
+    StorageEvict(&p->task->storage[j]);
   }
 
   TaskFinalize(m, p, t);
+  free(r_buffer);
 
-  H5Gclose(tasks);
-  H5Gclose(group);
-  H5Fclose(h5location);
+  return mstat;
+}
+
+/**
+ * @brief Write the whole buffer to the file descriptor
+ *
+ * @param fd The file descriptor
+ * @param data The buffer
+ * @param size The buffer size
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int JournalWrite(int fd, void *data, size_t size) {
+  unsigned char *buffer = data;
+  ssize_t w = 0;
+
+  while (size > 0) {
+    w = write(fd, buffer, size);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return CORE_ERR_CHECKPOINT;
+    buffer += w;
+    size -= w;
+  }
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Append the checkpoint to the journal
+ *
+ * The checkpoint buffer is appended as it is (the header and the task banks of each
+ * record), followed by the pool banks modified since the last fold. The journal is
+ * synchronized with the disk before returning.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param c The current checkpoint pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int JournalAppend(module *m, pool *p, checkpoint *c) {
+  int mstat = SUCCESS;
+  unsigned int i = 0, records = 0;
+  char *name = NULL;
+  journal_record record;
+
+  if (c->journal < 0) {
+    name = JournalName(m->filename);
+    c->journal = open(name, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (c->journal < 0) {
+      Message(MESSAGE_ERR, "Could not open the journal file %s\n", name);
+      free(name);
+      return CORE_ERR_CHECKPOINT;
+    }
+    free(name);
+  }
+
+  records = c->counter;
+  if (records == 0 || records > c->size) records = c->size;
+
+  record.magic = JOURNAL_MAGIC;
+  record.type = JOURNAL_TASKS;
+  record.pid = p->pid;
+  record.bank = 0;
+  record.size = (unsigned long long) records * c->storage->layout.size;
+  record.checksum = CheckpointChecksum(c->storage->memory, record.size);
+
+  mstat = JournalWrite(c->journal, &record, sizeof(journal_record));
+  CheckStatus(mstat);
+
+  mstat = JournalWrite(c->journal, c->storage->memory, record.size);
+  CheckStatus(mstat);
+
+  for (i = 0; i < p->pool_banks; i++) {
+    if (!p->storage[i].layout.use_hdf || p->storage[i].layout.size == 0) continue;
+
+    record.type = JOURNAL_POOL;
+    record.bank = i;
+    record.size = p->storage[i].layout.size;
+    record.checksum = CheckpointChecksum(p->storage[i].memory, record.size);
+    if (c->committed && record.checksum == c->checksums[i]) continue;
+
+    mstat = JournalWrite(c->journal, &record, sizeof(journal_record));
+    CheckStatus(mstat);
+
+    mstat = JournalWrite(c->journal, p->storage[i].memory, record.size);
+    CheckStatus(mstat);
+  }
+
+  if (fsync(c->journal) < 0) {
+    Message(MESSAGE_ERR, "Could not synchronize the journal file\n");
+    return CORE_ERR_CHECKPOINT;
+  }
+
+  return mstat;
+}
+
+/**
+ * @brief Process the checkpoint
+ *
+ * With the `checkpoint-journal` option, the checkpoint is appended to the journal file
+ * and merged into the master banks only. The journal is folded into the master datafile
+ * every `checkpoint-journal` checkpoints and at the end of the pool.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param c The current checkpoint pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int CheckpointProcess(module *m, pool *p, checkpoint *c) {
+  int mstat = SUCCESS, journal = 0;
+  hid_t group, tasks;
+  double start, span;
+
+  start = MPI_Wtime();
+
+  MReadOption(p, "checkpoint-journal", &journal);
+
+  if (journal > 0) {
+    span = TraceTime();
+    mstat = JournalAppend(m, p, c);
+    CheckStatus(mstat);
+    TraceSpan(TRACE_JOURNAL, span, -1, p->pid, c->cid);
+
+    mstat = CheckpointMerge(m, p, c, -1);
+    CheckStatus(mstat);
+
+    c->journaled++;
+    if (c->journaled >= (unsigned int) journal) {
+      mstat = CheckpointFold(m, p, c);
+      CheckStatus(mstat);
+    }
+
+    MetricsCheckpoint(MPI_Wtime() - start);
+    TraceSpan(TRACE_CHECKPOINT, start, -1, p->pid, c->cid);
+
+    return mstat;
+  }
+
+  span = TraceTime();
+  Backup(m, p);
+  TraceSpan(TRACE_BACKUP, span, -1, p->pid, c->cid);
+
+  /* Commit data for the task board */
+  group = SessionPool(m, p);
+
+  span = TraceTime();
+  mstat = CheckpointCommitBoard(group, p, c);
+  CheckStatus(mstat);
+  TraceSpan(TRACE_COMMIT_BOARD, span, -1, p->pid, c->cid);
+
+  /* Update pool data */
+  span = TraceTime();
+  mstat = CheckpointCommitPool(group, p, c);
+  CheckStatus(mstat);
+  TraceSpan(TRACE_COMMIT_POOL, span, -1, p->pid, c->cid);
+
+  c->committed = 1;
+
+  tasks = SessionTasks(m, p);
+
+  span = TraceTime();
+  mstat = CheckpointMerge(m, p, c, tasks);
+  CheckStatus(mstat);
+  TraceSpan(TRACE_COMMIT_TASKS, span, -1, p->pid, c->cid);
+
+  /* The checkpoint is complete on the disk */
+  span = TraceTime();
+  mstat = SessionFlush(m);
+  CheckStatus(mstat);
+  TraceSpan(TRACE_FLUSH, span, -1, p->pid, c->cid);
+
+  MetricsCheckpoint(MPI_Wtime() - start);
+  TraceSpan(TRACE_CHECKPOINT, start, -1, p->pid, c->cid);
 
   return mstat;
 }
 
+/**
+ * @brief Fold the journal into the master datafile
+ *
+ * The task board, the modified pool and task banks and the modified task groups are
+ * written from the master memory, the master datafile is flushed, and the journal is
+ * truncated. A crash during the fold leaves the journal intact, and its replay is
+ * idempotent.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param c The current checkpoint pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int CheckpointFold(module *m, pool *p, checkpoint *c) {
+  int mstat = SUCCESS;
+  char path[CONFIG_LEN], *name = NULL;
+  unsigned int i = 0, j = 0;
+  region whole;
+  hid_t group, tasks, datapath;
+  double span;
+
+  if (c->journaled == 0) return mstat;
+
+  Message(MESSAGE_DEBUG, "[%s:%d] Fold %d journaled checkpoints\n", __FILE__, __LINE__, c->journaled);
+
+  span = TraceTime();
+  Backup(m, p);
+  TraceSpan(TRACE_BACKUP, span, -1, p->pid, c->cid);
+
+  group = SessionPool(m, p);
+
+  mstat = CheckpointCommitBoard(group, p, c);
+  CheckStatus(mstat);
+
+  mstat = CheckpointCommitPool(group, p, c);
+  CheckStatus(mstat);
+
+  c->committed = 1;
+
+  tasks = SessionTasks(m, p);
+
+  for (j = 0; j < p->task_banks; j++) {
+    if (!c->dirty[j] || !p->task->storage[j].layout.use_hdf) continue;
+
+    if (!SessionParallel() && !SessionShards() && (p->task->storage[j].layout.storage_type == STORAGE_PM3D ||
+        p->task->storage[j].layout.storage_type == STORAGE_LIST ||
+        p->task->storage[j].layout.storage_type == STORAGE_PACKED ||
+        p->task->storage[j].layout.storage_type == STORAGE_TEXTURE)) {
+      for (i = 0; i < MAX_RANK; i++) {
+        whole.offsets[i] = 0;
+        whole.count[i] = p->task->storage[j].layout.storage_dim[i];
+      }
+
+      mstat = CheckpointCommitBank(tasks, &p->task->storage[j], &whole, 1);
+      CheckStatus(mstat);
+    }
+
+    if (p->task->storage[j].layout.storage_type == STORAGE_GROUP) {
+      for (i = 0; i < p->pool_size; i++) {
+        if (!c->pending[i]) continue;
+
+        sprintf(path, TASK_PATH, i);
+        datapath = H5Gopen2(tasks, path, H5P_DEFAULT);
+        H5CheckStatus(datapath);
+        mstat = CommitData(datapath, 1, &p->tasks[i]->storage[j]);
+        CheckStatus(mstat);
+        H5Gclose(datapath);
+      }
+    }
+  }
+
+  mstat = SessionFlush(m);
+  CheckStatus(mstat);
+
+  /* The master datafile is consistent, the journal may be discarded */
+  if (c->journal >= 0) close(c->journal);
+
+  name = JournalName(m->filename);
+  c->journal = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (c->journal < 0 || fsync(c->journal) < 0) {
+    Message(MESSAGE_ERR, "Could not truncate the journal file %s\n", name);
+    mstat = CORE_ERR_CHECKPOINT;
+  }
+  free(name);
+
+  c->journaled = 0;
+  memset(c->dirty, 0, p->task_banks > 0 ? p->task_banks : 1);
+  memset(c->pending, 0, p->pool_size);
+
+  return mstat;
+}
+
+/**
+ * @brief Resize the checkpoint buffer
+ *
+ * The records already in the buffer are kept, and the new records are marked empty.
+ *
+ * @param c The checkpoint pointer
+ * @param size The new checkpoint size (number of tasks)
+ */
+static void CheckpointResize(checkpoint *c, unsigned int size) {
+  int header[HEADER_SIZE] = HEADER_INIT;
+  unsigned int i = 0;
+  unsigned char *memory = NULL;
+
+  if (size == c->size || size < c->counter) return;
+
+  memory = realloc(c->storage->memory, (size_t) size * c->storage->layout.size);
+  if (!memory) Error(CORE_ERR_MEM);
+
+  c->storage->memory = memory;
+
+  for (i = c->size; i < size; i++) {
+    memcpy(c->storage->memory + (size_t) i * c->storage->layout.size, header, sizeof(header));
+  }
+
+  Message(MESSAGE_DEBUG, "[%s:%d] Checkpoint resized %d -> %d\n", __FILE__, __LINE__, c->size, size);
+
+  c->size = size;
+  c->storage->layout.dims[0] = size;
+}
+
+/**
+ * @brief Check whether the checkpoint has to be flushed
+ *
+ * The checkpoint is due when the wall time interval has passed since the last flush, or
+ * the buffer is full and has reached the size limit. The full buffer below the limit is
+ * doubled instead.
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param c The checkpoint pointer
+ *
+ * @return 1 if the checkpoint has to be flushed, 0 otherwise
+ */
+int CheckpointDue(module *m, pool *p, checkpoint *c) {
+  unsigned int size = 0;
+
+  if (c->interval > 0 && c->counter > 0 && difftime(time(NULL), c->flushed) >= c->interval) {
+    return 1;
+  }
+
+  if (c->counter < c->size) return 0;
+  if (c->size >= c->limit) return 1;
+
+  size = 2 * c->size;
+  if (size > c->limit) size = c->limit;
+  CheckpointResize(c, size);
+
+  return 0;
+}
+
 /**
  * @brief Reset the checkpoint pointer and update the checkpoint id
  *
@@ -345,13 +1082,21 @@ int CheckpointProcess(module *m, pool *p, checkpoint *c) {
  */
 void CheckpointReset(module *m, pool *p, checkpoint *c, int cid) {
   int header[HEADER_SIZE] = HEADER_INIT;
-  unsigned int i = 0, c_offset = 0;
+  unsigned int i = 0, c_offset = 0, size = 0;
   int mstat = SUCCESS;
   size_t header_size = 0;
 
+  /* Shrink the buffer mostly unused at the flush (i.e. by the wall time interval) */
+  if (c->size > c->initial && c->counter < c->size / 4) {
+    size = 2 * c->counter;
+    if (size < c->initial) size = c->initial;
+    CheckpointResize(c, size);
+  }
+
   header_size = sizeof(int) * (HEADER_SIZE);
   c->cid = cid;
   c->counter = 0;
+  c->flushed = time(NULL);
 
   for (i = 0; i < c->size; i++) {
     c_offset = i * c->storage->layout.size;
@@ -360,39 +1105,105 @@ void CheckpointReset(module *m, pool *p, checkpoint *c, int cid) {
   }
 }
 
+/**
+ * @brief Release the checkpoint memory
+ *
+ * @param c The checkpoint pointer
+ */
+static void CheckpointFree(checkpoint *c) {
+  if (c->storage) {
+    if (c->storage->memory) free(c->storage->memory);
+    free(c->storage);
+  }
+  if (c->board) free(c->board);
+  if (c->checksums) free(c->checksums);
+  if (c->dirty) free(c->dirty);
+  if (c->pending) free(c->pending);
+  if (c->journal >= 0) close(c->journal);
+  free(c);
+}
+
 /**
  * @brief Finalize the checkpoint
  *
+ * The journaled checkpoints are folded into the master datafile.
+ *
  * @param m The module pointer
  * @param p The current pool pointer
  * @param c The checkpoint pointer
  */
 void CheckpointFinalize(module *m, pool *p, checkpoint *c) {
+  int mstat = SUCCESS;
+
   if (c) {
-    if (c->storage) {
-      if (c->storage->memory) free(c->storage->memory);
-      free(c->storage);
-    }
-    free(c);
+    mstat = CheckpointFold(m, p, c);
+    CheckStatus(mstat);
+
+    CheckpointFree(c);
   }
 }
 
+/**
+ * @struct backup_source
+ * The state of the master datafile during the last backup
+ */
+static struct {
+  dev_t dev; /**< The device */
+  ino_t ino; /**< The inode */
+  off_t size; /**< The file size */
+  time_t mtime; /**< The modification time */
+  time_t taken; /**< The time of the backup */
+} backup_source = {.taken = 0};
+
 /**
  * @brief Create incremental backup
  *
+ * The backup is skipped when the master datafile has not changed since the last backup.
+ * The file is considered unchanged only if it was last modified before the second the
+ * backup was taken in, so that the modification time granularity cannot hide a write.
+ *
  * @param m The module pointer
  * @param p The pool pointer
  *
  * @return 0 on success, error code otherwise
  */
 int Backup(module *m, pool *p) {
-  int i = 0, b = 0, mstat = SUCCESS;
+  int i = 0, b = 0, latest = 0, mstat = SUCCESS;
   char *current_name, *backup_name, iter[4], name[CONFIG_LEN];
   struct stat current;
   struct stat backup;
+  struct stat source;
 
   MReadOption(p, "checkpoint-files", &b);
   MReadOption(p, "name", &name);
+  MReadOption(p, "hdf5-latest-format", &latest);
+
+  /**
+   * The master datafile is kept open, so it must be consistent on the disk before it is
+   * copied. The latest file format marks the file open for writing, so it has to be closed
+   */
+  if (b < 2) return mstat;
+
+  /* The master datafile is opened collectively, the backup is created after the task loop */
+  if (SessionParallel()) return mstat;
+
+  if (latest) {
+    SessionClose(m);
+  } else {
+    mstat = SessionFlush(m);
+    CheckStatus(mstat);
+  }
+
+  current_name = Name(name, "-master-", "00", ".h5");
+  if (stat(current_name, &source) == 0 && backup_source.taken > 0
+      && source.st_dev == backup_source.dev && source.st_ino == backup_source.ino
+      && source.st_size == backup_source.size && source.st_mtime == backup_source.mtime
+      && source.st_mtime < backup_source.taken) {
+    Message(MESSAGE_DEBUG, "[%s:%d] The master datafile is unchanged, backup skipped\n", __FILE__, __LINE__);
+    free(current_name);
+    return mstat;
+  }
+  free(current_name);
 
   for (i = b-2; i >= 0; i--) {
     snprintf(iter, 3, "%02d", i+1);
@@ -414,6 +1225,14 @@ int Backup(module *m, pool *p) {
           if (mstat < 0) Error(CORE_ERR_CHECKPOINT);
         }
       }
+
+      if (i == 0) {
+        backup_source.dev = current.st_dev;
+        backup_source.ino = current.st_ino;
+        backup_source.size = current.st_size;
+        backup_source.mtime = current.st_mtime;
+        backup_source.taken = time(NULL);
+      }
     }
     free(current_name);
     free(backup_name);
@@ -422,3 +1241,126 @@ int Backup(module *m, pool *p) {
   return mstat;
 }
 
+
+/**
+ * @brief Get the name of the journal file of the datafile
+ *
+ * @param filename The datafile name
+ *
+ * @return The journal file name (must be freed)
+ */
+char* JournalName(char *filename) {
+  char *name = NULL;
+  size_t len = 0;
+
+  len = strlen(filename);
+  if (len > 3 && strcmp(filename + len - 3, ".h5") == 0) len -= 3;
+
+  name = calloc(len + strlen(JOURNAL_SUFFIX) + 1, sizeof(char));
+  if (!name) Error(CORE_ERR_MEM);
+
+  strncpy(name, filename, len);
+  strcat(name, JOURNAL_SUFFIX);
+
+  return name;
+}
+
+/**
+ * @brief Replay the journal of the master datafile
+ *
+ * The journaled checkpoints are merged into the pool memory read from the master
+ * datafile, in the order they were written. The replay stops at the first incomplete
+ * record (i.e. the run has been interrupted during the append).
+ *
+ * @param m The module pointer
+ * @param pools The pointer to all pools data
+ * @param pool_counter The last pool id
+ *
+ * @return 0 on success, error code otherwise
+ */
+int JournalReplay(module *m, pool **pools, unsigned int pool_counter) {
+  int mstat = SUCCESS, fd = -1;
+  int header[HEADER_SIZE] = HEADER_INIT;
+  unsigned int i = 0, k = 0, records = 0, replayed = 0;
+  size_t header_size, b_offset;
+  off_t position;
+  char *name = NULL;
+  short *board;
+  unsigned char *buffer = NULL;
+  journal_record record;
+  checkpoint *c = NULL;
+  pool *p = NULL;
+
+  header_size = sizeof(int) * (HEADER_SIZE);
+
+  name = JournalName(m->filename);
+  fd = open(name, O_RDONLY);
+  if (fd < 0) {
+    free(name);
+    return mstat;
+  }
+
+  while (read(fd, &record, sizeof(journal_record)) == sizeof(journal_record)) {
+    if (record.magic != JOURNAL_MAGIC || record.pid > pool_counter) break;
+
+    buffer = malloc(record.size > 0 ? record.size : 1);
+    if (!buffer) Error(CORE_ERR_MEM);
+
+    if (read(fd, buffer, record.size) != (ssize_t) record.size
+        || CheckpointChecksum(buffer, record.size) != record.checksum) {
+      free(buffer);
+      break;
+    }
+
+    p = pools[record.pid];
+
+    if (record.type == JOURNAL_POOL && record.bank < p->pool_banks
+        && record.size == p->storage[record.bank].layout.size) {
+      memcpy(p->storage[record.bank].memory, buffer, record.size);
+    }
+
+    if (record.type == JOURNAL_TASKS) {
+      c = CheckpointLoad(m, p, 0);
+      records = record.size / c->storage->layout.size;
+      if (records > c->size) CheckpointResize(c, records);
+
+      memcpy(c->storage->memory, buffer, records * c->storage->layout.size);
+
+      mstat = CheckpointMerge(m, p, c, -1);
+      CheckStatus(mstat);
+
+      /* The task board follows the task headers */
+      board = (short*) p->board->memory;
+      for (i = 0; i < records; i++) {
+        memcpy(header, c->storage->memory + i * c->storage->layout.size, header_size);
+        if (header[2] == TASK_EMPTY || (header[0] != TAG_CHECKPOINT && header[0] != TAG_RESULT)) continue;
+
+        b_offset = header[3];
+        for (k = 1; k < TASK_BOARD_RANK; k++) {
+          b_offset = b_offset * p->board->layout.dims[k] + header[3+k];
+        }
+        b_offset *= p->board->layout.dims[TASK_BOARD_RANK];
+
+        board[b_offset] = header[2];
+        board[b_offset + 2] = header[6];
+      }
+
+      CheckpointFree(c);
+    }
+
+    free(buffer);
+    replayed++;
+  }
+
+  position = lseek(fd, 0, SEEK_CUR);
+  if (position < lseek(fd, 0, SEEK_END)) {
+    Message(MESSAGE_WARN, "The journal file %s is incomplete, the last record is skipped\n", name);
+  }
+
+  Message(MESSAGE_INFO, "Journal records replayed: %d\n", replayed);
+
+  close(fd);
+  free(name);
+
+  return mstat;
+}
@@ -7,11 +7,33 @@
 
 #include "M2Apublic.h"
 #include "M2Epublic.h"
+#include "M2Fpublic.h"
 #include "M2Hpublic.h"
+#include "M2Ipublic.h"
 #include "M2Mpublic.h"
 #include "M2Spublic.h"
 #include "M2Tpublic.h"
 #include "M2Ppublic.h"
+#include "M2Wpublic.h"
+
+#define JOURNAL_MAGIC 0x4d324a4c /**< The journal record magic number */
+#define JOURNAL_SUFFIX ".journal" /**< The journal file suffix (replaces the .h5 suffix) */
+#define JOURNAL_TASKS 1 /**< The journal record of the checkpoint buffer */
+#define JOURNAL_POOL 2 /**< The journal record of the pool bank */
+#define CHECKPOINT_INITIAL_SIZE 64 /**< The initial checkpoint buffer size (number of tasks) */
+
+/**
+ * @struct journal_record
+ * The header of the journal record
+ */
+typedef struct {
+  unsigned int magic; /**< The magic number */
+  unsigned int type; /**< The record type (JOURNAL_TASKS, JOURNAL_POOL) */
+  unsigned int pid; /**< The pool id */
+  unsigned int bank; /**< The pool bank index (JOURNAL_POOL) */
+  unsigned long long size; /**< The payload size in bytes */
+  unsigned long long checksum; /**< The payload checksum */
+} journal_record;
 
 /**
  * @struct checkpoint
@@ -21,14 +43,29 @@ typedef struct {
   int cid; /**< The checkpoint id */
   unsigned int counter; /**< The checkpoint internal counter */
   unsigned int size; /**< The actual checkpoint size */
+  unsigned int limit; /**< The checkpoint size limit (by the checkpoint and memory options) */
+  unsigned int initial; /**< The initial checkpoint size */
+  int interval; /**< The checkpoint wall time interval in seconds (0 disables) */
+  time_t flushed; /**< The wall time of the last checkpoint flush */
   storage *storage; /**< The checkpoint data */
+  int committed; /**< Whether the board and pool banks have been committed yet */
+  unsigned char *board; /**< The task board, as last committed to the master datafile */
+  unsigned long long *checksums; /**< The pool banks checksums, as last committed */
+  int journal; /**< The journal file descriptor */
+  unsigned int journaled; /**< The number of checkpoints journaled since the last fold */
+  unsigned char *dirty; /**< The task banks modified since the last fold */
+  unsigned char *pending; /**< The tasks (STORAGE_GROUP) modified since the last fold */
 } checkpoint;
 
 checkpoint* CheckpointLoad(module *m, pool *p, int cid);
 int M2CheckpointPrepare(module *m, pool *p, checkpoint *c);
 int CheckpointProcess(module *m, pool *p, checkpoint *c);
+int CheckpointDue(module *m, pool *p, checkpoint *c);
 void CheckpointReset(module *m, pool *p, checkpoint *c, int cid);
 void CheckpointFinalize(module *m, pool *p, checkpoint *c);
+int CheckpointFold(module *m, pool *p, checkpoint *c);
 int Backup(module *m, pool *p);
+char* JournalName(char *filename);
+int JournalReplay(module *m, pool **pools, unsigned int pool_counter);
 
 #endif
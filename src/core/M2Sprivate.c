@@ -15,6 +15,7 @@
 int Storage(module *m, pool *p) {
   int mstat = SUCCESS;
   unsigned int i = 0, j = 0, task_groups = 0, size = 0;
+  int journal = 0, out_of_core = 0;
   query *q;
 
   int int_attr;
@@ -174,8 +175,9 @@ int Storage(module *m, pool *p) {
 
   /* Master only memory/storage operations */
   if (m->node == MASTER) {
+    MReadOption(p, "out-of-core", &out_of_core);
 
-    /* Commit memory for task banks (whole datasets) */
+    /* Commit memory for task banks (whole datasets, mapped to the scratch file in the out-of-core mode) */
     for (i = 0; i < p->task_banks; i++) {
       if (p->task->storage[i].layout.storage_type == STORAGE_GROUP) {
         task_groups = 1;
@@ -183,7 +185,8 @@ int Storage(module *m, pool *p) {
       }
 
       if (p->task->storage[i].layout.storage_type == STORAGE_PM3D ||
-        p->task->storage[i].layout.storage_type == STORAGE_LIST) {
+        p->task->storage[i].layout.storage_type == STORAGE_LIST ||
+        p->task->storage[i].layout.storage_type == STORAGE_PACKED) {
 
         p->task->storage[i].layout.storage_dim[0] =
           p->task->storage[i].layout.dims[0] * p->pool_size;
@@ -193,6 +196,26 @@ int Storage(module *m, pool *p) {
             p->task->storage[i].layout.dims[j];
         }
 
+        size = GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.storage_dim);
+        p->task->storage[i].layout.storage_elements = size;
+        p->task->storage[i].layout.storage_size = size * p->task->storage[i].layout.datatype_size;
+        if (out_of_core) {
+          mstat = AllocateMapped(&(p->task->storage[i]), size, p->task->storage[i].layout.datatype_size, m->filename);
+          CheckStatus(mstat);
+        } else {
+          mstat = Allocate(&(p->task->storage[i]), size, p->task->storage[i].layout.datatype_size);
+        }
+        mstat = CommitAttrMemoryLayout(p->task->storage[i].attr_banks, &p->task->storage[i]);
+        CommitTileLayout(&(p->task->storage[i]));
+      }
+
+      /* The stream is appended to the dataset at each checkpoint, the master keeps the task capacity */
+      if (p->task->storage[i].layout.storage_type == STORAGE_STREAM) {
+        for (j = 0; j < MAX_RANK; j++) {
+          p->task->storage[i].layout.storage_dim[j] =
+            p->task->storage[i].layout.dims[j];
+        }
+
         size = GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.storage_dim);
         p->task->storage[i].layout.storage_elements = size;
         p->task->storage[i].layout.storage_size = size * p->task->storage[i].layout.datatype_size;
@@ -214,8 +237,14 @@ int Storage(module *m, pool *p) {
         size = GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.storage_dim);
         p->task->storage[i].layout.storage_elements = size;
         p->task->storage[i].layout.storage_size = size * p->task->storage[i].layout.datatype_size;
-        mstat = Allocate(&(p->task->storage[i]), size, p->task->storage[i].layout.datatype_size);
+        if (out_of_core) {
+          mstat = AllocateMapped(&(p->task->storage[i]), size, p->task->storage[i].layout.datatype_size, m->filename);
+          CheckStatus(mstat);
+        } else {
+          mstat = Allocate(&(p->task->storage[i]), size, p->task->storage[i].layout.datatype_size);
+        }
         mstat = CommitAttrMemoryLayout(p->task->storage[i].attr_banks, &p->task->storage[i]);
+        CommitTileLayout(&(p->task->storage[i]));
       }
 
       for (j = 0; j < MAX_RANK; j++) {
@@ -251,6 +280,8 @@ int Storage(module *m, pool *p) {
     for (i = 0; i < p->task_banks; i++) {
       if (p->task->storage[i].layout.storage_type == STORAGE_TEXTURE ||
           p->task->storage[i].layout.storage_type == STORAGE_LIST ||
+          p->task->storage[i].layout.storage_type == STORAGE_PACKED ||
+          p->task->storage[i].layout.storage_type == STORAGE_STREAM ||
           p->task->storage[i].layout.storage_type == STORAGE_PM3D) {
 
         for (j = 0; j < MAX_RANK; j++) {
@@ -286,6 +317,16 @@ int Storage(module *m, pool *p) {
     MWriteOption(p, "checkpoint", &p->checkpoint_size);
   }
 
+  /* The stream records are appended directly to the master datafile */
+  MReadOption(p, "checkpoint-journal", &journal);
+  if (journal > 0 && StreamBanks(p) > 0) {
+    if (m->node == MASTER) {
+      Message(MESSAGE_WARN, "The checkpoint journal is not available with the STORAGE_STREAM banks, disabling it\n");
+    }
+    journal = 0;
+    MWriteOption(p, "checkpoint-journal", &journal);
+  }
+
   return mstat;
 }
 
@@ -325,6 +366,12 @@ int CheckLayout(module *m, unsigned int banks, storage *s) {
       Error(CORE_ERR_STORAGE);
     }
 
+    if (s[i].layout.storage_type == STORAGE_PACKED &&
+        s[i].layout.rank >= MAX_RANK) {
+      Message(MESSAGE_ERR, "Maximum rank for STORAGE_PACKED is %d\n", MAX_RANK - 1);
+      Error(CORE_ERR_STORAGE);
+    }
+
     for (j = 0; j < s[i].layout.rank; j++) {
       if (s[i].layout.dims[j] < 1) {
         Message(MESSAGE_ERR, "Invalid size for dimension %d = %d\n", j, s[i].layout.dims[j]);
@@ -343,7 +390,7 @@ int CheckLayout(module *m, unsigned int banks, storage *s) {
       Error(CORE_ERR_STORAGE);
     }
 
-    if (s[i].layout.storage_type > STORAGE_LIST) {
+    if (s[i].layout.storage_type > STORAGE_STREAM) {
       Message(MESSAGE_ERR, "Unknown storage type\n");
       Error(CORE_ERR_STORAGE);
     }
@@ -546,6 +593,49 @@ int CheckFieldLayout(field *field) {
   return mstat;
 }
 
+/**
+ * @brief Create the index dataset of the stream
+ *
+ * Each row of the index describes the records appended by one task message: the task
+ * ID, the checkpoint ID, the offset of the first record in the stream dataset and the
+ * number of records.
+ *
+ * @param h5location The HDF5 location id
+ * @param s The stream storage structure
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int CreateStreamIndex(hid_t h5location, storage *s) {
+  int mstat = SUCCESS;
+  char name[CONFIG_LEN];
+  hid_t h5dataset, h5dataspace, dcpl;
+  hsize_t dims[2] = {0, STREAM_INDEX_FIELDS};
+  hsize_t maxdims[2] = {H5S_UNLIMITED, STREAM_INDEX_FIELDS};
+  hsize_t chunk[2] = {CHUNK_SIZE / (STREAM_INDEX_FIELDS * sizeof(unsigned long long)), STREAM_INDEX_FIELDS};
+  herr_t h5status;
+
+  snprintf(name, CONFIG_LEN, STREAM_INDEX, s->layout.name);
+
+  h5dataspace = H5Screate_simple(2, dims, maxdims);
+  H5CheckStatus(h5dataspace);
+
+  dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  H5CheckStatus(dcpl);
+
+  h5status = H5Pset_chunk(dcpl, 2, chunk);
+  H5CheckStatus(h5status);
+
+  h5dataset = H5Dcreate2(h5location, name, H5T_NATIVE_ULLONG, h5dataspace,
+      H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  H5CheckStatus(h5dataset);
+
+  H5Pclose(dcpl);
+  H5Dclose(h5dataset);
+  H5Sclose(h5dataspace);
+
+  return mstat;
+}
+
 /**
  * @brief Commit the storage layout
  *
@@ -560,8 +650,7 @@ int CommitStorageLayout(module *m, pool *p) {
   char path[CONFIG_LEN];
   hid_t h5location, h5group, h5pools, h5tasks, h5task;
 
-  h5location = H5Fopen(m->filename, H5F_ACC_RDWR, H5P_DEFAULT);
-  H5CheckStatus(h5location);
+  h5location = SessionOpen(m, p);
 
   /* The Pools */
   if (!H5Lexists(h5location, POOLS_GROUP, H5P_DEFAULT)) {
@@ -596,9 +685,14 @@ int CommitStorageLayout(module *m, pool *p) {
     if (p->task->storage[i].layout.use_hdf) {
       if (p->task->storage[i].layout.storage_type == STORAGE_PM3D ||
         p->task->storage[i].layout.storage_type == STORAGE_LIST ||
+        p->task->storage[i].layout.storage_type == STORAGE_PACKED ||
         p->task->storage[i].layout.storage_type == STORAGE_TEXTURE) {
           CreateDataset(h5tasks, &p->task->storage[i], m, p);
       }
+      if (p->task->storage[i].layout.storage_type == STORAGE_STREAM) {
+        CreateDataset(h5tasks, &p->task->storage[i], m, p);
+        CreateStreamIndex(h5tasks, &p->task->storage[i]);
+      }
       if (p->task->storage[i].layout.storage_type == STORAGE_GROUP) {
         for (j = 0; j < p->pool_size; j++) {
           sprintf(path, TASK_PATH, j);
@@ -619,11 +713,263 @@ int CommitStorageLayout(module *m, pool *p) {
   H5Gclose(h5tasks);
   H5Gclose(h5group);
   H5Gclose(h5pools);
-  H5Fclose(h5location);
+
+  mstat = SessionFlush(m);
+  CheckStatus(mstat);
 
   return mstat;
 }
 
+/**
+ * @brief Check whether the lossy storage precision applies to the dataset
+ *
+ * @param s The storage structure
+ *
+ * @return 1 for the floating point datasets with reduced precision, 0 otherwise
+ */
+static int DatasetLossy(storage *s) {
+  if (s->layout.precision == PRECISION_FULL) return 0;
+  if (s->layout.datatype == H5T_COMPOUND) return 0;
+  if (H5Tget_class(s->layout.datatype) != H5T_FLOAT) return 0;
+  return 1;
+}
+
+/**
+ * @brief Store the storage precision as the dataset attributes
+ *
+ * @param h5dataset The HDF5 dataset
+ * @param s The storage structure
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int DatasetPrecision(hid_t h5dataset, storage *s) {
+  int mstat = SUCCESS;
+  int digits = 0;
+  char *precision = NULL;
+  hid_t attr_s, attr_d, attr_t;
+
+  switch (s->layout.precision) {
+    case PRECISION_FLOAT:
+      precision = "float32";
+      break;
+    case PRECISION_ROUND:
+      precision = "round";
+      digits = s->layout.digits > 0 ? s->layout.digits : PRECISION_DIGITS;
+      break;
+    case PRECISION_SCALEOFFSET:
+      precision = "scale-offset";
+      digits = s->layout.digits > 0 ? s->layout.digits : PRECISION_DIGITS;
+      break;
+    default:
+      return mstat;
+  }
+
+  attr_s = H5Screate(H5S_SCALAR);
+  attr_t = H5Tcopy(H5T_C_S1);
+  H5Tset_size(attr_t, strlen(precision) + 1);
+
+  attr_d = H5Acreate2(h5dataset, "Precision", attr_t, attr_s, H5P_DEFAULT, H5P_DEFAULT);
+  H5CheckStatus(attr_d);
+  H5Awrite(attr_d, attr_t, precision);
+  H5Aclose(attr_d);
+  H5Tclose(attr_t);
+
+  if (digits > 0) {
+    attr_d = H5Acreate2(h5dataset, "Precision digits", H5T_NATIVE_INT, attr_s, H5P_DEFAULT, H5P_DEFAULT);
+    H5CheckStatus(attr_d);
+    H5Awrite(attr_d, H5T_NATIVE_INT, &digits);
+    H5Aclose(attr_d);
+  }
+
+  H5Sclose(attr_s);
+
+  return mstat;
+}
+
+/**
+ * @brief Create the dataset creation property list
+ *
+ * The task datasets (STORAGE_PM3D, STORAGE_LIST, STORAGE_PACKED and STORAGE_TEXTURE) are
+ * always chunked. The default chunk is built from the task tiles grouped along the task board
+ * axes up to CHUNK_SIZE, so that each task result is stored within a single chunk. Other datasets are
+ * chunked only if the chunk dimensions or the filters are set in the storage schema. The
+ * chunked datasets use the incremental allocation, so that the masked and unfinished parts
+ * of the task board do not use the disk space. The STORAGE_STREAM datasets are chunked by
+ * the records, since they are extended at each checkpoint.
+ *
+ * With the parallel output, the space is allocated early and no filters are used, since
+ * the datasets are written with the independent I/O.
+ *
+ * @param s The storage structure
+ * @param parallel Whether the parallel output is used
+ *
+ * @return The dataset creation property list
+ */
+static hid_t DatasetCreateList(storage *s, int parallel) {
+  hid_t dcpl;
+  hsize_t chunk[MAX_RANK];
+  herr_t h5status;
+  size_t chunk_size;
+  unsigned int i = 0, j = 0, axes = 0, grow = 0, chunked = 0, level = 0, rank = 0;
+  unsigned int packed = 0;
+
+  dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  H5CheckStatus(dcpl);
+
+  if (s->layout.dataspace != H5S_SIMPLE) return dcpl;
+
+  if (parallel) {
+    h5status = H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_EARLY);
+    H5CheckStatus(h5status);
+  }
+
+  for (i = 0; i < MAX_RANK; i++) {
+    chunk[i] = s->layout.storage_dim[i];
+  }
+
+  /* Group the task tiles */
+  if (s->layout.storage_type == STORAGE_PM3D ||
+      s->layout.storage_type == STORAGE_LIST ||
+      s->layout.storage_type == STORAGE_PACKED ||
+      s->layout.storage_type == STORAGE_TEXTURE) {
+    chunked = 1;
+    chunk_size = s->layout.datatype_size;
+
+    for (i = 0; i < s->layout.rank; i++) {
+      chunk[i] = s->layout.dims[i];
+      chunk_size *= chunk[i];
+    }
+
+    axes = 1;
+    if (s->layout.storage_type == STORAGE_TEXTURE) axes = TASK_BOARD_RANK;
+
+    do {
+      grow = 0;
+      for (j = axes; j > 0 && chunk_size < CHUNK_SIZE; j--) {
+        i = j - 1;
+        if (chunk[i] * 2 <= s->layout.storage_dim[i]) {
+          chunk[i] *= 2;
+          chunk_size *= 2;
+          grow = 1;
+        } else if (chunk[i] < s->layout.storage_dim[i]) {
+          chunk_size = chunk_size / chunk[i] * s->layout.storage_dim[i];
+          chunk[i] = s->layout.storage_dim[i];
+          grow = 1;
+        }
+      }
+    } while (grow && chunk_size < CHUNK_SIZE);
+  }
+
+  /* The stream records are grouped up to CHUNK_SIZE */
+  if (s->layout.storage_type == STORAGE_STREAM) {
+    chunked = 1;
+    chunk_size = s->layout.datatype_size;
+
+    for (i = 1; i < s->layout.rank; i++) {
+      chunk[i] = s->layout.dims[i];
+      chunk_size *= chunk[i];
+    }
+
+    chunk[0] = CHUNK_SIZE / chunk_size;
+    if (chunk[0] < 1) chunk[0] = 1;
+  }
+
+  /* User defined chunk (the stream dataset is unlimited along the first dimension) */
+  if (s->layout.chunk[0] > 0) {
+    chunked = 1;
+    for (i = 0; i < s->layout.rank; i++) {
+      if (s->layout.chunk[i] > 0) {
+        chunk[i] = s->layout.chunk[i];
+        if (s->layout.storage_type == STORAGE_STREAM && i == 0) continue;
+        if (chunk[i] > s->layout.storage_dim[i]) chunk[i] = s->layout.storage_dim[i];
+      }
+    }
+  }
+
+  /* The packed task blocks are never split */
+  if (s->layout.storage_type == STORAGE_PACKED && chunk[0] % s->layout.dims[0] != 0) {
+    chunk[0] += s->layout.dims[0] - chunk[0] % s->layout.dims[0];
+  }
+
+  rank = StorageFileRegion(s, NULL, chunk);
+
+  if (parallel) {
+    if (s->layout.filters != FILTER_NONE || s->layout.precision == PRECISION_SCALEOFFSET) {
+      Message(MESSAGE_WARN, "The filters are not supported by the parallel output, "
+          "ignoring them for '%s'\n", s->layout.name);
+    }
+
+    if (chunked) {
+      h5status = H5Pset_chunk(dcpl, rank, chunk);
+      H5CheckStatus(h5status);
+    }
+
+    return dcpl;
+  }
+
+  if (s->layout.filters != FILTER_NONE) chunked = 1;
+  if (s->layout.precision == PRECISION_SCALEOFFSET) chunked = 1;
+  if (!chunked) return dcpl;
+
+  h5status = H5Pset_chunk(dcpl, rank, chunk);
+  H5CheckStatus(h5status);
+
+  h5status = H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_INCR);
+  H5CheckStatus(h5status);
+
+  /* The filters are applied in the order of the pipeline */
+  if (s->layout.filters & FILTER_NBIT) {
+    h5status = H5Pset_nbit(dcpl);
+    H5CheckStatus(h5status);
+    packed = 1;
+  }
+
+  if (s->layout.filters & FILTER_SCALEOFFSET) {
+    if (s->layout.datatype != H5T_COMPOUND && H5Tget_class(s->layout.datatype) == H5T_INTEGER) {
+      h5status = H5Pset_scaleoffset(dcpl, H5Z_SO_INT, H5Z_SO_INT_MINBITS_DEFAULT);
+      H5CheckStatus(h5status);
+      packed = 1;
+    } else {
+      Message(MESSAGE_WARN, "The scale-offset filter is lossless only for integer datasets, "
+          "ignoring it for '%s'\n", s->layout.name);
+    }
+  }
+
+  if (s->layout.precision == PRECISION_SCALEOFFSET && DatasetLossy(s)) {
+    h5status = H5Pset_scaleoffset(dcpl, H5Z_SO_FLOAT_DSCALE,
+        s->layout.digits > 0 ? s->layout.digits : PRECISION_DIGITS);
+    H5CheckStatus(h5status);
+    packed = 1;
+  }
+
+  /* The shuffle works on the bytes of the whole elements, not on the bit-packed data of the
+   * N-bit and scale-offset filters, which must be the first ones in the pipeline */
+  if (s->layout.filters & FILTER_SHUFFLE) {
+    if (packed) {
+      Message(MESSAGE_WARN, "The shuffle filter does not apply to the N-bit or scale-offset "
+          "packed data, ignoring it for '%s'\n", s->layout.name);
+    } else {
+      h5status = H5Pset_shuffle(dcpl);
+      H5CheckStatus(h5status);
+    }
+  }
+
+  if (s->layout.filters & FILTER_DEFLATE) {
+    if (H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0) {
+      level = s->layout.deflate;
+      if (level == 0 || level > 9) level = FILTER_DEFLATE_LEVEL;
+
+      h5status = H5Pset_deflate(dcpl, level);
+      H5CheckStatus(h5status);
+    } else {
+      Message(MESSAGE_WARN, "The deflate filter is not available, ignoring it for '%s'\n",
+          s->layout.name);
+    }
+  }
+
+  return dcpl;
+}
+
 /**
  * @brief Create a dataset
  *
@@ -636,9 +982,10 @@ int CommitStorageLayout(module *m, pool *p) {
  */
 int CreateDataset(hid_t h5location, storage *s, module *m, pool *p) {
   int mstat = SUCCESS, i;
+  unsigned int rank = 0;
   query *q;
-  hid_t h5dataset, h5dataspace, h5datatype;
-  hsize_t dims[MAX_RANK];
+  hid_t h5dataset, h5dataspace, h5datatype, dcpl;
+  hsize_t dims[MAX_RANK], maxdims[MAX_RANK];
   herr_t h5status;
 
   h5dataspace = H5Screate(s->layout.dataspace);
@@ -650,21 +997,55 @@ int CreateDataset(hid_t h5location, storage *s, module *m, pool *p) {
       dims[i] = s->layout.storage_dim[i];
     }
 
-    h5status = H5Sset_extent_simple(h5dataspace, s->layout.rank, dims, NULL);
+    rank = StorageFileRegion(s, NULL, dims);
+
+    /* The stream dataset starts empty and grows with each checkpoint */
+    if (s->layout.storage_type == STORAGE_STREAM) {
+      for (i = 0; i < MAX_RANK; i++) {
+        maxdims[i] = dims[i];
+      }
+      dims[0] = 0;
+      maxdims[0] = H5S_UNLIMITED;
+
+      h5status = H5Sset_extent_simple(h5dataspace, rank, dims, maxdims);
+    } else {
+      h5status = H5Sset_extent_simple(h5dataspace, rank, dims, NULL);
+    }
     H5CheckStatus(h5status);
   }
 
+  dcpl = DatasetCreateList(s, SessionParallelMode(m, p));
+
+  if (s->layout.precision != PRECISION_FULL && !DatasetLossy(s)) {
+    Message(MESSAGE_WARN, "The storage precision applies to floating point datasets only, "
+        "ignoring it for '%s'\n", s->layout.name);
+  }
+
   if (s->layout.datatype != H5T_COMPOUND) {
-    h5dataset = H5Dcreate2(h5location, s->layout.name, s->layout.datatype, h5dataspace,
-        H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    h5datatype = s->layout.datatype;
+
+    /* The data is converted by the library during the write */
+    if (s->layout.precision == PRECISION_FLOAT && DatasetLossy(s) && s->layout.datatype_size > sizeof(float)) {
+      h5datatype = H5T_NATIVE_FLOAT;
+    }
+
+    h5dataset = H5Dcreate2(h5location, s->layout.name, h5datatype, h5dataspace,
+        H5P_DEFAULT, dcpl, H5P_DEFAULT);
     H5CheckStatus(h5dataset);
+
+    if (DatasetLossy(s)) {
+      mstat = DatasetPrecision(h5dataset, s);
+      CheckStatus(mstat);
+    }
   } else {
     h5datatype = CommitFileDatatype(s);
     h5dataset = H5Dcreate2(h5location, s->layout.name, h5datatype, h5dataspace,
-        H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        H5P_DEFAULT, dcpl, H5P_DEFAULT);
     H5CheckStatus(h5dataset);
   }
 
+  H5Pclose(dcpl);
+
   q = LoadSym(m, "DatasetPrepare", LOAD_DEFAULT);
   if (q) mstat = q(h5location, h5dataset, p, s);
   CheckStatus(mstat);
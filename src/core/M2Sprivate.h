@@ -10,6 +10,7 @@
 #include "M2Spublic.h"
 #include "M2Tpublic.h"
 #include "M2Ppublic.h"
+#include "M2Fpublic.h"
 
 int CommitStorageLayout(module *m, pool *p);
 int Storage(module *m, pool *p);
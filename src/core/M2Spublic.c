@@ -2,7 +2,18 @@
  * @file
  * Data storage and management (public API)
  */
+/* mkstemp(), ftruncate() and madvise() of the out-of-core task banks */
+#if !defined(_DEFAULT_SOURCE)
+  #define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
 #include "M2Spublic.h"
+#include "M2Fpublic.h"
 
 /**
  * Generic-type macro for 2D allocation
@@ -272,6 +283,44 @@ int ReadData(storage *s, void *data) {
   return SUCCESS;
 }
 
+/**
+ * @brief Appends the records to the stream memory buffer (STORAGE_STREAM)
+ *
+ * The record is the memory block without the first dimension, and the first dimension is
+ * the number of records the task may send at once. The appended records are sent to the
+ * master node with the task result or the task checkpoint.
+ *
+ * @param s The storage object
+ * @param data The data pointer
+ * @param records The number of records to append
+ *
+ * @return SUCCESS on success, error code otherwise
+ */
+int AppendData(storage *s, void *data, unsigned int records) {
+  size_t record_size;
+
+  if (!s->memory) return CORE_ERR_MEM;
+  if (!data) return CORE_ERR_MEM;
+
+  if (s->layout.storage_type != STORAGE_STREAM) {
+    Message(MESSAGE_ERR, "The storage bank '%s' is not a stream\n", s->layout.name);
+    return CORE_ERR_STORAGE;
+  }
+
+  if (s->layout.records + records > s->layout.dims[0]) {
+    Message(MESSAGE_ERR, "The stream '%s' is full (%d records), return TASK_CHECKPOINT to send it\n",
+        s->layout.name, s->layout.dims[0]);
+    return CORE_ERR_STORAGE;
+  }
+
+  record_size = s->layout.size / s->layout.dims[0];
+
+  CopyData(data, s->memory + s->layout.records * record_size, records * record_size);
+  s->layout.records += records;
+
+  return SUCCESS;
+}
+
 /**
  * @brief Copies data from local buffer to the attribute memory buffer
  *
@@ -321,6 +370,92 @@ int CopyData(void *in, void *out, size_t size) {
   return SUCCESS;
 }
 
+/**
+ * @brief Broadcast the buffer from the master node in chunks of at most INT_MAX bytes
+ *
+ * @param buffer The buffer
+ * @param size The size of the buffer (in bytes)
+ *
+ * @return SUCCESS on success, error code otherwise
+ */
+static int BroadcastChunks(char *buffer, size_t size) {
+  int mstat = SUCCESS, chunk = 0;
+  size_t offset = 0;
+
+  while (offset < size) {
+    chunk = (size - offset > INT_MAX) ? INT_MAX : (int) (size - offset);
+
+    mstat = MPI_Bcast(buffer + offset, chunk, MPI_CHAR, MASTER, MPI_COMM_WORLD);
+    if (mstat != MPI_SUCCESS) Error(CORE_ERR_MPI);
+
+    offset += chunk;
+  }
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Broadcast the buffers from the master node in a single message
+ *
+ * The buffers are packed into one contiguous buffer, so that the many small buffers
+ * (i.e. the pool attributes) are sent with one MPI_Bcast instead of one per buffer.
+ * The packing doubles the peak memory of the broadcast data on each node. When the total
+ * size exceeds the MPI count (INT_MAX bytes), the buffers are not packed, but broadcast
+ * one by one, in chunks. Must be called on all nodes, with the same buffer sizes.
+ *
+ * @param node The current node
+ * @param count The number of buffers
+ * @param data The buffers
+ * @param size The sizes of the buffers (in bytes)
+ *
+ * @return SUCCESS on success, error code otherwise
+ */
+int BroadcastData(int node, unsigned int count, void **data, size_t *size) {
+  int mstat = SUCCESS;
+  unsigned int i = 0;
+  size_t total = 0, offset = 0;
+  char *buffer = NULL;
+
+  for (i = 0; i < count; i++) total += size[i];
+  if (total == 0) return mstat;
+
+  if (total > INT_MAX) {
+    for (i = 0; i < count; i++) {
+      mstat = BroadcastChunks(data[i], size[i]);
+      CheckStatus(mstat);
+    }
+    return mstat;
+  }
+
+  buffer = calloc(total, sizeof(char));
+  if (!buffer) Error(CORE_ERR_MEM);
+
+  if (node == MASTER) {
+    for (i = 0; i < count; i++) {
+      if (size[i] == 0) continue;
+      mstat = CopyData(data[i], buffer + offset, size[i]);
+      CheckStatus(mstat);
+      offset += size[i];
+    }
+  }
+
+  mstat = BroadcastChunks(buffer, total);
+  CheckStatus(mstat);
+
+  if (node != MASTER) {
+    for (i = 0; i < count; i++) {
+      if (size[i] == 0) continue;
+      mstat = CopyData(buffer + offset, data[i], size[i]);
+      CheckStatus(mstat);
+      offset += size[i];
+    }
+  }
+
+  free(buffer);
+
+  return mstat;
+}
+
 /**
  * Wrapper to strncpy
  *
@@ -390,6 +525,66 @@ int GetAttributeIndex(attr *a, char *name) {
   return -1;
 }
 
+/**
+ * @brief Resolve the storage bank by its name
+ *
+ * The storage bank is looked up once, and the handle is used with the MReadDataH(),
+ * MWriteDataH() and MAppendDataH() macros instead of the name (no lookup per call).
+ *
+ * @param s The storage array
+ * @param storage_name The storage bank name
+ *
+ * @return The storage handle, the handle name is NULL when the bank is not found
+ */
+storageHandle GetStorageHandle(storage *s, char *storage_name) {
+  storageHandle h = {NULL, -1};
+
+  h.index = GetStorageIndex(s, storage_name);
+  if (h.index >= 0) h.name = s[h.index].layout.name;
+
+  return h;
+}
+
+/**
+ * @brief Resolve the storage bank attribute by its name
+ *
+ * @param s The storage array
+ * @param storage_name The storage bank name
+ * @param attr_name The attribute name
+ *
+ * @return The attribute handle, the handle name is NULL when the attribute is not found
+ */
+attrHandle GetAttributeHandle(storage *s, char *storage_name, char *attr_name) {
+  attrHandle h = {NULL, -1, -1};
+
+  h.storage = GetStorageIndex(s, storage_name);
+  if (h.storage < 0) return h;
+
+  h.index = GetAttributeIndex(s[h.storage].attr, attr_name);
+  if (h.index >= 0) h.name = s[h.storage].attr[h.index].layout.name;
+
+  return h;
+}
+
+/**
+ * @brief Resolve the pool option (the task board attribute) by its name
+ *
+ * @param board The task board
+ * @param option_name The option name
+ *
+ * @return The option handle, the handle name is NULL when the option is not found
+ */
+optionHandle GetOptionHandle(storage *board, char *option_name) {
+  optionHandle h = {NULL, -1};
+
+  if (!board) return h;
+
+  h.index = GetAttributeIndex(board->attr, option_name);
+  if (h.index >= 0) h.name = board->attr[h.index].layout.name;
+
+  return h;
+}
+
 /**
  * @brief Allocates the memory buffer
  *
@@ -415,6 +610,175 @@ int Allocate(storage *s, size_t size, size_t datatype) {
   return SUCCESS;
 }
 
+/**
+ * @brief Allocates the memory buffer backed by the scratch file
+ *
+ * The scratch file is created next to the given file, mapped to the memory and removed
+ * at once, so that it never outlives the run. The file is sparse, and the pages are read
+ * and written back by the system on demand, i.e. the resident part of the buffer is
+ * bounded by the page cache instead of the buffer size.
+ *
+ * @param s The storage object
+ * @param size The number of elements
+ * @param datatype The size of the datatype
+ * @param filename The file to create the scratch file next to
+ *
+ * @return SUCCESS on success, error code otherwise
+ */
+int AllocateMapped(storage *s, size_t size, size_t datatype, char *filename) {
+  char name[FILENAME_MAX];
+  void *memory;
+  int fd;
+
+  if (s->memory) {
+    Message(MESSAGE_ERR, "The buffer is already allocated\n");
+    return CORE_ERR_MEM;
+  }
+
+  if (size == 0) return CORE_ERR_MEM;
+
+  snprintf(name, FILENAME_MAX, SCRATCH_TEMPLATE, filename);
+  fd = mkstemp(name);
+  if (fd < 0) {
+    Message(MESSAGE_ERR, "Could not create the scratch file %s\n", name);
+    return CORE_ERR_MEM;
+  }
+  unlink(name);
+
+  if (ftruncate(fd, size * datatype) < 0) {
+    Message(MESSAGE_ERR, "Could not resize the scratch file for '%s'\n", s->layout.name);
+    close(fd);
+    return CORE_ERR_MEM;
+  }
+
+  memory = mmap(NULL, size * datatype, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (memory == MAP_FAILED) {
+    Message(MESSAGE_ERR, "Could not map the scratch file for '%s'\n", s->layout.name);
+    return CORE_ERR_MEM;
+  }
+
+  Message(MESSAGE_DEBUG, "Storage map: size = %zu, datatype = %zu\n", size, datatype);
+
+  s->memory = memory;
+  s->layout.mapped = 1;
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Release the resident pages of the out-of-core memory buffer
+ *
+ * The data is kept in the scratch file, and it is read back on the next access.
+ *
+ * @param s The storage object
+ */
+void StorageEvict(storage *s) {
+  if (!s->memory || !s->layout.mapped) return;
+  madvise(s->memory, s->layout.storage_size, MADV_DONTNEED);
+}
+
+/**
+ * @brief Commit the task tile layout of the pool task bank
+ *
+ * The strides of the pool bank are computed once per pool, and the trailing axes covered
+ * by the task tile are merged into the contiguous run. This function is used for the
+ * STORAGE_PM3D, STORAGE_LIST, STORAGE_PACKED and STORAGE_TEXTURE banks of the master node,
+ * after the storage dimensions are set.
+ *
+ * @param s The pool task bank
+ */
+void CommitTileLayout(storage *s) {
+  tiling *tile = &s->tile;
+  unsigned int i = 0, axis = 0;
+
+  for (i = 0; i < MAX_RANK; i++) {
+    tile->stride[i] = 0;
+  }
+
+  tile->stride[s->layout.rank - 1] = s->layout.datatype_size;
+  for (i = s->layout.rank - 1; i > 0; i--) {
+    tile->stride[i-1] = tile->stride[i] * s->layout.storage_dim[i];
+  }
+
+  axis = s->layout.rank - 1;
+  while (axis > 0 && s->layout.dims[axis] == s->layout.storage_dim[axis]) axis--;
+
+  tile->run = s->layout.dims[axis] * tile->stride[axis];
+  tile->axes = axis;
+
+  for (i = 0; i < TASK_BOARD_RANK - 1; i++) {
+    tile->count[i] = i < axis ? s->layout.dims[i] : 1;
+  }
+
+  Message(MESSAGE_DEBUG, "[%s:%d] Tile '%s': run %zu bytes, %d outer axes\n", __FILE__, __LINE__,
+      s->layout.name, tile->run, tile->axes);
+}
+
+/**
+ * @brief Copy the task tile between the pool task bank and the task buffer
+ *
+ * @param s The pool task bank
+ * @param offsets The offsets of the task tile in the pool bank
+ * @param data The task buffer
+ * @param gather 1 to copy the tile to the task buffer, 0 to copy the task buffer to the tile
+ */
+static void TileCopy(storage *s, hsize_t *offsets, unsigned char *data, int gather) {
+  tiling *tile = &s->tile;
+  unsigned char *bank = s->memory;
+  size_t i = 0, j = 0, run = tile->run;
+
+  for (i = 0; i < s->layout.rank; i++) {
+    bank += offsets[i] * tile->stride[i];
+  }
+
+  switch (tile->axes) {
+    case 0:
+      if (gather) memcpy(data, bank, run);
+      else memcpy(bank, data, run);
+      break;
+
+    case 1:
+      for (i = 0; i < tile->count[0]; i++, data += run) {
+        if (gather) memcpy(data, bank + i * tile->stride[0], run);
+        else memcpy(bank + i * tile->stride[0], data, run);
+      }
+      break;
+
+    default:
+      for (i = 0; i < tile->count[0]; i++) {
+        for (j = 0; j < tile->count[1]; j++, data += run) {
+          if (gather) memcpy(data, bank + i * tile->stride[0] + j * tile->stride[1], run);
+          else memcpy(bank + i * tile->stride[0] + j * tile->stride[1], data, run);
+        }
+      }
+      break;
+  }
+}
+
+/**
+ * @brief Copy the task data to the task tile of the pool task bank
+ *
+ * @param s The pool task bank (with the committed tile layout)
+ * @param offsets The offsets of the task tile, @see TaskStorageOffsets()
+ * @param data The task data
+ */
+void ScatterData(storage *s, hsize_t *offsets, void *data) {
+  TileCopy(s, offsets, data, 0);
+}
+
+/**
+ * @brief Copy the task tile of the pool task bank to the task data (the reverse of ScatterData())
+ *
+ * @param s The pool task bank (with the committed tile layout)
+ * @param offsets The offsets of the task tile, @see TaskStorageOffsets()
+ * @param data The task data
+ */
+void GatherData(storage *s, hsize_t *offsets, void *data) {
+  TileCopy(s, offsets, data, 1);
+}
+
 /**
  * @brief Allocates the memory buffer for attribute
  *
@@ -509,13 +873,74 @@ void FreeMemoryLayout(unsigned int banks, unsigned int attr_banks, storage *s) {
         free(s[i].attr);
       }
       if (s[i].field) free(s[i].field);
-      if (s[i].memory) free(s[i].memory);
+      if (s[i].memory && s[i].layout.mapped) {
+        munmap(s[i].memory, s[i].layout.storage_size);
+      } else if (s[i].memory) {
+        free(s[i].memory);
+      }
     }
 
     free(s);
   }
 }
 
+/**
+ * @brief Reduce the precision of the data buffer (bit-grooming)
+ *
+ * Applies to PRECISION_ROUND floating point banks only. The mantissa is rounded to the
+ * number of bits required by the significant decimal digits, and the remaining bits are
+ * zeroed, so that the data compresses well. Other precision modes are handled by the HDF5
+ * library during the write.
+ *
+ * @param s The storage structure
+ * @param data The data buffer (of the storage datatype)
+ * @param elements The number of elements in the buffer
+ *
+ * @return SUCCESS on success, error code otherwise
+ */
+int ReducePrecision(storage *s, void *data, size_t elements) {
+  unsigned long long b64, half64, mask64;
+  unsigned int b32, half32, mask32;
+  unsigned int digits = 0, keep = 0;
+  size_t i = 0;
+
+  if (s->layout.precision != PRECISION_ROUND) return SUCCESS;
+  if (s->layout.datatype == H5T_COMPOUND || H5Tget_class(s->layout.datatype) != H5T_FLOAT) return SUCCESS;
+  if (!data) return CORE_ERR_MEM;
+
+  digits = s->layout.digits;
+  if (digits == 0) digits = PRECISION_DIGITS;
+
+  /* log2(10) bits per decimal digit, rounded up, and one guard bit */
+  keep = (digits * 3322 + 999) / 1000 + 1;
+
+  if (s->layout.datatype_size == sizeof(double) && keep < 52) {
+    half64 = 1ULL << (52 - keep - 1);
+    mask64 = ~((1ULL << (52 - keep)) - 1);
+    for (i = 0; i < elements; i++) {
+      memcpy(&b64, (char*) data + i * sizeof(double), sizeof(double));
+      if (((b64 >> 52) & 0x7FF) != 0x7FF) {
+        b64 = (b64 + half64) & mask64;
+        memcpy((char*) data + i * sizeof(double), &b64, sizeof(double));
+      }
+    }
+  }
+
+  if (s->layout.datatype_size == sizeof(float) && keep < 23) {
+    half32 = 1U << (23 - keep - 1);
+    mask32 = ~((1U << (23 - keep)) - 1);
+    for (i = 0; i < elements; i++) {
+      memcpy(&b32, (char*) data + i * sizeof(float), sizeof(float));
+      if (((b32 >> 23) & 0xFF) != 0xFF) {
+        b32 = (b32 + half32) & mask32;
+        memcpy((char*) data + i * sizeof(float), &b32, sizeof(float));
+      }
+    }
+  }
+
+  return SUCCESS;
+}
+
 /**
  * @brief Commit the data to the master file
  *
@@ -527,6 +952,7 @@ void FreeMemoryLayout(unsigned int banks, unsigned int attr_banks, storage *s) {
  */
 int CommitData(hid_t h5location, int banks, storage *s) {
   int mstat = SUCCESS, i = 0, j = 0;
+  unsigned int rank = 0;
   hid_t dataspace, dataset, memspace;
   hid_t h5datatype;
   herr_t hdf_status = 0;
@@ -536,20 +962,18 @@ int CommitData(hid_t h5location, int banks, storage *s) {
   for (i = 0; i < banks; i++) {
     if (s[i].layout.use_hdf && s[i].layout.size > 0) {
 
-      dataset = H5Dopen2(h5location, s[i].layout.name, H5P_DEFAULT);
-      H5CheckStatus(dataset);
+      dataset = SessionDataset(h5location, s[i].layout.name);
       dataspace = H5Dget_space(dataset);
       H5CheckStatus(dataspace);
 
       buffer = calloc(s[i].layout.elements, s[i].layout.datatype_size);
       ReadData(&s[i], buffer);
 
-      h5datatype = s[i].layout.datatype;
+      /* The lossy precision is applied to the copy only */
+      mstat = ReducePrecision(&s[i], buffer, s[i].layout.elements);
+      CheckStatus(mstat);
 
-      if (s[i].layout.datatype == H5T_COMPOUND) {
-        h5datatype = CommitFileDatatype(&s[i]);
-        H5CheckStatus(h5datatype);
-      }
+      h5datatype = SessionDatatype(&s[i]);
 
       /* Whole dataset at once */
       if (s[i].layout.storage_type == STORAGE_GROUP) {
@@ -564,7 +988,10 @@ int CommitData(hid_t h5location, int banks, storage *s) {
           offsets[j] = s[i].layout.offsets[j];
         }
 
-        memspace = H5Screate_simple(s[i].layout.rank, dims, NULL);
+        /* The memory block has the same element order as the file region */
+        rank = StorageFileRegion(&s[i], offsets, dims);
+
+        memspace = H5Screate_simple(rank, dims, NULL);
         H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offsets, NULL, dims, NULL);
         hdf_status = H5Dwrite(dataset, h5datatype,
             memspace, dataspace, H5P_DEFAULT, buffer);
@@ -576,9 +1003,7 @@ int CommitData(hid_t h5location, int banks, storage *s) {
       if (buffer) free(buffer);
 
       H5Sclose(dataspace);
-      H5Dclose(dataset);
-
-      if (s[i].layout.datatype == H5T_COMPOUND) H5Tclose(h5datatype);
+      SessionDatasetClose(dataset);
     }
   }
 
@@ -753,6 +1178,61 @@ int ReadDataset(hid_t h5location, int banks, storage *s, unsigned int size) {
   return mstat;
 }
 
+/**
+ * @brief Get the region of the task bank in the storage dataset
+ *
+ * The region is given in the memory bank coordinates, where the task blocks follow each
+ * other along the first axis. The STORAGE_PACKED dataset has the additional leading axis
+ * (the task ID), so that the first axis is split into the task and the block axes. Both
+ * layouts have the same element order. Other storage types are stored as in the memory.
+ *
+ * @param s The storage structure
+ * @param offsets The region offsets (converted in place, may be NULL)
+ * @param count The region count (converted in place)
+ *
+ * @return The rank of the storage dataset
+ */
+unsigned int StorageFileRegion(storage *s, hsize_t *offsets, hsize_t *count) {
+  unsigned int i = 0;
+  hsize_t block;
+
+  if (s->layout.storage_type != STORAGE_PACKED) return s->layout.rank;
+
+  block = s->layout.dims[0];
+
+  for (i = s->layout.rank; i > 1; i--) {
+    count[i] = count[i-1];
+    if (offsets) offsets[i] = offsets[i-1];
+  }
+
+  count[1] = block;
+  count[0] = count[0] / block;
+
+  if (offsets) {
+    offsets[1] = 0;
+    offsets[0] = offsets[0] / block;
+  }
+
+  return s->layout.rank + 1;
+}
+
+/**
+ * @brief Get the number of the STORAGE_STREAM task banks
+ *
+ * @param p The current pool pointer
+ *
+ * @return The number of the stream banks
+ */
+unsigned int StreamBanks(pool *p) {
+  unsigned int i = 0, streams = 0;
+
+  for (i = 0; i < p->task_banks; i++) {
+    if (p->task->storage[i].layout.storage_type == STORAGE_STREAM) streams++;
+  }
+
+  return streams;
+}
+
 /**
  * @brief
  * Commit the compound datatype to the memory
@@ -19,11 +19,30 @@
 #define STORAGE_PM3D 12 /**< The pm3d data storage type */
 #define STORAGE_TEXTURE 13 /**< The board data storage type */
 #define STORAGE_LIST 14 /**< The list data storage type */
+#define STORAGE_PACKED 15 /**< The packed per-task data storage type (addressed by the task ID) */
+#define STORAGE_STREAM 16 /**< The streaming data storage type (records appended by the tasks) */
+#define STREAM_INDEX "%s-index" /**< The name of the stream index dataset */
+#define STREAM_INDEX_FIELDS 4 /**< The stream index fields: task ID, checkpoint ID, offset, count */
+#define SCRATCH_TEMPLATE "%s.scratch-XXXXXX" /**< The scratch file of the out-of-core task banks */
 
 #define HDF_NO_STORAGE 0 /**< No HDF5 file storage */
 #define HDF_NORMAL_STORAGE 1 /**< HDF5 file storage */
 #define HDF_TEMP_STORAGE 2 /**< Only temporary HDF5 file storage */
 
+#define FILTER_NONE 0 /**< No storage filters */
+#define FILTER_SHUFFLE 1 /**< The HDF5 shuffle filter */
+#define FILTER_DEFLATE 2 /**< The HDF5 deflate (gzip) filter */
+#define FILTER_NBIT 4 /**< The HDF5 N-bit filter */
+#define FILTER_SCALEOFFSET 8 /**< The HDF5 scale-offset filter (lossless, integer datasets only) */
+#define FILTER_DEFLATE_LEVEL 6 /**< The default deflate compression level */
+#define CHUNK_SIZE 65536 /**< The default chunk size of the task datasets (in bytes) */
+
+#define PRECISION_FULL 0 /**< Store the data with the full precision */
+#define PRECISION_FLOAT 1 /**< Store the floating point data as float32 */
+#define PRECISION_ROUND 2 /**< Round the mantissa to the number of significant digits (bit-grooming) */
+#define PRECISION_SCALEOFFSET 3 /**< Quantize the data with the scale-offset filter (decimal digits) */
+#define PRECISION_DIGITS 4 /**< The default number of digits kept */
+
 #define STORAGE_END {.name = NULL, .dataspace = H5S_SIMPLE, .datatype = -1, .mpi_datatype = MPI_DOUBLE, .rank = 0, .dims = {0, 0, 0, 0}, .offsets = {0, 0, 0, 0}, .use_hdf = 0, .sync = 0, .storage_type = STORAGE_NULL} /**< The storage scheme default initializer */
 #define FIELD_STORAGE_END {.name = NULL, .dataspace = H5S_SIMPLE, .datatype = -1, .mpi_datatype = MPI_DOUBLE, .rank = 0, .dims = {0, 0, 0, 0}, .offsets = {0, 0, 0, 0}, .use_hdf = 0, .sync = 0, .storage_type = STORAGE_NULL, .field_offset = -1} /**< The storage scheme default initializer */
 #define ATTR_STORAGE_END {.name = NULL, .dataspace = H5S_NO_CLASS, .datatype = -1, .mpi_datatype = MPI_DOUBLE, .rank = 0, .dims = {0, 0, 0, 0}, .offsets = {0, 0, 0, 0}, .use_hdf = 0, .sync = 0, .storage_type = STORAGE_NULL} /**< The attribute storage scheme default initializer */
@@ -35,11 +54,16 @@
 typedef struct {
   char *name; /**< The name of the dataset */
   unsigned short rank; /**< The rank of the dataset */
-  unsigned short storage_type; /**< The storage type: STORAGE_GROUP, STORAGE_PM3D, STORAGE_TEXTURE, STORAGE_LIST */
+  unsigned short storage_type; /**< The storage type: STORAGE_GROUP, STORAGE_PM3D, STORAGE_TEXTURE, STORAGE_LIST, STORAGE_PACKED, STORAGE_STREAM */
   unsigned short use_hdf; /**< Enables HDF5 storage for the memory block */
   unsigned short sync; /**< Whether to synchronize memory bank between master and worker */
   unsigned int dims[MAX_RANK]; /**< The dimensions of the memory dataset */
   hid_t datatype; /**< The datatype of the dataset */
+  unsigned int chunk[MAX_RANK]; /**< The chunk dimensions of the storage dataset (optional) */
+  unsigned short filters; /**< The storage filters: FILTER_SHUFFLE, FILTER_DEFLATE, FILTER_NBIT, FILTER_SCALEOFFSET */
+  unsigned short deflate; /**< The deflate compression level (optional) */
+  unsigned short precision; /**< The lossy storage precision: PRECISION_FULL, PRECISION_FLOAT, PRECISION_ROUND, PRECISION_SCALEOFFSET */
+  unsigned short digits; /**< The number of digits kept by PRECISION_ROUND and PRECISION_SCALEOFFSET (optional) */
   unsigned int storage_dim[MAX_RANK]; /**< @internal The dimensions of the storage dataset */
   unsigned int offsets[MAX_RANK]; /**< @internal The offsets (calculated automatically) */
   H5S_class_t dataspace; /**< @internal The type of the HDF5 dataspace (H5S_SIMPLE) */
@@ -49,6 +73,8 @@ typedef struct {
   size_t datatype_size; /** @internal The size of the datatype */
   unsigned int elements; /**< @internal Number of data elements in the memory block */
   unsigned int storage_elements; /**< @internal Number of data elements in the storage block */
+  unsigned int records; /**< @internal Number of records appended to the memory block (STORAGE_STREAM) */
+  unsigned short mapped; /**< @internal The memory block is mapped to the scratch file (out-of-core) */
   size_t compound_size; /**< @internal Compound datatype size */
   size_t field_offset; /**< Compound datatype field offset */
 } schema;
@@ -72,6 +98,21 @@ typedef struct {
   unsigned short compound_fields; /**< Number of compound datatype fields in use */
 } attr;
 
+/**
+ * @struct tiling
+ * The task tile in the pool task bank (the scatter/gather plan)
+ *
+ * The axes fully covered by the task tile are merged into a single contiguous run, so that
+ * at most TASK_BOARD_RANK - 1 outer axes are left (STORAGE_TEXTURE) and the
+ * STORAGE_PM3D, STORAGE_LIST and STORAGE_PACKED tiles are copied at once.
+ */
+typedef struct {
+  size_t run; /**< The size of the contiguous run (bytes) */
+  size_t count[TASK_BOARD_RANK - 1]; /**< The number of runs along the outer axes */
+  size_t stride[MAX_RANK]; /**< The strides of the pool bank axes (bytes) */
+  unsigned short axes; /**< The number of the outer axes */
+} tiling;
+
 /**
  * @struct storage
  * The storage structure
@@ -79,6 +120,7 @@ typedef struct {
 typedef struct {
   schema layout; /**< The memory/storage schema, @see schema */
   unsigned char *memory; /**< The memory block */
+  tiling tile; /**< @internal The task tile of the pool task bank (master node) */
   attr *attr; /**< The dataset attributes */
   field *field; /**< Compound datatype fields */
   unsigned short attr_banks; /**< Number of attribute banks in use */
@@ -125,8 +167,40 @@ typedef struct {
   unsigned short pool_banks; /**< The number of pool memory banks */
   unsigned short task_banks; /**< The number of task memory banks */
   unsigned short attr_banks; /**< The number of attributes banks */
+  unsigned char *restored; /**< The board cells of the tasks not read yet (lazy restart) */
 } pool;
 
+/**
+ * @struct storageHandle
+ * The storage bank resolved by its name, @see GetStorageHandle()
+ *
+ * The handle is valid for the pool it has been resolved for. The task banks handle
+ * resolved for the pool task (p->task) is valid for all tasks of the pool.
+ */
+typedef struct {
+  char *name; /**< The storage bank name (NULL when not resolved) */
+  int index; /**< The storage bank index */
+} storageHandle;
+
+/**
+ * @struct attrHandle
+ * The storage bank attribute resolved by its name, @see GetAttributeHandle()
+ */
+typedef struct {
+  char *name; /**< The attribute name (NULL when not resolved) */
+  int storage; /**< The storage bank index */
+  int index; /**< The attribute index */
+} attrHandle;
+
+/**
+ * @struct optionHandle
+ * The pool option (the task board attribute) resolved by its name, @see GetOptionHandle()
+ */
+typedef struct {
+  char *name; /**< The option name (NULL when not resolved) */
+  int index; /**< The task board attribute index */
+} optionHandle;
+
 /**
  * Data read/write helpers
  */
@@ -134,6 +208,7 @@ unsigned int GetSize(unsigned int rank, unsigned int *dims); /**< Get the 1D siz
 void GetDims(storage *s, unsigned int *dims); /**< Get the dimensions of the storage object */
 int CopyData(void *in, void *out, size_t size); /**< Copy data buffers */
 char* StringCopy(char *in); /**< Copy the given string */
+int BroadcastData(int node, unsigned int count, void **data, size_t *size); /**< Broadcast the buffers in a single message */
 
 /**
  * Direct read/write interface
@@ -142,24 +217,134 @@ int WriteData(storage *s, void *data); /**< Copy local data buffers to memory (b
 int ReadData(storage *s, void *data); /**< Copy memory buffers to local data buffers (by storage index) */
 int WriteAttr(attr *a, void *data); /**< Copy local attribute buffers to memory (by attribute index) */
 int ReadAttr(attr *a, void *data); /**< Copy attribute buffers to local data buffers (by attribute index */
+int AppendData(storage *s, void *data, unsigned int records); /**< Append the records to the stream memory (by storage index) */
 
 int GetStorageIndex(storage *s, char *storage_name); /**< Get the index for given storage bank */
 int GetAttributeIndex(attr *a, char *storage_name); /**< Get the index for given attribute */
 
+/**
+ * Handle interface (the names resolved once, i.e. in LoopPrepare())
+ */
+storageHandle GetStorageHandle(storage *s, char *storage_name); /**< Resolve the storage bank */
+attrHandle GetAttributeHandle(storage *s, char *storage_name, char *attr_name); /**< Resolve the attribute */
+optionHandle GetOptionHandle(storage *board, char *option_name); /**< Resolve the pool option */
+
+/**
+ * @macro
+ * Resolve the storage bank of the given object (pool, task) into the handle
+ */
+#define MStorageHandle(_mobject, _mstorage_name, _mhandle)\
+  if (_mobject) {\
+    *(_mhandle) = GetStorageHandle(_mobject->storage, _mstorage_name);\
+    if (!(_mhandle)->name) {\
+      Message(MESSAGE_ERR, "MStorageHandle: Storage bank '%s' could not be found\n", _mstorage_name);\
+      Error(CORE_ERR_MEM);\
+    }\
+  } else {\
+    Message(MESSAGE_ERR, "MStorageHandle: Invalid object\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
+/**
+ * @macro
+ * Resolve the storage bank attribute of the given object (pool, task) into the handle
+ */
+#define MAttrHandle(_mobject, _mstorage_name, _mattr_name, _mhandle)\
+  if (_mobject) {\
+    *(_mhandle) = GetAttributeHandle(_mobject->storage, _mstorage_name, _mattr_name);\
+    if (!(_mhandle)->name) {\
+      Message(MESSAGE_ERR, "MAttrHandle: Attribute '%s' for storage '%s' could not be found\n",\
+          _mattr_name, _mstorage_name);\
+      Error(CORE_ERR_MEM);\
+    }\
+  } else {\
+    Message(MESSAGE_ERR, "MAttrHandle: Invalid object\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
+/**
+ * @macro
+ * Read the data for the given object (pool, task) by the storage handle
+ */
+#define MReadDataH(_mobject, _mhandle, _mdata)\
+  if (_mobject && (_mhandle).name) {\
+    int _mmstat;\
+    _mmstat = ReadData(&_mobject->storage[(_mhandle).index], _mdata);\
+    CheckStatus(_mmstat);\
+  } else {\
+    Message(MESSAGE_ERR, "MReadDataH: Invalid object or storage handle\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
+/**
+ * @macro
+ * Write the data for the given object (pool, task) by the storage handle
+ */
+#define MWriteDataH(_mobject, _mhandle, _mdata)\
+  if (_mobject && (_mhandle).name) {\
+    int _mmstat;\
+    _mmstat = WriteData(&_mobject->storage[(_mhandle).index], _mdata);\
+    CheckStatus(_mmstat);\
+  } else {\
+    Message(MESSAGE_ERR, "MWriteDataH: Invalid object or storage handle\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
+/**
+ * @macro
+ * Append the records to the stream of the given task by the storage handle
+ */
+#define MAppendDataH(_mobject, _mhandle, _mdata, _mrecords)\
+  if (_mobject && (_mhandle).name) {\
+    int _mmstat;\
+    _mmstat = AppendData(&_mobject->storage[(_mhandle).index], _mdata, _mrecords);\
+    CheckStatus(_mmstat);\
+  } else {\
+    Message(MESSAGE_ERR, "MAppendDataH: Invalid object or storage handle\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
+/**
+ * @macro
+ * Read the attribute for the given object (pool, task) by the attribute handle
+ */
+#define MReadAttrH(_mobject, _mhandle, _mdata)\
+  if (_mobject && (_mhandle).name) {\
+    int _mmstat;\
+    _mmstat = ReadAttr(&_mobject->storage[(_mhandle).storage].attr[(_mhandle).index], _mdata);\
+    CheckStatus(_mmstat);\
+  } else {\
+    Message(MESSAGE_ERR, "MReadAttrH: Invalid object or attribute handle\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
+/**
+ * @macro
+ * Write the attribute for the given object (pool, task) by the attribute handle
+ */
+#define MWriteAttrH(_mobject, _mhandle, _mdata)\
+  if (_mobject && (_mhandle).name) {\
+    int _mmstat;\
+    _mmstat = WriteAttr(&_mobject->storage[(_mhandle).storage].attr[(_mhandle).index], _mdata);\
+    CheckStatus(_mmstat);\
+  } else {\
+    Message(MESSAGE_ERR, "MWriteAttrH: Invalid object or attribute handle\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
 /**
  * @macro
  * Read the data for the given object (pool, task)
  */
 #define MReadData(_mobject, _mstorage_name, _mdata)\
   if (_mobject) {\
-    int _msindex, _mmstat;\
-    _msindex = GetStorageIndex(_mobject->storage, _mstorage_name);\
-    if (_msindex < 0) {\
+    storageHandle _mshandle;\
+    _mshandle = GetStorageHandle(_mobject->storage, _mstorage_name);\
+    if (!_mshandle.name) {\
       Message(MESSAGE_ERR, "MReadData: Storage bank '%s' could not be found\n", _mstorage_name);\
       Error(CORE_ERR_MEM);\
     } else {\
-      _mmstat = ReadData(&_mobject->storage[_msindex], _mdata);\
-      CheckStatus(_mmstat);\
+      MReadDataH(_mobject, _mshandle, _mdata);\
     }\
   } else {\
     Message(MESSAGE_ERR, "MReadData: Invalid object\n");\
@@ -172,40 +357,52 @@ int GetAttributeIndex(attr *a, char *storage_name); /**< Get the index for given
  */
 #define MWriteData(_mobject, _mstorage_name, _mdata)\
   if (_mobject) {\
-    int _msindex, _mmstat;\
-    _msindex = GetStorageIndex(_mobject->storage, _mstorage_name);\
-    if (_msindex < 0) {\
+    storageHandle _mshandle;\
+    _mshandle = GetStorageHandle(_mobject->storage, _mstorage_name);\
+    if (!_mshandle.name) {\
       Message(MESSAGE_ERR, "MWriteData: Storage bank '%s' could not be found\n", _mstorage_name);\
       Error(CORE_ERR_MEM);\
     } else {\
-      _mmstat = WriteData(&_mobject->storage[_msindex], _mdata);\
-      CheckStatus(_mmstat);\
+      MWriteDataH(_mobject, _mshandle, _mdata);\
     }\
   } else {\
     Message(MESSAGE_ERR, "MWriteData: Invalid object\n");\
     Error(CORE_ERR_MEM);\
   }
 
+/**
+ * @macro
+ * Append the records to the stream of the given task
+ */
+#define MAppendData(_mobject, _mstorage_name, _mdata, _mrecords)\
+  if (_mobject) {\
+    storageHandle _mshandle;\
+    _mshandle = GetStorageHandle(_mobject->storage, _mstorage_name);\
+    if (!_mshandle.name) {\
+      Message(MESSAGE_ERR, "MAppendData: Storage bank '%s' could not be found\n", _mstorage_name);\
+      Error(CORE_ERR_MEM);\
+    } else {\
+      MAppendDataH(_mobject, _mshandle, _mdata, _mrecords);\
+    }\
+  } else {\
+    Message(MESSAGE_ERR, "MAppendData: Invalid object\n");\
+    Error(CORE_ERR_MEM);\
+  }
+
 /**
  * @macro
  * Read the attribute for the given object (pool, task)
  */
 #define MReadAttr(_mobject, _mstorage_name, _mattr_name, _mdata)\
   if (_mobject) {\
-    int _msindex, _maindex, _mmstat;\
-    _msindex = GetStorageIndex(_mobject->storage, _mstorage_name);\
-    if (_msindex < 0) {\
-      Message(MESSAGE_ERR, "MReadAttr: Storage bank '%s' could not be found\n", _mstorage_name);\
+    attrHandle _mahandle;\
+    _mahandle = GetAttributeHandle(_mobject->storage, _mstorage_name, _mattr_name);\
+    if (!_mahandle.name) {\
+      Message(MESSAGE_ERR, "MReadAttr: Attribute '%s' for storage '%s' could not be found\n",\
+          _mattr_name, _mstorage_name);\
       Error(CORE_ERR_MEM);\
     } else {\
-      _maindex = GetAttributeIndex(_mobject->storage[_msindex].attr, _mattr_name);\
-      if (_maindex < 0) {\
-        Message(MESSAGE_ERR, "MReadAttr: Attribute '%s' for storage '%s' could not be found\n",\
-            _mattr_name, _mstorage_name);\
-        Error(CORE_ERR_MEM);\
-      }\
-      _mmstat = ReadAttr(&_mobject->storage[_msindex].attr[_maindex], _mdata);\
-      CheckStatus(_mmstat);\
+      MReadAttrH(_mobject, _mahandle, _mdata);\
     }\
   } else {\
     Message(MESSAGE_ERR, "MReadAttr: Invalid object\n");\
@@ -218,20 +415,14 @@ int GetAttributeIndex(attr *a, char *storage_name); /**< Get the index for given
  */
 #define MWriteAttr(_mobject, _mstorage_name, _mattr_name, _mdata)\
   if (_mobject) {\
-    int _msindex, _maindex, _mmstat;\
-    _msindex = GetStorageIndex(_mobject->storage, _mstorage_name);\
-    if (_msindex < 0) {\
-      Message(MESSAGE_ERR, "MWriteAttr: Storage bank '%s' could not be found\n", _mstorage_name);\
+    attrHandle _mahandle;\
+    _mahandle = GetAttributeHandle(_mobject->storage, _mstorage_name, _mattr_name);\
+    if (!_mahandle.name) {\
+      Message(MESSAGE_ERR, "MWriteAttr: Attribute '%s' for storage '%s' could not be found\n",\
+          _mattr_name, _mstorage_name);\
       Error(CORE_ERR_MEM);\
     } else {\
-      _maindex = GetAttributeIndex(_mobject->storage[_msindex].attr, _mattr_name);\
-      if (_maindex < 0) {\
-        Message(MESSAGE_ERR, "MWriteAttr: Attribute '%s' for storage '%s' could not be found\n",\
-            _mattr_name, _mstorage_name);\
-        Error(CORE_ERR_MEM);\
-      }\
-      _mmstat = WriteAttr(&_mobject->storage[_msindex].attr[_maindex], _mdata);\
-      CheckStatus(_mmstat);\
+      MWriteAttrH(_mobject, _mahandle, _mdata);\
     }\
   } else {\
     Message(MESSAGE_ERR, "MWriteAttr: Invalid object\n");\
@@ -484,7 +675,15 @@ int CommitAttribute(hid_t h5location, attr *a);
 void FreeMemoryLayout(unsigned int banks, unsigned int attr_banks, storage *s);
 
 int CommitData(hid_t h5location, int banks, storage *s);
+int ReducePrecision(storage *s, void *data, size_t elements);
 int ReadDataset(hid_t h5location, int banks, storage *s, unsigned int size);
+unsigned int StorageFileRegion(storage *s, hsize_t *offsets, hsize_t *count);
+unsigned int StreamBanks(pool *p);
+int AllocateMapped(storage *s, size_t size, size_t datatype, char *filename);
+void StorageEvict(storage *s);
+void CommitTileLayout(storage *s);
+void ScatterData(storage *s, hsize_t *offsets, void *data);
+void GatherData(storage *s, hsize_t *offsets, void *data);
 
 size_t GetPadding(unsigned int elements, size_t datatype_size);
 hid_t CommitDatatype(storage *s);
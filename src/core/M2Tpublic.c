@@ -9,6 +9,8 @@
  * The task (public API)
  */
 #include "M2Tpublic.h"
+#include "M2Fpublic.h"
+#include "M2Ipublic.h"
 
 /**
  * @brief Load the task
@@ -86,6 +88,8 @@ task* M2TaskLoad(module *m, pool *p, unsigned int tid) {
     t->storage[i].layout.storage_elements = p->task->storage[i].layout.elements;
     t->storage[i].layout.datatype_size    = p->task->storage[i].layout.datatype_size;
     t->storage[i].layout.compound_size    = p->task->storage[i].layout.compound_size;
+    t->storage[i].layout.precision        = p->task->storage[i].layout.precision;
+    t->storage[i].layout.digits           = p->task->storage[i].layout.digits;
     t->storage[i].attr_banks              = p->task->storage[i].attr_banks;
     t->storage[i].compound_fields         = p->task->storage[i].compound_fields;
 
@@ -227,15 +231,12 @@ int GetNewTask(module *m, pool *p, task *t, short ****board_buffer) {
     y = t->location[1];
     z = t->location[2];
 
-    if (m->mode == RESTART_MODE) {
-      // Prepare the checkpoint data
-      if (board_buffer[x][y][z][0] == TASK_TO_BE_RESTARTED) {
-        mstat = TaskRestore(m, p, t);
-        t->cid = board_buffer[x][y][z][2];
-      }
-
-      if (board_buffer[x][y][z][0] == TASK_AVAILABLE
-          || board_buffer[x][y][z][0] == TASK_TO_BE_RESTARTED) break;
+    // Prepare the checkpoint data (the available tasks are reset below, so that they do not
+    // inherit the checkpoint ID of the previously restored task)
+    if (m->mode == RESTART_MODE && board_buffer[x][y][z][0] == TASK_TO_BE_RESTARTED) {
+      mstat = TaskRestore(m, p, t);
+      t->cid = board_buffer[x][y][z][2];
+      break;
     }
 
     if (board_buffer[x][y][z][0] == TASK_AVAILABLE) {
@@ -251,127 +252,51 @@ int GetNewTask(module *m, pool *p, task *t, short ****board_buffer) {
 }
 
 /**
- * @brief Restore the task data from the pool data (restart mode)
+ * @brief Copy the task data between the task and the pool task banks
+ *
+ * The task tiles of the STORAGE_PM3D, STORAGE_LIST, STORAGE_PACKED and STORAGE_TEXTURE
+ * banks are copied with the tile layout committed for the pool, @see CommitTileLayout().
  *
  * @param m The module pointer
  * @param p The current pool pointer
  * @param t The task pointer
+ * @param restore 1 to copy the pool data to the task, 0 to copy the task data to the pool
  *
  * @return 0 on success, error code otherwise
  */
-int TaskRestore(module *m, pool *p, task *t) {
+static int TaskCopy(module *m, pool *p, task *t, int restore) {
   int mstat = SUCCESS;
-  unsigned int j = 0, k = 0, l = 0, r = 0;
-  unsigned int e_offset = 0, l_offset = 0, k_offset = 0, z_offset = 0;
-  unsigned int s_offset = 0, r_offset = 0, dim_offset = 0;
-  size_t elements = 0;
-  hsize_t dims[MAX_RANK], offsets[MAX_RANK];
-
-  for (l = 0; l < MAX_RANK; l++) {
-    dims[l] = p->board->layout.dims[l];
-  }
+  unsigned int j = 0, l = 0;
+  hsize_t offsets[MAX_RANK];
 
   for (j = 0; j < p->task_banks; j++) {
 
-    for (l = 0; l < MAX_RANK; l++) {
-      offsets[l] = 0;
-    }
-
-    elements = 1;
-    for (k = 1; k < t->storage[j].layout.rank; k++) {
-      elements *= t->storage[j].layout.dims[k];
-    }
-    elements *= t->storage[j].layout.datatype_size;
-
-    dim_offset = 1;
-    for (k = 2; k < t->storage[j].layout.rank; k++) {
-      dim_offset *= t->storage[j].layout.dims[k];
-    }
-
-    // Prepare STORAGE_PM3D
-    if (t->storage[j].layout.storage_type == STORAGE_PM3D) {
-      offsets[0] = (t->location[0] + dims[0]*t->location[1]) * t->storage[j].layout.dims[0]
-        + t->location[2]*dims[0]*dims[1]*t->storage[j].layout.dims[0];
-      offsets[1] = 0;
-      Message(MESSAGE_DEBUG, "[%s:%d] PM3D[%d] task %d %d %d with offsets %d %d %d\n", __FILE__, __LINE__,
-          j, t->tid, t->location[0], t->location[1], (int)offsets[0], (int)offsets[1], (int)offsets[2]);
-
-      l_offset = elements;
-      z_offset = 0;
-    }
-
-    // Prepare STORAGE_LIST
-    if (t->storage[j].layout.storage_type == STORAGE_LIST) {
-      offsets[0] = t->tid * t->storage[j].layout.dims[0];
-      offsets[1] = 0;
-      Message(MESSAGE_DEBUG, "[%s:%d] LIST[%d] task %d %d %d with offsets %d %d %d\n", __FILE__, __LINE__,
-          j, t->tid, t->location[0], t->location[1], (int)offsets[0], (int)offsets[1], (int)offsets[2]);
-
-      l_offset = elements;
-      z_offset = 0;
-    }
-
-    // Prepare STORAGE_TEXTURE
-    if (t->storage[j].layout.storage_type == STORAGE_TEXTURE) {
-      offsets[0] = t->location[0] * t->storage[j].layout.dims[0];
-      offsets[1] = t->location[1] * t->storage[j].layout.dims[1];
-      offsets[2] = t->location[2] * t->storage[j].layout.dims[2];
+    if (t->storage[j].layout.storage_type == STORAGE_PM3D ||
+        t->storage[j].layout.storage_type == STORAGE_LIST ||
+        t->storage[j].layout.storage_type == STORAGE_PACKED ||
+        t->storage[j].layout.storage_type == STORAGE_TEXTURE) {
 
-      Message(MESSAGE_DEBUG, "[%s:%d] BOARD[%d] task %d %d %d with offsets %d %d %d\n", __FILE__, __LINE__,
+      TaskStorageOffsets(p, t, j, offsets);
+      Message(MESSAGE_DEBUG, "[%s:%d] BANK[%d] task %d %d %d with offsets %d %d %d\n", __FILE__, __LINE__,
           j, t->tid, t->location[0], t->location[1], (int)offsets[0], (int)offsets[1], (int)offsets[2]);
 
-    }
-
-    for (l = 0; l < MAX_RANK; l++) {
-      t->storage[j].layout.offsets[l] = offsets[l];
-    }
-
-    // Restore the data
-    if (t->storage[j].layout.storage_type == STORAGE_TEXTURE) {
-
-      elements = 1;
-      for (k = 2; k < t->storage[j].layout.rank; k++) {
-        elements *= t->storage[j].layout.dims[k];
-      }
-
-      elements *= t->storage[j].layout.datatype_size;
-      s_offset = dims[1] * dims[2] * elements * t->storage[j].layout.dims[1];
-
-      for (k = 0; k < t->storage[j].layout.dims[0]; k++) {
-
-        k_offset = k * s_offset;
-        k_offset += t->location[0] * t->storage[j].layout.dims[0] * s_offset;
-        k_offset += t->location[1] * t->storage[j].layout.dims[1] * dims[2] * elements;
-        k_offset += t->location[2] * elements;
-
-        for (r = 0; r < t->storage[j].layout.dims[1]; r++) {
-
-          e_offset = r * elements + k * t->storage[j].layout.dims[1] * elements;
-          r_offset = r * elements * dims[2] + k_offset;
-
-          mstat = CopyData(p->task->storage[j].memory + r_offset, t->storage[j].memory + e_offset, elements);
-          CheckStatus(mstat);
-        }
+      for (l = 0; l < MAX_RANK; l++) {
+        t->storage[j].layout.offsets[l] = offsets[l];
       }
-    } else if (t->storage[j].layout.storage_type == STORAGE_LIST ||
-        t->storage[j].layout.storage_type == STORAGE_PM3D) {
-
-      for (k = 0; k < t->storage[j].layout.dims[0]; k++) {
-        k_offset = k * l_offset;
-        k_offset += t->storage[j].layout.offsets[1] * dim_offset * t->storage[j].layout.datatype_size;
-        k_offset += t->storage[j].layout.offsets[0] * l_offset;
-        k_offset += z_offset;
 
-        e_offset = k * elements;
-
-        mstat = CopyData(p->task->storage[j].memory + k_offset, t->storage[j].memory + e_offset, elements);
-        CheckStatus(mstat);
+      if (restore) {
+        GatherData(&p->task->storage[j], offsets, t->storage[j].memory);
+      } else {
+        ScatterData(&p->task->storage[j], offsets, t->storage[j].memory);
       }
-
     }
 
     if (t->storage[j].layout.storage_type == STORAGE_GROUP) {
-      mstat = CopyData(p->tasks[t->tid]->storage[j].memory, t->storage[j].memory, t->storage[j].layout.size);
+      if (restore) {
+        mstat = CopyData(p->tasks[t->tid]->storage[j].memory, t->storage[j].memory, t->storage[j].layout.size);
+      } else {
+        mstat = CopyData(t->storage[j].memory, p->tasks[t->tid]->storage[j].memory, t->storage[j].layout.size);
+      }
       CheckStatus(mstat);
     }
   }
@@ -379,6 +304,38 @@ int TaskRestore(module *m, pool *p, task *t) {
   return mstat;
 }
 
+/**
+ * @brief Restore the task data from the pool data (restart mode)
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param t The task pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int TaskRestore(module *m, pool *p, task *t) {
+  int mstat = SUCCESS;
+
+  /* The task data of the lazily restarted pool is read on demand */
+  mstat = SessionFetchTask(m, p, t);
+  CheckStatus(mstat);
+
+  return TaskCopy(m, p, t, 1);
+}
+
+/**
+ * @brief Store the task data in the pool data (the reverse of TaskRestore())
+ *
+ * @param m The module pointer
+ * @param p The current pool pointer
+ * @param t The task pointer
+ *
+ * @return 0 on success, error code otherwise
+ */
+int TaskStore(module *m, pool *p, task *t) {
+  return TaskCopy(m, p, t, 0);
+}
+
 /**
  * @brief Prepare the task
  *
@@ -390,11 +347,14 @@ int TaskRestore(module *m, pool *p, task *t) {
  */
 int M2TaskPrepare(module *m, pool *p, task *t) {
   int mstat = SUCCESS;
+  double span;
   query *q;
 
+  span = TraceTime();
   q = LoadSym(m, "TaskPrepare", LOAD_DEFAULT);
   if (q) mstat = q(p, t);
   CheckStatus(mstat);
+  TraceSpan(TRACE_TASK_PREPARE, span, t->tid, p->pid, t->cid);
 
   return mstat;
 }
@@ -410,11 +370,14 @@ int M2TaskPrepare(module *m, pool *p, task *t) {
  */
 int M2TaskProcess(module *m, pool *p, task *t) {
   int mstat = SUCCESS;
+  double span;
   query *q;
 
+  span = TraceTime();
   q = LoadSym(m, "TaskProcess", LOAD_DEFAULT);
   if (q) mstat = q(p, t);
   CheckStatus(mstat);
+  TraceSpan(TRACE_TASK_PROCESS, span, t->tid, p->pid, t->cid);
 
   return mstat;
 }
@@ -470,3 +433,38 @@ void TaskFinalize(module *m, pool *p, task *t) {
   }
 }
 
+
+/**
+ * @brief Get the offsets of the task region in the task bank dataset
+ *
+ * @param p The current pool pointer
+ * @param t The task pointer
+ * @param bank The task bank index (STORAGE_PM3D, STORAGE_LIST, STORAGE_PACKED or STORAGE_TEXTURE)
+ * @param offsets The offsets of the task region (output)
+ */
+void TaskStorageOffsets(pool *p, task *t, unsigned int bank, hsize_t *offsets) {
+  unsigned int i = 0;
+  hsize_t dims[MAX_RANK], board[MAX_RANK];
+
+  for (i = 0; i < MAX_RANK; i++) {
+    dims[i] = t->storage[bank].layout.dims[i];
+    board[i] = p->board->layout.dims[i];
+    offsets[i] = 0;
+  }
+
+  if (t->storage[bank].layout.storage_type == STORAGE_PM3D) {
+    offsets[0] = (t->location[0] + board[0]*t->location[1]) * dims[0]
+      + t->location[2]*board[0]*board[1]*dims[0];
+  }
+
+  if (t->storage[bank].layout.storage_type == STORAGE_LIST ||
+      t->storage[bank].layout.storage_type == STORAGE_PACKED) {
+    offsets[0] = (hsize_t) t->tid * dims[0];
+  }
+
+  if (t->storage[bank].layout.storage_type == STORAGE_TEXTURE) {
+    for (i = 0; i < TASK_BOARD_RANK; i++) {
+      offsets[i] = t->location[i] * dims[i];
+    }
+  }
+}
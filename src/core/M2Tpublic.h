@@ -31,8 +31,10 @@ int GetNewTask(module *m, pool *p, task *t, short ****board_buffer);
 int M2TaskPrepare(module *m, pool *p, task *t);
 int M2TaskProcess(module *m, pool *p, task *t);
 int TaskRestore(module *m, pool *p, task *t);
+int TaskStore(module *m, pool *p, task *t);
 void TaskReset(module *m, pool *p, task *t, unsigned int tid);
 void TaskFinalize(module *m, pool *p, task *t);
+void TaskStorageOffsets(pool *p, task *t, unsigned int bank, hsize_t *offsets);
 
 #endif
 
@@ -22,9 +22,9 @@ int Work(module *m) {
   clock_t time_in, time_out;
   clock_t taskloop_in, taskloop_out;
   clock_t resetloop_in, resetloop_out;
+  double reset_span, stage_span, taskloop_span;
 
-  hid_t h5location, h5pool, attr_s, attr_d;
-  char path[CONFIG_LEN];
+  hid_t h5pool, attr_s, attr_d;
 
   /* M2Prepare the simulation */
   mstat = M2Prepare(m);
@@ -69,11 +69,16 @@ int Work(module *m) {
       Message(MESSAGE_INFO, "Entering the pool %04d\n", p[pid]->pid);
     }
 
+    // The timeline trace of the pool
+    mstat = TraceOpen(m, p[pid]);
+    CheckStatus(mstat);
+
     time_in = clock();
 
     do { // The pool reset loop
 
       resetloop_in = clock();
+      reset_span = TraceTime();
 
       if (m->mode != RESTART_MODE) {
         mstat = PoolReset(m, p[pid]);
@@ -86,6 +91,8 @@ int Work(module *m) {
 
         do { // The paol stage reset loop
 
+          stage_span = TraceTime();
+
           mstat = M2NodePrepare(m, p, p[pid]);
           CheckStatus(mstat);
 
@@ -97,9 +104,19 @@ int Work(module *m) {
 
           // The Task loop
           taskloop_in = clock();
+          taskloop_span = TraceTime();
 
           MReadOption(p[pid], "disable-task-loop", &disable_task_loop);
           if (disable_task_loop == 0) {
+
+            // The collective master datafile (parallel HDF5)
+            mstat = SessionParallelOpen(m, p[pid]);
+            CheckStatus(mstat);
+
+            // The per-node shard files
+            mstat = SessionShardOpen(m, p[pid]);
+            CheckStatus(mstat);
+
             if (m->node == MASTER) {
               mstat = M2Master(m, p[pid]);
               CheckStatus(mstat);
@@ -107,6 +124,12 @@ int Work(module *m) {
               mstat = M2Worker(m, p[pid]);
               CheckStatus(mstat);
             }
+
+            mstat = SessionShardClose(m, p[pid]);
+            CheckStatus(mstat);
+
+            mstat = SessionParallelClose(m, p[pid]);
+            CheckStatus(mstat);
           } else {
             if (m->node == MASTER) {
               Message(MESSAGE_INFO, "Task loop has been disabled for the pool %04d\n", p[pid]->pid);
@@ -114,6 +137,7 @@ int Work(module *m) {
           }
 
           taskloop_out = clock();
+          TraceSpan(TRACE_TASK_LOOP, taskloop_span, -1, p[pid]->pid, m->node);
           cpu_time = (double)(taskloop_out - taskloop_in)/CLOCKS_PER_SEC;
           if (m->node == MASTER && m->showtime) Message(MESSAGE_INFO, "Taskloop completed. CPU time: %f\n", cpu_time);
 
@@ -125,6 +149,8 @@ int Work(module *m) {
           mstat = M2NodeProcess(m, p, p[pid]);
           CheckStatus(mstat);
 
+          TraceSpan(TRACE_STAGE, stage_span, -1, p[pid]->pid, p[pid]->sid);
+
           p[pid]->srid++;
           if (m->mode == RESTART_MODE) m->mode = NORMAL_MODE;
         } while (pool_create == POOL_STAGE_RESET);
@@ -136,9 +162,14 @@ int Work(module *m) {
       cpu_time = (double)(resetloop_out - resetloop_in)/CLOCKS_PER_SEC;
       if (m->node == MASTER && m->showtime) Message(MESSAGE_INFO, "Resetloop %4d completed. CPU time: %f\n", p[pid]->rid, cpu_time);
 
+      TraceSpan(TRACE_RESET, reset_span, -1, p[pid]->pid, p[pid]->rid);
+
       p[pid]->rid++;
     } while (pool_create == POOL_RESET);
 
+    mstat = TraceClose(m, p[pid]);
+    CheckStatus(mstat);
+
     time_out = clock();
     cpu_time = (double)(time_out - time_in)/CLOCKS_PER_SEC;
 
@@ -149,11 +180,7 @@ int Work(module *m) {
        * Write global pool attributes
        */
       if (m->stats) {
-        h5location = H5Fopen(m->filename, H5F_ACC_RDWR, H5P_DEFAULT);
-
-        sprintf(path, POOL_PATH, p[pid]->pid);
-        h5pool = H5Gopen2(h5location, path, H5P_DEFAULT);
-        H5CheckStatus(h5pool);
+        h5pool = SessionPool(m, p[pid]);
 
         if (H5Aexists(h5pool, "CPU Time [s]") > 0) {
           attr_d = H5Aopen(h5pool, "CPU Time [s]", H5P_DEFAULT);
@@ -166,9 +193,10 @@ int Work(module *m) {
         }
 
         H5Aclose(attr_d);
-        H5Gclose(h5pool);
-        H5Fclose(h5location);
       }
+
+      /* The pool is complete, release the master datafile */
+      SessionClose(m);
     }
 
     pid++;
@@ -206,6 +234,10 @@ int M2Master(module *m, pool *p) {
   char *err;
   query *q;
 
+  // The live metrics of the task loop
+  mstat = MetricsOpen(m, p);
+  CheckStatus(mstat);
+
   q = (query*) dlsym(m->layer->mode_handler, "Master");
   err = dlerror();
   if (err == NULL) {
@@ -214,6 +246,9 @@ int M2Master(module *m, pool *p) {
 
   CheckStatus(mstat);
 
+  mstat = MetricsClose(m, p);
+  CheckStatus(mstat);
+
   return mstat;
 }
 
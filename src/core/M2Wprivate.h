@@ -5,6 +5,8 @@
 #ifndef MECHANIC_M2W_PRIVATE_H
 #define MECHANIC_M2W_PRIVATE_H
 
+#include "M2Fpublic.h"
+#include "M2Ipublic.h"
 #include "M2Spublic.h"
 #include "M2Tpublic.h"
 #include "M2Ppublic.h"
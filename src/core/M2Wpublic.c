@@ -54,6 +54,9 @@ int M2NodePrepare(module *m, pool **all, pool *current) {
   int mstat = SUCCESS;
   query *q;
 
+  mstat = SessionFetchHook(m, all, current, "NodePrepare");
+  CheckStatus(mstat);
+
   q = LoadSym(m, "NodePrepare", LOAD_DEFAULT);
   if (q) mstat = q(m->mpi_size, m->node, all, current);
   CheckStatus(mstat);
@@ -74,6 +77,9 @@ int M2NodeProcess(module *m, pool **all, pool *current) {
   int mstat = SUCCESS;
   query *q;
 
+  mstat = SessionFetchHook(m, all, current, "NodeProcess");
+  CheckStatus(mstat);
+
   q = LoadSym(m, "NodeProcess", LOAD_DEFAULT);
   if (q) mstat = q(m->mpi_size, m->node, all, current);
   CheckStatus(mstat);
@@ -94,6 +100,9 @@ int M2LoopPrepare(module *m, pool **all, pool *current) {
   int mstat = SUCCESS;
   query *q;
 
+  mstat = SessionFetchHook(m, all, current, "LoopPrepare");
+  CheckStatus(mstat);
+
   q = LoadSym(m, "LoopPrepare", LOAD_DEFAULT);
   if (q) mstat = q(m->mpi_size, m->node, all, current);
   CheckStatus(mstat);
@@ -114,6 +123,9 @@ int M2LoopProcess(module *m, pool **all, pool *current) {
   int mstat = SUCCESS;
   query *q;
 
+  mstat = SessionFetchHook(m, all, current, "LoopProcess");
+  CheckStatus(mstat);
+
   q = LoadSym(m, "LoopProcess", LOAD_DEFAULT);
   if (q) mstat = q(m->mpi_size, m->node, all, current);
   CheckStatus(mstat);
@@ -166,9 +178,37 @@ int M2Receive(int node, int sender, int tag, module *m, pool *p, void *buffer) {
   return mstat;
 }
 
+/**
+ * @brief Get the size of the task data buffer
+ *
+ * The buffer contains the header, the task banks, and the number of records of each
+ * STORAGE_STREAM bank at the end.
+ *
+ * @param p The current pool pointer
+ *
+ * @return The size of the buffer in bytes
+ */
+size_t PackSize(pool *p) {
+  unsigned int i = 0;
+  size_t size = 0;
+
+  size = sizeof(int) * (HEADER_SIZE);
+  for (i = 0; i < p->task_banks; i++) {
+    size += GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.dims)
+      * p->task->storage[i].layout.datatype_size;
+  }
+
+  size += StreamBanks(p) * sizeof(unsigned int);
+
+  return size;
+}
+
 /**
  * @brief Pack the task data into memory buffer
  *
+ * Only the appended records of the STORAGE_STREAM banks are packed, and the stream is
+ * emptied, since the records are sent once.
+ *
  * @param m The module pointer
  * @param buffer The output pack buffer
  * @param p The current pool pointer
@@ -180,7 +220,8 @@ int M2Receive(int node, int sender, int tag, module *m, pool *p, void *buffer) {
 int Pack(module *m, void *buffer, pool *p, task *t, int tag) {
   int mstat = SUCCESS, i = 0;
   int header[HEADER_SIZE] = HEADER_INIT;
-  size_t position = 0, size = 0, header_size = 0;
+  unsigned int records = 0;
+  size_t position = 0, size = 0, header_size = 0, trailer = 0;
 
   header[0] = tag;
   header[1] = t->tid;
@@ -196,10 +237,28 @@ int Pack(module *m, void *buffer, pool *p, task *t, int tag) {
   CheckStatus(mstat);
 
   if (tag != TAG_TERMINATE) {
+    trailer = PackSize(p) - StreamBanks(p) * sizeof(unsigned int);
 
     /* Task data */
     for (i = 0; i < p->task_banks; i++) {
       size = GetSize(t->storage[i].layout.rank, t->storage[i].layout.dims) * t->storage[i].layout.datatype_size;
+
+      /* The stream records */
+      if (t->storage[i].layout.storage_type == STORAGE_STREAM) {
+        records = t->storage[i].layout.records;
+        mstat = CopyData(t->storage[i].memory, (unsigned char*)buffer + position,
+            records * (size / t->storage[i].layout.dims[0]));
+        CheckStatus(mstat);
+
+        mstat = CopyData(&records, (unsigned char*)buffer + trailer, sizeof(unsigned int));
+        CheckStatus(mstat);
+
+        t->storage[i].layout.records = 0;
+        trailer += sizeof(unsigned int);
+        position = position + size;
+        continue;
+      }
+
       if (t->storage[i].layout.sync) {
         Message(MESSAGE_DEBUG, "[%s:%d] Packed dataset %s of rank %d = %zu bytes\n", __FILE__, __LINE__,
             t->storage[i].layout.name, t->storage[i].layout.rank, size);
@@ -245,10 +304,12 @@ int Unpack(module *m, void *buffer, pool *p, task *t, int *tag) {
 
   if (*tag != TAG_TERMINATE) {
 
-    /* Task data */
+    /* Task data (the stream records are never sent back) */
     for (i = 0; i < p->task_banks; i++) {
       size = GetSize(t->storage[i].layout.rank, t->storage[i].layout.dims) * t->storage[i].layout.datatype_size;
-      if (t->storage[i].layout.sync) {
+      if (t->storage[i].layout.storage_type == STORAGE_STREAM) {
+        t->storage[i].layout.records = 0;
+      } else if (t->storage[i].layout.sync) {
         mstat = CopyData((unsigned char*)buffer + position, t->storage[i].memory, size);
         CheckStatus(mstat);
       }
@@ -260,3 +321,104 @@ int Unpack(module *m, void *buffer, pool *p, task *t, int *tag) {
   return mstat;
 }
 
+/**
+ * @brief Remove the unused stream capacity from the packed buffer
+ *
+ * The STORAGE_STREAM banks are cut to the appended records, so that only the records are
+ * sent. The number of records is kept at the end of the message.
+ *
+ * @param p The current pool pointer
+ * @param buffer The packed buffer (compacted in place)
+ *
+ * @return The size of the message in bytes
+ */
+size_t PackStreams(pool *p, void *buffer) {
+  unsigned int i = 0, k = 0, streams = 0, records = 0;
+  size_t in = 0, out = 0, size = 0, used = 0, trailer = 0;
+  unsigned char *b = buffer;
+
+  streams = StreamBanks(p);
+  if (streams == 0) return PackSize(p);
+
+  trailer = PackSize(p) - streams * sizeof(unsigned int);
+  in = out = sizeof(int) * (HEADER_SIZE);
+
+  for (i = 0; i < p->task_banks; i++) {
+    size = GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.dims)
+      * p->task->storage[i].layout.datatype_size;
+
+    used = size;
+    if (p->task->storage[i].layout.storage_type == STORAGE_STREAM) {
+      memcpy(&records, b + trailer + k * sizeof(unsigned int), sizeof(unsigned int));
+      used = records * (size / p->task->storage[i].layout.dims[0]);
+      k++;
+    }
+
+    if (out != in) memmove(b + out, b + in, used);
+    in += size;
+    out += used;
+  }
+
+  memmove(b + out, b + trailer, streams * sizeof(unsigned int));
+
+  return out + streams * sizeof(unsigned int);
+}
+
+/**
+ * @brief Restore the packed buffer layout of the received message (the reverse of PackStreams())
+ *
+ * @param p The current pool pointer
+ * @param buffer The received buffer of PackSize() bytes (expanded in place)
+ * @param length The length of the received message
+ *
+ * @return 0 on success, error code otherwise
+ */
+int UnpackStreams(pool *p, void *buffer, size_t length) {
+  int mstat = SUCCESS;
+  unsigned int i = 0, k = 0, streams = 0, *records = NULL;
+  size_t *in = NULL, *out = NULL, *used = NULL, size = 0, position = 0;
+  unsigned char *b = buffer;
+
+  streams = StreamBanks(p);
+  if (streams == 0 || length >= PackSize(p)) return mstat;
+
+  records = calloc(streams, sizeof(unsigned int));
+  in = calloc(p->task_banks, sizeof(size_t));
+  out = calloc(p->task_banks, sizeof(size_t));
+  used = calloc(p->task_banks, sizeof(size_t));
+  if (!records || !in || !out || !used) Error(CORE_ERR_MEM);
+
+  memcpy(records, b + length - streams * sizeof(unsigned int), streams * sizeof(unsigned int));
+
+  in[0] = out[0] = sizeof(int) * (HEADER_SIZE);
+  for (i = 0; i < p->task_banks; i++) {
+    size = GetSize(p->task->storage[i].layout.rank, p->task->storage[i].layout.dims)
+      * p->task->storage[i].layout.datatype_size;
+
+    used[i] = size;
+    if (p->task->storage[i].layout.storage_type == STORAGE_STREAM) {
+      used[i] = records[k] * (size / p->task->storage[i].layout.dims[0]);
+      k++;
+    }
+
+    if (i + 1 < p->task_banks) {
+      in[i+1] = in[i] + used[i];
+      out[i+1] = out[i] + size;
+    }
+    position = out[i] + size;
+  }
+
+  /* The banks are moved back starting from the last one */
+  for (i = p->task_banks; i > 0; i--) {
+    if (out[i-1] != in[i-1]) memmove(b + out[i-1], b + in[i-1], used[i-1]);
+  }
+
+  memcpy(b + position, records, streams * sizeof(unsigned int));
+
+  free(records);
+  free(in);
+  free(out);
+  free(used);
+
+  return mstat;
+}
@@ -7,6 +7,7 @@
 
 #include "M2Apublic.h"
 #include "M2Epublic.h"
+#include "M2Fpublic.h"
 #include "M2Hpublic.h"
 #include "M2Mpublic.h"
 #include "M2Spublic.h"
@@ -24,5 +25,8 @@ int M2Receive(int node, int sender, int tag, module *m, pool *p, void *buffer);
 
 int Pack(module *m, void *buffer, pool *p, task *t, int tag);
 int Unpack(module *m, void *buffer, pool *p, task *t, int *tag);
+size_t PackSize(pool *p);
+size_t PackStreams(pool *p, void *buffer);
+int UnpackStreams(pool *p, void *buffer, size_t length);
 
 #endif
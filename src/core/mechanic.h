@@ -9,7 +9,9 @@
 #include "M2Cpublic.h"
 #include "M2Apublic.h"
 #include "M2Epublic.h"
+#include "M2Fpublic.h"
 #include "M2Hpublic.h"
+#include "M2Ipublic.h"
 #include "M2Spublic.h"
 #include "M2Tpublic.h"
 #include "M2Ppublic.h"
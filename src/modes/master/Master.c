@@ -22,10 +22,9 @@ int Init(init *i) {
  */
 int Master(module *m, pool *p) {
   int mstat = SUCCESS, ice = 0;
-  int k = 0, cid = 0;
-  unsigned int c_offset = 0, d_offset = 0, l_size = 0;
+  int cid = 0;
+  unsigned int c_offset = 0, l_size = 0;
   short ****board_buffer = NULL;
-  size_t header_size;
   int tag = TAG_TERMINATE;
   int header[HEADER_SIZE] = HEADER_INIT;
   clock_t loop_in, loop_out;
@@ -44,13 +43,7 @@ int Master(module *m, pool *p) {
   t = M2TaskLoad(m, p, 0);
   c = CheckpointLoad(m, p, 0);
 
-  header_size = sizeof(int) * (HEADER_SIZE);
-
-  l_size = header_size;
-  for (k = 0; k < p->task_banks; k++) {
-    l_size +=
-      GetSize(p->task->storage[k].layout.rank, p->task->storage[k].layout.dims) * p->task->storage[k].layout.datatype_size;
-  }
+  l_size = PackSize(p);
 
   // Specific for the restart mode. The restart file is already full of completed tasks
   if (p->completed == p->pool_size) goto finalize;
@@ -75,7 +68,7 @@ int Master(module *m, pool *p) {
         }
 
         // Flush checkpoint buffer and write data, reset counter 
-        if ((c->counter > (c->size-1)) || ice == CORE_ICE) {
+        if (CheckpointDue(m, p, c) || ice == CORE_ICE) {
 
           WriteData(p->board, &board_buffer[0][0][0][0]);
           mstat = M2CheckpointPrepare(m, p, c);
@@ -93,6 +86,11 @@ int Master(module *m, pool *p) {
         // Do simple Abort on ICE
         if (ice == CORE_ICE) Abort(CORE_ICE);
 
+        mstat = MetricsUpdate(m, p);
+        CheckStatus(mstat);
+
+        MetricsSend(MASTER, 1);
+
         // Ok, process the task
         board_buffer[t->location[0]][t->location[1]][t->location[2]][0] = TASK_IN_USE;
         if (m->stats) board_buffer[t->location[0]][t->location[1]][t->location[2]][1] = MASTER;
@@ -126,15 +124,8 @@ int Master(module *m, pool *p) {
         c_offset = c->counter * l_size;
 
         // Write data to the checkpoint buffer
-        mstat = CopyData(header, c->storage->memory + c_offset, header_size);
+        mstat = Pack(m, c->storage->memory + c_offset, p, t, tag);
         CheckStatus(mstat);
-
-        d_offset = 0;
-        for (k = 0; k < p->task_banks; k++) {
-          mstat = CopyData(t->storage[k].memory, c->storage->memory + c_offset + header_size + d_offset, t->storage[k].layout.size);
-          CheckStatus(mstat);
-          d_offset += t->storage[k].layout.size;
-        }
       
         c->counter++;
 
@@ -147,6 +138,8 @@ int Master(module *m, pool *p) {
 
       if (t->status == TASK_FINISHED) {
         p->completed++;
+
+        MetricsReceive(MASTER, TAG_RESULT, 0);
         
         mstat = M2Receive(MASTER, MASTER, TAG_RESULT, m, p, c->storage->memory);
         CheckStatus(mstat);
@@ -22,15 +22,15 @@ int Init(init *i) {
  */
 int Master(module *m, pool *p) {
   int mstat = SUCCESS, ice = 0;
-  int i = 0, k = 0, cid = 0, terminated_nodes = 0;
+  int i = 0, cid = 0, terminated_nodes = 0, length = 0;
   int tag = TAG_TERMINATE;
   int header[HEADER_SIZE] = HEADER_INIT;
   unsigned int c_offset = 0;
   short ****board_buffer = NULL;
-  int send_node;
+  int send_node, shards = 0;
   size_t header_size;
   clock_t loop_in, loop_out;
-  double cpu_time;
+  double cpu_time, span;
 
   MPI_Status mpi_status;
   
@@ -40,6 +40,9 @@ int Master(module *m, pool *p) {
   task *tc = NULL;
   checkpoint *c = NULL;
 
+  // The computing node is always recorded when the workers write to the shard files
+  shards = SessionShards();
+
   // Initialize the temporary task board buffer
   board_buffer = AllocateShort4(p->board);
   ReadData(p->board, &board_buffer[0][0][0][0]);
@@ -64,11 +67,7 @@ int Master(module *m, pool *p) {
   header_size = sizeof(int) * (HEADER_SIZE);
 
   // Initialize data buffers
-  send_buffer->layout.size = header_size;
-  for (k = 0; k < p->task_banks; k++) {
-    send_buffer->layout.size +=
-      GetSize(p->task->storage[k].layout.rank, p->task->storage[k].layout.dims) * p->task->storage[k].layout.datatype_size;
-  }
+  send_buffer->layout.size = PackSize(p);
 
   recv_buffer->layout.size = send_buffer->layout.size;
   temp_buffer->layout.size = send_buffer->layout.size;
@@ -98,7 +97,7 @@ int Master(module *m, pool *p) {
       mstat = Pack(m, send_buffer->memory, p, t, TAG_DATA);
       CheckStatus(mstat);
       board_buffer[t->location[0]][t->location[1]][t->location[2]][0] = TASK_IN_USE;
-      if (m->stats) board_buffer[t->location[0]][t->location[1]][t->location[2]][1] = t->node;
+      if (m->stats || shards) board_buffer[t->location[0]][t->location[1]][t->location[2]][1] = t->node;
       board_buffer[t->location[0]][t->location[1]][t->location[2]][2] = t->cid;
     } else {
       tag = TAG_TERMINATE;
@@ -109,6 +108,11 @@ int Master(module *m, pool *p) {
 
     MPI_Send(&(send_buffer->memory[0]), send_buffer->layout.size, MPI_CHAR,
         i, TAG_DATA, MPI_COMM_WORLD);
+
+    if (mstat != NO_MORE_TASKS) {
+      MetricsSend(i, 1);
+      TraceInstant(TRACE_DISPATCH, t->tid, p->pid, i);
+    }
         
     mstat = M2Send(MASTER, i, TAG_DATA, m, p);
     CheckStatus(mstat);
@@ -124,7 +128,7 @@ int Master(module *m, pool *p) {
     }
 
     // Flush checkpoint buffer and write data, reset counter
-    if ((c->counter > (c->size-1)) || ice == CORE_ICE) {
+    if (CheckpointDue(m, p, c) || ice == CORE_ICE) {
 
       WriteData(p->board, &board_buffer[0][0][0][0]);
       mstat = M2CheckpointPrepare(m, p, c);
@@ -142,11 +146,21 @@ int Master(module *m, pool *p) {
     // Do simple Abort on ICE
     if (ice == CORE_ICE) Abort(CORE_ICE);
 
+    mstat = MetricsUpdate(m, p);
+    CheckStatus(mstat);
+
     // Wait for any operation to complete
+    span = TraceTime();
     MPI_Recv(&(recv_buffer->memory[0]), recv_buffer->layout.size, MPI_CHAR,
       MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &mpi_status);
 
     send_node = mpi_status.MPI_SOURCE;
+    TraceSpan(TRACE_WAIT, span, -1, p->pid, send_node);
+
+    // The workers send only the appended records of the streams
+    MPI_Get_count(&mpi_status, MPI_CHAR, &length);
+    mstat = UnpackStreams(p, recv_buffer->memory, length);
+    CheckStatus(mstat);
 
     // Get the data header
     mstat = CopyData(recv_buffer->memory, header, header_size);
@@ -154,6 +168,9 @@ int Master(module *m, pool *p) {
 
     if (header[0] == TAG_RESULT) p->completed++;
 
+    MetricsReceive(send_node, header[0], length);
+    TraceInstant(TRACE_RECEIVE, header[1], p->pid, send_node);
+
     mstat = M2Receive(MASTER, send_node, header[0], m, p, recv_buffer->memory);
     CheckStatus(mstat);
 
@@ -166,7 +183,7 @@ int Master(module *m, pool *p) {
     }
 
     board_buffer[header[3]][header[4]][header[5]][0] = header[2];
-    if (m->stats) board_buffer[header[3]][header[4]][header[5]][1] = send_node;
+    if (m->stats || shards) board_buffer[header[3]][header[4]][header[5]][1] = send_node;
     board_buffer[header[3]][header[4]][header[5]][2] = header[6];
 
     if (header[0] == TAG_RESULT) {
@@ -179,12 +196,15 @@ int Master(module *m, pool *p) {
         CheckStatus(mstat);
 
         board_buffer[t->location[0]][t->location[1]][t->location[2]][0] = TASK_IN_USE;
-        if (m->stats) board_buffer[t->location[0]][t->location[1]][t->location[2]][1] = send_node;
+        if (m->stats || shards) board_buffer[t->location[0]][t->location[1]][t->location[2]][1] = send_node;
         board_buffer[t->location[0]][t->location[1]][t->location[2]][2] = t->cid;
 
         MPI_Send(&(send_buffer->memory[0]), send_buffer->layout.size, MPI_CHAR,
             send_node, TAG_DATA, MPI_COMM_WORLD);
 
+        MetricsSend(send_node, 1);
+        TraceInstant(TRACE_DISPATCH, t->tid, p->pid, send_node);
+
         mstat = M2Send(MASTER, send_node, TAG_DATA, m, p);
         CheckStatus(mstat);
 
@@ -209,6 +229,8 @@ int Master(module *m, pool *p) {
       MPI_Send(&(temp_buffer->memory[0]), temp_buffer->layout.size, MPI_CHAR,
           send_node, TAG_DATA, MPI_COMM_WORLD);
 
+      MetricsSend(send_node, 0);
+
       mstat = M2Send(MASTER, send_node, TAG_DATA, m, p);
       CheckStatus(mstat);
     } else {
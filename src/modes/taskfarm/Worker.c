@@ -15,7 +15,8 @@
 int Worker(module *m, pool *p) {
   int mstat = SUCCESS;
   int tag;
-  int k = 0;
+  size_t size = 0;
+  double span;
 
   MPI_Status recv_status;
 
@@ -33,11 +34,7 @@ int Worker(module *m, pool *p) {
   if (!recv_buffer) Error(CORE_ERR_MEM);
 
   // Initialize data buffers
-  send_buffer->layout.size = sizeof(int) * (HEADER_SIZE);
-  for (k = 0; k < p->task_banks; k++) {
-    send_buffer->layout.size +=
-      GetSize(p->task->storage[k].layout.rank, p->task->storage[k].layout.dims)*p->task->storage[k].layout.datatype_size;
-  }
+  send_buffer->layout.size = PackSize(p);
 
   recv_buffer->layout.size = send_buffer->layout.size;
   
@@ -49,8 +46,10 @@ int Worker(module *m, pool *p) {
 
   while (1) {
 
+    span = TraceTime();
     MPI_Recv(&(recv_buffer->memory[0]), recv_buffer->layout.size, MPI_CHAR,
         MASTER, MPI_ANY_TAG, MPI_COMM_WORLD, &recv_status);
+    TraceSpan(TRACE_WAIT, span, -1, p->pid, MASTER);
 
     mstat = Unpack(m, &(recv_buffer->memory[0]), p, t, &tag);
     CheckStatus(mstat);
@@ -82,10 +81,17 @@ int Worker(module *m, pool *p) {
         tag = TAG_RESULT;
       }
 
+      // Write the task data directly to the master datafile (parallel HDF5) or to the shard file
+      mstat = SessionWriteTask(m, p, t);
+      CheckStatus(mstat);
+
       mstat = Pack(m, send_buffer->memory, p, t, tag);
       CheckStatus(mstat);
 
-      MPI_Send(&(send_buffer->memory[0]), send_buffer->layout.size, MPI_CHAR,
+      // Only the appended records of the streams are sent
+      size = PackStreams(p, send_buffer->memory);
+
+      MPI_Send(&(send_buffer->memory[0]), size, MPI_CHAR,
           MASTER, TAG_DATA, MPI_COMM_WORLD);
 
       mstat = M2Send(m->node, MASTER, TAG_DATA, m, p);
@@ -25,6 +25,7 @@
 /** @} */
 
 #include "mechanic.h"
+#include "mechanic_module_core.h"
 
 /**
  * @defgroup public_api The Public API
@@ -50,7 +51,7 @@
  * @return `SUCCESS` on success, error code otherwise
  */
 int Init(init *i) {
-  i->options = 82; /**< Maximum number of configurations option for the module */
+  i->options = 128; /**< Maximum number of configurations option for the module */
   i->pools = 1; /**< Maximum number of task pools */
   i->banks_per_pool = 1; /**< Maximum number of memory bank per pool */
   i->banks_per_task = 1; /**< Maximum number of memory banks per task */
@@ -382,7 +383,91 @@ int Setup(setup *s) {
     .space="core", .name="disable-task-loop", .shortName='\0', .value="0", .type=C_VAL,
     .description="Disable the evaluation of the task loop"
   };
-  s->options[76] = (options) OPTIONS_END;
+  s->options[76] = (options) {
+    .space="core", .name="task-order", .shortName='\0', .value="row", .type=C_STRING,
+    .description="The task board ordering (row, morton, hilbert, progressive)"
+  };
+  s->options[77] = (options) {
+    .space="core", .name="refine", .shortName='\0', .value="0", .type=C_INT,
+    .description="The coarse grid stride of the adaptive refinement (0 disables). The coarse and the refined passes are the pool reset loops 0 and 1"
+  };
+  s->options[78] = (options) {
+    .space="core", .name="refine-dataset", .shortName='\0', .value="", .type=C_STRING,
+    .description="The task dataset used by the refinement criterion (default: the first one)"
+  };
+  s->options[79] = (options) {
+    .space="core", .name="refine-field", .shortName='\0', .value="0", .type=C_INT,
+    .description="The element of the task dataset used by the refinement criterion"
+  };
+  s->options[80] = (options) {
+    .space="core", .name="refine-criterion", .shortName='\0', .value="gradient", .type=C_STRING,
+    .description="The refinement criterion (gradient, threshold)"
+  };
+  s->options[81] = (options) {
+    .space="core", .name="refine-threshold", .shortName='\0', .value="0.0", .type=C_DOUBLE,
+    .description="The refinement criterion threshold"
+  };
+  s->options[82] = (options) {
+    .space="core", .name="hdf5-latest-format", .shortName='\0', .value="0", .type=C_VAL,
+    .description="Use the latest HDF5 file format for the master file"
+  };
+  s->options[83] = (options) {
+    .space="core", .name="hdf5-metadata-cache", .shortName='\0', .value="0", .type=C_INT,
+    .description="The HDF5 metadata cache size in kB (0: library default)"
+  };
+  s->options[84] = (options) {
+    .space="core", .name="hdf5-alignment", .shortName='\0', .value="0", .type=C_INT,
+    .description="Align the HDF5 objects, i.e. to the filesystem stripe size, in bytes (0 disables)"
+  };
+  s->options[85] = (options) {
+    .space="core", .name="hdf5-page-size", .shortName='\0', .value="0", .type=C_INT,
+    .description="The HDF5 paged aggregation page size in bytes (0 disables)"
+  };
+  s->options[86] = (options) {
+    .space="core", .name="checkpoint-journal", .shortName='\0', .value="0", .type=C_INT,
+    .description="Append the checkpoints to the journal file, and fold it into the master file every N checkpoints (0 disables)"
+  };
+  s->options[87] = (options) {
+    .space="core", .name="hdf5-parallel", .shortName='\0', .value="0", .type=C_VAL,
+    .description="Experimental: the workers write the task data directly to the master file (parallel HDF5, taskfarm mode)"
+  };
+  s->options[88] = (options) {
+    .space="core", .name="hdf5-shards", .shortName='\0', .value="0", .type=C_VAL,
+    .description="The workers write the task data to the shard files, assembled with virtual datasets (taskfarm mode)"
+  };
+  s->options[89] = (options) {
+    .space="core", .name="checkpoint-interval", .shortName='\0', .value="0", .type=C_INT,
+    .description="Flush the checkpoint after this wall time in seconds (0 disables)"
+  };
+  s->options[90] = (options) {
+    .space="core", .name="checkpoint-memory", .shortName='\0', .value="0", .type=C_LONG,
+    .description="The checkpoint memory budget in bytes (0 disables)"
+  };
+  s->options[91] = (options) {
+    .space="core", .name="restart-lazy", .shortName='\0', .value="0", .type=C_VAL,
+    .description="Read the task data of the restart file on demand (restart mode)"
+  };
+  s->options[92] = (options) {
+    .space="core", .name="out-of-core", .shortName='\0', .value="0", .type=C_VAL,
+    .description="Keep the master task datasets in the scratch file instead of the memory"
+  };
+  s->options[93] = (options) {
+    .space="core", .name="metrics", .shortName='\0', .value="", .type=C_STRING,
+    .description="The live metrics file of the task loop (Prometheus text format, master node)"
+  };
+  s->options[94] = (options) {
+    .space="core", .name="metrics-interval", .shortName='\0', .value="5", .type=C_INT,
+    .description="The metrics file update interval in seconds"
+  };
+  s->options[95] = (options) {
+    .space="core", .name="trace", .shortName='\0', .value="0", .type=C_VAL,
+    .description="Record the timeline trace of each pool (Chrome trace file)"
+  };
+  s->options[96] = (options) {
+    .space="core", .name="trace-buffer", .shortName='\0', .value="65536", .type=C_INT,
+    .description="The size of the trace ring buffer of each node (number of events)"
+  };
+  s->options[97] = (options) OPTIONS_END;
 
   return SUCCESS;
 }
@@ -477,6 +562,225 @@ int PoolProcess(pool **allpools, pool *current) {
   return POOL_FINALIZE;
 }
 
+#define TASK_ORDER_ROW 0 /**< Row-major task board ordering */
+#define TASK_ORDER_MORTON 1 /**< Morton (Z-order) task board ordering */
+#define TASK_ORDER_HILBERT 2 /**< Hilbert task board ordering */
+#define TASK_ORDER_PROGRESSIVE 3 /**< Coarse-to-fine (strided passes) task board ordering */
+
+/**
+ * @struct curvekey
+ * The space-filling curve key of the task board cell
+ */
+typedef struct {
+  unsigned long long key; /**< The curve key */
+  unsigned int cell; /**< The row-major cell index */
+} curvekey;
+
+/**
+ * @struct boardorder
+ * The task board ordering, computed once per pool (and pool/stage reset)
+ */
+static struct {
+  int valid; /**< Whether the ordering has been computed */
+  int order; /**< The task order (TASK_ORDER_ROW, TASK_ORDER_MORTON, TASK_ORDER_HILBERT,
+               TASK_ORDER_PROGRESSIVE) */
+  unsigned int pid, rid, sid, srid; /**< The pool identifiers the ordering has been computed for */
+  unsigned int dims[TASK_BOARD_RANK]; /**< The task board dimensions */
+  unsigned int *map; /**< The task id to row-major cell index map */
+} boardorder = {.valid = 0, .map = NULL};
+
+/**
+ * @brief Compute the space-filling curve key of the given cell
+ *
+ * The Hilbert key follows the Skilling transform (AIP Conf. Proc. 707, 381, 2004), the
+ * transposed coordinates are then bit-interleaved as in the Morton key.
+ *
+ * @param x The cell coordinates (modified in place)
+ * @param n The number of coordinates
+ * @param bits The number of bits per coordinate
+ * @param order The task order (TASK_ORDER_MORTON, TASK_ORDER_HILBERT)
+ *
+ * @return The curve key
+ */
+static unsigned long long CurveKey(unsigned int *x, unsigned int n, unsigned int bits, int order) {
+  unsigned int i, b, q, r, s;
+  unsigned long long key = 0;
+
+  if (order == TASK_ORDER_HILBERT) {
+    for (q = 1U << (bits - 1); q > 1; q >>= 1) {
+      r = q - 1;
+      for (i = 0; i < n; i++) {
+        if (x[i] & q) {
+          x[0] ^= r;
+        } else {
+          s = (x[0] ^ x[i]) & r;
+          x[0] ^= s;
+          x[i] ^= s;
+        }
+      }
+    }
+
+    for (i = 1; i < n; i++) x[i] ^= x[i-1];
+
+    s = 0;
+    for (q = 1U << (bits - 1); q > 1; q >>= 1) {
+      if (x[n-1] & q) s ^= q - 1;
+    }
+
+    for (i = 0; i < n; i++) x[i] ^= s;
+  }
+
+  for (b = bits; b > 0; b--) {
+    for (i = 0; i < n; i++) {
+      key = (key << 1) | ((x[i] >> (b - 1)) & 1);
+    }
+  }
+
+  return key;
+}
+
+/**
+ * @brief Compute the coarse-to-fine key of the given cell
+ *
+ * The cell belongs to the pass of the largest stride that divides all its coordinates.
+ * The passes follow from the coarsest to the finest one, and the cells of each pass are
+ * ordered row by row.
+ *
+ * @param x The cell coordinates
+ * @param n The number of coordinates
+ * @param bits The number of bits per coordinate (the coarsest stride is `2^(bits-1)`)
+ * @param cell The row-major cell index
+ *
+ * @return The coarse-to-fine key
+ */
+static unsigned long long ProgressiveKey(unsigned int *x, unsigned int n, unsigned int bits, unsigned int cell) {
+  unsigned int i, level, tz;
+
+  level = bits - 1;
+  for (i = 0; i < n; i++) {
+    tz = 0;
+    while (tz < level && ((x[i] >> tz) & 1) == 0) tz++;
+    if (tz < level) level = tz;
+  }
+
+  return ((unsigned long long) (bits - 1 - level) << 32) | cell;
+}
+
+/**
+ * @brief Compare the curve keys (qsort helper)
+ *
+ * @param a The first curve key
+ * @param b The second curve key
+ *
+ * @return -1, 0, 1
+ */
+static int CurveKeyCompare(const void *a, const void *b) {
+  const curvekey *ka = (const curvekey *) a;
+  const curvekey *kb = (const curvekey *) b;
+
+  if (ka->key < kb->key) return -1;
+  if (ka->key > kb->key) return 1;
+  return 0;
+}
+
+/**
+ * @brief Prepare the task board ordering
+ *
+ * The ordering is computed only when the pool identifiers or the task board dimensions
+ * change. For the space-filling curves, the board is embedded in the smallest
+ * power-of-two cube, and the cells are ranked by their curve key, so that boards of any
+ * size are supported (the cells outside the board are simply skipped). The coarse-to-fine
+ * ordering is ranked the same way, by the pass of the cell.
+ *
+ * @param p The current pool structure
+ *
+ * @return `SUCCESS` or error code otherwise
+ */
+static int BoardOrderPrepare(pool *p) {
+  char order[CONFIG_LEN];
+  unsigned int i, n, bits, size, plane, max, x[TASK_BOARD_RANK];
+  curvekey *keys = NULL;
+
+  if (boardorder.valid
+      && boardorder.pid == p->pid && boardorder.rid == p->rid
+      && boardorder.sid == p->sid && boardorder.srid == p->srid
+      && boardorder.dims[0] == p->board->layout.dims[0]
+      && boardorder.dims[1] == p->board->layout.dims[1]
+      && boardorder.dims[2] == p->board->layout.dims[2]) return SUCCESS;
+
+  boardorder.valid = 1;
+  boardorder.pid = p->pid;
+  boardorder.rid = p->rid;
+  boardorder.sid = p->sid;
+  boardorder.srid = p->srid;
+  for (i = 0; i < TASK_BOARD_RANK; i++) {
+    boardorder.dims[i] = p->board->layout.dims[i];
+  }
+
+  if (boardorder.map) free(boardorder.map);
+  boardorder.map = NULL;
+
+  MReadOption(p, "task-order", &order);
+
+  boardorder.order = TASK_ORDER_ROW;
+  if (strcmp(order, "morton") == 0) boardorder.order = TASK_ORDER_MORTON;
+  if (strcmp(order, "hilbert") == 0) boardorder.order = TASK_ORDER_HILBERT;
+  if (strcmp(order, "progressive") == 0) boardorder.order = TASK_ORDER_PROGRESSIVE;
+  if (boardorder.order == TASK_ORDER_ROW && strcmp(order, "row") != 0) {
+    Message(MESSAGE_WARN, "Unknown task order '%s', using row ordering\n", order);
+  }
+
+  if (boardorder.order == TASK_ORDER_ROW) return SUCCESS;
+
+  size = boardorder.dims[0] * boardorder.dims[1] * boardorder.dims[2];
+  plane = boardorder.dims[0] * boardorder.dims[1];
+  if (size == 0) return SUCCESS;
+
+  n = (boardorder.dims[2] > 1) ? 3 : 2;
+
+  max = 0;
+  for (i = 0; i < n; i++) {
+    if (boardorder.dims[i] > max) max = boardorder.dims[i];
+  }
+
+  bits = 1;
+  while ((1U << bits) < max) bits++;
+
+  if (boardorder.order != TASK_ORDER_PROGRESSIVE && n * bits > 8 * sizeof(unsigned long long)) {
+    Message(MESSAGE_ERR, "The task board is too large for the '%s' task order\n", order);
+    return CORE_ERR_CORE;
+  }
+
+  keys = calloc(size, sizeof(curvekey));
+  if (!keys) Error(CORE_ERR_MEM);
+
+  boardorder.map = calloc(size, sizeof(unsigned int));
+  if (!boardorder.map) Error(CORE_ERR_MEM);
+
+  for (i = 0; i < size; i++) {
+    x[0] = (i % plane) / boardorder.dims[1];
+    x[1] = (i % plane) % boardorder.dims[1];
+    x[2] = i / plane;
+
+    if (boardorder.order == TASK_ORDER_PROGRESSIVE) {
+      keys[i].key = ProgressiveKey(x, n, bits, i);
+    } else {
+      keys[i].key = CurveKey(x, n, bits, boardorder.order);
+    }
+    keys[i].cell = i;
+  }
+
+  qsort(keys, size, sizeof(curvekey), CurveKeyCompare);
+
+  for (i = 0; i < size; i++) {
+    boardorder.map[i] = keys[i].cell;
+  }
+
+  free(keys);
+
+  return SUCCESS;
+}
+
 /**
  * @brief Maps tasks
  *
@@ -495,6 +799,19 @@ int PoolProcess(pool **allpools, pool *current) {
  *      4  5  6  7
  *      8  9 10 11
  *
+ * With the `task-order` option set to `morton` or `hilbert`, the tasks follow the Morton
+ * (Z-order) or Hilbert space-filling curve instead, so that consecutive task ids are
+ * neighbours on the task board (i.e. for the Hilbert curve):
+ *
+ *      0  3  4  5
+ *      1  2  7  6
+ *     14 13  8  9
+ *     15 12 11 10
+ *
+ * With `task-order` set to `progressive`, the tasks are dispatched in coarse-to-fine
+ * passes (every 2^k-th task along each board axis, then every 2^(k-1)-th, and so on), so
+ * that a partially completed run already covers the whole board at low resolution.
+ *
  * The current task location is available at `t->location array`. The pool resolution
  * is available at `p->board->layout.dims` array. The `pool_size` is a multiplication of
  * `p->board->layout.dims[i]`, where `i < p->board->layout.rank`.
@@ -511,9 +828,15 @@ int PoolProcess(pool **allpools, pool *current) {
  * @return `SUCCESS` or error code otherwise
  */
 int TaskBoardMap(pool *p, task *t) {
+  int mstat = SUCCESS;
   unsigned int px, vert, horiz;
 
+  mstat = BoardOrderPrepare(p);
+  CheckStatus(mstat);
+
   px = t->tid;
+  if (boardorder.map && px < p->pool_size) px = boardorder.map[px];
+
   horiz = p->board->layout.dims[0];
   vert = p->board->layout.dims[1];
 
@@ -534,6 +857,25 @@ int TaskBoardMap(pool *p, task *t) {
     t->location[1] = px % vert;
   }
 
+  return mstat;
+}
+
+/**
+ * @brief Release the task board ordering of the core TaskBoardMap()
+ *
+ * This function is called by the core on the pool finalize (it is not a hook, the custom
+ * module implementation is not used).
+ *
+ * @ingroup all_nodes
+ * @param p The current pool structure
+ *
+ * @return `SUCCESS`
+ */
+int TaskBoardOrderFinalize(pool *p) {
+  if (boardorder.map) free(boardorder.map);
+  boardorder.map = NULL;
+  boardorder.valid = 0;
+
   return SUCCESS;
 }
 
@@ -623,7 +965,8 @@ int TaskProcess(pool *p, task *t) {
  *
  *     c->storage->memory
  *
- * which is a one-dimensional, flattened array, filled with c->size tasks, in a form:
+ * which is a one-dimensional, flattened array, filled with c->counter tasks (of c->size
+ * allocated), in a form:
  *
  *    task 0 header | task 0 datasets | task 1 header | task 1 datasets | ...
  *
@@ -0,0 +1,12 @@
+/**
+ * @file
+ * The core Mechanic module (the functions called by the core, not the module hooks)
+ */
+#ifndef MECHANIC_MODULE_CORE_H
+#define MECHANIC_MODULE_CORE_H
+
+#include "mechanic.h"
+
+int TaskBoardOrderFinalize(pool *p);
+
+#endif
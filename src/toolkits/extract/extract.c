@@ -0,0 +1,2298 @@
+/**
+ * @file
+ * The master file extraction library
+ *
+ * The query is resolved into a list of hyperslab reads of the dataset (a single read may
+ * cover a run of task tiles with the stride/block selection), and the reads are grouped
+ * into work units of about EXTRACT_BLOCK_SIZE bytes, cut at the chunk boundaries. The
+ * reader threads take the units in turn, read and format them, and write them to the
+ * output in order, so that at most one unit per thread is kept in memory.
+ *
+ * The serial HDF5 library is not thread-safe, so unless the library is built with the
+ * thread-safety enabled, the HDF5 calls are serialized and the threads overlap the reads
+ * with the conversion of the data and the output.
+ */
+#if !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#include "M2Tpublic.h"
+#include "mechanic_extract.h"
+
+#define EXTRACT_NAME_LEN 1024 /**< The maximum length of the dataset path */
+#define EXTRACT_BOARD "board" /**< The task board dataset */
+#define EXTRACT_ORDER "task-order" /**< The task order attribute of the pool */
+#define EXTRACT_CACHE_CHUNKS 16 /**< The chunk cache of the reader thread (in chunks) */
+#define EXTRACT_CACHE_MIN 1048576 /**< The minimum chunk cache of the reader thread (in bytes) */
+#define EXTRACT_CACHE_MAX 67108864 /**< The maximum chunk cache of the reader thread (in bytes) */
+#define EXTRACT_CACHE_SLOTS 10007 /**< The number of chunk slots in the chunk cache */
+#define EXTRACT_VALUE_LEN 48 /**< The maximum length of the formatted number */
+
+/**
+ * @struct extract_read
+ * The single hyperslab read
+ */
+typedef struct {
+  unsigned int tid; /**< The task ID (STORAGE_GROUP) */
+  hsize_t start[MAX_RANK]; /**< The hyperslab start */
+  hsize_t stride[MAX_RANK]; /**< The hyperslab stride */
+  hsize_t count[MAX_RANK]; /**< The hyperslab count */
+  hsize_t block[MAX_RANK]; /**< The hyperslab block */
+  hsize_t elements; /**< The number of elements */
+} extract_read;
+
+/**
+ * @struct extract_unit
+ * The work unit (consecutive reads)
+ */
+typedef struct {
+  size_t first; /**< The first read */
+  size_t last; /**< The last read (exclusive) */
+  hsize_t offset; /**< The element offset in the output */
+  hsize_t elements; /**< The number of elements */
+} extract_unit;
+
+/**
+ * @struct extract_column
+ * The atomic member of the memory datatype
+ */
+typedef struct {
+  size_t offset; /**< The offset in the element */
+  H5T_class_t type_class; /**< The datatype class */
+  size_t size; /**< The size */
+  H5T_sign_t sign; /**< The sign of the integer type */
+} extract_column;
+
+/**
+ * @struct extract_task
+ * The selected task
+ */
+typedef struct {
+  unsigned int tid; /**< The task ID */
+  unsigned int location[TASK_BOARD_RANK]; /**< The task location */
+  hsize_t row; /**< The sort key (the row of the STORAGE_PM3D dataset) */
+} extract_task;
+
+/**
+ * @struct extract
+ * The extraction handle
+ */
+struct extract {
+  extract_query query; /**< The query */
+  hid_t file; /**< The master file */
+  hid_t pool; /**< The pool group */
+  hid_t tasks; /**< The tasks group of the pool */
+  hid_t location; /**< The location of the dataset */
+  char name[EXTRACT_NAME_LEN]; /**< The dataset name (relative to the location) */
+  int layout; /**< The dataset layout */
+  int rank; /**< The dataset rank */
+  hsize_t dims[MAX_RANK]; /**< The dataset dimensions */
+  hsize_t chunk[MAX_RANK]; /**< The chunk dimensions */
+  int chunked; /**< Whether the dataset is chunked */
+  hsize_t board[TASK_BOARD_RANK]; /**< The task board dimensions */
+  unsigned int pool_size; /**< The number of tasks */
+  short *status; /**< The task board status */
+  int row_order; /**< Whether the tasks follow the row order */
+  hid_t memtype; /**< The memory datatype */
+  size_t size; /**< The size of the memory datatype */
+  extract_column *columns; /**< The atomic members of the memory datatype */
+  unsigned int ncolumns; /**< The number of atomic members */
+  size_t width; /**< The maximum length of the formatted element */
+  int out_rank; /**< The output rank */
+  hsize_t out_dims[MAX_RANK]; /**< The output dimensions */
+  hsize_t row_length; /**< The number of elements in the CSV line */
+  int sl_given; /**< The number of axes given in the slice */
+  hsize_t sl_start[MAX_RANK]; /**< The slice start */
+  hsize_t sl_step[MAX_RANK]; /**< The slice step */
+  hsize_t sl_count[MAX_RANK]; /**< The slice count */
+  int sl_drop[MAX_RANK]; /**< Whether the axis is dropped from the output */
+  extract_read *reads; /**< The reads */
+  size_t nreads; /**< The number of reads */
+  size_t areads; /**< The number of allocated reads */
+  extract_unit *units; /**< The work units */
+  size_t nunits; /**< The number of work units */
+  hsize_t elements; /**< The number of elements */
+  pthread_mutex_t lock; /**< The work queue lock */
+  pthread_cond_t turn_cond; /**< The output turn */
+  size_t next; /**< The next work unit */
+  size_t turn; /**< The work unit to be written */
+  int state; /**< The error state */
+  FILE *stream; /**< The output stream */
+};
+
+#ifndef H5_HAVE_THREADSAFE
+static pthread_mutex_t ExtractHDF = PTHREAD_MUTEX_INITIALIZER; /**< Serializes the HDF5 calls */
+#endif
+
+static const struct {
+  const char *name;
+  int layout;
+} ExtractLayouts[] = {
+  {"auto", EXTRACT_LAYOUT_AUTO},
+  {"dataset", EXTRACT_LAYOUT_DATASET},
+  {"group", EXTRACT_LAYOUT_GROUP},
+  {"pm3d", EXTRACT_LAYOUT_PM3D},
+  {"texture", EXTRACT_LAYOUT_TEXTURE},
+  {"list", EXTRACT_LAYOUT_LIST},
+  {"packed", EXTRACT_LAYOUT_PACKED},
+  {"stream", EXTRACT_LAYOUT_STREAM},
+  {NULL, 0}
+};
+
+static const struct {
+  const char *name;
+  int status;
+} ExtractStatuses[] = {
+  {"available", TASK_AVAILABLE},
+  {"finished", TASK_FINISHED},
+  {"in-use", TASK_IN_USE},
+  {"restart", TASK_TO_BE_RESTARTED},
+  {NULL, 0}
+};
+
+/**
+ * @brief Print the error message
+ *
+ * @param format The message format
+ */
+static void ExtractMessage(const char *format, ...) {
+  va_list args;
+
+  fprintf(stderr, "!! ");
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+}
+
+/**
+ * @brief Lock the HDF5 library (unless it is thread-safe)
+ */
+static void ExtractLockHDF(void) {
+#ifndef H5_HAVE_THREADSAFE
+  pthread_mutex_lock(&ExtractHDF);
+#endif
+}
+
+/**
+ * @brief Unlock the HDF5 library
+ */
+static void ExtractUnlockHDF(void) {
+#ifndef H5_HAVE_THREADSAFE
+  pthread_mutex_unlock(&ExtractHDF);
+#endif
+}
+
+/**
+ * @brief Get the name of the layout
+ *
+ * @param layout The layout
+ *
+ * @return The layout name
+ */
+static const char* ExtractLayoutName(int layout) {
+  unsigned int i = 0;
+
+  for (i = 0; ExtractLayouts[i].name != NULL; i++) {
+    if (ExtractLayouts[i].layout == layout) return ExtractLayouts[i].name;
+  }
+
+  return "unknown";
+}
+
+/**
+ * @brief Initialize the query with defaults
+ *
+ * @param q The query
+ */
+void ExtractQueryInit(extract_query *q) {
+  memset(q, 0, sizeof(extract_query));
+  q->task_min = 0;
+  q->task_max = -1;
+  q->layout = EXTRACT_LAYOUT_AUTO;
+  q->format = EXTRACT_FORMAT_CSV;
+}
+
+/**
+ * @brief Parse the task board status filter
+ *
+ * The list is comma separated, and contains the status names (`available`, `finished`,
+ * `in-use`, `restart`) or the status codes.
+ *
+ * @param q The query
+ * @param list The status list
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+int ExtractParseStatus(extract_query *q, char *list) {
+  char *copy, *item, *save, *end;
+  unsigned int i = 0;
+  int found;
+  long value;
+
+  copy = strdup(list);
+  if (!copy) return EXTRACT_ERR_MEM;
+
+  for (item = strtok_r(copy, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+    found = 0;
+    for (i = 0; ExtractStatuses[i].name != NULL; i++) {
+      if (strcmp(item, ExtractStatuses[i].name) == 0) {
+        value = ExtractStatuses[i].status;
+        found = 1;
+      }
+    }
+
+    if (!found) {
+      value = strtol(item, &end, 10);
+      if (*item == '\0' || *end != '\0') {
+        ExtractMessage("Unknown task status '%s'\n", item);
+        free(copy);
+        return EXTRACT_ERR_ARGS;
+      }
+    }
+
+    if (q->statuses >= EXTRACT_STATUS_MAX) {
+      ExtractMessage("Too many task status filters (max %d)\n", EXTRACT_STATUS_MAX);
+      free(copy);
+      return EXTRACT_ERR_ARGS;
+    }
+    q->status[q->statuses++] = (int) value;
+  }
+
+  free(copy);
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief Parse the task ID range
+ *
+ * The range is `MIN:MAX` (the last task is excluded), `MIN:`, `:MAX` or a single task ID.
+ *
+ * @param q The query
+ * @param range The task range
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+int ExtractParseTasks(extract_query *q, char *range) {
+  char *colon, *end;
+
+  colon = strchr(range, ':');
+  q->task_min = 0;
+  q->task_max = -1;
+
+  if (colon == NULL) {
+    q->task_min = strtol(range, &end, 10);
+    if (*range == '\0' || *end != '\0' || q->task_min < 0) goto invalid;
+    q->task_max = q->task_min + 1;
+    return EXTRACT_SUCCESS;
+  }
+
+  if (colon != range) {
+    q->task_min = strtol(range, &end, 10);
+    if (end != colon || q->task_min < 0) goto invalid;
+  }
+
+  if (*(colon + 1) != '\0') {
+    q->task_max = strtol(colon + 1, &end, 10);
+    if (*end != '\0' || q->task_max < q->task_min) goto invalid;
+  }
+
+  return EXTRACT_SUCCESS;
+
+invalid:
+  ExtractMessage("Invalid task range '%s'\n", range);
+  return EXTRACT_ERR_ARGS;
+}
+
+/**
+ * @brief Parse the layout name
+ *
+ * @param name The layout name
+ *
+ * @return The layout, -1 if not known
+ */
+int ExtractParseLayout(char *name) {
+  unsigned int i = 0;
+
+  for (i = 0; ExtractLayouts[i].name != NULL; i++) {
+    if (strcmp(name, ExtractLayouts[i].name) == 0) return ExtractLayouts[i].layout;
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Parse the slice index
+ *
+ * @param text The index text
+ * @param dim The axis length
+ * @param value The index
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractIndex(char *text, hsize_t dim, long long *value) {
+  char *end;
+
+  *value = strtoll(text, &end, 10);
+  if (*text == '\0' || *end != '\0') return EXTRACT_ERR_ARGS;
+  if (*value < 0) *value += (long long) dim;
+
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief Parse the slice of the given tile
+ *
+ * The slice follows the NumPy syntax: the comma separated axes, each of them being an
+ * index (the axis is dropped from the output) or the `start:stop:step` range. The
+ * missing axes are selected whole.
+ *
+ * @param e The extraction handle
+ * @param rank The tile rank
+ * @param dims The tile dimensions
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractParseSlice(extract *e, int rank, hsize_t *dims) {
+  int mstat = EXTRACT_SUCCESS, i = 0, parts;
+  char *copy, *axis, *save, *field[3], *c;
+  long long start, stop, step;
+
+  for (i = 0; i < rank; i++) {
+    e->sl_start[i] = 0;
+    e->sl_step[i] = 1;
+    e->sl_count[i] = dims[i];
+    e->sl_drop[i] = 0;
+  }
+  e->sl_given = 0;
+
+  if (e->query.slice == NULL || e->query.slice[0] == '\0') return mstat;
+
+  copy = strdup(e->query.slice);
+  if (!copy) return EXTRACT_ERR_MEM;
+
+  i = 0;
+  for (axis = strtok_r(copy, ",", &save); axis != NULL; axis = strtok_r(NULL, ",", &save), i++) {
+    if (i >= rank) {
+      ExtractMessage("The slice '%s' has more axes than the data (%d)\n", e->query.slice, rank);
+      mstat = EXTRACT_ERR_ARGS;
+      break;
+    }
+
+    while (isspace((unsigned char) *axis)) axis++;
+
+    parts = 0;
+    field[parts++] = axis;
+    for (c = axis; *c != '\0'; c++) {
+      if (*c == ':') {
+        if (parts == 3) {
+          mstat = EXTRACT_ERR_ARGS;
+          break;
+        }
+        *c = '\0';
+        field[parts++] = c + 1;
+      }
+    }
+    if (mstat != EXTRACT_SUCCESS) goto invalid;
+
+    if (parts == 1) {
+      if (ExtractIndex(field[0], dims[i], &start) != EXTRACT_SUCCESS) goto invalid;
+      if (start < 0 || start >= (long long) dims[i]) goto invalid;
+      e->sl_start[i] = (hsize_t) start;
+      e->sl_count[i] = 1;
+      e->sl_drop[i] = 1;
+      continue;
+    }
+
+    start = 0;
+    stop = (long long) dims[i];
+    step = 1;
+
+    if (*field[0] != '\0' && ExtractIndex(field[0], dims[i], &start) != EXTRACT_SUCCESS) goto invalid;
+    if (*field[1] != '\0' && ExtractIndex(field[1], dims[i], &stop) != EXTRACT_SUCCESS) goto invalid;
+    if (parts == 3 && *field[2] != '\0') {
+      step = strtoll(field[2], &c, 10);
+      if (*c != '\0' || step < 1) goto invalid;
+    }
+
+    if (start < 0) start = 0;
+    if (stop > (long long) dims[i]) stop = (long long) dims[i];
+    if (start >= stop) goto invalid;
+
+    e->sl_start[i] = (hsize_t) start;
+    e->sl_step[i] = (hsize_t) step;
+    e->sl_count[i] = (hsize_t) ((stop - start + step - 1) / step);
+  }
+
+  e->sl_given = i;
+  free(copy);
+  return mstat;
+
+invalid:
+  ExtractMessage("Invalid or empty slice '%s' (axis %d)\n", e->query.slice, i);
+  free(copy);
+  return EXTRACT_ERR_ARGS;
+}
+
+/**
+ * @brief Read the string attribute
+ *
+ * @param h5location The HDF5 location
+ * @param name The attribute name
+ * @param value The value buffer
+ * @param len The length of the value buffer
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractStringAttr(hid_t h5location, char *name, char *value, size_t len) {
+  hid_t attr, ftype, mtype, space;
+  hssize_t points;
+  size_t size;
+  char *buffer;
+
+  value[0] = '\0';
+
+  attr = H5Aopen(h5location, name, H5P_DEFAULT);
+  if (attr < 0) return EXTRACT_ERR_HDF;
+
+  ftype = H5Aget_type(attr);
+  space = H5Aget_space(attr);
+  points = H5Sget_simple_extent_npoints(space);
+  size = H5Tget_size(ftype);
+
+  if (H5Tget_class(ftype) != H5T_STRING || H5Tis_variable_str(ftype) > 0 || points < 1) {
+    H5Sclose(space);
+    H5Tclose(ftype);
+    H5Aclose(attr);
+    return EXTRACT_ERR_HDF;
+  }
+
+  buffer = calloc(size * points + 1, sizeof(char));
+  if (!buffer) {
+    H5Sclose(space);
+    H5Tclose(ftype);
+    H5Aclose(attr);
+    return EXTRACT_ERR_MEM;
+  }
+
+  mtype = H5Tcopy(H5T_C_S1);
+  H5Tset_size(mtype, size);
+  H5Aread(attr, mtype, buffer);
+
+  snprintf(value, len, "%s", buffer);
+
+  free(buffer);
+  H5Tclose(mtype);
+  H5Sclose(space);
+  H5Tclose(ftype);
+  H5Aclose(attr);
+
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief Open the master file, the pool and read the task board
+ *
+ * @param e The extraction handle
+ * @param filename The master file
+ * @param pool The pool ID or `last`
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractPoolOpen(extract *e, char *filename, char *pool) {
+  char path[EXTRACT_NAME_LEN], order[EXTRACT_NAME_LEN], *end;
+  hid_t board, space, memspace;
+  hsize_t dims[MAX_RANK], start[MAX_RANK], count[MAX_RANK], elements;
+  long id;
+  int rank, i;
+
+  e->file = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (e->file < 0) {
+    ExtractMessage("Cannot open the master file '%s'\n", filename);
+    return EXTRACT_ERR_HDF;
+  }
+
+  if (pool == NULL || strcmp(pool, "last") == 0) {
+    snprintf(path, EXTRACT_NAME_LEN, "%s", LAST_GROUP);
+  } else {
+    id = strtol(pool, &end, 10);
+    if (*pool != '\0' && *end == '\0' && id >= 0) {
+      snprintf(path, EXTRACT_NAME_LEN, POOL_PATH, (int) id);
+    } else if (pool[0] == '/') {
+      snprintf(path, EXTRACT_NAME_LEN, "%s", pool);
+    } else {
+      snprintf(path, EXTRACT_NAME_LEN, "/%s/%s", POOLS_GROUP, pool);
+    }
+  }
+
+  if (H5Lexists(e->file, "/" POOLS_GROUP, H5P_DEFAULT) <= 0 ||
+      H5Lexists(e->file, path, H5P_DEFAULT) <= 0) {
+    ExtractMessage("The pool '%s' does not exist in '%s'\n", path, filename);
+    return EXTRACT_ERR_ARGS;
+  }
+
+  e->pool = H5Gopen2(e->file, path, H5P_DEFAULT);
+  if (e->pool < 0) return EXTRACT_ERR_HDF;
+
+  if (H5Lexists(e->pool, TASKS_GROUP, H5P_DEFAULT) > 0) {
+    e->tasks = H5Gopen2(e->pool, TASKS_GROUP, H5P_DEFAULT);
+    if (e->tasks < 0) return EXTRACT_ERR_HDF;
+  }
+
+  e->row_order = 1;
+  if (H5Aexists(e->pool, EXTRACT_ORDER) > 0) {
+    if (ExtractStringAttr(e->pool, EXTRACT_ORDER, order, EXTRACT_NAME_LEN) == EXTRACT_SUCCESS) {
+      e->row_order = (strcmp(order, "row") == 0);
+    }
+  }
+
+  if (H5Lexists(e->pool, EXTRACT_BOARD, H5P_DEFAULT) <= 0) return EXTRACT_SUCCESS;
+
+  board = H5Dopen2(e->pool, EXTRACT_BOARD, H5P_DEFAULT);
+  if (board < 0) return EXTRACT_ERR_HDF;
+
+  space = H5Dget_space(board);
+  rank = H5Sget_simple_extent_dims(space, dims, NULL);
+  if (rank != TASK_BOARD_RANK + 1) {
+    H5Sclose(space);
+    H5Dclose(board);
+    return EXTRACT_SUCCESS;
+  }
+
+  // Only the status channel is read
+  elements = 1;
+  for (i = 0; i < TASK_BOARD_RANK; i++) {
+    e->board[i] = dims[i];
+    start[i] = 0;
+    count[i] = dims[i];
+    elements *= dims[i];
+  }
+  start[TASK_BOARD_RANK] = 0;
+  count[TASK_BOARD_RANK] = 1;
+
+  e->pool_size = (unsigned int) elements;
+  e->status = calloc(elements > 0 ? elements : 1, sizeof(short));
+  if (!e->status) {
+    H5Sclose(space);
+    H5Dclose(board);
+    return EXTRACT_ERR_MEM;
+  }
+
+  if (elements > 0) {
+    H5Sselect_hyperslab(space, H5S_SELECT_SET, start, NULL, count, NULL);
+    memspace = H5Screate_simple(1, &elements, NULL);
+    if (H5Dread(board, H5T_NATIVE_SHORT, memspace, space, H5P_DEFAULT, e->status) < 0) {
+      H5Sclose(memspace);
+      H5Sclose(space);
+      H5Dclose(board);
+      return EXTRACT_ERR_HDF;
+    }
+    H5Sclose(memspace);
+  }
+
+  H5Sclose(space);
+  H5Dclose(board);
+
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief Detect the layout of the task dataset
+ *
+ * The task datasets do not store their storage type, so that it is derived from the
+ * dimensions of the dataset and the task board. The STORAGE_LIST and STORAGE_PM3D
+ * datasets have the same dimensions, and the STORAGE_LIST is assumed.
+ *
+ * @param e The extraction handle
+ *
+ * @return The layout, -1 if the requested layout does not fit the dataset
+ */
+static int ExtractDetect(extract *e) {
+  char index[EXTRACT_NAME_LEN + 16];
+  int list = 0, texture = 0, i = 0;
+
+  snprintf(index, EXTRACT_NAME_LEN + 16, STREAM_INDEX, e->name);
+
+  if (H5Lexists(e->tasks, index, H5P_DEFAULT) > 0) {
+    if (e->query.layout == EXTRACT_LAYOUT_AUTO || e->query.layout == EXTRACT_LAYOUT_STREAM) {
+      return EXTRACT_LAYOUT_STREAM;
+    }
+  }
+
+  if (e->query.layout == EXTRACT_LAYOUT_DATASET || e->pool_size == 0) return EXTRACT_LAYOUT_DATASET;
+
+  list = (e->dims[0] >= e->pool_size && e->dims[0] % e->pool_size == 0);
+
+  if (e->rank >= TASK_BOARD_RANK) {
+    texture = 1;
+    for (i = 0; i < TASK_BOARD_RANK; i++) {
+      if (e->dims[i] == 0 || e->dims[i] % e->board[i] != 0) texture = 0;
+    }
+  }
+
+  switch (e->query.layout) {
+    case EXTRACT_LAYOUT_AUTO:
+      if (list && texture) {
+        ExtractMessage("The layout of '%s' is ambiguous, use the layout option\n", e->name);
+        return -1;
+      }
+      if (list) return e->dims[0] == e->pool_size ? EXTRACT_LAYOUT_PACKED : EXTRACT_LAYOUT_LIST;
+      if (texture) return EXTRACT_LAYOUT_TEXTURE;
+      return EXTRACT_LAYOUT_DATASET;
+    case EXTRACT_LAYOUT_LIST:
+    case EXTRACT_LAYOUT_PM3D:
+    case EXTRACT_LAYOUT_PACKED:
+      if (list) return e->query.layout;
+      break;
+    case EXTRACT_LAYOUT_TEXTURE:
+      if (texture) return e->query.layout;
+      break;
+    default:
+      break;
+  }
+
+  ExtractMessage("The dataset '%s' does not fit the '%s' layout\n", e->name,
+      ExtractLayoutName(e->query.layout));
+
+  return -1;
+}
+
+/**
+ * @brief Flatten the memory datatype into the atomic members
+ *
+ * @param e The extraction handle
+ * @param type The datatype
+ * @param offset The offset of the datatype in the element
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractColumns(extract *e, hid_t type, size_t offset) {
+  int mstat = EXTRACT_SUCCESS, i = 0, n = 0, ndims;
+  hsize_t adims[MAX_RANK], elements = 1, k;
+  extract_column *columns;
+  hid_t member;
+  size_t size;
+
+  switch (H5Tget_class(type)) {
+    case H5T_COMPOUND:
+      n = H5Tget_nmembers(type);
+      for (i = 0; i < n && mstat == EXTRACT_SUCCESS; i++) {
+        member = H5Tget_member_type(type, i);
+        mstat = ExtractColumns(e, member, offset + H5Tget_member_offset(type, i));
+        H5Tclose(member);
+      }
+      return mstat;
+
+    case H5T_ARRAY:
+      member = H5Tget_super(type);
+      ndims = H5Tget_array_ndims(type);
+      H5Tget_array_dims2(type, adims);
+      for (i = 0; i < ndims; i++) elements *= adims[i];
+      size = H5Tget_size(member);
+      for (k = 0; k < elements && mstat == EXTRACT_SUCCESS; k++) {
+        mstat = ExtractColumns(e, member, offset + k * size);
+      }
+      H5Tclose(member);
+      return mstat;
+
+    case H5T_INTEGER:
+    case H5T_FLOAT:
+    case H5T_STRING:
+      size = H5Tget_size(type);
+      if (H5Tget_class(type) == H5T_STRING && H5Tis_variable_str(type) > 0) break;
+      if (H5Tget_class(type) == H5T_FLOAT && size != sizeof(float)
+          && size != sizeof(double) && size != sizeof(long double)) break;
+      if (H5Tget_class(type) == H5T_INTEGER && size != 1 && size != 2 && size != 4 && size != 8) break;
+
+      columns = realloc(e->columns, (e->ncolumns + 1) * sizeof(extract_column));
+      if (!columns) return EXTRACT_ERR_MEM;
+      e->columns = columns;
+
+      e->columns[e->ncolumns].offset = offset;
+      e->columns[e->ncolumns].type_class = H5Tget_class(type);
+      e->columns[e->ncolumns].size = size;
+      e->columns[e->ncolumns].sign = H5Tget_class(type) == H5T_INTEGER ? H5Tget_sign(type) : H5T_SGN_NONE;
+      e->width += H5Tget_class(type) == H5T_STRING ? 2 * size + 3 : EXTRACT_VALUE_LEN;
+      e->ncolumns++;
+      return mstat;
+
+    default:
+      break;
+  }
+
+  ExtractMessage("The datatype of '%s' is not supported\n", e->name);
+  return EXTRACT_ERR_ARGS;
+}
+
+/**
+ * @brief Copy the native datatype with the null padded strings
+ *
+ * The null terminated strings may hold any bytes after the terminator, which are cleared
+ * by the HDF5 string conversion.
+ *
+ * @param type The native datatype
+ *
+ * @return The memory datatype, negative on error
+ */
+static hid_t ExtractMemType(hid_t type) {
+  hid_t mtype = -1, member, super;
+  hsize_t adims[MAX_RANK];
+  int i = 0, n;
+  char *name;
+
+  switch (H5Tget_class(type)) {
+    case H5T_STRING:
+      mtype = H5Tcopy(type);
+      if (H5Tis_variable_str(type) <= 0) H5Tset_strpad(mtype, H5T_STR_NULLPAD);
+      break;
+
+    case H5T_COMPOUND:
+      mtype = H5Tcreate(H5T_COMPOUND, H5Tget_size(type));
+      n = H5Tget_nmembers(type);
+      for (i = 0; i < n; i++) {
+        super = H5Tget_member_type(type, i);
+        member = ExtractMemType(super);
+        name = H5Tget_member_name(type, i);
+        H5Tinsert(mtype, name, H5Tget_member_offset(type, i), member);
+        H5free_memory(name);
+        H5Tclose(member);
+        H5Tclose(super);
+      }
+      break;
+
+    case H5T_ARRAY:
+      super = H5Tget_super(type);
+      member = ExtractMemType(super);
+      n = H5Tget_array_ndims(type);
+      H5Tget_array_dims2(type, adims);
+      mtype = H5Tarray_create2(member, n, adims);
+      H5Tclose(member);
+      H5Tclose(super);
+      break;
+
+    default:
+      mtype = H5Tcopy(type);
+      break;
+  }
+
+  return mtype;
+}
+
+/**
+ * @brief Prepare the memory datatype
+ *
+ * The compound datatypes are packed, and with the fields given, only the selected members
+ * are read (the HDF5 library matches the members by their names).
+ *
+ * @param e The extraction handle
+ * @param dataset The dataset
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractType(extract *e, hid_t dataset) {
+  hid_t ftype, native, member, members[EXTRACT_NAME_LEN];
+  char *copy, *item, *save, *names[EXTRACT_NAME_LEN];
+  unsigned int n = 0, i = 0;
+  size_t size = 0;
+  int index;
+
+  ftype = H5Dget_type(dataset);
+  member = H5Tget_native_type(ftype, H5T_DIR_ASCEND);
+  H5Tclose(ftype);
+  if (member < 0) return EXTRACT_ERR_HDF;
+
+  native = ExtractMemType(member);
+  H5Tclose(member);
+  if (native < 0) return EXTRACT_ERR_HDF;
+
+  if (e->query.fields != NULL && e->query.fields[0] != '\0') {
+    if (H5Tget_class(native) != H5T_COMPOUND) {
+      ExtractMessage("The dataset '%s' is not a compound dataset\n", e->name);
+      H5Tclose(native);
+      return EXTRACT_ERR_ARGS;
+    }
+
+    copy = strdup(e->query.fields);
+    if (!copy) {
+      H5Tclose(native);
+      return EXTRACT_ERR_MEM;
+    }
+
+    for (item = strtok_r(copy, ",", &save); item != NULL && n < EXTRACT_NAME_LEN;
+        item = strtok_r(NULL, ",", &save)) {
+      index = H5Tget_member_index(native, item);
+      if (index < 0) {
+        ExtractMessage("The field '%s' does not exist in '%s'\n", item, e->name);
+        for (i = 0; i < n; i++) H5Tclose(members[i]);
+        free(copy);
+        H5Tclose(native);
+        return EXTRACT_ERR_ARGS;
+      }
+      member = H5Tget_member_type(native, index);
+      members[n] = member;
+      names[n] = item;
+      size += H5Tget_size(member);
+      n++;
+    }
+
+    e->memtype = H5Tcreate(H5T_COMPOUND, size);
+    size = 0;
+    for (i = 0; i < n; i++) {
+      H5Tinsert(e->memtype, names[i], size, members[i]);
+      size += H5Tget_size(members[i]);
+      H5Tclose(members[i]);
+    }
+
+    free(copy);
+    H5Tclose(native);
+  } else if (H5Tget_class(native) == H5T_COMPOUND) {
+    e->memtype = H5Tcopy(native);
+    H5Tpack(e->memtype);
+    H5Tclose(native);
+  } else {
+    e->memtype = native;
+  }
+
+  e->size = H5Tget_size(e->memtype);
+
+  return ExtractColumns(e, e->memtype, 0);
+}
+
+/**
+ * @brief Open the dataset of the reader
+ *
+ * @param e The extraction handle
+ * @param tid The task ID (STORAGE_GROUP)
+ *
+ * @return The dataset, negative on error
+ */
+static hid_t ExtractDatasetOpen(extract *e, unsigned int tid) {
+  char path[EXTRACT_NAME_LEN + 16];
+  hid_t dataset, dapl;
+  size_t cache = 0;
+  int i = 0;
+
+  dapl = H5Pcreate(H5P_DATASET_ACCESS);
+
+  if (e->chunked) {
+    cache = e->size;
+    for (i = 0; i < e->rank; i++) cache *= e->chunk[i];
+    cache *= EXTRACT_CACHE_CHUNKS;
+    if (cache < EXTRACT_CACHE_MIN) cache = EXTRACT_CACHE_MIN;
+    if (cache > EXTRACT_CACHE_MAX) cache = EXTRACT_CACHE_MAX;
+    H5Pset_chunk_cache(dapl, EXTRACT_CACHE_SLOTS, cache, 1.0);
+  }
+
+  if (e->layout == EXTRACT_LAYOUT_GROUP) {
+    snprintf(path, EXTRACT_NAME_LEN + 16, TASK_PATH "/%s", tid, e->name);
+    dataset = H5Dopen2(e->location, path, dapl);
+  } else {
+    dataset = H5Dopen2(e->location, e->name, dapl);
+  }
+
+  H5Pclose(dapl);
+
+  return dataset;
+}
+
+/**
+ * @brief Check whether the task stores the STORAGE_GROUP dataset
+ *
+ * @param e The extraction handle
+ * @param tid The task ID
+ *
+ * @return 1 if the dataset exists, 0 otherwise
+ */
+static int ExtractGroupExists(extract *e, unsigned int tid) {
+  char path[EXTRACT_NAME_LEN + 16];
+
+  snprintf(path, EXTRACT_NAME_LEN + 16, TASK_PATH, tid);
+  if (H5Lexists(e->tasks, path, H5P_DEFAULT) <= 0) return 0;
+
+  snprintf(path, EXTRACT_NAME_LEN + 16, TASK_PATH "/%s", tid, e->name);
+  return H5Lexists(e->tasks, path, H5P_DEFAULT) > 0;
+}
+
+/**
+ * @brief Resolve the dataset of the query
+ *
+ * The dataset name is looked up in the tasks group of the pool (the task banks), in
+ * the task groups (STORAGE_GROUP) and in the pool group (the pool banks). The absolute
+ * path is opened as the plain dataset.
+ *
+ * @param e The extraction handle
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractDataset(extract *e) {
+  int mstat = EXTRACT_SUCCESS, i = 0;
+  unsigned int tid = 0;
+  hid_t dataset, space, dcpl;
+  char *name = e->query.dataset;
+
+  if (name == NULL || name[0] == '\0') {
+    ExtractMessage("No dataset given\n");
+    return EXTRACT_ERR_ARGS;
+  }
+
+  snprintf(e->name, EXTRACT_NAME_LEN, "%s", name);
+  e->layout = EXTRACT_LAYOUT_DATASET;
+
+  if (name[0] == '/') {
+    e->location = e->file;
+  } else if (e->tasks >= 0 && H5Lexists(e->tasks, name, H5P_DEFAULT) > 0) {
+    e->location = e->tasks;
+    e->layout = EXTRACT_LAYOUT_AUTO;
+  } else {
+    e->location = -1;
+    if (e->tasks >= 0) {
+      e->location = e->tasks;
+      for (tid = 0; tid < e->pool_size; tid++) {
+        if (ExtractGroupExists(e, tid)) break;
+      }
+      if (tid < e->pool_size) {
+        e->layout = EXTRACT_LAYOUT_GROUP;
+      } else {
+        e->location = -1;
+      }
+    }
+    if (e->location < 0 && H5Lexists(e->pool, name, H5P_DEFAULT) > 0) e->location = e->pool;
+    if (e->location < 0) {
+      ExtractMessage("The dataset '%s' does not exist in the pool\n", name);
+      return EXTRACT_ERR_ARGS;
+    }
+  }
+
+  if (e->layout == EXTRACT_LAYOUT_GROUP) {
+    dataset = ExtractDatasetOpen(e, tid);
+  } else {
+    dataset = H5Dopen2(e->location, e->name, H5P_DEFAULT);
+  }
+  if (dataset < 0) {
+    ExtractMessage("Cannot open the dataset '%s'\n", name);
+    return EXTRACT_ERR_HDF;
+  }
+
+  space = H5Dget_space(dataset);
+  e->rank = H5Sget_simple_extent_dims(space, e->dims, NULL);
+  H5Sclose(space);
+
+  dcpl = H5Dget_create_plist(dataset);
+  if (H5Pget_layout(dcpl) == H5D_CHUNKED) {
+    e->chunked = 1;
+    H5Pget_chunk(dcpl, MAX_RANK, e->chunk);
+  }
+  for (i = 0; i < e->rank && !e->chunked; i++) e->chunk[i] = 0;
+  H5Pclose(dcpl);
+
+  mstat = ExtractType(e, dataset);
+  H5Dclose(dataset);
+  if (mstat != EXTRACT_SUCCESS) return mstat;
+
+  if (e->layout == EXTRACT_LAYOUT_AUTO) {
+    e->layout = ExtractDetect(e);
+    if (e->layout < 0) return EXTRACT_ERR_ARGS;
+  } else if (e->query.layout != EXTRACT_LAYOUT_AUTO && e->query.layout != e->layout) {
+    ExtractMessage("The dataset '%s' does not fit the '%s' layout\n", name,
+        ExtractLayoutName(e->query.layout));
+    return EXTRACT_ERR_ARGS;
+  }
+
+  if (e->rank < 1) {
+    e->rank = 1;
+    e->dims[0] = 1;
+  }
+
+  return mstat;
+}
+
+/**
+ * @brief Add the read
+ *
+ * @param e The extraction handle
+ * @param r The read
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractAddRead(extract *e, extract_read *r) {
+  extract_read *reads;
+  int i = 0;
+
+  r->elements = 1;
+  for (i = 0; i < e->rank; i++) r->elements *= r->count[i] * r->block[i];
+
+  if (e->nreads == e->areads) {
+    e->areads = e->areads ? 2 * e->areads : 64;
+    reads = realloc(e->reads, e->areads * sizeof(extract_read));
+    if (!reads) return EXTRACT_ERR_MEM;
+    e->reads = reads;
+  }
+
+  e->reads[e->nreads++] = *r;
+  e->elements += r->elements;
+
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief Prepare the read from the slice
+ *
+ * @param e The extraction handle
+ * @param r The read
+ */
+static void ExtractSliceRead(extract *e, extract_read *r) {
+  int i = 0;
+
+  memset(r, 0, sizeof(extract_read));
+  for (i = 0; i < e->rank; i++) {
+    r->start[i] = e->sl_start[i];
+    r->stride[i] = e->sl_step[i];
+    r->count[i] = e->sl_count[i];
+    r->block[i] = 1;
+  }
+}
+
+/**
+ * @brief Set the output dimensions
+ *
+ * @param e The extraction handle
+ * @param tasks The number of tasks (prepended to the tile), 0 for none
+ * @param with_tasks Whether the task axis is present
+ */
+static void ExtractOutput(extract *e, hsize_t tasks, int with_tasks) {
+  int i = 0;
+
+  e->out_rank = 0;
+  if (with_tasks) e->out_dims[e->out_rank++] = tasks;
+
+  for (i = 0; i < e->rank; i++) {
+    if (!e->sl_drop[i]) e->out_dims[e->out_rank++] = e->sl_count[i];
+  }
+
+  e->row_length = e->out_rank >= 2 ? e->out_dims[e->out_rank - 1] : 1;
+}
+
+/**
+ * @brief Select the whole dataset (with the slice)
+ *
+ * The selection is split along the first axis with more than one element, and the
+ * reads end at the chunk boundaries of that axis.
+ *
+ * @param e The extraction handle
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractSelectDataset(extract *e) {
+  int mstat = EXTRACT_SUCCESS, i = 0, axis = -1;
+  hsize_t rows, rowbytes = e->size, k, m, first, last, boundary;
+  extract_read r;
+
+  mstat = ExtractParseSlice(e, e->rank, e->dims);
+  if (mstat != EXTRACT_SUCCESS) return mstat;
+
+  ExtractOutput(e, 0, 0);
+  ExtractSliceRead(e, &r);
+
+  for (i = 0; i < e->rank; i++) {
+    if (e->sl_count[i] > 1) {
+      axis = i;
+      break;
+    }
+  }
+
+  if (axis < 0) return ExtractAddRead(e, &r);
+
+  for (i = axis + 1; i < e->rank; i++) rowbytes *= e->sl_count[i];
+  rows = e->query.block_size / rowbytes;
+  if (rows < 1) rows = 1;
+
+  for (k = 0; k < e->sl_count[axis]; k += m) {
+    m = e->sl_count[axis] - k;
+    if (m > rows) m = rows;
+
+    if (e->chunked && e->chunk[axis] > 0) {
+      first = e->sl_start[axis] + k * e->sl_step[axis];
+      last = first + (m - 1) * e->sl_step[axis] + 1;
+      boundary = (last / e->chunk[axis]) * e->chunk[axis];
+      if (boundary > first && last != boundary && k + m < e->sl_count[axis]) {
+        m = (boundary - first + e->sl_step[axis] - 1) / e->sl_step[axis];
+      }
+    }
+
+    r.start[axis] = e->sl_start[axis] + k * e->sl_step[axis];
+    r.count[axis] = m;
+
+    mstat = ExtractAddRead(e, &r);
+    if (mstat != EXTRACT_SUCCESS) return mstat;
+  }
+
+  return mstat;
+}
+
+/**
+ * @brief Compare the selected tasks by the sort key
+ *
+ * @param a The first task
+ * @param b The second task
+ *
+ * @return The comparison result
+ */
+static int ExtractCompareTasks(const void *a, const void *b) {
+  const extract_task *x = a, *y = b;
+
+  if (x->row < y->row) return -1;
+  if (x->row > y->row) return 1;
+  return 0;
+}
+
+/**
+ * @brief Check the task board status filter
+ *
+ * @param e The extraction handle
+ * @param location The task location
+ *
+ * @return 1 if the task is selected, 0 otherwise
+ */
+static int ExtractStatusMatch(extract *e, unsigned int *location) {
+  unsigned int i = 0;
+  short status;
+
+  if (e->query.statuses == 0) return 1;
+
+  status = e->status[(location[0] * e->board[1] + location[1]) * e->board[2] + location[2]];
+  for (i = 0; i < e->query.statuses; i++) {
+    if (status == e->query.status[i]) return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Select the tasks
+ *
+ * The task IDs are mapped onto the task board as in the core `TaskBoardMap()`. The
+ * mapping is known only for the default row order of the tasks, so that the task
+ * ranges of the board-addressed datasets and the status filter of the task-addressed
+ * datasets are not available for the other task orders. The task range must lie within
+ * the pool.
+ *
+ * @param e The extraction handle
+ * @param tasks The selected tasks (allocated)
+ * @param n The number of selected tasks
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractTasks(extract *e, extract_task **tasks, size_t *n) {
+  unsigned int tid, min, max, px, x, y, z;
+  unsigned int X = e->board[0], Y = e->board[1], Z = e->board[2];
+  int board_addressed, full_range;
+  extract_task *t;
+
+  *n = 0;
+  *tasks = NULL;
+
+  if (e->pool_size == 0) {
+    ExtractMessage("The pool has no task board\n");
+    return EXTRACT_ERR_ARGS;
+  }
+
+  if (e->query.task_min >= (long) e->pool_size || e->query.task_max > (long) e->pool_size) {
+    ExtractMessage("The task range exceeds the pool size (%u tasks)\n", e->pool_size);
+    return EXTRACT_ERR_ARGS;
+  }
+
+  board_addressed = (e->layout == EXTRACT_LAYOUT_PM3D || e->layout == EXTRACT_LAYOUT_TEXTURE);
+  full_range = (e->query.task_min <= 0 && e->query.task_max < 0);
+
+  t = calloc(e->pool_size, sizeof(extract_task));
+  if (!t) return EXTRACT_ERR_MEM;
+
+  if (board_addressed && full_range) {
+    for (z = 0; z < Z; z++) {
+      for (x = 0; x < X; x++) {
+        for (y = 0; y < Y; y++) {
+          t[*n].tid = (z * X + x) * Y + y;
+          t[*n].location[0] = x;
+          t[*n].location[1] = y;
+          t[*n].location[2] = z;
+          if (ExtractStatusMatch(e, t[*n].location)) (*n)++;
+        }
+      }
+    }
+  } else {
+    if ((board_addressed || e->query.statuses > 0) && !e->row_order) {
+      ExtractMessage("The tasks of the pool do not follow the row order, "
+          "the task IDs cannot be mapped onto the task board\n");
+      free(t);
+      return EXTRACT_ERR_ARGS;
+    }
+
+    min = e->query.task_min > 0 ? (unsigned int) e->query.task_min : 0;
+    max = e->query.task_max < 0 ? e->pool_size : (unsigned int) e->query.task_max;
+
+    for (tid = min; tid < max; tid++) {
+      px = tid % (X * Y);
+      t[*n].tid = tid;
+      t[*n].location[0] = px / Y;
+      t[*n].location[1] = px % Y;
+      t[*n].location[2] = tid / (X * Y);
+      if (ExtractStatusMatch(e, t[*n].location)) (*n)++;
+    }
+  }
+
+  // The STORAGE_PM3D rows follow the board columns
+  if (e->layout == EXTRACT_LAYOUT_PM3D) {
+    for (tid = 0; tid < *n; tid++) {
+      t[tid].row = t[tid].location[0] + (hsize_t) X * t[tid].location[1]
+        + (hsize_t) X * Y * t[tid].location[2];
+    }
+    qsort(t, *n, sizeof(extract_task), ExtractCompareTasks);
+  } else {
+    for (tid = 0; tid < *n; tid++) t[tid].row = t[tid].tid;
+  }
+
+  *tasks = t;
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief Select the task rows (STORAGE_PM3D, STORAGE_LIST, STORAGE_PACKED)
+ *
+ * The runs of consecutive task tiles are read with a single strided hyperslab, and the
+ * run is cut at the chunk boundary when the work unit is full.
+ *
+ * @param e The extraction handle
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractSelectRows(extract *e) {
+  int mstat = EXTRACT_SUCCESS, i = 0;
+  hsize_t tile[MAX_RANK], rows, tilebytes, bytes = 0, chunk;
+  extract_task *tasks = NULL;
+  extract_read r;
+  size_t n = 0, k = 0, run = 0;
+
+  rows = e->dims[0] / e->pool_size;
+  tile[0] = rows;
+  for (i = 1; i < e->rank; i++) tile[i] = e->dims[i];
+
+  mstat = ExtractParseSlice(e, e->rank, tile);
+  if (mstat != EXTRACT_SUCCESS) return mstat;
+
+  // One row per task: the task axis replaces the tile rows
+  if (rows == 1 && e->sl_given == 0) e->sl_drop[0] = 1;
+
+  mstat = ExtractTasks(e, &tasks, &n);
+  if (mstat != EXTRACT_SUCCESS) return mstat;
+
+  ExtractOutput(e, n, 1);
+
+  tilebytes = e->size;
+  for (i = 0; i < e->rank; i++) tilebytes *= e->sl_count[i];
+  chunk = e->chunked && e->chunk[0] > 0 ? e->chunk[0] : 1;
+
+  for (k = 0; k < n; k = run) {
+    bytes = tilebytes;
+    for (run = k + 1; run < n && e->sl_step[0] == 1; run++) {
+      if (tasks[run].row != tasks[run - 1].row + 1) break;
+      if (bytes >= e->query.block_size
+          && (tasks[run].row * rows) / chunk != (tasks[run - 1].row * rows) / chunk) break;
+      bytes += tilebytes;
+    }
+
+    ExtractSliceRead(e, &r);
+    r.tid = tasks[k].tid;
+    if (e->sl_step[0] == 1) {
+      r.start[0] = tasks[k].row * rows + e->sl_start[0];
+      r.stride[0] = rows;
+      r.count[0] = run - k;
+      r.block[0] = e->sl_count[0];
+    } else {
+      r.start[0] = tasks[k].row * rows + e->sl_start[0];
+    }
+
+    mstat = ExtractAddRead(e, &r);
+    if (mstat != EXTRACT_SUCCESS) break;
+  }
+
+  free(tasks);
+  return mstat;
+}
+
+/**
+ * @brief Select the task tiles (STORAGE_TEXTURE, STORAGE_GROUP)
+ *
+ * @param e The extraction handle
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractSelectTiles(extract *e) {
+  int mstat = EXTRACT_SUCCESS, i = 0;
+  hsize_t tile[MAX_RANK], selected = 0;
+  extract_task *tasks = NULL;
+  extract_read r;
+  size_t n = 0, k = 0;
+
+  for (i = 0; i < e->rank; i++) {
+    tile[i] = e->dims[i];
+    if (e->layout == EXTRACT_LAYOUT_TEXTURE && i < TASK_BOARD_RANK) tile[i] = e->dims[i] / e->board[i];
+  }
+
+  mstat = ExtractParseSlice(e, e->rank, tile);
+  if (mstat != EXTRACT_SUCCESS) return mstat;
+
+  mstat = ExtractTasks(e, &tasks, &n);
+  if (mstat != EXTRACT_SUCCESS) return mstat;
+
+  for (k = 0; k < n; k++) {
+    if (e->layout == EXTRACT_LAYOUT_GROUP && !ExtractGroupExists(e, tasks[k].tid)) continue;
+
+    ExtractSliceRead(e, &r);
+    r.tid = tasks[k].tid;
+    if (e->layout == EXTRACT_LAYOUT_TEXTURE) {
+      for (i = 0; i < TASK_BOARD_RANK; i++) r.start[i] += tasks[k].location[i] * tile[i];
+    }
+
+    mstat = ExtractAddRead(e, &r);
+    if (mstat != EXTRACT_SUCCESS) break;
+    selected++;
+  }
+
+  ExtractOutput(e, selected, 1);
+
+  free(tasks);
+  return mstat;
+}
+
+/**
+ * @brief Compare the stream index entries by the offset
+ *
+ * @param a The first entry
+ * @param b The second entry
+ *
+ * @return The comparison result
+ */
+static int ExtractCompareEntries(const void *a, const void *b) {
+  const unsigned long long *x = a, *y = b;
+
+  if (x[2] < y[2]) return -1;
+  if (x[2] > y[2]) return 1;
+  return 0;
+}
+
+/**
+ * @brief Select the records of the tasks (STORAGE_STREAM)
+ *
+ * The stream index is read, and the records of the selected tasks are merged into the
+ * runs of consecutive records.
+ *
+ * @param e The extraction handle
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractSelectStream(extract *e) {
+  int mstat = EXTRACT_SUCCESS, i = 0;
+  char name[EXTRACT_NAME_LEN + 16];
+  unsigned long long *index = NULL;
+  unsigned char *selected = NULL;
+  hsize_t idims[2], rows, rowbytes = e->size, records = 0, start, length, m;
+  extract_task *tasks = NULL;
+  extract_read r;
+  size_t n = 0, k = 0, entries = 0;
+  hid_t dataset, space;
+
+  mstat = ExtractParseSlice(e, e->rank, e->dims);
+  if (mstat != EXTRACT_SUCCESS) return mstat;
+
+  if (e->sl_start[0] != 0 || e->sl_step[0] != 1 || e->sl_count[0] != e->dims[0] || e->sl_drop[0]) {
+    ExtractMessage("The records of the stream are selected by the tasks, use ':' for the first axis\n");
+    return EXTRACT_ERR_ARGS;
+  }
+
+  mstat = ExtractTasks(e, &tasks, &n);
+  if (mstat != EXTRACT_SUCCESS) return mstat;
+
+  selected = calloc(e->pool_size, sizeof(unsigned char));
+  if (!selected) {
+    free(tasks);
+    return EXTRACT_ERR_MEM;
+  }
+  for (k = 0; k < n; k++) selected[tasks[k].tid] = 1;
+  free(tasks);
+
+  snprintf(name, EXTRACT_NAME_LEN + 16, STREAM_INDEX, e->name);
+  dataset = H5Dopen2(e->tasks, name, H5P_DEFAULT);
+  if (dataset < 0) {
+    free(selected);
+    return EXTRACT_ERR_HDF;
+  }
+
+  space = H5Dget_space(dataset);
+  H5Sget_simple_extent_dims(space, idims, NULL);
+  H5Sclose(space);
+
+  index = calloc(idims[0] * STREAM_INDEX_FIELDS + 1, sizeof(unsigned long long));
+  if (!index) {
+    H5Dclose(dataset);
+    free(selected);
+    return EXTRACT_ERR_MEM;
+  }
+
+  if (idims[0] > 0 && H5Dread(dataset, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, index) < 0) {
+    mstat = EXTRACT_ERR_HDF;
+  }
+  H5Dclose(dataset);
+
+  if (mstat == EXTRACT_SUCCESS) {
+    for (k = 0; k < idims[0]; k++) {
+      if (index[k * STREAM_INDEX_FIELDS] < e->pool_size && selected[index[k * STREAM_INDEX_FIELDS]]
+          && index[k * STREAM_INDEX_FIELDS + 3] > 0) {
+        memmove(&index[entries * STREAM_INDEX_FIELDS], &index[k * STREAM_INDEX_FIELDS],
+            STREAM_INDEX_FIELDS * sizeof(unsigned long long));
+        entries++;
+      }
+    }
+    qsort(index, entries, STREAM_INDEX_FIELDS * sizeof(unsigned long long), ExtractCompareEntries);
+
+    for (i = 1; i < e->rank; i++) rowbytes *= e->sl_count[i];
+    rows = e->query.block_size / rowbytes;
+    if (rows < 1) rows = 1;
+
+    for (k = 0; k < entries && mstat == EXTRACT_SUCCESS; ) {
+      start = index[k * STREAM_INDEX_FIELDS + 2];
+      length = index[k * STREAM_INDEX_FIELDS + 3];
+      for (k++; k < entries && index[k * STREAM_INDEX_FIELDS + 2] == start + length; k++) {
+        length += index[k * STREAM_INDEX_FIELDS + 3];
+      }
+
+      if (start + length > e->dims[0]) {
+        ExtractMessage("The stream index of '%s' does not fit the dataset\n", e->name);
+        mstat = EXTRACT_ERR_HDF;
+        break;
+      }
+
+      for (m = 0; m < length && mstat == EXTRACT_SUCCESS; m += rows) {
+        ExtractSliceRead(e, &r);
+        r.start[0] = start + m;
+        r.count[0] = length - m > rows ? rows : length - m;
+        records += r.count[0];
+        mstat = ExtractAddRead(e, &r);
+      }
+    }
+  }
+
+  e->sl_count[0] = records;
+  ExtractOutput(e, 0, 0);
+
+  free(index);
+  free(selected);
+  return mstat;
+}
+
+/**
+ * @brief Group the reads into the work units
+ *
+ * @param e The extraction handle
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractUnits(extract *e) {
+  size_t k = 0;
+  hsize_t offset = 0, elements = 0;
+
+  e->units = calloc(e->nreads + 1, sizeof(extract_unit));
+  if (!e->units) return EXTRACT_ERR_MEM;
+
+  e->nunits = 0;
+  for (k = 0; k < e->nreads; k++) {
+    if (elements == 0) {
+      e->units[e->nunits].first = k;
+      e->units[e->nunits].offset = offset;
+    }
+
+    elements += e->reads[k].elements;
+
+    if (elements * e->size >= e->query.block_size || k + 1 == e->nreads) {
+      e->units[e->nunits].last = k + 1;
+      e->units[e->nunits].elements = elements;
+      offset += elements;
+      elements = 0;
+      e->nunits++;
+    }
+  }
+
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief Open the extraction
+ *
+ * The master file is opened, the dataset and its layout are resolved, and the query is
+ * turned into the list of reads. No data is read yet.
+ *
+ * @param filename The master file
+ * @param q The query
+ * @param status The return code
+ *
+ * @return The extraction handle, NULL on error
+ */
+extract* ExtractOpen(char *filename, extract_query *q, int *status) {
+  int mstat = EXTRACT_SUCCESS, selection;
+  extract *e;
+
+  e = calloc(1, sizeof(extract));
+  if (!e) {
+    *status = EXTRACT_ERR_MEM;
+    return NULL;
+  }
+
+  e->query = *q;
+  if (e->query.block_size == 0) e->query.block_size = EXTRACT_BLOCK_SIZE;
+  e->file = e->pool = e->tasks = e->location = e->memtype = -1;
+  pthread_mutex_init(&e->lock, NULL);
+  pthread_cond_init(&e->turn_cond, NULL);
+
+  mstat = ExtractPoolOpen(e, filename, q->pool);
+  if (mstat == EXTRACT_SUCCESS) mstat = ExtractDataset(e);
+
+  if (mstat == EXTRACT_SUCCESS) {
+    selection = (q->task_min > 0 || q->task_max >= 0 || q->statuses > 0);
+
+    switch (e->layout) {
+      case EXTRACT_LAYOUT_GROUP:
+        mstat = ExtractSelectTiles(e);
+        break;
+      case EXTRACT_LAYOUT_TEXTURE:
+        mstat = selection ? ExtractSelectTiles(e) : ExtractSelectDataset(e);
+        break;
+      case EXTRACT_LAYOUT_PM3D:
+      case EXTRACT_LAYOUT_LIST:
+      case EXTRACT_LAYOUT_PACKED:
+        mstat = selection ? ExtractSelectRows(e) : ExtractSelectDataset(e);
+        break;
+      case EXTRACT_LAYOUT_STREAM:
+        mstat = selection ? ExtractSelectStream(e) : ExtractSelectDataset(e);
+        break;
+      default:
+        if (selection) {
+          ExtractMessage("The task selection requires the task dataset ('%s' is a plain dataset)\n", e->name);
+          mstat = EXTRACT_ERR_ARGS;
+        } else {
+          mstat = ExtractSelectDataset(e);
+        }
+        break;
+    }
+  }
+
+  if (mstat == EXTRACT_SUCCESS) mstat = ExtractUnits(e);
+
+  *status = mstat;
+  if (mstat != EXTRACT_SUCCESS) {
+    ExtractClose(e);
+    return NULL;
+  }
+
+  return e;
+}
+
+/**
+ * @brief Get the layout of the extracted dataset
+ *
+ * @param e The extraction handle
+ *
+ * @return The layout
+ */
+int ExtractLayout(extract *e) {
+  return e->layout;
+}
+
+/**
+ * @brief Get the shape of the output
+ *
+ * The array members of the top-level datatype are appended to the shape.
+ *
+ * @param e The extraction handle
+ * @param shape The shape (at least 2 * MAX_RANK long)
+ *
+ * @return The output rank
+ */
+int ExtractShape(extract *e, hsize_t *shape) {
+  int i = 0, rank = e->out_rank, ndims;
+  hsize_t adims[MAX_RANK];
+
+  for (i = 0; i < e->out_rank; i++) shape[i] = e->out_dims[i];
+
+  if (H5Tget_class(e->memtype) == H5T_ARRAY) {
+    ndims = H5Tget_array_ndims(e->memtype);
+    H5Tget_array_dims2(e->memtype, adims);
+    for (i = 0; i < ndims; i++) shape[rank++] = adims[i];
+  }
+
+  return rank;
+}
+
+/**
+ * @brief Append the formatted text to the growable buffer
+ *
+ * @param buffer The buffer
+ * @param length The text length
+ * @param size The buffer size
+ * @param format The format
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractAppend(char **buffer, size_t *length, size_t *size, const char *format, ...) {
+  va_list args;
+  char *resized;
+  int n;
+
+  for (;;) {
+    va_start(args, format);
+    n = vsnprintf(*buffer + *length, *size - *length, format, args);
+    va_end(args);
+
+    if (n < 0) return EXTRACT_ERR_MEM;
+    if ((size_t) n < *size - *length) break;
+
+    resized = realloc(*buffer, 2 * (*size) + n);
+    if (!resized) return EXTRACT_ERR_MEM;
+    *buffer = resized;
+    *size = 2 * (*size) + n;
+  }
+
+  *length += n;
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief Build the NumPy type description of the datatype
+ *
+ * @param type The datatype
+ * @param buffer The buffer
+ * @param length The text length
+ * @param size The buffer size
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractDescr(hid_t type, char **buffer, size_t *length, size_t *size) {
+  int mstat = EXTRACT_SUCCESS, i = 0, n, j, ndims, *order;
+  hsize_t adims[MAX_RANK];
+  hid_t member, base;
+  char byteorder, *name;
+  size_t tsize, offset, cursor = 0;
+
+  tsize = H5Tget_size(type);
+  byteorder = H5Tget_order(type) == H5T_ORDER_BE ? '>' : '<';
+  if (tsize == 1) byteorder = '|';
+
+  switch (H5Tget_class(type)) {
+    case H5T_INTEGER:
+      return ExtractAppend(buffer, length, size, "'%c%c%d'", byteorder,
+          H5Tget_sign(type) == H5T_SGN_NONE ? 'u' : 'i', (int) tsize);
+    case H5T_FLOAT:
+      return ExtractAppend(buffer, length, size, "'%cf%d'", byteorder, (int) tsize);
+    case H5T_STRING:
+      return ExtractAppend(buffer, length, size, "'|S%d'", (int) tsize);
+    case H5T_ARRAY:
+      base = H5Tget_super(type);
+      ndims = H5Tget_array_ndims(type);
+      H5Tget_array_dims2(type, adims);
+      mstat = ExtractAppend(buffer, length, size, "(");
+      if (mstat == EXTRACT_SUCCESS) mstat = ExtractDescr(base, buffer, length, size);
+      if (mstat == EXTRACT_SUCCESS) mstat = ExtractAppend(buffer, length, size, ", (");
+      for (j = 0; j < ndims && mstat == EXTRACT_SUCCESS; j++) {
+        mstat = ExtractAppend(buffer, length, size, "%llu,", (unsigned long long) adims[j]);
+      }
+      if (mstat == EXTRACT_SUCCESS) mstat = ExtractAppend(buffer, length, size, "))");
+      H5Tclose(base);
+      return mstat;
+    case H5T_COMPOUND:
+      // The members are listed by their offsets, the gaps are described as the void fields
+      n = H5Tget_nmembers(type);
+      order = calloc(n + 1, sizeof(int));
+      if (!order) return EXTRACT_ERR_MEM;
+      for (i = 0; i < n; i++) {
+        for (j = i; j > 0 && H5Tget_member_offset(type, order[j - 1]) > H5Tget_member_offset(type, i); j--) {
+          order[j] = order[j - 1];
+        }
+        order[j] = i;
+      }
+
+      mstat = ExtractAppend(buffer, length, size, "[");
+      for (i = 0; i < n && mstat == EXTRACT_SUCCESS; i++) {
+        offset = H5Tget_member_offset(type, order[i]);
+        if (offset > cursor) {
+          mstat = ExtractAppend(buffer, length, size, "('', '|V%llu'), ", (unsigned long long) (offset - cursor));
+        }
+        name = H5Tget_member_name(type, order[i]);
+        member = H5Tget_member_type(type, order[i]);
+        if (mstat == EXTRACT_SUCCESS) mstat = ExtractAppend(buffer, length, size, "('%s', ", name);
+        if (mstat == EXTRACT_SUCCESS) mstat = ExtractDescr(member, buffer, length, size);
+        if (mstat == EXTRACT_SUCCESS) mstat = ExtractAppend(buffer, length, size, ")%s", i + 1 < n ? ", " : "");
+        cursor = offset + H5Tget_size(member);
+        H5Tclose(member);
+        H5free_memory(name);
+      }
+      if (mstat == EXTRACT_SUCCESS && tsize > cursor) {
+        mstat = ExtractAppend(buffer, length, size, ", ('', '|V%llu')", (unsigned long long) (tsize - cursor));
+      }
+      if (mstat == EXTRACT_SUCCESS) mstat = ExtractAppend(buffer, length, size, "]");
+      free(order);
+      return mstat;
+    default:
+      break;
+  }
+
+  return EXTRACT_ERR_ARGS;
+}
+
+/**
+ * @brief Write the NumPy .npy header
+ *
+ * The version 1.0 header is used, and the version 2.0 when the header does not fit.
+ *
+ * @param e The extraction handle
+ * @param stream The output stream
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractHeaderNPY(extract *e, FILE *stream) {
+  int mstat = EXTRACT_SUCCESS, i = 0, rank;
+  hsize_t shape[2 * MAX_RANK];
+  size_t length = 0, size = 256, prefix, total;
+  unsigned char magic[12] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0};
+  char *header;
+  hid_t type;
+
+  header = calloc(size, sizeof(char));
+  if (!header) return EXTRACT_ERR_MEM;
+
+  rank = ExtractShape(e, shape);
+
+  // The top-level array is described by its base type and the shape
+  type = H5Tget_class(e->memtype) == H5T_ARRAY ? H5Tget_super(e->memtype) : H5Tcopy(e->memtype);
+
+  mstat = ExtractAppend(&header, &length, &size, "{'descr': ");
+  if (mstat == EXTRACT_SUCCESS) mstat = ExtractDescr(type, &header, &length, &size);
+  H5Tclose(type);
+  if (mstat == EXTRACT_SUCCESS) mstat = ExtractAppend(&header, &length, &size, ", 'fortran_order': False, 'shape': (");
+  for (i = 0; i < rank && mstat == EXTRACT_SUCCESS; i++) {
+    mstat = ExtractAppend(&header, &length, &size, "%s%llu", i > 0 ? ", " : "", (unsigned long long) shape[i]);
+  }
+  if (mstat == EXTRACT_SUCCESS) mstat = ExtractAppend(&header, &length, &size, "%s), }", rank == 1 ? "," : "");
+
+  if (mstat != EXTRACT_SUCCESS) {
+    free(header);
+    return mstat;
+  }
+
+  // The header is padded with spaces and ends with the newline (64-byte alignment)
+  prefix = 10;
+  if (length + prefix + 1 > 65535) {
+    prefix = 12;
+    magic[6] = 2;
+  }
+  total = ((prefix + length + 1 + 63) / 64) * 64;
+  while (prefix + length + 1 < total && mstat == EXTRACT_SUCCESS) {
+    mstat = ExtractAppend(&header, &length, &size, " ");
+  }
+  if (mstat == EXTRACT_SUCCESS) mstat = ExtractAppend(&header, &length, &size, "\n");
+
+  if (prefix == 10) {
+    magic[8] = length & 0xff;
+    magic[9] = (length >> 8) & 0xff;
+  } else {
+    magic[8] = length & 0xff;
+    magic[9] = (length >> 8) & 0xff;
+    magic[10] = (length >> 16) & 0xff;
+    magic[11] = (length >> 24) & 0xff;
+  }
+
+  if (mstat == EXTRACT_SUCCESS) {
+    if (fwrite(magic, 1, prefix, stream) != prefix
+        || fwrite(header, 1, length, stream) != length) mstat = EXTRACT_ERR_IO;
+  }
+
+  free(header);
+  return mstat;
+}
+
+/**
+ * @brief Read the work unit
+ *
+ * @param e The extraction handle
+ * @param u The work unit
+ * @param dataset The dataset of the reader (-1 for STORAGE_GROUP)
+ * @param buffer The data buffer
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractReadUnit(extract *e, extract_unit *u, hid_t dataset, char *buffer) {
+  int mstat = EXTRACT_SUCCESS;
+  hid_t h5dataset = dataset, space, memspace;
+  extract_read *r;
+  size_t k = 0;
+  hsize_t offset = 0;
+
+  ExtractLockHDF();
+
+  for (k = u->first; k < u->last && mstat == EXTRACT_SUCCESS; k++) {
+    r = &e->reads[k];
+
+    if (e->layout == EXTRACT_LAYOUT_GROUP) {
+      h5dataset = ExtractDatasetOpen(e, r->tid);
+      if (h5dataset < 0) {
+        mstat = EXTRACT_ERR_HDF;
+        break;
+      }
+    }
+
+    space = H5Dget_space(h5dataset);
+    memspace = H5Screate_simple(1, &r->elements, NULL);
+
+    if (H5Sselect_hyperslab(space, H5S_SELECT_SET, r->start, r->stride, r->count, r->block) < 0
+        || H5Sselect_valid(space) <= 0
+        || H5Dread(h5dataset, e->memtype, memspace, space, H5P_DEFAULT, buffer + offset * e->size) < 0) {
+      ExtractMessage("Cannot read the dataset '%s'\n", e->name);
+      mstat = EXTRACT_ERR_HDF;
+    }
+
+    H5Sclose(memspace);
+    H5Sclose(space);
+    if (e->layout == EXTRACT_LAYOUT_GROUP) H5Dclose(h5dataset);
+
+    offset += r->elements;
+  }
+
+  ExtractUnlockHDF();
+
+  return mstat;
+}
+
+/**
+ * @brief Format the work unit as CSV
+ *
+ * @param e The extraction handle
+ * @param u The work unit
+ * @param data The data
+ * @param text The text buffer
+ * @param length The text length
+ * @param size The text buffer size
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+static int ExtractFormatCSV(extract *e, extract_unit *u, char *data, char **text, size_t *length, size_t *size) {
+  hsize_t i = 0, g;
+  unsigned int c = 0;
+  size_t need, j;
+  extract_column *col;
+  char *p, *value, *resized;
+  int n;
+
+  *length = 0;
+
+  for (i = 0; i < u->elements; i++) {
+    need = *length + e->width + e->ncolumns + 4;
+    if (need > *size) {
+      resized = realloc(*text, 2 * need);
+      if (!resized) return EXTRACT_ERR_MEM;
+      *text = resized;
+      *size = 2 * need;
+    }
+
+    p = *text + *length;
+    for (c = 0; c < e->ncolumns; c++) {
+      col = &e->columns[c];
+      value = data + i * e->size + col->offset;
+      n = 0;
+
+      if (c > 0) *p++ = ',';
+
+      if (col->type_class == H5T_INTEGER) {
+        if (col->sign == H5T_SGN_NONE) {
+          unsigned long long v = 0;
+          if (col->size == 1) v = *(unsigned char *) value;
+          if (col->size == 2) v = *(unsigned short *) value;
+          if (col->size == 4) v = *(unsigned int *) value;
+          if (col->size == 8) v = *(unsigned long long *) value;
+          n = snprintf(p, EXTRACT_VALUE_LEN, "%llu", v);
+        } else {
+          long long v = 0;
+          if (col->size == 1) v = *(signed char *) value;
+          if (col->size == 2) v = *(short *) value;
+          if (col->size == 4) v = *(int *) value;
+          if (col->size == 8) v = *(long long *) value;
+          n = snprintf(p, EXTRACT_VALUE_LEN, "%lld", v);
+        }
+      } else if (col->type_class == H5T_FLOAT) {
+        if (col->size == sizeof(float)) n = snprintf(p, EXTRACT_VALUE_LEN, "%.9g", *(float *) value);
+        else if (col->size == sizeof(double)) n = snprintf(p, EXTRACT_VALUE_LEN, "%.17g", *(double *) value);
+        else n = snprintf(p, EXTRACT_VALUE_LEN, "%.21Lg", *(long double *) value);
+      } else {
+        *p++ = '"';
+        for (j = 0; j < col->size && value[j] != '\0'; j++) {
+          if (value[j] == '"') *p++ = '"';
+          *p++ = value[j];
+        }
+        *p++ = '"';
+      }
+      p += n;
+    }
+
+    g = u->offset + i + 1;
+    if (g % e->row_length == 0) {
+      *p++ = '\n';
+      if (e->query.lines > 0 && (g / e->row_length) % e->query.lines == 0) *p++ = '\n';
+    } else {
+      *p++ = ',';
+    }
+
+    *length = p - *text;
+  }
+
+  return EXTRACT_SUCCESS;
+}
+
+/**
+ * @brief The reader thread
+ *
+ * The thread takes the next work unit, reads it and formats it, and waits for its turn
+ * to write it to the output.
+ *
+ * @param arg The extraction handle
+ *
+ * @return NULL
+ */
+static void* ExtractWorker(void *arg) {
+  int mstat = EXTRACT_SUCCESS;
+  extract *e = arg;
+  extract_unit *u;
+  hid_t dataset = -1;
+  char *buffer = NULL, *text = NULL, *resized, *out;
+  size_t bsize = 0, tsize = 0, tlength = 0, unit;
+
+  if (e->layout != EXTRACT_LAYOUT_GROUP) {
+    ExtractLockHDF();
+    dataset = ExtractDatasetOpen(e, 0);
+    ExtractUnlockHDF();
+    if (dataset < 0) mstat = EXTRACT_ERR_HDF;
+  }
+
+  while (mstat == EXTRACT_SUCCESS) {
+    pthread_mutex_lock(&e->lock);
+    if (e->state != EXTRACT_SUCCESS || e->next >= e->nunits) {
+      pthread_mutex_unlock(&e->lock);
+      break;
+    }
+    unit = e->next++;
+    pthread_mutex_unlock(&e->lock);
+
+    u = &e->units[unit];
+
+    if (u->elements * e->size > bsize) {
+      resized = realloc(buffer, u->elements * e->size);
+      if (!resized) {
+        mstat = EXTRACT_ERR_MEM;
+        break;
+      }
+      buffer = resized;
+      bsize = u->elements * e->size;
+    }
+
+    mstat = ExtractReadUnit(e, u, dataset, buffer);
+    if (mstat != EXTRACT_SUCCESS) break;
+
+    out = buffer;
+    tlength = u->elements * e->size;
+    if (e->query.format == EXTRACT_FORMAT_CSV) {
+      mstat = ExtractFormatCSV(e, u, buffer, &text, &tlength, &tsize);
+      if (mstat != EXTRACT_SUCCESS) break;
+      out = text;
+    }
+
+    pthread_mutex_lock(&e->lock);
+    while (e->turn != unit && e->state == EXTRACT_SUCCESS) {
+      pthread_cond_wait(&e->turn_cond, &e->lock);
+    }
+    if (e->state != EXTRACT_SUCCESS) {
+      pthread_mutex_unlock(&e->lock);
+      break;
+    }
+    pthread_mutex_unlock(&e->lock);
+
+    if (tlength > 0 && fwrite(out, 1, tlength, e->stream) != tlength) mstat = EXTRACT_ERR_IO;
+
+    pthread_mutex_lock(&e->lock);
+    e->turn++;
+    pthread_cond_broadcast(&e->turn_cond);
+    pthread_mutex_unlock(&e->lock);
+  }
+
+  if (mstat != EXTRACT_SUCCESS) {
+    pthread_mutex_lock(&e->lock);
+    if (e->state == EXTRACT_SUCCESS) e->state = mstat;
+    pthread_cond_broadcast(&e->turn_cond);
+    pthread_mutex_unlock(&e->lock);
+  }
+
+  if (dataset >= 0) {
+    ExtractLockHDF();
+    H5Dclose(dataset);
+    ExtractUnlockHDF();
+  }
+
+  free(buffer);
+  free(text);
+
+  return NULL;
+}
+
+/**
+ * @brief Write the extracted data to the stream
+ *
+ * @param e The extraction handle
+ * @param stream The output stream
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+int ExtractWrite(extract *e, FILE *stream) {
+  int mstat = EXTRACT_SUCCESS;
+  pthread_t threads[EXTRACT_THREADS_MAX];
+  unsigned int n = 0, i = 0, started = 0;
+  long cpus;
+
+  e->stream = stream;
+  e->next = 0;
+  e->turn = 0;
+  e->state = EXTRACT_SUCCESS;
+
+  if (e->query.format == EXTRACT_FORMAT_NPY) {
+    mstat = ExtractHeaderNPY(e, stream);
+    if (mstat != EXTRACT_SUCCESS) return mstat;
+  }
+
+  n = e->query.threads;
+  if (n == 0) {
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    n = cpus > 0 ? (unsigned int) cpus : 1;
+  }
+  if (n > EXTRACT_THREADS_MAX) n = EXTRACT_THREADS_MAX;
+  if (n > e->nunits) n = (unsigned int) e->nunits;
+
+  if (n <= 1) {
+    ExtractWorker(e);
+  } else {
+    for (i = 0; i < n; i++) {
+      if (pthread_create(&threads[i], NULL, ExtractWorker, e) != 0) break;
+      started++;
+    }
+    if (started == 0) ExtractWorker(e);
+    for (i = 0; i < started; i++) pthread_join(threads[i], NULL);
+  }
+
+  mstat = e->state;
+  if (mstat == EXTRACT_SUCCESS && fflush(stream) != 0) mstat = EXTRACT_ERR_IO;
+
+  return mstat;
+}
+
+/**
+ * @brief Close the extraction
+ *
+ * @param e The extraction handle
+ */
+void ExtractClose(extract *e) {
+  if (e == NULL) return;
+
+  if (e->memtype >= 0) H5Tclose(e->memtype);
+  if (e->tasks >= 0) H5Gclose(e->tasks);
+  if (e->pool >= 0) H5Gclose(e->pool);
+  if (e->file >= 0) H5Fclose(e->file);
+
+  pthread_mutex_destroy(&e->lock);
+  pthread_cond_destroy(&e->turn_cond);
+
+  free(e->status);
+  free(e->columns);
+  free(e->reads);
+  free(e->units);
+  free(e);
+}
+
+/**
+ * @brief Describe the datatype
+ *
+ * @param type The datatype
+ * @param name The description buffer
+ * @param len The buffer length
+ */
+static void ExtractTypeName(hid_t type, char *name, size_t len) {
+  size_t size = H5Tget_size(type);
+
+  switch (H5Tget_class(type)) {
+    case H5T_INTEGER:
+      snprintf(name, len, "%sint%d", H5Tget_sign(type) == H5T_SGN_NONE ? "u" : "", (int) (8 * size));
+      break;
+    case H5T_FLOAT:
+      snprintf(name, len, "float%d", (int) (8 * size));
+      break;
+    case H5T_STRING:
+      snprintf(name, len, "string");
+      break;
+    case H5T_COMPOUND:
+      snprintf(name, len, "compound");
+      break;
+    case H5T_ARRAY:
+      snprintf(name, len, "array");
+      break;
+    default:
+      snprintf(name, len, "other");
+      break;
+  }
+}
+
+/**
+ * @struct extract_list
+ * The dataset listing
+ */
+typedef struct {
+  extract *e; /**< The extraction handle */
+  hid_t location; /**< The listed group */
+  int layout; /**< The layout of the listed datasets */
+  FILE *stream; /**< The output stream */
+  char group[EXTRACT_NAME_LEN]; /**< The first task group */
+} extract_list;
+
+/**
+ * @brief List the dataset (the H5Literate() callback)
+ *
+ * @param group The group
+ * @param name The link name
+ * @param info The link info
+ * @param data The listing
+ *
+ * @return 0 to continue the iteration
+ */
+static herr_t ExtractListDataset(hid_t group, const char *name, const H5L_info_t *info, void *data) {
+  extract_list *l = data;
+  extract *e = l->e;
+  char typename[EXTRACT_NAME_LEN], index[EXTRACT_NAME_LEN];
+  hid_t object, space, type;
+  hsize_t dims[MAX_RANK];
+  int rank, i = 0, layout = l->layout;
+  size_t len;
+
+  object = H5Oopen(group, name, H5P_DEFAULT);
+  if (object < 0) return 0;
+
+  if (H5Iget_type(object) == H5I_GROUP) {
+    if (l->layout == EXTRACT_LAYOUT_AUTO && l->group[0] == '\0' && strncmp(name, "task-", 5) == 0) {
+      snprintf(l->group, EXTRACT_NAME_LEN, "%s", name);
+    }
+    H5Oclose(object);
+    return 0;
+  }
+
+  if (H5Iget_type(object) != H5I_DATASET || (l->location == e->pool && strcmp(name, EXTRACT_BOARD) == 0)) {
+    H5Oclose(object);
+    return 0;
+  }
+
+  // The stream index is listed with the stream
+  len = strlen(name);
+  if (l->layout == EXTRACT_LAYOUT_AUTO && len > 6 && strcmp(name + len - 6, "-index") == 0) {
+    snprintf(index, EXTRACT_NAME_LEN, "%.*s", (int) (len - 6), name);
+    if (H5Lexists(group, index, H5P_DEFAULT) > 0) {
+      H5Oclose(object);
+      return 0;
+    }
+  }
+
+  space = H5Dget_space(object);
+  rank = H5Sget_simple_extent_dims(space, dims, NULL);
+  H5Sclose(space);
+
+  type = H5Dget_type(object);
+  ExtractTypeName(type, typename, EXTRACT_NAME_LEN);
+  H5Tclose(type);
+
+  if (layout == EXTRACT_LAYOUT_AUTO) {
+    snprintf(e->name, EXTRACT_NAME_LEN, "%s", name);
+    e->rank = rank;
+    for (i = 0; i < rank; i++) e->dims[i] = dims[i];
+    layout = rank > 0 ? ExtractDetect(e) : EXTRACT_LAYOUT_DATASET;
+  }
+
+  fprintf(l->stream, "%-32s %-8s %-9s (", name, layout < 0 ? "?" : ExtractLayoutName(layout), typename);
+  for (i = 0; i < rank; i++) fprintf(l->stream, "%s%llu", i > 0 ? ", " : "", (unsigned long long) dims[i]);
+  fprintf(l->stream, "%s)\n", rank == 1 ? "," : "");
+
+  H5Oclose(object);
+  return 0;
+}
+
+/**
+ * @brief List the datasets of the pool
+ *
+ * The pool banks, the task banks with their detected layout, and the STORAGE_GROUP
+ * datasets of the first task group are listed.
+ *
+ * @param filename The master file
+ * @param pool The pool ID or `last`
+ * @param stream The output stream
+ *
+ * @return EXTRACT_SUCCESS on success, error code otherwise
+ */
+int ExtractList(char *filename, char *pool, FILE *stream) {
+  int mstat = EXTRACT_SUCCESS;
+  extract_list l;
+  extract *e;
+  hid_t group;
+
+  e = calloc(1, sizeof(extract));
+  if (!e) return EXTRACT_ERR_MEM;
+
+  ExtractQueryInit(&e->query);
+  e->file = e->pool = e->tasks = e->location = e->memtype = -1;
+  pthread_mutex_init(&e->lock, NULL);
+  pthread_cond_init(&e->turn_cond, NULL);
+
+  mstat = ExtractPoolOpen(e, filename, pool);
+
+  if (mstat == EXTRACT_SUCCESS) {
+    fprintf(stream, "# board (%llu, %llu, %llu), %u tasks, %s order\n",
+        (unsigned long long) e->board[0], (unsigned long long) e->board[1],
+        (unsigned long long) e->board[2], e->pool_size, e->row_order ? "row" : "custom");
+
+    memset(&l, 0, sizeof(extract_list));
+    l.e = e;
+    l.stream = stream;
+
+    l.location = e->pool;
+    l.layout = EXTRACT_LAYOUT_DATASET;
+    H5Literate(e->pool, H5_INDEX_NAME, H5_ITER_INC, NULL, ExtractListDataset, &l);
+
+    if (e->tasks >= 0) {
+      l.location = e->tasks;
+      l.layout = EXTRACT_LAYOUT_AUTO;
+      H5Literate(e->tasks, H5_INDEX_NAME, H5_ITER_INC, NULL, ExtractListDataset, &l);
+
+      if (l.group[0] != '\0') {
+        group = H5Gopen2(e->tasks, l.group, H5P_DEFAULT);
+        if (group >= 0) {
+          l.location = group;
+          l.layout = EXTRACT_LAYOUT_GROUP;
+          H5Literate(group, H5_INDEX_NAME, H5_ITER_INC, NULL, ExtractListDataset, &l);
+          H5Gclose(group);
+        }
+      }
+    }
+  }
+
+  ExtractClose(e);
+  return mstat;
+}
+
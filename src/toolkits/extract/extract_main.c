@@ -0,0 +1,161 @@
+/**
+ * @file
+ * The master file extraction tool (mechanic-extract)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <popt.h>
+
+#include "mechanic_extract.h"
+
+/**
+ * @brief Guess the output format from the output file extension
+ *
+ * @param output The output file
+ *
+ * @return The output format
+ */
+static int ExtractGuessFormat(char *output) {
+  char *ext;
+
+  if (output == NULL) return EXTRACT_FORMAT_CSV;
+
+  ext = strrchr(output, '.');
+  if (ext == NULL) return EXTRACT_FORMAT_CSV;
+  if (strcmp(ext, ".npy") == 0) return EXTRACT_FORMAT_NPY;
+  if (strcmp(ext, ".bin") == 0 || strcmp(ext, ".raw") == 0) return EXTRACT_FORMAT_BINARY;
+
+  return EXTRACT_FORMAT_CSV;
+}
+
+/**
+ * @brief The main function
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ *
+ * @return 0 on success, error code otherwise
+ */
+int main(int argc, const char **argv) {
+  int mstat = EXTRACT_SUCCESS, rc, list = 0, threads = 0, lines = 0;
+  long block = 0;
+  char *pool = NULL, *dataset = NULL, *fields = NULL, *slice = NULL, *tasks = NULL;
+  char *status = NULL, *layout = NULL, *format = NULL, *output = NULL;
+  const char *filename;
+  extract_query q;
+  extract *e;
+  poptContext context;
+  FILE *stream = stdout;
+
+  struct poptOption options[] = {
+    {"dataset", 'd', POPT_ARG_STRING, &dataset, 0,
+      "The dataset name (the pool or task bank) or the absolute path in the file", "NAME"},
+    {"pool", 'p', POPT_ARG_STRING, &pool, 0, "The pool ID (default: the last pool)", "ID"},
+    {"slice", 's', POPT_ARG_STRING, &slice, 0,
+      "The slice of the dataset (or the task tile), i.e. 0:10,:,2 (the ranges are clipped to "
+      "the axis as in NumPy)", "SLICE"},
+    {"tasks", 't', POPT_ARG_STRING, &tasks, 0,
+      "The task ID range, i.e. 100:200 (within the pool)", "MIN:MAX"},
+    {"status", 0, POPT_ARG_STRING, &status, 0,
+      "The task board status filter: available, finished, in-use, restart", "LIST"},
+    {"field", 'f', POPT_ARG_STRING, &fields, 0, "The comma separated compound fields", "LIST"},
+    {"layout", 0, POPT_ARG_STRING, &layout, 0,
+      "The dataset layout: auto, dataset, group, pm3d, texture, list, packed, stream", "LAYOUT"},
+    {"format", 'F', POPT_ARG_STRING, &format, 0,
+      "The output format: csv, binary, npy (default: from the output extension)", "FORMAT"},
+    {"output", 'o', POPT_ARG_STRING, &output, 0, "The output file (default: standard output)", "FILE"},
+    {"threads", 'j', POPT_ARG_INT, &threads, 0, "The number of reader threads (default: all CPUs)", "N"},
+    {"block", 0, POPT_ARG_LONG, &block, 0, "The size of the work unit of the reader threads "
+      "(default: 4194304 bytes)", "BYTES"},
+    {"pm3d", 0, POPT_ARG_INT, &lines, 0, "The CSV output: an empty line after every N lines", "N"},
+    {"list", 'l', POPT_ARG_NONE, &list, 0, "List the datasets of the pool", NULL},
+    POPT_AUTOHELP
+    POPT_TABLEEND
+  };
+
+  context = poptGetContext(NULL, argc, argv, options, 0);
+  poptSetOtherOptionHelp(context, "[OPTIONS] MASTER-FILE");
+
+  while ((rc = poptGetNextOpt(context)) > 0);
+  if (rc < -1) {
+    fprintf(stderr, "!! %s: %s\n", poptBadOption(context, POPT_BADOPTION_NOALIAS), poptStrerror(rc));
+    poptFreeContext(context);
+    return EXTRACT_ERR_ARGS;
+  }
+
+  filename = poptGetArg(context);
+  if (filename == NULL) {
+    poptPrintUsage(context, stderr, 0);
+    poptFreeContext(context);
+    return EXTRACT_ERR_ARGS;
+  }
+
+  H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+
+  if (list) {
+    mstat = ExtractList((char *) filename, pool, stdout);
+    poptFreeContext(context);
+    return mstat;
+  }
+
+  ExtractQueryInit(&q);
+  q.pool = pool;
+  q.dataset = dataset;
+  q.fields = fields;
+  q.slice = slice;
+  q.threads = threads > 0 ? (unsigned int) threads : 0;
+  q.block_size = block > 0 ? (size_t) block : 0;
+  q.lines = lines > 0 ? (unsigned int) lines : 0;
+  q.format = ExtractGuessFormat(output);
+
+  if (tasks) mstat = ExtractParseTasks(&q, tasks);
+  if (mstat == EXTRACT_SUCCESS && status) mstat = ExtractParseStatus(&q, status);
+
+  if (mstat == EXTRACT_SUCCESS && layout) {
+    q.layout = ExtractParseLayout(layout);
+    if (q.layout < 0) {
+      fprintf(stderr, "!! Unknown layout '%s'\n", layout);
+      mstat = EXTRACT_ERR_ARGS;
+    }
+  }
+
+  if (mstat == EXTRACT_SUCCESS && format) {
+    if (strcmp(format, "csv") == 0) {
+      q.format = EXTRACT_FORMAT_CSV;
+    } else if (strcmp(format, "binary") == 0) {
+      q.format = EXTRACT_FORMAT_BINARY;
+    } else if (strcmp(format, "npy") == 0) {
+      q.format = EXTRACT_FORMAT_NPY;
+    } else {
+      fprintf(stderr, "!! Unknown format '%s'\n", format);
+      mstat = EXTRACT_ERR_ARGS;
+    }
+  }
+
+  if (mstat == EXTRACT_SUCCESS) {
+    e = ExtractOpen((char *) filename, &q, &mstat);
+
+    if (e != NULL) {
+      if (output != NULL) {
+        stream = fopen(output, "wb");
+        if (stream == NULL) {
+          fprintf(stderr, "!! Cannot open the output file '%s'\n", output);
+          mstat = EXTRACT_ERR_IO;
+        }
+      }
+
+      if (mstat == EXTRACT_SUCCESS) mstat = ExtractWrite(e, stream);
+      if (stream != NULL && stream != stdout && fclose(stream) != 0 && mstat == EXTRACT_SUCCESS) {
+        mstat = EXTRACT_ERR_IO;
+      }
+
+      ExtractClose(e);
+    }
+  }
+
+  poptFreeContext(context);
+
+  return mstat;
+}
+
@@ -0,0 +1,77 @@
+/**
+ * @file
+ * The master file extraction library (public API)
+ *
+ * The library reads the task datasets of the Mechanic master file, i.e. slices, task ranges
+ * and the task board status subsets, and streams them as raw binary, CSV or NumPy .npy
+ * data without reading the whole dataset into memory.
+ */
+#ifndef MECHANIC_EXTRACT_H
+#define MECHANIC_EXTRACT_H
+
+#include <stdio.h>
+#include <hdf5.h>
+
+#define EXTRACT_SUCCESS 0 /**< The success return code */
+#define EXTRACT_ERR_ARGS 1 /**< The invalid query return code */
+#define EXTRACT_ERR_HDF 2 /**< The HDF5 error return code */
+#define EXTRACT_ERR_MEM 3 /**< The memory allocation error return code */
+#define EXTRACT_ERR_IO 4 /**< The output error return code */
+
+#define EXTRACT_FORMAT_BINARY 0 /**< The raw binary output (native byte order) */
+#define EXTRACT_FORMAT_CSV 1 /**< The comma separated output, one line per row of the last axis */
+#define EXTRACT_FORMAT_NPY 2 /**< The NumPy .npy output */
+
+/* The layouts follow the STORAGE_* types of the core */
+#define EXTRACT_LAYOUT_AUTO 0 /**< Detect the layout of the dataset */
+#define EXTRACT_LAYOUT_DATASET 1 /**< A plain dataset (no task selection) */
+#define EXTRACT_LAYOUT_GROUP 11 /**< The STORAGE_GROUP task dataset */
+#define EXTRACT_LAYOUT_PM3D 12 /**< The STORAGE_PM3D task dataset */
+#define EXTRACT_LAYOUT_TEXTURE 13 /**< The STORAGE_TEXTURE task dataset */
+#define EXTRACT_LAYOUT_LIST 14 /**< The STORAGE_LIST task dataset */
+#define EXTRACT_LAYOUT_PACKED 15 /**< The STORAGE_PACKED task dataset */
+#define EXTRACT_LAYOUT_STREAM 16 /**< The STORAGE_STREAM task dataset */
+
+#define EXTRACT_STATUS_MAX 8 /**< The maximum number of the task board status filters */
+#define EXTRACT_THREADS_MAX 64 /**< The maximum number of reader threads */
+#define EXTRACT_BLOCK_SIZE 4194304 /**< The default size of the work unit (in bytes) */
+
+/**
+ * @struct extract_query
+ * The extraction query
+ */
+typedef struct {
+  char *pool; /**< The pool ID or `last` (NULL for the last pool) */
+  char *dataset; /**< The dataset name (or the absolute path in the file) */
+  char *fields; /**< The comma separated compound fields (NULL for all fields) */
+  char *slice; /**< The slice, i.e. `0:10,:,2` (NULL for the whole dataset or task tile) */
+  long task_min; /**< The first task ID */
+  long task_max; /**< The last task ID (exclusive), -1 for all tasks */
+  int status[EXTRACT_STATUS_MAX]; /**< The task board status filter */
+  unsigned int statuses; /**< The number of status filters (0 for no filter) */
+  int layout; /**< The dataset layout, EXTRACT_LAYOUT_AUTO to detect */
+  int format; /**< The output format */
+  unsigned int threads; /**< The number of reader threads (0 for the number of CPUs) */
+  size_t block_size; /**< The size of the work unit (0 for EXTRACT_BLOCK_SIZE) */
+  unsigned int lines; /**< The CSV output: an empty line after every N lines (0 to disable) */
+} extract_query;
+
+/**
+ * @struct extract
+ * The extraction handle (opaque)
+ */
+typedef struct extract extract;
+
+void ExtractQueryInit(extract_query *q);
+int ExtractParseStatus(extract_query *q, char *list);
+int ExtractParseTasks(extract_query *q, char *range);
+int ExtractParseLayout(char *name);
+extract* ExtractOpen(char *filename, extract_query *q, int *status);
+int ExtractLayout(extract *e);
+int ExtractShape(extract *e, hsize_t *shape);
+int ExtractWrite(extract *e, FILE *stream);
+void ExtractClose(extract *e);
+int ExtractList(char *filename, char *pool, FILE *stream);
+
+#endif
+
@@ -0,0 +1,91 @@
+# The mechanic-extract tool
+#
+# The tool reads the reference datafiles, and its output is compared with the known output
+# (references/extract), checked against the datasets read with h5py.
+
+# The extraction library of the build tree
+set (ENV{LD_LIBRARY_PATH} ${LIBRARY_PATH}:$ENV{LD_LIBRARY_PATH})
+set (ENV{DYLD_LIBRARY_PATH} ${LIBRARY_PATH}:$ENV{DYLD_LIBRARY_PATH})
+
+message(STATUS "Mechanic extract path is: ${EXTRACT}")
+
+# Compare the CSV output of the query with the known output
+function(extract_csv name datafile)
+  message(STATUS "Testing ${name}")
+  execute_process(COMMAND ${EXTRACT} ${ARGN} -F csv ${REFERENCES}/${datafile}
+    OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
+
+  if (ROUT OR EOUT)
+    message(FATAL_ERROR "${name}: ${ROUT} ${EOUT}")
+  endif (ROUT OR EOUT)
+
+  file(READ ${REFERENCES}/extract/${name}.csv REFERENCE)
+  if (NOT TOUT STREQUAL REFERENCE)
+    message(FATAL_ERROR "${name}: The output differs from the reference\n${TOUT}")
+  endif (NOT TOUT STREQUAL REFERENCE)
+endfunction(extract_csv)
+
+# Check that the query fails with the error message
+function(extract_error name datafile)
+  message(STATUS "Testing ${name}")
+  execute_process(COMMAND ${EXTRACT} ${ARGN} -F csv ${REFERENCES}/${datafile}
+    OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
+
+  if (NOT ROUT OR NOT EOUT OR TOUT)
+    message(FATAL_ERROR "${name}: The query has not failed (${ROUT})\n${TOUT}")
+  endif (NOT ROUT OR NOT EOUT OR TOUT)
+endfunction(extract_error)
+
+# The compound fields of the task tiles (STORAGE_TEXTURE and STORAGE_GROUP)
+extract_csv(compound-texture tex_compound-master-00.h5
+  -d sensors-board -f id,pressure,name -t 0:2 -s 0:2,0:3)
+extract_csv(compound-group tex_compound-master-00.h5
+  -d sensors -f id,temperature,points -t 3:5 -s 1,0:2)
+
+# The slices of the task tiles, and of the whole dataset (the range is clipped to the axis)
+extract_csv(slice-task tex_map-master-00.h5 -d result -t 10:13 -s :,1:)
+extract_csv(slice-clipped tex_mandelbrot-master-00.h5 -d result -s 2:20,3)
+
+# The task board status filter
+extract_csv(status-finished tex_mandelbrot-master-00.h5 -d result --status finished -t 10:13)
+extract_csv(status-available tex_mandelbrot-master-00.h5 -d result --status available)
+
+# The reader threads (the small work units), the output is written in order
+extract_csv(compound-group tex_compound-master-00.h5
+  -d sensors -f id,temperature,points -t 3:5 -s 1,0:2 -j 3 --block=432)
+
+# The .npy output (the header and the data), with the single and several reader threads
+foreach (threads 1 4)
+  message(STATUS "Testing the .npy output (-j ${threads})")
+  file(REMOVE result.npy)
+  execute_process(COMMAND ${EXTRACT} -d result -o result.npy -j ${threads} --block=96
+    ${REFERENCES}/tex_map-master-00.h5
+    OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
+
+  if (ROUT OR EOUT)
+    message(FATAL_ERROR "The .npy output: ${ROUT} ${EOUT}")
+  endif (ROUT OR EOUT)
+
+  # The magic string, the version 1.0 and the header length
+  file(READ result.npy MAGIC LIMIT 10 HEX)
+  if (NOT MAGIC STREQUAL "934e554d505901007600")
+    message(FATAL_ERROR "The .npy preamble is ${MAGIC}")
+  endif (NOT MAGIC STREQUAL "934e554d505901007600")
+
+  file(READ result.npy HEADER OFFSET 10 LIMIT 118)
+  string(FIND "${HEADER}" "{'descr': '<f8', 'fortran_order': False, 'shape': (100, 3), }" FOUND)
+  if (NOT FOUND EQUAL 0)
+    message(FATAL_ERROR "The .npy header is ${HEADER}")
+  endif (NOT FOUND EQUAL 0)
+
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files result.npy
+    ${REFERENCES}/extract/result.npy RESULT_VARIABLE ROUT)
+  if (ROUT)
+    message(FATAL_ERROR "The .npy output differs from the reference")
+  endif (ROUT)
+endforeach (threads)
+
+# The task range and the slice index out of the pool and the dataset
+extract_error(tasks-range tex_mandelbrot-master-00.h5 -d result -t 95:200)
+extract_error(tasks-index tex_mandelbrot-master-00.h5 -d result -t 100)
+extract_error(slice-index tex_mandelbrot-master-00.h5 -d result -s 10,0)
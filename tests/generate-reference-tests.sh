@@ -1,4 +1,9 @@
 #!/bin/bash
+#
+# Generate the reference datafiles of the modules in the current directory. The arguments
+# are passed to the core, i.e. the references of a test variant (tests/references/VARIANT):
+#
+#   generate-reference-tests.sh --task-order=hilbert
 
 MODULES=(
   core
@@ -12,30 +17,35 @@ MODULES=(
   #tex_datatypes
   #tex_dim
   #tex_dset
+  #tex_filters
+  #tex_ice
   #tex_loop
   #tex_mandelbrot
   #tex_map
   #tex_node
+  #tex_packed
   #tex_pool
   #tex_poolmask
   #tex_poolsetup
   #tex_poolsetup2
   #tex_poolsize
+  #tex_precision
   #tex_prepareprocess
   #tex_readfile
   #tex_readfile_setup
   #tex_reset
   #tex_setup
   #tex_stage
+  #tex_stream
   #tex_taskcheckpoint
 )
 
 # master mode
 for MODULE in ${MODULES[*]}; do
-  mpirun -np 4 mechanic -m master -p $MODULE -n $MODULE-master-mode -x 10 -y 10 -b 3 -d 13 --test --restart-file=$MODULE-master-mode-master-02.h5
+  mpirun -np 4 mechanic -m master -p $MODULE -n $MODULE-master-mode -x 10 -y 10 -b 3 -d 13 --test "$@" --restart-file=$MODULE-master-mode-master-02.h5
 done
 
 # task farm mode
 for MODULE in ${MODULES[*]}; do
-  mpirun -np 4 mechanic -m taskfarm -p $MODULE -n $MODULE -x 10 -y 10 -b 3 -d 13 --test --restart-file=$MODULE-master-02.h5
+  mpirun -np 4 mechanic -m taskfarm -p $MODULE -n $MODULE -x 10 -y 10 -b 3 -d 13 --test "$@" --restart-file=$MODULE-master-02.h5
 done
@@ -0,0 +1,62 @@
+# The restart from the checkpoint journal
+#
+# The run is stopped with the ICE file (ex_ice) before the journal is folded, so that the
+# checkpoints are in the journal only. The restart replays the journal of the copy of the
+# master datafile (the restart file cannot be the master datafile itself).
+
+# The core of the build tree and the test modules
+set (ENV{LD_LIBRARY_PATH} ${LIBRARY_PATH}:$ENV{LD_LIBRARY_PATH}:.)
+set (ENV{DYLD_LIBRARY_PATH} ${LIBRARY_PATH}:$ENV{DYLD_LIBRARY_PATH}:.)
+
+message(STATUS "Mechanic path is: ${MECHANIC}")
+
+file(REMOVE mechanic.ice ${MODULE}-master-00.h5 ${MODULE}-master-00.journal
+  ${MODULE}-stopped.h5 ${MODULE}-stopped.journal)
+
+#
+# Task farm: Stop the run (the ICE file, MPI_Abort)
+#
+message(STATUS "Testing the stopped run (task farm)")
+execute_process(COMMAND mpirun -np 4 ${MECHANIC} -p ${MODULE} -n ${MODULE} -x 10 -y 10 -b 3 -d 13 --test
+  --checkpoint-journal=100 --ice-checkpoint=3
+  OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
+
+if (NOT EXISTS mechanic.ice)
+  message(STATUS ${TOUT})
+  message(FATAL_ERROR "The run has not been stopped with the ICE file")
+endif (NOT EXISTS mechanic.ice)
+
+file(READ ${MODULE}-master-00.journal JOURNAL HEX LIMIT 16)
+if (NOT JOURNAL)
+  message(FATAL_ERROR "The journal of the stopped run is empty")
+endif (NOT JOURNAL)
+
+file(REMOVE mechanic.ice)
+configure_file(${MODULE}-master-00.h5 ${MODULE}-stopped.h5 COPYONLY)
+configure_file(${MODULE}-master-00.journal ${MODULE}-stopped.journal COPYONLY)
+
+#
+# Task farm: The restart mode (replay the journal)
+#
+message(STATUS "Testing restart mode with the journal (task farm)")
+execute_process(COMMAND mpirun -np 4 ${MECHANIC} -p ${MODULE} -n ${MODULE} -x 10 -y 10 -b 3 -d 13 --test
+  --checkpoint-journal=100 --ice-checkpoint=0 --restart-mode --restart-file=${MODULE}-stopped.h5
+  OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
+
+if (EOUT)
+  message(STATUS ${TOUT})
+  message(STATUS ${ROUT})
+  message(FATAL_ERROR ${EOUT})
+endif (EOUT)
+
+if (NOT TOUT MATCHES "Journal records replayed")
+  message(STATUS ${TOUT})
+  message(FATAL_ERROR "The journal has not been replayed")
+endif (NOT TOUT MATCHES "Journal records replayed")
+
+execute_process(COMMAND h5diff ${MODULE}-master-00.h5 ${REFERENCES}/${MODULE}-master-00.h5
+  OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
+
+if (TOUT)
+  message(FATAL_ERROR ${TOUT})
+endif (TOUT)
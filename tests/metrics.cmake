@@ -0,0 +1,52 @@
+# The live metrics and the timeline trace (the files of the metrics variant)
+#
+# The metrics file is rewritten by each run of the variant, so that it holds the final
+# counters of the last run (the restart in the master mode). The trace files of the task
+# farm and the master mode are written by the runs of the normal and the restart mode.
+
+set (METRICS ${WORKDIR}/m.prom)
+
+message(STATUS "Testing the metrics file")
+if (NOT EXISTS ${METRICS})
+  message(FATAL_ERROR "The metrics file ${METRICS} has not been written")
+endif (NOT EXISTS ${METRICS})
+
+file(READ ${METRICS} CONTENT)
+foreach (metric "mechanic_pool_size{pool=\"0\"} ${POOL_SIZE}"
+    "mechanic_tasks{pool=\"0\",state=\"completed\"} ${POOL_SIZE}"
+    "mechanic_tasks{pool=\"0\",state=\"in_flight\"} 0"
+    "mechanic_tasks{pool=\"0\",state=\"available\"} 0")
+  string(FIND "${CONTENT}" "${metric}\n" FOUND)
+  if (FOUND LESS 0)
+    message(FATAL_ERROR "The metrics file has no '${metric}'\n${CONTENT}")
+  endif (FOUND LESS 0)
+endforeach (metric)
+
+foreach (name ${MODULE} ${MODULE}-master-mode)
+  set (TRACE ${WORKDIR}/${name}-trace-0000.json)
+
+  message(STATUS "Testing the trace file ${name}-trace-0000.json")
+  if (NOT EXISTS ${TRACE})
+    message(FATAL_ERROR "The trace file ${TRACE} has not been written")
+  endif (NOT EXISTS ${TRACE})
+
+  file(READ ${TRACE} CONTENT)
+
+  # The JSON parser of CMake 3.19
+  if (NOT CMAKE_VERSION VERSION_LESS 3.19)
+    string(JSON EVENTS ERROR_VARIABLE ERROR LENGTH "${CONTENT}" traceEvents)
+    if (ERROR OR EVENTS EQUAL 0)
+      message(FATAL_ERROR "The trace file ${TRACE} is not valid: ${ERROR}")
+    endif (ERROR OR EVENTS EQUAL 0)
+  endif (NOT CMAKE_VERSION VERSION_LESS 3.19)
+
+  # The pool span of the master node, the computed tasks, and the merged events of the
+  # workers (the master node computes the tasks in the master mode)
+  foreach (event "\"name\":\"pool\",[^}]*\"pid\":0," "\"name\":\"TaskProcess\","
+      "\"name\":\"task loop\",[^}]*\"pid\":[1-9]")
+    string(REGEX MATCH "${event}" FOUND "${CONTENT}")
+    if (NOT FOUND)
+      message(FATAL_ERROR "The trace file ${TRACE} has no '${event}' event")
+    endif (NOT FOUND)
+  endforeach (event)
+endforeach (name)
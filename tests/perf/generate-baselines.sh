@@ -0,0 +1,25 @@
+#!/bin/bash
+#
+# Records the micro-benchmark baselines (the ratio of the benchmark time to the time of its
+# reference workload, the slowest of three runs, so that the baselines are not too tight).
+# Run from the tests directory of the build tree (configured with -DBUILD_BENCHMARKS=ON):
+#
+#   ../../tests/perf/generate-baselines.sh > ../../tests/perf/baselines.txt
+#
+# The benchmarks are the perf tests registered in tests/CMakeLists.txt.
+#
+
+BENCHMARKS=$(ctest -N -L perf | sed -n 's/^ *Test *#[0-9]*: perf-//p')
+
+if [ -z "$BENCHMARKS" ]; then
+  echo "No benchmarks found, configure the build tree with -DBUILD_BENCHMARKS=ON" >&2
+  exit 1
+fi
+
+echo "# The micro-benchmark baselines (the time over the time of the reference workload)"
+echo "# Recorded with: mpirun -np 4 mechanic-perf BENCHMARK - 0 -p perf -x 64 -y 64"
+for BENCHMARK in $BENCHMARKS; do
+  for RUN in 1 2 3; do
+    PERF_BASELINES=- ctest -R "^perf-$BENCHMARK\$" -V | grep -oE "(^|[ :])$BENCHMARK [0-9.]+\$" | tail -1
+  done | sed 's/^[ :]*//' | sort -k2 -g | tail -1
+done
@@ -0,0 +1,126 @@
+/**
+ * The micro-benchmark module
+ * ==========================
+ *
+ * The pool and task layout used by the core micro-benchmarks (mechanic-perf). The pool
+ * has one pool bank and two task banks of the storage type given with `--storage`.
+ *
+ * Using the module
+ * ----------------
+ *
+ *    mpirun -np 2 mechanic-perf pack - 1.0 -p perf -x 64 -y 64 --storage=list
+ */
+#include "mechanic.h"
+
+/**
+ * Implements Init()
+ */
+int Init(init *i) {
+  i->banks_per_pool = 1;
+  i->banks_per_task = 2;
+  return SUCCESS;
+}
+
+/**
+ * Implements Setup()
+ */
+int Setup(setup *s) {
+  s->options[0] = (options) {
+    .space="perf", .name="storage", .shortName='\0', .value="pm3d", .type=C_STRING,
+    .description="The storage type of the task banks (pm3d, list, texture, packed, group)"
+  };
+  s->options[1] = (options) {
+    .space="perf", .name="output", .shortName='\0', .value="16", .type=C_INT,
+    .description="The number of elements of the task result bank"
+  };
+  s->options[2] = (options) {
+    .space="perf", .name="input", .shortName='\0', .value="1024", .type=C_INT,
+    .description="The number of elements of the pool bank"
+  };
+  s->options[3] = (options) {
+    .space="perf", .name="step", .shortName='\0', .value="0.1", .type=C_DOUBLE,
+    .description="The option read by the lookup benchmark"
+  };
+  s->options[4] = (options) OPTIONS_END;
+
+  return SUCCESS;
+}
+
+/**
+ * Implements Storage()
+ */
+int Storage(pool *p) {
+  int type = STORAGE_PM3D, rank = 2, output, input;
+  char storage_type[CONFIG_LEN];
+
+  MReadOption(p, "storage", &storage_type);
+  MReadOption(p, "output", &output);
+  MReadOption(p, "input", &input);
+
+  if (strcmp(storage_type, "list") == 0) type = STORAGE_LIST;
+  if (strcmp(storage_type, "texture") == 0) type = STORAGE_TEXTURE;
+  if (strcmp(storage_type, "packed") == 0) type = STORAGE_PACKED;
+  if (strcmp(storage_type, "group") == 0) type = STORAGE_GROUP;
+
+  /* The texture banks have at least the rank of the task board */
+  if (type == STORAGE_TEXTURE) rank = TASK_BOARD_RANK;
+
+  p->storage[0].layout = (schema) {
+    .name = "input",
+    .rank = 2,
+    .dims[0] = 1,
+    .dims[1] = input,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = STORAGE_GROUP,
+    .datatype = H5T_NATIVE_DOUBLE
+  };
+
+  p->task->storage[0].layout = (schema) {
+    .name = "result",
+    .rank = rank,
+    .dims[0] = 1,
+    .dims[1] = output,
+    .dims[2] = 1,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = type,
+    .datatype = H5T_NATIVE_DOUBLE
+  };
+
+  p->task->storage[1].layout = (schema) {
+    .name = "state",
+    .rank = rank,
+    .dims[0] = 1,
+    .dims[1] = 1,
+    .dims[2] = 1,
+    .sync = 1,
+    .use_hdf = 1,
+    .storage_type = type,
+    .datatype = H5T_NATIVE_INT
+  };
+
+  return SUCCESS;
+}
+
+/**
+ * Implements TaskProcess()
+ */
+int TaskProcess(pool *p, task *t) {
+  double *result;
+  int state = t->tid, output, i;
+
+  MReadOption(p, "output", &output);
+
+  result = calloc(output, sizeof(double));
+  if (!result) return CORE_ERR_MEM;
+
+  for (i = 0; i < output; i++) result[i] = t->tid + i;
+
+  MWriteData(t, "result", result);
+  MWriteData(t, "state", &state);
+
+  free(result);
+
+  return TASK_FINALIZE;
+}
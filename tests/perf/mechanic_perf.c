@@ -0,0 +1,910 @@
+/**
+ * @file
+ * The micro-benchmarks of the core hot paths
+ *
+ * Usage:
+ *
+ *    mpirun -np 2 mechanic-perf BENCHMARK BASELINES TOLERANCE [MECHANIC OPTIONS]
+ *
+ * The pool of the given module (i.e. `-p perf`) is prepared as for the task loop, and the
+ * benchmark is timed on the master node (the `setup` benchmark runs on all nodes), together
+ * with its reference workload (the memory copy, the HDF5 write or the MPI broadcast of a
+ * fixed size), which does not depend on the core. The time per operation (the best of
+ * PERF_REPEATS runs) is divided by the time of the reference, so that the ratio does not
+ * depend on the speed of the machine, and compared with the baseline ratio read from the
+ * BASELINES file. The benchmark fails when it exceeds the baseline by more than TOLERANCE
+ * (relative). With BASELINES set to `-` the result is only printed, in the format of the
+ * baselines file.
+ */
+/* usleep() of the idle nodes */
+#if !defined(_DEFAULT_SOURCE)
+  #define _DEFAULT_SOURCE
+#endif
+
+#include <unistd.h>
+
+#include "M2Main.h"
+#include "M2Sprivate.h"
+
+#define PERF_REPEATS 5 /**< The number of timed runs (the best one is used) */
+#define PERF_MIN_TIME 0.05 /**< The minimum time of the timed run (in seconds) */
+#define PERF_SETUP_ITERATIONS 16 /**< The number of Setup() calls of the timed run */
+#define PERF_MASK_STRIDE 8 /**< Every n-th task is available on the masked task board */
+#define PERF_OPTION "step" /**< The module option read by the lookup benchmark */
+#define PERF_POOL_BANK "input" /**< The pool bank committed by the commit benchmark */
+#define PERF_TASK_BANK "result" /**< The task bank read by the lookup benchmark */
+#define PERF_REFERENCE_BYTES 4096 /**< The block size of the memory reference */
+#define PERF_REFERENCE_ELEMENTS 8192 /**< The dataset size of the HDF5 and MPI references */
+#define PERF_REFERENCE_DATASET "perf-reference" /**< The dataset of the HDF5 reference */
+#define PERF_IDLE_SLEEP 1000 /**< The sleep of the idle nodes (in microseconds) */
+
+/**
+ * @struct perf
+ * The state of the benchmark
+ */
+typedef struct perf {
+  module *m; /**< The module pointer */
+  pool **all; /**< The pool bank */
+  pool *p; /**< The current pool */
+  task *t; /**< The task */
+  checkpoint *c; /**< The checkpoint */
+  short ****board; /**< The task board buffer */
+  short *template; /**< The initial state of the task board buffer */
+  unsigned char *buffer; /**< The task message buffer */
+  double *data; /**< The data buffer */
+  int argc; /**< The command line argc (setup benchmark) */
+  char **argv; /**< The command line argv (setup benchmark) */
+  char *filename; /**< The configuration file (setup benchmark) */
+  unsigned char *block; /**< The memory blocks (the memory reference) */
+  double *reference; /**< The data of the HDF5 and MPI references */
+  hid_t dataset; /**< The dataset of the HDF5 reference */
+} perf;
+
+/**
+ * @struct benchmark
+ * The benchmark definition
+ */
+typedef struct {
+  char *name; /**< The benchmark name */
+  char *option; /**< The extra mechanic option (i.e. the storage type) */
+  char *reference; /**< The reference workload of the benchmark */
+  int (*prepare)(perf *s); /**< Prepare the benchmark */
+  double (*run)(perf *s, unsigned long n); /**< Run n operations, return the measured time */
+  int collective; /**< The benchmark runs on all nodes */
+} benchmark;
+
+/**
+ * @brief Prepare the task board buffer
+ *
+ * @param s The benchmark state
+ * @param stride Every stride-th task is available, the others are finished
+ * @param restart Every stride-th task (shifted by one) is to be restarted
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareBoard(perf *s, unsigned int stride, int restart) {
+  unsigned int i = 0;
+  short *cell;
+
+  s->board = AllocateShort4(s->p->board);
+  if (!s->board) Error(CORE_ERR_MEM);
+
+  s->template = calloc(s->p->board->layout.elements, sizeof(short));
+  if (!s->template) Error(CORE_ERR_MEM);
+
+  /* The task board cells are stored as [x][y][z][status, node, cid] */
+  cell = s->template;
+  for (i = 0; i < s->p->board->layout.elements / s->p->board->layout.dims[3]; i++) {
+    cell[0] = (i % stride == 0) ? TASK_AVAILABLE : TASK_FINISHED;
+    if (restart && i % stride == 1) cell[0] = TASK_TO_BE_RESTARTED;
+    cell += s->p->board->layout.dims[3];
+  }
+
+  memcpy(&s->board[0][0][0][0], s->template, s->p->board->layout.elements * sizeof(short));
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Prepare the dense task board (all tasks available)
+ *
+ * @param s The benchmark state
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareDense(perf *s) {
+  return PrepareBoard(s, 1, 0);
+}
+
+/**
+ * @brief Prepare the masked task board (every PERF_MASK_STRIDE-th task available)
+ *
+ * @param s The benchmark state
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareMasked(perf *s) {
+  return PrepareBoard(s, PERF_MASK_STRIDE, 0);
+}
+
+/**
+ * @brief Prepare the restart task board (available, restarted and finished tasks)
+ *
+ * @param s The benchmark state
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareRestart(perf *s) {
+  s->m->mode = RESTART_MODE;
+  return PrepareBoard(s, 4, 1);
+}
+
+/**
+ * @brief Prepare the task message buffer and the packed task
+ *
+ * @param s The benchmark state
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareMessage(perf *s) {
+  int mstat = SUCCESS;
+
+  mstat = PrepareDense(s);
+  CheckStatus(mstat);
+
+  s->buffer = calloc(PackSize(s->p), sizeof(unsigned char));
+  if (!s->buffer) Error(CORE_ERR_MEM);
+
+  mstat = GetNewTask(s->m, s->p, s->t, s->board);
+  CheckStatus(mstat);
+
+  s->t->status = TASK_FINISHED;
+  mstat = Pack(s->m, s->buffer, s->p, s->t, TAG_RESULT);
+  CheckStatus(mstat);
+
+  return mstat;
+}
+
+/**
+ * @brief Prepare the checkpoint
+ *
+ * @param s The benchmark state
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareCheckpoint(perf *s) {
+  int mstat = SUCCESS;
+
+  mstat = PrepareDense(s);
+  CheckStatus(mstat);
+
+  s->c = CheckpointLoad(s->m, s->p, 0);
+
+  return mstat;
+}
+
+/**
+ * @brief Prepare the data buffer of the pool bank
+ *
+ * @param s The benchmark state
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareData(perf *s) {
+  int index;
+
+  index = GetStorageIndex(s->p->storage, PERF_POOL_BANK);
+  if (index < 0) Error(CORE_ERR_SETUP);
+
+  s->data = calloc(s->p->storage[index].layout.elements, sizeof(double));
+  if (!s->data) Error(CORE_ERR_MEM);
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Run the GetNewTask() sweeps over the task board
+ *
+ * The task board is restored when no more tasks are available.
+ *
+ * @param s The benchmark state
+ * @param n The number of tasks to get
+ *
+ * @return The measured time
+ */
+static double RunGetNewTask(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  int mstat = SUCCESS;
+  double start, time = 0.0;
+
+  for (i = 0; i < n; i++) {
+    start = MPI_Wtime();
+    mstat = GetNewTask(s->m, s->p, s->t, s->board);
+    time += MPI_Wtime() - start;
+
+    if (mstat == NO_MORE_TASKS) {
+      memcpy(&s->board[0][0][0][0], s->template, s->p->board->layout.elements * sizeof(short));
+      s->t->tid = 0;
+      continue;
+    }
+
+    s->board[s->t->location[0]][s->t->location[1]][s->t->location[2]][0] = TASK_IN_USE;
+  }
+
+  return time;
+}
+
+/**
+ * @brief Run the Pack() operations
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunPack(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  double start;
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    Pack(s->m, s->buffer, s->p, s->t, TAG_RESULT);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the Unpack() operations
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunUnpack(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  int tag;
+  double start;
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    Unpack(s->m, s->buffer, s->p, s->t, &tag);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the checkpoint flushes
+ *
+ * Each checkpoint is filled with the packed task results (not timed), and flushed with
+ * CheckpointProcess().
+ *
+ * @param s The benchmark state
+ * @param n The number of checkpoint flushes
+ *
+ * @return The measured time
+ */
+static double RunCheckpoint(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  unsigned int tid = 0;
+  int mstat = SUCCESS;
+  double start, time = 0.0;
+
+  for (i = 0; i < n; i++) {
+    while (s->c->counter < s->c->size) {
+      s->t->tid = tid;
+      memcpy(&s->board[0][0][0][0], s->template, s->p->board->layout.elements * sizeof(short));
+      mstat = GetNewTask(s->m, s->p, s->t, s->board);
+      CheckStatus(mstat);
+
+      s->t->status = TASK_FINISHED;
+      mstat = Pack(s->m, s->c->storage->memory + s->c->counter * s->c->storage->layout.size,
+          s->p, s->t, TAG_RESULT);
+      CheckStatus(mstat);
+
+      s->c->counter++;
+      tid = (tid + 1) % s->p->pool_size;
+    }
+
+    start = MPI_Wtime();
+    mstat = CheckpointProcess(s->m, s->p, s->c);
+    time += MPI_Wtime() - start;
+    CheckStatus(mstat);
+
+    CheckpointReset(s->m, s->p, s->c, s->c->cid + 1);
+  }
+
+  return time;
+}
+
+/**
+ * @brief Run the CommitData() of the pool banks
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunCommit(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  int mstat = SUCCESS;
+  hid_t h5pool;
+  double start;
+
+  h5pool = SessionPool(s->m, s->p);
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    mstat = CommitData(h5pool, s->p->pool_banks, s->p->storage);
+    CheckStatus(mstat);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the M2TaskLoad() and TaskFinalize() pairs
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunTaskLoad(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  task *t;
+  double start;
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    t = M2TaskLoad(s->m, s->p, i % s->p->pool_size);
+    TaskFinalize(s->m, s->p, t);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the MReadOption() lookups
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunReadOption(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  double start, step = 0.0;
+  pool *p = s->p;
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    MReadOption(p, PERF_OPTION, &step);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the MReadData() lookups
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunReadData(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  double start;
+  pool *p = s->p;
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    MReadData(p, PERF_POOL_BANK, s->data);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the MReadOptionH() reads (the option resolved once)
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunReadOptionHandle(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  double start, step = 0.0;
+  pool *p = s->p;
+  optionHandle h;
+
+  MOptionHandle(p, PERF_OPTION, &h);
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    MReadOptionH(p, h, &step);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the MReadDataH() reads (the storage bank resolved once)
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunReadDataHandle(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  double start;
+  pool *p = s->p;
+  storageHandle h;
+
+  MStorageHandle(p, PERF_POOL_BANK, &h);
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    MReadDataH(p, h, s->data);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the module Setup() (the configuration broadcast to all nodes)
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunSetup(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  int mstat = SUCCESS;
+  double start, time = 0.0;
+
+  for (i = 0; i < n; i++) {
+    if (s->m->layer->setup->popt->poptcontext) {
+      poptFreeContext(s->m->layer->setup->popt->poptcontext);
+      s->m->layer->setup->popt->poptcontext = NULL;
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    start = MPI_Wtime();
+    mstat = Setup(s->m, s->filename, s->argc, s->argv, MODULE_SETUP);
+    time += MPI_Wtime() - start;
+    CheckStatus(mstat);
+  }
+
+  return time;
+}
+
+/**
+ * @brief Prepare the memory blocks of the memory reference
+ *
+ * @param s The benchmark state
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareMemory(perf *s) {
+  unsigned int i = 0;
+
+  s->block = calloc(2 * PERF_REFERENCE_BYTES, sizeof(unsigned char));
+  if (!s->block) Error(CORE_ERR_MEM);
+
+  for (i = 0; i < PERF_REFERENCE_BYTES; i++) s->block[i] = (unsigned char) i;
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Prepare the reference data (and the dataset of the HDF5 reference)
+ *
+ * @param s The benchmark state
+ *
+ * @return 0 on success, error code otherwise
+ */
+static int PrepareReference(perf *s) {
+  unsigned int i = 0;
+  hsize_t dims[1] = {PERF_REFERENCE_ELEMENTS};
+  hid_t h5pool, h5dataspace;
+
+  s->reference = calloc(PERF_REFERENCE_ELEMENTS, sizeof(double));
+  if (!s->reference) Error(CORE_ERR_MEM);
+
+  for (i = 0; i < PERF_REFERENCE_ELEMENTS; i++) s->reference[i] = i;
+
+  if (s->m->node == MASTER) {
+    h5pool = SessionPool(s->m, s->p);
+
+    h5dataspace = H5Screate_simple(1, dims, NULL);
+    H5CheckStatus(h5dataspace);
+
+    s->dataset = H5Dcreate(h5pool, PERF_REFERENCE_DATASET, H5T_NATIVE_DOUBLE, h5dataspace,
+        H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5CheckStatus(s->dataset);
+
+    H5Sclose(h5dataspace);
+  }
+
+  return SUCCESS;
+}
+
+/**
+ * @brief Run the memory reference (the copy and the checksum of the memory block)
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunMemory(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  unsigned int j = 0, sum = 0;
+  double start;
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    memcpy(s->block + PERF_REFERENCE_BYTES, s->block, PERF_REFERENCE_BYTES);
+    for (j = 0; j < PERF_REFERENCE_BYTES; j++) sum += s->block[PERF_REFERENCE_BYTES + j];
+    s->block[i % PERF_REFERENCE_BYTES] = (unsigned char) sum;
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the HDF5 reference (the write of the reference dataset and the file flush)
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunHDF5(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  int mstat = SUCCESS;
+  herr_t h5status;
+  double start;
+
+  start = MPI_Wtime();
+  for (i = 0; i < n; i++) {
+    h5status = H5Dwrite(s->dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+        s->reference);
+    H5CheckStatus(h5status);
+
+    mstat = SessionFlush(s->m);
+    CheckStatus(mstat);
+  }
+
+  return MPI_Wtime() - start;
+}
+
+/**
+ * @brief Run the MPI reference (the broadcast of the reference data to all nodes)
+ *
+ * @param s The benchmark state
+ * @param n The number of operations
+ *
+ * @return The measured time
+ */
+static double RunMPI(perf *s, unsigned long n) {
+  unsigned long i = 0;
+  double start, time = 0.0;
+
+  for (i = 0; i < n; i++) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    start = MPI_Wtime();
+    MPI_Bcast(s->reference, PERF_REFERENCE_ELEMENTS, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+    time += MPI_Wtime() - start;
+  }
+
+  return time;
+}
+
+/* The benchmarks */
+static benchmark benchmarks[] = {
+  {"pack", NULL, "memory", PrepareMessage, RunPack, 0},
+  {"unpack", NULL, "memory", PrepareMessage, RunUnpack, 0},
+  {"getnewtask-dense", NULL, "memory", PrepareDense, RunGetNewTask, 0},
+  {"getnewtask-masked", NULL, "memory", PrepareMasked, RunGetNewTask, 0},
+  {"getnewtask-restart", NULL, "memory", PrepareRestart, RunGetNewTask, 0},
+  {"checkpoint-pm3d", "--storage=pm3d", "hdf5", PrepareCheckpoint, RunCheckpoint, 0},
+  {"checkpoint-list", "--storage=list", "hdf5", PrepareCheckpoint, RunCheckpoint, 0},
+  {"checkpoint-texture", "--storage=texture", "hdf5", PrepareCheckpoint, RunCheckpoint, 0},
+  {"checkpoint-packed", "--storage=packed", "hdf5", PrepareCheckpoint, RunCheckpoint, 0},
+  {"checkpoint-group", "--storage=group", "hdf5", PrepareCheckpoint, RunCheckpoint, 0},
+  {"commit", NULL, "hdf5", NULL, RunCommit, 0},
+  {"taskload", NULL, "memory", NULL, RunTaskLoad, 0},
+  {"readoption", NULL, "memory", NULL, RunReadOption, 0},
+  {"readoption-handle", NULL, "memory", NULL, RunReadOptionHandle, 0},
+  {"readdata", NULL, "memory", PrepareData, RunReadData, 0},
+  {"readdata-handle", NULL, "memory", PrepareData, RunReadDataHandle, 0},
+  {"setup", NULL, "mpi", NULL, RunSetup, 1},
+  {NULL, NULL, NULL, NULL, NULL, 0}
+};
+
+/* The reference workloads (not compared with the baselines) */
+static benchmark references[] = {
+  {"memory", NULL, NULL, PrepareMemory, RunMemory, 0},
+  {"hdf5", NULL, NULL, PrepareReference, RunHDF5, 0},
+  {"mpi", NULL, NULL, PrepareReference, RunMPI, 1},
+  {NULL, NULL, NULL, NULL, NULL, 0}
+};
+
+/**
+ * @brief Time the benchmark
+ *
+ * The number of operations is doubled until the run takes at least PERF_MIN_TIME, and
+ * the best of PERF_REPEATS runs is used. The collective benchmarks use the fixed number
+ * of operations, so that all nodes make the same calls.
+ *
+ * @param s The benchmark state
+ * @param b The benchmark
+ *
+ * @return The time per operation (in nanoseconds)
+ */
+static double Measure(perf *s, benchmark *b) {
+  unsigned long n = 1;
+  int i = 0;
+  double time, best = -1.0;
+
+  if (b->collective) {
+    n = PERF_SETUP_ITERATIONS;
+  } else {
+    while (b->run(s, n) < PERF_MIN_TIME) n *= 2;
+  }
+
+  for (i = 0; i < PERF_REPEATS; i++) {
+    time = b->run(s, n);
+    if (best < 0 || time < best) best = time;
+  }
+
+  return best / n * 1e9;
+}
+
+/**
+ * @brief Wait for all nodes
+ *
+ * The nodes that do not run the benchmark wait here without the busy polling of the
+ * blocking MPI calls, so that they do not take the CPU from the master node.
+ *
+ * @param node The node ID
+ */
+static void Idle(int node) {
+  MPI_Request request;
+  int done = 0;
+
+  MPI_Ibarrier(MPI_COMM_WORLD, &request);
+  while (!done) {
+    MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+    if (!done && node != MASTER) usleep(PERF_IDLE_SLEEP);
+  }
+}
+
+/**
+ * @brief Read the baseline of the benchmark
+ *
+ * The baselines file contains one `name ratio` pair per line (the time of the benchmark
+ * over the time of its reference), lines starting with `#` are comments.
+ *
+ * @param filename The baselines file
+ * @param name The benchmark name
+ *
+ * @return The baseline ratio, negative if not found
+ */
+static double Baseline(char *filename, char *name) {
+  FILE *f;
+  char line[CONFIG_LEN], key[CONFIG_LEN];
+  double value, baseline = -1.0;
+
+  f = fopen(filename, "r");
+  if (!f) {
+    Message(MESSAGE_ERR, "The baselines file '%s' could not be opened\n", filename);
+    return baseline;
+  }
+
+  while (fgets(line, CONFIG_LEN, f)) {
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%127s %lf", key, &value) == 2 && strcmp(key, name) == 0) {
+      baseline = value;
+      break;
+    }
+  }
+
+  fclose(f);
+
+  return baseline;
+}
+
+int main(int argc, char **argv) {
+  int mpi_rank, mpi_size, node, i = 0, margc = 0, result = EXIT_SUCCESS;
+  int mstat = SUCCESS;
+  module *core = NULL, *m = NULL;
+  benchmark *b = NULL, *r = NULL;
+  char **margv = NULL, *filename = NULL, *journal = NULL;
+  double tolerance, baseline, time, reference, ratio;
+  hid_t h5location;
+  perf s;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+  node = mpi_rank;
+
+  if (argc < 4) {
+    if (node == MASTER) {
+      Message(MESSAGE_ERR, "Usage: mechanic-perf BENCHMARK BASELINES TOLERANCE [MECHANIC OPTIONS]\n");
+    }
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  for (b = benchmarks; b->name; b++) {
+    if (strcmp(b->name, argv[1]) == 0) break;
+  }
+
+  if (!b->name) {
+    if (node == MASTER) Message(MESSAGE_ERR, "Unknown benchmark '%s'\n", argv[1]);
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  for (r = references; r->name; r++) {
+    if (strcmp(r->name, b->reference) == 0) break;
+  }
+
+  tolerance = strtod(argv[3], NULL);
+
+  /* The mechanic options, with the benchmark option appended */
+  margv = calloc(argc, sizeof(char*));
+  if (!margv) Error(CORE_ERR_MEM);
+
+  margv[margc++] = argv[0];
+  for (i = 4; i < argc; i++) margv[margc++] = argv[i];
+  if (b->option) margv[margc++] = b->option;
+
+  H5open();
+
+  /* Bootstrap and configure the core and the module, as the mechanic does */
+  core = Bootstrap(node, mpi_size, margc, margv, CORE_MODULE, NULL);
+  core->mode = NORMAL_MODE;
+
+  filename = Name(Option2String("core", "config", core->layer->setup->head), "", "", "");
+  mstat = Setup(core, filename, margc, margv, CORE_SETUP);
+  CheckStatus(mstat);
+  free(filename);
+
+  m = Bootstrap(node, mpi_size, margc, margv, Option2String("core", "module", core->layer->setup->head), core);
+  m->mode = core->mode;
+
+  filename = Name(Option2String("core", "config", m->layer->setup->head), "", "", "");
+  mstat = Setup(m, filename, margc, margv, MODULE_SETUP);
+  CheckStatus(mstat);
+
+  if (node == MASTER) {
+    core->filename = Name(Option2String("core", "name", m->layer->setup->head), "-master", "-00", ".h5");
+    m->filename = Name(Option2String("core", "name", m->layer->setup->head), "-master", "-00", ".h5");
+
+    h5location = H5Fcreate(m->filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    H5CheckStatus(h5location);
+    H5Fclose(h5location);
+
+    journal = JournalName(m->filename);
+    unlink(journal);
+    free(journal);
+  }
+
+  /* Prepare the pool as for the task loop */
+  mstat = M2Prepare(m);
+  CheckStatus(mstat);
+
+  memset(&s, 0, sizeof(perf));
+  s.m = m;
+  s.argc = margc;
+  s.argv = margv;
+  s.filename = filename;
+
+  s.all = calloc(m->layer->init->pools, sizeof(pool*));
+  if (!s.all) Error(CORE_ERR_MEM);
+
+  for (i = 0; i < (int) m->layer->init->pools; i++) {
+    s.all[i] = PoolLoad(m, i);
+  }
+  s.p = s.all[0];
+
+  Storage(m, s.p);
+
+  mstat = PoolReset(m, s.p);
+  CheckStatus(mstat);
+
+  mstat = M2NodePrepare(m, s.all, s.p);
+  CheckStatus(mstat);
+
+  mstat = PoolPrepare(m, s.all, s.p);
+  CheckStatus(mstat);
+
+  s.t = M2TaskLoad(m, s.p, 0);
+
+  /* Run the benchmark between two runs of the reference workload (the faster one is used) */
+  time = reference = 0.0;
+  if (node == MASTER || b->collective) {
+    mstat = r->prepare(&s);
+    CheckStatus(mstat);
+    reference = Measure(&s, r);
+
+    if (b->prepare) {
+      mstat = b->prepare(&s);
+      CheckStatus(mstat);
+    }
+    time = Measure(&s, b);
+    m->mode = NORMAL_MODE;
+
+    ratio = Measure(&s, r);
+    if (ratio < reference) reference = ratio;
+  }
+
+  Idle(node);
+
+  if (node == MASTER) {
+    ratio = time / reference;
+    Message(MESSAGE_INFO, "%s: %.1f ns/op, %s reference: %.1f ns/op\n",
+        b->name, time, r->name, reference);
+
+    if (strcmp(argv[2], "-") == 0) {
+      printf("%s %.6f\n", b->name, ratio);
+    } else {
+      baseline = Baseline(argv[2], b->name);
+      if (baseline <= 0) {
+        Message(MESSAGE_ERR, "No baseline for the '%s' benchmark\n", b->name);
+        result = EXIT_FAILURE;
+      } else {
+        Message(MESSAGE_INFO, "%s: ratio %.6f (baseline %.6f, limit %.6f)\n",
+            b->name, ratio, baseline, baseline * (1.0 + tolerance));
+        if (ratio > baseline * (1.0 + tolerance)) {
+          Message(MESSAGE_ERR, "%s: performance regression, %.1f%% slower than the baseline\n",
+              b->name, 100.0 * (ratio / baseline - 1.0));
+          result = EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  MPI_Bcast(&result, 1, MPI_INT, MASTER, MPI_COMM_WORLD);
+
+  /* Finalize */
+  if (s.c) CheckpointFinalize(m, s.p, s.c);
+  if (s.dataset > 0) H5Dclose(s.dataset);
+  TaskFinalize(m, s.p, s.t);
+  if (node == MASTER) SessionClose(m);
+
+  for (i = 0; i < (int) m->layer->init->pools; i++) {
+    PoolFinalize(m, s.all[i]);
+  }
+
+  free(s.all);
+  free(s.board);
+  free(s.template);
+  free(s.buffer);
+  free(s.data);
+  free(s.block);
+  free(s.reference);
+  free(filename);
+  free(margv);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  ModuleFinalize(core);
+  ModuleFinalize(m);
+
+  H5close();
+  MPI_Finalize();
+
+  return result;
+}
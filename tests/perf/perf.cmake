@@ -0,0 +1,25 @@
+#
+# Runs the micro-benchmark (ctest -L perf)
+#
+# The library path is set when the test runs (not when CMake configures), so that the
+# core, the runtime modes and the modules of the build tree are loaded. The PERF_BASELINES
+# environment variable overrides the baselines file, i.e. `-` only prints the result (see
+# generate-baselines.sh).
+#
+set (ENV{LD_LIBRARY_PATH} ${LIBRARY_PATH}:$ENV{LD_LIBRARY_PATH})
+set (ENV{DYLD_LIBRARY_PATH} ${LIBRARY_PATH}:$ENV{DYLD_LIBRARY_PATH})
+
+if (DEFINED ENV{PERF_BASELINES})
+  set (BASELINES $ENV{PERF_BASELINES})
+endif (DEFINED ENV{PERF_BASELINES})
+
+execute_process(COMMAND mpirun -np 4 ${MECHANIC_PERF} ${BENCHMARK} ${BASELINES} ${TOLERANCE}
+  -p perf -n perf-${BENCHMARK} -x 64 -y 64
+  OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
+
+message(STATUS ${TOUT})
+
+if (ROUT)
+  message(STATUS ${EOUT})
+  message(FATAL_ERROR "The benchmark ${BENCHMARK} failed (${ROUT})")
+endif (ROUT)
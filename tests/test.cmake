@@ -1,13 +1,62 @@
-set (ENV{LD_LIBRARY_PATH} $ENV{LD_LIBRARY_PATH}:.)
-set (ENV{DYLD_LIBRARY_PATH} $ENV{DYLD_LIBRARY_PATH}:.)
+# The core, the runtime modes and the core module of the build tree (LIBRARY_PATH), and the
+# test modules, so that the tests do not load the installed core. The variants run in their
+# own working directories, so that the test module directory is passed in LIBRARY_PATH too
+set (ENV{LD_LIBRARY_PATH} ${LIBRARY_PATH}:$ENV{LD_LIBRARY_PATH}:.)
+set (ENV{DYLD_LIBRARY_PATH} ${LIBRARY_PATH}:$ENV{DYLD_LIBRARY_PATH}:.)
 
 message(STATUS "Mechanic path is: ${MECHANIC}")
 
+# The variant options of the core (-DARGS="--option=value ...")
+separate_arguments(ARGS)
+
+# The reference datafiles
+if (NOT REFERENCES)
+  set (REFERENCES references)
+endif (NOT REFERENCES)
+
+# The datasets of each pool that are not compared with the references (-DEXCLUDE="board ...")
+separate_arguments(EXCLUDE)
+
+# The stream datasets (-DSTREAMS="events ...") are appended in the order of the task
+# messages, which differs between the runs, so that they are compared task by task
+# (mechanic-extract selects the records of the task through the stream index)
+separate_arguments(STREAMS)
+foreach (dataset ${STREAMS})
+  list(APPEND EXCLUDE Tasks/${dataset} Tasks/${dataset}-index)
+endforeach (dataset)
+
+function(compare_streams datafile reference)
+  foreach (dataset ${STREAMS})
+    foreach (tid RANGE 99)
+      execute_process(COMMAND ${EXTRACT} -d ${dataset} -t ${tid} -F csv ${datafile}
+        OUTPUT_VARIABLE DATA RESULT_VARIABLE RDATA)
+      execute_process(COMMAND ${EXTRACT} -d ${dataset} -t ${tid} -F csv ${reference}
+        OUTPUT_VARIABLE REFERENCE RESULT_VARIABLE RREFERENCE)
+      if (RDATA OR RREFERENCE OR NOT DATA STREQUAL REFERENCE)
+        message(FATAL_ERROR "The records of the task ${tid} differ in the stream ${dataset}")
+      endif (RDATA OR RREFERENCE OR NOT DATA STREQUAL REFERENCE)
+    endforeach (tid)
+  endforeach (dataset)
+endfunction(compare_streams)
+
+set (EXCLUDE_PATHS)
+foreach (dataset ${EXCLUDE})
+  list(APPEND EXCLUDE_PATHS --exclude-path /Pools/last/${dataset})
+  foreach (pid RANGE 63)
+    if (pid LESS 10)
+      set (pid 000${pid})
+    else (pid LESS 10)
+      set (pid 00${pid})
+    endif (pid LESS 10)
+    list(APPEND EXCLUDE_PATHS --exclude-path /Pools/pool-${pid}/${dataset})
+  endforeach (pid)
+endforeach (dataset)
+
 #
 # Task farm: The normal mode
 #
 message(STATUS "Testing normal mode (task farm)")
-execute_process(COMMAND mpirun -np 4 ${MECHANIC} -p ${MODULE} -n ${MODULE} -x 10 -y 10 -b 3 -d 13 --test
+execute_process(COMMAND mpirun -np 4 ${MECHANIC} -p ${MODULE} -n ${MODULE} -x 10 -y 10 -b 3 -d 13 --test ${ARGS}
   --restart-file=${MODULE}-master-02.h5
   OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
 
@@ -17,19 +66,21 @@ if (EOUT)
   message(FATAL_ERROR ${EOUT})
 endif (EOUT)
 
-execute_process(COMMAND h5diff ${MODULE}-master-00.h5 references/${MODULE}-master-00.h5
+execute_process(COMMAND h5diff ${EXCLUDE_PATHS} ${MODULE}-master-00.h5 ${REFERENCES}/${MODULE}-master-00.h5
   OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
 
 if (TOUT)
   message(FATAL_ERROR ${TOUT})
 endif (TOUT)
 
+compare_streams(${MODULE}-master-00.h5 ${REFERENCES}/${MODULE}-master-00.h5)
+
 #
 # Task farm: The restart mode
 #
 message(STATUS "Testing restart mode (task farm)")
 execute_process(COMMAND 
-  mpirun -np 4 ${MECHANIC} -p ${MODULE} -n ${MODULE} -x 10 -y 10 -b 3 -d 13 --test
+  mpirun -np 4 ${MECHANIC} -p ${MODULE} -n ${MODULE} -x 10 -y 10 -b 3 -d 13 --test ${ARGS}
   --restart-mode --restart-file=${MODULE}-master-02.h5
   OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
 
@@ -39,19 +90,21 @@ if (EOUT)
   message(FATAL_ERROR ${EOUT})
 endif (EOUT)
 
-execute_process(COMMAND h5diff ${MODULE}-master-00.h5 references/${MODULE}-master-00.h5
+execute_process(COMMAND h5diff ${EXCLUDE_PATHS} ${MODULE}-master-00.h5 ${REFERENCES}/${MODULE}-master-00.h5
   OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
 
 if (TOUT)
   message(FATAL_ERROR ${TOUT})
 endif (TOUT)
 
+compare_streams(${MODULE}-master-00.h5 ${REFERENCES}/${MODULE}-master-00.h5)
+
 #
 # Master: The normal mode
 #
 message(STATUS "Testing normal mode (master)")
 execute_process(COMMAND 
-  mpirun -np 4 ${MECHANIC} -m master -p ${MODULE} -n ${MODULE}-master-mode -x 10 -y 10 -b 3 -d 13 --test
+  mpirun -np 4 ${MECHANIC} -m master -p ${MODULE} -n ${MODULE}-master-mode -x 10 -y 10 -b 3 -d 13 --test ${ARGS}
   --restart-file=${MODULE}-master-mode-master-02.h5
   OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
 
@@ -61,20 +114,22 @@ if (EOUT)
   message(FATAL_ERROR ${EOUT})
 endif (EOUT)
 
-execute_process(COMMAND h5diff ${MODULE}-master-mode-master-00.h5
-  references/${MODULE}-master-mode-master-00.h5
+execute_process(COMMAND h5diff ${EXCLUDE_PATHS} ${MODULE}-master-mode-master-00.h5
+  ${REFERENCES}/${MODULE}-master-mode-master-00.h5
   OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
 
 if (TOUT)
   message(FATAL_ERROR ${TOUT})
 endif (TOUT)
 
+compare_streams(${MODULE}-master-mode-master-00.h5 ${REFERENCES}/${MODULE}-master-mode-master-00.h5)
+
 #
 # Master: The restart mode
 #
 message(STATUS "Testing restart mode (master)")
 execute_process(COMMAND 
-  mpirun -np 4 ${MECHANIC} -m master -p ${MODULE} -n ${MODULE}-master-mode -x 10 -y 10 -b 3 -d 13 --test
+  mpirun -np 4 ${MECHANIC} -m master -p ${MODULE} -n ${MODULE}-master-mode -x 10 -y 10 -b 3 -d 13 --test ${ARGS}
   --restart-mode --restart-file=${MODULE}-master-mode-master-02.h5
   OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
 
@@ -84,11 +139,12 @@ if (EOUT)
   message(FATAL_ERROR ${EOUT})
 endif (EOUT)
 
-execute_process(COMMAND h5diff ${MODULE}-master-mode-master-00.h5
-  references/${MODULE}-master-mode-master-00.h5
+execute_process(COMMAND h5diff ${EXCLUDE_PATHS} ${MODULE}-master-mode-master-00.h5
+  ${REFERENCES}/${MODULE}-master-mode-master-00.h5
   OUTPUT_VARIABLE TOUT RESULT_VARIABLE ROUT ERROR_VARIABLE EOUT)
 
 if (TOUT)
   message(FATAL_ERROR ${TOUT})
 endif (TOUT)
 
+compare_streams(${MODULE}-master-mode-master-00.h5 ${REFERENCES}/${MODULE}-master-mode-master-00.h5)